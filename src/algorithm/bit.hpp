@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <type_traits>
 
 namespace lib
@@ -52,4 +53,65 @@ template <typename T> inline unsigned countrZero(T x)
 #endif
 }
 
+template <typename T> inline unsigned countlZero(T x)
+{
+  static_assert(std::is_unsigned<T>::value, "countl_zero requires unsigned type");
+
+  if (x == 0)
+    return std::numeric_limits<T>::digits;
+
+#if defined(__clang__) || defined(__GNUC__)
+  if (sizeof(T) <= sizeof(unsigned int))
+    return __builtin_clz(static_cast<unsigned int>(x)) - (std::numeric_limits<unsigned int>::digits - std::numeric_limits<T>::digits);
+  else if (sizeof(T) <= sizeof(unsigned long))
+    return __builtin_clzl(static_cast<unsigned long>(x)) - (std::numeric_limits<unsigned long>::digits - std::numeric_limits<T>::digits);
+  else
+    return __builtin_clzll(static_cast<unsigned long long>(x)) - (std::numeric_limits<unsigned long long>::digits - std::numeric_limits<T>::digits);
+
+#elif defined(_MSC_VER)
+  unsigned long index;
+
+  if (sizeof(T) <= sizeof(unsigned long))
+  {
+    _BitScanReverse(&index, static_cast<unsigned long>(x));
+    return std::numeric_limits<T>::digits - 1 - static_cast<unsigned>(index);
+  }
+  else
+  {
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanReverse64(&index, static_cast<unsigned long long>(x));
+    return std::numeric_limits<T>::digits - 1 - static_cast<unsigned>(index);
+#else
+    // 32-bit MSVC fallback
+    unsigned long high = static_cast<unsigned long>(x >> 32);
+    if (high != 0)
+    {
+      _BitScanReverse(&index, high);
+      return 31 - static_cast<unsigned>(index);
+    }
+    _BitScanReverse(&index, static_cast<unsigned long>(x));
+    return 63 - static_cast<unsigned>(index);
+#endif
+  }
+#else
+  // Portable fallback
+  unsigned n = 0;
+  T mask = T(1) << (std::numeric_limits<T>::digits - 1);
+
+  while ((x & mask) == 0)
+  {
+    mask >>= 1;
+    n++;
+  }
+
+  return n;
+#endif
+}
+
+// Number of bits needed to represent x, zero for x == 0.
+template <typename T> inline unsigned bitWidth(T x)
+{
+  return std::numeric_limits<T>::digits - countlZero(x);
+}
+
 } // namespace lib
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "AsyncManager.hpp"
+#include "memory/SystemMemoryManager.hpp"
 #include "os/hqos.hpp"
 
 using namespace async;
@@ -52,6 +53,8 @@ void AsyncManager::init(void (*entry)(), SystemSettings settings)
     workerThreads.emplace_back(
         [&threadInitialization]()
         {
+          lib::memory::SystemMemoryManager::initializeThread();
+
           os::hqos::setHighQos();
           threadInitialization();
 
@@ -69,6 +72,8 @@ void AsyncManager::init(void (*entry)(), SystemSettings settings)
 
           workerJob->deref();
           jobAllocator->deinitializeThread();
+
+          lib::memory::SystemMemoryManager::finializeThread();
         });
 
     workerThreads.back().setAffinity(i % os::Thread::getHardwareConcurrency());
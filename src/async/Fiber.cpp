@@ -72,6 +72,7 @@
 // }
 
 #include "Fiber.hpp"
+#include "memory/AllocationTracker.hpp"
 #include "os/print.hpp"
 #include <cassert>
 #include <sys/resource.h>
@@ -147,6 +148,13 @@ static void fiber_entry(fcontext_transfer_t t)
 
 // ================= Fiber lifecycle =================
 
+// Stacks are mapped by fcontext, they are accounted apart from SystemMemoryManager.
+static uint16_t stackAllocationTag()
+{
+  static const uint16_t tag = lib::memory::AllocationTracker::registerTag("fiber stacks");
+  return tag;
+}
+
 Fiber::Fiber() = default;
 
 Fiber::Fiber(Handler h, void *ud, size_t ssize, bool prefault) : handler(h), userData(ud)
@@ -159,6 +167,8 @@ Fiber::Fiber(Handler h, void *ud, size_t ssize, bool prefault) : handler(h), use
   stack = create_fcontext_stack(allocSize);
   ctx = make_fcontext(stack.sptr, stack.ssize, fiber_entry);
 
+  lib::memory::AllocationTracker::recordExternal(stackAllocationTag(), stack.ssize);
+
   stack_size = stack.ssize;
   isThreadFiber = false;
 
@@ -177,6 +187,7 @@ Fiber::~Fiber()
 {
   if (stack.sptr)
   {
+    lib::memory::AllocationTracker::releaseExternal(stackAllocationTag(), stack.ssize);
     destroy_fcontext_stack(&stack);
   }
 
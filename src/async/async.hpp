@@ -41,6 +41,18 @@ inline static void shutdown()
   detail::AsyncManager::shutdown();
 }
 
+// True between init and stop, jobs can only be enqueued and waited on while it holds.
+inline static bool isRunning()
+{
+  return detail::AsyncManager::isRunning.load();
+}
+
+// True when called from a job, threads outside the job system can not wait on promises.
+inline static bool isInJob()
+{
+  return Job::currentJob != nullptr && Job::currentJob->manager != nullptr;
+}
+
 inline static void yield()
 {
   detail::AsyncManager::yield();
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "AtomicLock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lib
+{
+
+// Bounded cache of expensive objects keyed by their content, split in shards that each run the CLOCK algorithm.
+//
+// acquire returns the cached value for a key, or builds it with the given factory outside of any lock, and pins the
+// entry until the matching release. Pinned entries are never evicted. Released entries stay cached so the next
+// acquire of the same key is a hit, and are handed to the eviction callback in CLOCK order once the cost of their
+// shard goes over its share of the budget. Lookups only lock the shard owning the key.
+template <typename K, typename V, typename Hasher = std::hash<K>> class ConcurrentBoundedCache
+{
+public:
+  using EvictCallback = std::function<void(const K &, V &)>;
+
+private:
+  struct Slot
+  {
+    K key;
+    V value;
+    size_t cost;
+    uint32_t pins;
+    bool referenced;
+    bool used;
+  };
+
+  struct alignas(64) Shard
+  {
+    AtomicLock lock;
+    std::unordered_map<K, size_t, Hasher> index;
+    std::vector<Slot> slots;
+    std::vector<size_t> freeSlots;
+    size_t hand = 0;
+    size_t cost = 0;
+  };
+
+  Hasher hasher;
+  EvictCallback onEvict;
+  size_t shardBudget;
+  std::vector<Shard> shards;
+
+  std::atomic<uint64_t> hitCount;
+  std::atomic<uint64_t> missCount;
+  std::atomic<uint64_t> evictionCount;
+
+  Shard &shardFor(const K &key)
+  {
+    // The low bits pick the bucket inside the shard's index, use the high ones here.
+    size_t hash = hasher(key);
+    return shards[(hash ^ (hash >> 32)) % shards.size()];
+  }
+
+  // Inserts a pinned entry, shard lock must be held.
+  void place(Shard &shard, const K &key, V &&value, size_t cost)
+  {
+    size_t slot;
+
+    if (shard.freeSlots.size())
+    {
+      slot = shard.freeSlots.back();
+      shard.freeSlots.pop_back();
+      shard.slots[slot] = Slot{key, std::move(value), cost, 1, true, true};
+    }
+    else
+    {
+      slot = shard.slots.size();
+      shard.slots.push_back(Slot{key, std::move(value), cost, 1, true, true});
+    }
+
+    shard.index[key] = slot;
+    shard.cost += cost;
+  }
+
+  // Sweeps the clock hand until the shard fits its budget or only pinned entries are left, shard lock must be held.
+  void shrink(Shard &shard, size_t budget, std::vector<std::pair<K, V>> &evicted)
+  {
+    size_t steps = 0;
+
+    while (shard.cost > budget && steps < 2 * shard.slots.size())
+    {
+      Slot &slot = shard.slots[shard.hand];
+      shard.hand = (shard.hand + 1) % shard.slots.size();
+      steps++;
+
+      if (!slot.used || slot.pins > 0)
+      {
+        continue;
+      }
+
+      if (slot.referenced)
+      {
+        slot.referenced = false;
+        continue;
+      }
+
+      shard.index.erase(slot.key);
+      shard.freeSlots.push_back(&slot - shard.slots.data());
+      shard.cost -= slot.cost;
+
+      slot.used = false;
+      evicted.emplace_back(std::move(slot.key), std::move(slot.value));
+      steps = 0;
+    }
+  }
+
+  void evict(std::vector<std::pair<K, V>> &evicted)
+  {
+    evictionCount.fetch_add(evicted.size(), std::memory_order_relaxed);
+
+    if (onEvict)
+    {
+      for (auto &[key, value] : evicted)
+      {
+        onEvict(key, value);
+      }
+    }
+  }
+
+public:
+  ConcurrentBoundedCache(size_t budget, EvictCallback onEvict, size_t shardCount = 16)
+      : onEvict(std::move(onEvict)), shardBudget(budget / (shardCount ? shardCount : 1)), shards(shardCount ? shardCount : 1), hitCount(0), missCount(0), evictionCount(0)
+  {
+  }
+
+  ~ConcurrentBoundedCache()
+  {
+    clear();
+  }
+
+  ConcurrentBoundedCache(const ConcurrentBoundedCache &) = delete;
+  ConcurrentBoundedCache &operator=(const ConcurrentBoundedCache &) = delete;
+
+  // Returns the value cached for key, or the first element of create(), a std::pair<V, size_t> of the value and its
+  // cost, and pins it. When two threads miss on the same key the value built last is evicted right away.
+  template <typename F> V acquire(const K &key, F &&create)
+  {
+    Shard &shard = shardFor(key);
+
+    {
+      std::lock_guard<AtomicLock> guard(shard.lock);
+      auto it = shard.index.find(key);
+
+      if (it != shard.index.end())
+      {
+        Slot &slot = shard.slots[it->second];
+        slot.pins += 1;
+        slot.referenced = true;
+        hitCount.fetch_add(1, std::memory_order_relaxed);
+        return slot.value;
+      }
+    }
+
+    missCount.fetch_add(1, std::memory_order_relaxed);
+
+    std::pair<V, size_t> created = create();
+    std::vector<std::pair<K, V>> evicted;
+    V result;
+
+    {
+      std::lock_guard<AtomicLock> guard(shard.lock);
+      auto it = shard.index.find(key);
+
+      if (it != shard.index.end())
+      {
+        Slot &slot = shard.slots[it->second];
+        slot.pins += 1;
+        slot.referenced = true;
+        result = slot.value;
+        evicted.emplace_back(key, std::move(created.first));
+      }
+      else
+      {
+        result = created.first;
+        place(shard, key, std::move(created.first), created.second);
+        shrink(shard, shardBudget, evicted);
+      }
+    }
+
+    evict(evicted);
+    return result;
+  }
+
+  // Unpins an entry acquired before, returns false if key is not cached.
+  bool release(const K &key)
+  {
+    Shard &shard = shardFor(key);
+    std::vector<std::pair<K, V>> evicted;
+
+    {
+      std::lock_guard<AtomicLock> guard(shard.lock);
+      auto it = shard.index.find(key);
+
+      if (it == shard.index.end() || shard.slots[it->second].pins == 0)
+      {
+        return false;
+      }
+
+      shard.slots[it->second].pins -= 1;
+      shrink(shard, shardBudget, evicted);
+    }
+
+    evict(evicted);
+    return true;
+  }
+
+  bool contains(const K &key)
+  {
+    Shard &shard = shardFor(key);
+    std::lock_guard<AtomicLock> guard(shard.lock);
+    return shard.index.find(key) != shard.index.end();
+  }
+
+  // Evicts every entry that is not pinned.
+  void clear()
+  {
+    for (Shard &shard : shards)
+    {
+      std::vector<std::pair<K, V>> evicted;
+
+      {
+        std::lock_guard<AtomicLock> guard(shard.lock);
+
+        for (Slot &slot : shard.slots)
+        {
+          if (slot.used && slot.pins == 0)
+          {
+            shard.index.erase(slot.key);
+            shard.freeSlots.push_back(&slot - shard.slots.data());
+            shard.cost -= slot.cost;
+
+            slot.used = false;
+            evicted.emplace_back(std::move(slot.key), std::move(slot.value));
+          }
+        }
+      }
+
+      evict(evicted);
+    }
+  }
+
+  size_t size()
+  {
+    size_t count = 0;
+
+    for (Shard &shard : shards)
+    {
+      std::lock_guard<AtomicLock> guard(shard.lock);
+      count += shard.index.size();
+    }
+
+    return count;
+  }
+
+  size_t cost()
+  {
+    size_t total = 0;
+
+    for (Shard &shard : shards)
+    {
+      std::lock_guard<AtomicLock> guard(shard.lock);
+      total += shard.cost;
+    }
+
+    return total;
+  }
+
+  uint64_t hits() const
+  {
+    return hitCount.load(std::memory_order_relaxed);
+  }
+
+  uint64_t misses() const
+  {
+    return missCount.load(std::memory_order_relaxed);
+  }
+
+  uint64_t evictions() const
+  {
+    return evictionCount.load(std::memory_order_relaxed);
+  }
+};
+
+} // namespace lib
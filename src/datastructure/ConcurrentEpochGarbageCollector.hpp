@@ -3,6 +3,9 @@
 #include "MarkedAtomicPointer.hpp"
 #include "ThreadLocalStorage.hpp"
 #include "algorithm/bit.hpp"
+#include "memory/AllocationTracker.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/SystemAllocator.hpp"
 #include "os/Thread.hpp"
 #include "os/print.hpp"
 #include <algorithm>
@@ -20,11 +23,27 @@
 namespace lib
 {
 
-template <typename T, uint32_t CacheSize = 8> class ConcurrentEpochGarbageCollector
+// SizeClasses > 1 enables allocateSized, used by types with a variable length tail (e.g. skip list towers)
+// that only construct a prefix of T. Each class keeps its own per thread cache, allocate() always uses the
+// last class, which holds a complete T.
+//
+// Allocator hands out the node memory in bytes, e.g. SystemAllocator<uint8_t> or SlabAllocator<uint8_t>, and every
+// node is returned with the size it was allocated with. Thread records are few and stay on SystemMemoryManager.
+template <typename T, uint32_t CacheSize = 8, uint32_t SizeClasses = 1, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>>
+class ConcurrentEpochGarbageCollector
 {
   friend struct EpochGuard;
 
 private:
+  Allocator allocator;
+
+  // Nodes are charged to one tag shared by every collector, retired nodes stay charged until reclaimed.
+  void *allocateNode(size_t size)
+  {
+    static const uint16_t allocationTag = lib::memory::AllocationTracker::registerTag("epoch gc");
+    lib::memory::AllocationTagScope tagScope(allocationTag);
+    return allocator.allocate(size);
+  }
 
 public:
   using Epoch = uint64_t;
@@ -32,14 +51,17 @@ public:
   {
     Allocation *next;
     std::atomic<Epoch> epoch;
+    uint32_t sizeClass;
+    // Bytes requested from the allocator, fits in the padding before data.
+    uint32_t bytes;
     T data;
 
     template <typename... Args, typename = std::enable_if_t<std::is_constructible_v<T, Args...>>>
-    explicit Allocation(Epoch e, Args &&...args) : next(nullptr), epoch(e), data(std::forward<Args>(args)...)
+    explicit Allocation(Epoch e, Args &&...args) : next(nullptr), epoch(e), sizeClass(SizeClasses - 1), data(std::forward<Args>(args)...)
     {
     }
 
-    Allocation()
+    Allocation() : sizeClass(SizeClasses - 1)
     {
       epoch.store(0, std::memory_order_relaxed);
       new (&data) T();
@@ -60,8 +82,8 @@ public:
     Allocation *retiredListHead;
     Allocation *retiredListTail;
 
-    Allocation *cache;
-    uint64_t cacheSize;
+    Allocation *cache[SizeClasses];
+    uint64_t cacheSize[SizeClasses];
 
     void free(Allocation *ptr)
     {
@@ -144,16 +166,7 @@ public:
       os::print("[%u] freeing %p freed at epoch %u during epoch %u\n", os::Thread::getCurrentThreadId(), curr, curr->epoch.load(std::memory_order_relaxed), minimum);
 #endif
 
-      if (record->cacheSize < CacheSize)
-      {
-        curr->next = record->cache;
-        record->cache = curr;
-        record->cacheSize += 1;
-      }
-      else
-      {
-        free(static_cast<void *>(curr));
-      }
+      recycle(record, curr);
     }
 
     if (record->retiredListHead == nullptr)
@@ -162,6 +175,36 @@ public:
     }
   }
 
+  void recycle(ThreadRecord *record, Allocation *curr)
+  {
+    uint32_t sizeClass = curr->sizeClass;
+
+    if (record->cacheSize[sizeClass] < CacheSize)
+    {
+      curr->next = record->cache[sizeClass];
+      record->cache[sizeClass] = curr;
+      record->cacheSize[sizeClass] += 1;
+    }
+    else
+    {
+      freeNode(curr);
+    }
+  }
+
+  void freeNode(Allocation *allocation)
+  {
+    allocator.deallocate(reinterpret_cast<uint8_t *>(allocation), allocation->bytes);
+  }
+
+  static void initializeCaches(ThreadRecord *record)
+  {
+    for (uint32_t i = 0; i < SizeClasses; i++)
+    {
+      record->cache[i] = nullptr;
+      record->cacheSize[i] = 0;
+    }
+  }
+
   void releaseThreadRecord(ThreadRecord *record)
   {
     release(record);
@@ -181,14 +224,14 @@ public:
 public:
   struct EpochGuard
   {
-    friend class ConcurrentEpochGarbageCollector<T, CacheSize>;
+    friend class ConcurrentEpochGarbageCollector<T, CacheSize, SizeClasses, Allocator>;
 
   private:
     ThreadRecord *record;
-    ConcurrentEpochGarbageCollector<T, CacheSize> *gc;
+    ConcurrentEpochGarbageCollector<T, CacheSize, SizeClasses, Allocator> *gc;
 
   public:
-    EpochGuard(ThreadRecord *r, ConcurrentEpochGarbageCollector<T, CacheSize> *gc) : record(r), gc(gc)
+    EpochGuard(ThreadRecord *r, ConcurrentEpochGarbageCollector<T, CacheSize, SizeClasses, Allocator> *gc) : record(r), gc(gc)
     {
       if (record)
       {
@@ -319,8 +362,7 @@ public:
       newNode->retiredListTail = nullptr;
       newNode->active.store(false);
       newNode->refCount.store(0, std::memory_order_relaxed);
-      newNode->cache = nullptr;
-      newNode->cacheSize = 0;
+      initializeCaches(newNode);
 
       if (i + 1 <= initialRecordsSize)
       {
@@ -358,19 +400,21 @@ public:
 #ifdef CONCURRENT_EGC_DEBUG_LOG
         os::print("[%u] freeing %p\n", os::Thread::getCurrentThreadId(), h);
 #endif
-        free(static_cast<void *>(h));
+        freeNode(h);
 
         curr->retiredListHead = next;
       }
 
       curr->retiredListTail = nullptr;
 
-      while (curr->cache)
+      for (uint32_t i = 0; i < SizeClasses; i++)
       {
-        auto next = curr->cache->next;
-        curr->cache->data.~T();
-        free(static_cast<void *>(curr->cache));
-        curr->cache = next;
+        while (curr->cache[i])
+        {
+          auto next = curr->cache[i]->next;
+          freeNode(curr->cache[i]);
+          curr->cache[i] = next;
+        }
       }
 
       ThreadRecord *begin = recordsCache;
@@ -378,7 +422,7 @@ public:
 
       if (curr < begin || curr >= end)
       {
-        free(static_cast<void *>(curr));
+        lib::memory::SystemMemoryManager::free(static_cast<void *>(curr));
       }
 
       curr = succ;
@@ -424,14 +468,13 @@ public:
 
     if (newNode == nullptr)
     {
-      newNode = new ThreadRecord();
+      newNode = new (lib::memory::SystemMemoryManager::alignedAlloc(alignof(ThreadRecord), sizeof(ThreadRecord))) ThreadRecord();
 
       newNode->retiredSize = 0;
       newNode->retiredListHead = nullptr;
       newNode->retiredListTail = nullptr;
       newNode->refCount.store(0, std::memory_order_relaxed);
-      newNode->cache = nullptr;
-      newNode->cacheSize = 0;
+      initializeCaches(newNode);
       newNode->active.store(true);
 
       ThreadRecord *oldNext = head->next.load();
@@ -478,16 +521,7 @@ public:
 #ifdef CONCURRENT_EGC_DEBUG_LOG
           os::print("[%u] freeing %p freed at epoch %u during epoch %u\n", os::Thread::getCurrentThreadId(), curr, curr->epoch.load(std::memory_order_relaxed), minimum);
 #endif
-          if (record->cacheSize < CacheSize)
-          {
-            curr->next = record->cache;
-            record->cache = curr;
-            record->cacheSize += 1;
-          }
-          else
-          {
-            free(static_cast<void *>(curr));
-          }
+          recycle(record, curr);
         }
 
         if (record->retiredListHead == nullptr)
@@ -515,7 +549,8 @@ public:
     //   return &reused->data;
     // }
 
-    Allocation *allocation = new Allocation(UINT64_MAX); // (Allocation *)malloc(sizeof(Allocation));
+    Allocation *allocation = new (allocateNode(sizeof(Allocation))) Allocation(UINT64_MAX);
+    allocation->bytes = sizeof(Allocation);
 #ifdef CONCURRENT_EGC_DEBUG_LOG
     os::print("[%u] allocating %p\n", os::Thread::getCurrentThreadId(), allocation);
 #endif
@@ -525,13 +560,14 @@ public:
 
   template <typename... Args> T *allocate(EpochGuard &scope, Args &&...args)
   {
-    if (scope.record->cache != nullptr)
+    if (scope.record->cache[SizeClasses - 1] != nullptr)
     {
-      Allocation *reused = scope.record->cache;
-      scope.record->cache = reused->next;
-      scope.record->cacheSize -= 1;
+      Allocation *reused = scope.record->cache[SizeClasses - 1];
+      scope.record->cache[SizeClasses - 1] = reused->next;
+      scope.record->cacheSize[SizeClasses - 1] -= 1;
 
       new (reused) Allocation(UINT64_MAX, std::forward<Args>(args)...);
+      reused->bytes = sizeof(Allocation);
 #ifdef CONCURRENT_EGC_DEBUG_LOG
       os::print("[%u] allocating %p\n", os::Thread::getCurrentThreadId(), reused);
 #endif
@@ -539,7 +575,41 @@ public:
     }
 
     static_assert(std::is_constructible_v<T, Args...>, "T must be constructible from the provided arguments");
-    Allocation *allocation = new Allocation(UINT64_MAX, std::forward<Args>(args)...);
+    Allocation *allocation = new (allocateNode(sizeof(Allocation))) Allocation(UINT64_MAX, std::forward<Args>(args)...);
+    allocation->bytes = sizeof(Allocation);
+#ifdef CONCURRENT_EGC_DEBUG_LOG
+    os::print("[%u] allocating %p\n", os::Thread::getCurrentThreadId(), allocation);
+#endif
+    return &allocation->data;
+  }
+
+  // Allocates from sizeClass only size bytes of T, the constructor must not touch memory past that.
+  // Allocations of the same class must always request the same size.
+  template <typename... Args> T *allocateSized(EpochGuard &scope, uint32_t sizeClass, size_t size, Args &&...args)
+  {
+    static_assert(std::is_constructible_v<T, Args...>, "T must be constructible from the provided arguments");
+    assert(sizeClass < SizeClasses);
+
+    size_t bytes = offsetof(Allocation, data) + size;
+    Allocation *allocation = scope.record->cache[sizeClass];
+
+    if (allocation != nullptr)
+    {
+      scope.record->cache[sizeClass] = allocation->next;
+      scope.record->cacheSize[sizeClass] -= 1;
+    }
+    else
+    {
+      allocation = static_cast<Allocation *>(allocateNode(bytes));
+    }
+
+    // Only the header and T fit in size bytes, constructing a whole Allocation would write past them.
+    allocation->next = nullptr;
+    new (&allocation->epoch) std::atomic<Epoch>(UINT64_MAX);
+    allocation->sizeClass = sizeClass;
+    allocation->bytes = static_cast<uint32_t>(bytes);
+    new (&allocation->data) T(std::forward<Args>(args)...);
+
 #ifdef CONCURRENT_EGC_DEBUG_LOG
     os::print("[%u] allocating %p\n", os::Thread::getCurrentThreadId(), allocation);
 #endif
@@ -547,6 +617,7 @@ public:
   }
 };
 
-template <typename T, uint32_t C> typename ConcurrentEpochGarbageCollector<T, C>::EpochGuard nullGuard = {nullptr, nullptr};
+template <typename T, uint32_t C, uint32_t S = 1, typename A = lib::memory::allocator::SystemAllocator<uint8_t>>
+typename ConcurrentEpochGarbageCollector<T, C, S, A>::EpochGuard nullGuard = {nullptr, nullptr};
 
 } // namespace lib
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "datastructure/AtomicLock.hpp"
+#include "os/Thread.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace lib
+{
+
+// Relaxed priority queue, the MultiQueue of Rihani, Sanders and Dementiev.
+//
+// Elements are spread over c * threads sequential binary heaps, each protected by a try-lock. Enqueue pushes to
+// a random heap, dequeue samples two random heaps and pops from the one with the smaller top priority. Threads
+// rarely touch the same heap, so throughput scales close to linearly, at the cost of dequeue only returning an
+// element with a small expected rank instead of the minimum. Lower priorities are dequeued first, as in
+// ConcurrentPriorityQueue.
+template <typename T, typename P = size_t> class ConcurrentMultiQueue
+{
+  static thread_local uint32_t seed;
+
+  static constexpr P EMPTY_PRIORITY = std::numeric_limits<P>::max();
+
+  struct Entry
+  {
+    P priority;
+    T value;
+  };
+
+  struct EntryGreater
+  {
+    bool operator()(const Entry &a, const Entry &b) const
+    {
+      return a.priority > b.priority;
+    }
+  };
+
+  struct alignas(64) Heap
+  {
+    AtomicLock lock;
+    // Priority of the top entry, read without the lock to pick between the two sampled heaps.
+    std::atomic<P> top;
+    std::vector<Entry> entries;
+
+    Heap() : top(EMPTY_PRIORITY)
+    {
+    }
+
+    void push(const T &value, P priority)
+    {
+      entries.push_back(Entry{priority, value});
+      std::push_heap(entries.begin(), entries.end(), EntryGreater());
+      top.store(entries.front().priority, std::memory_order_relaxed);
+    }
+
+    void pop(T &out)
+    {
+      std::pop_heap(entries.begin(), entries.end(), EntryGreater());
+      out = std::move(entries.back().value);
+      entries.pop_back();
+      top.store(entries.empty() ? EMPTY_PRIORITY : entries.front().priority, std::memory_order_relaxed);
+    }
+  };
+
+  Heap *heaps;
+  size_t heapsCount;
+
+  uint32_t xorshift32()
+  {
+    if (seed == 0)
+    {
+      seed = static_cast<uint32_t>(os::Thread::getCurrentThreadId()) | 1;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  inline size_t randomHeap()
+  {
+    return xorshift32() % heapsCount;
+  }
+
+  // Blocking pop from the first non empty heap, used once sampling keeps hitting empty heaps.
+  bool dequeueScan(T &out)
+  {
+    size_t start = randomHeap();
+
+    for (size_t i = 0; i < heapsCount; i++)
+    {
+      Heap &heap = heaps[(start + i) % heapsCount];
+
+      if (heap.top.load(std::memory_order_relaxed) == EMPTY_PRIORITY)
+      {
+        continue;
+      }
+
+      heap.lock.lock();
+
+      if (!heap.entries.empty())
+      {
+        heap.pop(out);
+        heap.lock.unlock();
+        return true;
+      }
+
+      heap.lock.unlock();
+    }
+
+    return false;
+  }
+
+public:
+  // queuesPerThread is the c factor, higher values lower contention and increase the rank error.
+  ConcurrentMultiQueue(size_t queuesPerThread = 2, size_t threads = os::Thread::getHardwareConcurrency())
+  {
+    heapsCount = std::max<size_t>(2, queuesPerThread * std::max<size_t>(1, threads));
+    heaps = new Heap[heapsCount];
+  }
+
+  ~ConcurrentMultiQueue()
+  {
+    delete[] heaps;
+  }
+
+  ConcurrentMultiQueue(const ConcurrentMultiQueue &) = delete;
+  ConcurrentMultiQueue &operator=(const ConcurrentMultiQueue &) = delete;
+
+  bool enqueue(const T &value, P priority)
+  {
+    assert(priority != EMPTY_PRIORITY);
+
+    while (true)
+    {
+      Heap &heap = heaps[randomHeap()];
+
+      if (heap.lock.tryLock())
+      {
+        heap.push(value, priority);
+        heap.lock.unlock();
+        return true;
+      }
+    }
+  }
+
+  // Returns false only if every heap was observed empty.
+  bool dequeue(T &out)
+  {
+    for (size_t attempt = 0; attempt < heapsCount; attempt++)
+    {
+      Heap &a = heaps[randomHeap()];
+      Heap &b = heaps[randomHeap()];
+
+      P pa = a.top.load(std::memory_order_relaxed);
+      P pb = b.top.load(std::memory_order_relaxed);
+
+      if (pa == EMPTY_PRIORITY && pb == EMPTY_PRIORITY)
+      {
+        continue;
+      }
+
+      Heap &heap = pa <= pb ? a : b;
+
+      if (!heap.lock.tryLock())
+      {
+        continue;
+      }
+
+      if (heap.entries.empty())
+      {
+        heap.lock.unlock();
+        continue;
+      }
+
+      heap.pop(out);
+      heap.lock.unlock();
+      return true;
+    }
+
+    return dequeueScan(out);
+  }
+
+  // Approximate, other threads may be modifying the heaps.
+  bool isEmpty() const
+  {
+    for (size_t i = 0; i < heapsCount; i++)
+    {
+      if (heaps[i].top.load(std::memory_order_relaxed) != EMPTY_PRIORITY)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+template <typename T, typename P> thread_local uint32_t ConcurrentMultiQueue<T, P>::seed = 0;
+
+} // namespace lib
@@ -10,11 +10,13 @@
 #include <cstddef>
 
 #include <type_traits>
+#include <utility>
 
 namespace lib
 {
 
-template <typename T, uint64_t CacheSize = 128> class ConcurrentQueue
+// Allocator hands out node memory in bytes, see ConcurrentEpochGarbageCollector.
+template <typename T, uint64_t CacheSize = 128, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> class ConcurrentQueue
 {
 private:
   struct Node
@@ -30,14 +32,45 @@ private:
     Node(const T &v) : next(nullptr), value(v)
     {
     }
+
+    Node(T &&v) : next(nullptr), value(std::move(v))
+    {
+    }
   };
 
-  ConcurrentEpochGarbageCollector<Node, CacheSize> garbageCollector;
+  ConcurrentEpochGarbageCollector<Node, CacheSize, 1, Allocator> garbageCollector;
 
   std::atomic<Node *> head;
   std::atomic<Node *> tail;
   std::atomic<uint32_t> size;
 
+  // Appends a node at the tail, the caller holds an epoch guard.
+  void link(Node *newNode)
+  {
+    while (true)
+    {
+      Node *last = tail.load(std::memory_order_acquire);
+      Node *next = last->next.load(std::memory_order_acquire);
+
+      if (last == tail.load(std::memory_order_acquire))
+      {
+        if (next == nullptr)
+        {
+          if (last->next.compare_exchange_weak(next, newNode, std::memory_order_release, std::memory_order_relaxed))
+          {
+            tail.compare_exchange_weak(last, newNode, std::memory_order_release, std::memory_order_relaxed);
+            size.fetch_add(1);
+            return;
+          }
+        }
+        else
+        {
+          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
 public:
   template <typename U = T, typename = std::enable_if_t<std::is_default_constructible_v<U>>> ConcurrentQueue() : size(0)
   {
@@ -99,30 +132,13 @@ public:
   void enqueue(const T &value)
   {
     auto scope = garbageCollector.openEpochGuard();
-    Node *newNode = garbageCollector.allocate(scope, value);
-
-    while (true)
-    {
-      Node *last = tail.load(std::memory_order_acquire);
-      Node *next = last->next.load(std::memory_order_acquire);
+    link(garbageCollector.allocate(scope, value));
+  }
 
-      if (last == tail.load(std::memory_order_acquire))
-      {
-        if (next == nullptr)
-        {
-          if (last->next.compare_exchange_weak(next, newNode, std::memory_order_release, std::memory_order_relaxed))
-          {
-            tail.compare_exchange_weak(last, newNode, std::memory_order_release, std::memory_order_relaxed);
-            size.fetch_add(1);
-            return;
-          }
-        }
-        else
-        {
-          tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
-        }
-      }
-    }
+  void enqueue(T &&value)
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    link(garbageCollector.allocate(scope, std::move(value)));
   }
 
   bool dequeue(T &out)
@@ -172,7 +188,7 @@ public:
   }
 };
 
-template <typename T, uint64_t CacheSize = 128> class ConcurrentShardedQueue
+template <typename T, uint64_t CacheSize = 128, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> class ConcurrentShardedQueue
 {
 public:
   ConcurrentShardedQueue() : threadLists(), localLists()
@@ -185,7 +201,7 @@ public:
 
   void enqueue(T value)
   {
-    ConcurrentQueue<T, CacheSize> *local = nullptr;
+    ConcurrentQueue<T, CacheSize, Allocator> *local = nullptr;
 
     if (!localLists.get(local))
     {
@@ -200,7 +216,7 @@ public:
 
   bool dequeue(T &value)
   {
-    ConcurrentQueue<T, CacheSize> *local = nullptr;
+    ConcurrentQueue<T, CacheSize, Allocator> *local = nullptr;
 
     localLists.get(local);
 
@@ -226,8 +242,8 @@ public:
   }
 
 private:
-  ConcurrentLinkedList<ConcurrentQueue<T, CacheSize>> threadLists;
-  ThreadLocalStorage<ConcurrentQueue<T, CacheSize> *> localLists;
+  ConcurrentLinkedList<ConcurrentQueue<T, CacheSize, Allocator>> threadLists;
+  ThreadLocalStorage<ConcurrentQueue<T, CacheSize, Allocator> *> localLists;
 };
 
 } // namespace lib
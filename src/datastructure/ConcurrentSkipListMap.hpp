@@ -1,7 +1,9 @@
-
+#pragma once
 #include "HazardPointer.hpp"
 #include "algorithm/bit.hpp"
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <bit>
 #include <functional>
 #include <limits>
@@ -27,23 +29,57 @@ namespace lib
 
 #define CONCURRENT_EGC_CACHE_SIZE 16
 
-template <typename K, typename V, size_t MAX_LEVEL = 16> struct ConcurrentSkipListMapNode
+// Nodes are allocated from size classes, class c holds a tower of min(2^c, MAX_LEVEL + 1) next pointers,
+// so a node of level l only pays for the pointers of its class instead of MAX_LEVEL + 1.
+constexpr uint32_t skipListSizeClasses(size_t maxLevel)
 {
-private:
+  uint32_t classes = 1;
+
+  while (maxLevel)
+  {
+    maxLevel >>= 1;
+    classes++;
+  }
 
+  return classes;
+}
+
+template <typename K, typename V, size_t MAX_LEVEL = 16, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> struct ConcurrentSkipListMapNode
+{
 public:
-  using Node = ConcurrentSkipListMapNode<K, V, MAX_LEVEL>;
-  using GC = ConcurrentEpochGarbageCollector<Node, CONCURRENT_EGC_CACHE_SIZE>;
+  using Node = ConcurrentSkipListMapNode<K, V, MAX_LEVEL, Allocator>;
 
-  std::atomic<uint32_t> refCount; // Own cache line
-  MarkedAtomicPointer<Node> next[MAX_LEVEL + 1];
+  static constexpr uint32_t SIZE_CLASSES = skipListSizeClasses(MAX_LEVEL);
 
-  char pad[256 - sizeof(bool) - sizeof(uint32_t) - sizeof(MarkedAtomicPointer<Node>) * (MAX_LEVEL + 1)];
+  using GC = ConcurrentEpochGarbageCollector<Node, CONCURRENT_EGC_CACHE_SIZE, SIZE_CLASSES, Allocator>;
 
+  std::atomic<uint32_t> refCount;
   uint32_t level;
   K key;
   V value;
-  const char *debug[MAX_LEVEL + 1];
+
+  // Must stay the last member, only the first towerSize(sizeClass(level)) entries are backed by memory.
+  alignas(MarkedAtomicPointer<Node>) unsigned char tower[sizeof(MarkedAtomicPointer<Node>) * (MAX_LEVEL + 1)];
+
+  static inline uint32_t sizeClass(uint32_t level)
+  {
+    return lib::bitWidth(level);
+  }
+
+  static inline size_t towerSize(uint32_t sizeClass)
+  {
+    return std::min<size_t>(size_t(1) << sizeClass, MAX_LEVEL + 1);
+  }
+
+  static inline size_t sizeFor(uint32_t level)
+  {
+    return offsetof(Node, tower) + sizeof(MarkedAtomicPointer<Node>) * towerSize(sizeClass(level));
+  }
+
+  inline MarkedAtomicPointer<Node> &next(uint32_t level)
+  {
+    return reinterpret_cast<MarkedAtomicPointer<Node> *>(tower)[level];
+  }
 
   // std::atomic<bool> freed;
 
@@ -87,7 +123,7 @@ public:
 
       for (int i = 0; i <= level; i++)
       {
-        next[i].load()->refSub(1, scope);
+        next(i).load()->refSub(1, scope);
       }
 
       scope.retire(this);
@@ -99,11 +135,11 @@ public:
     return expected;
   }
 
-  ConcurrentSkipListMapNode(const K &k, const V &v, uint32_t level) : key(k), value(v), refCount(1), level(level)
+  ConcurrentSkipListMapNode(const K &k, const V &v, uint32_t level) : refCount(1), level(level), key(k), value(v)
   {
     for (int i = 0; i <= level; ++i)
     {
-      next[i].store(nullptr, std::memory_order_relaxed);
+      new (&next(i)) MarkedAtomicPointer<Node>();
     }
   }
 
@@ -118,11 +154,11 @@ public:
   {
     for (int i = 0; i <= level; ++i)
     {
-      next[i].store(nullptr, std::memory_order_relaxed);
+      new (&next(i)) MarkedAtomicPointer<Node>();
     }
   }
 
-  ConcurrentSkipListMapNode<K, V, MAX_LEVEL> *get(uint32_t level, Node *prev = nullptr, uint32_t l = 0)
+  Node *get(uint32_t level, Node *prev = nullptr, uint32_t l = 0)
   {
     // if (freed.load())
     // {
@@ -133,10 +169,10 @@ public:
     //   *t = 3;
     // }
     // assert(!freed.load());
-    return next[level].getReference();
+    return next(level).getReference();
   }
 
-  ConcurrentSkipListMapNode<K, V, MAX_LEVEL> *get(uint32_t level, bool &marked, Node *prev = nullptr, uint32_t l = 0)
+  Node *get(uint32_t level, bool &marked, Node *prev = nullptr, uint32_t l = 0)
   {
     // if (freed.load())
     // {
@@ -147,7 +183,7 @@ public:
     //   *t = 3;
     //   // exit(1);
     // }
-    auto p = next[level].get();
+    auto p = next(level).get();
     marked = p.second;
     return p.first;
   }
@@ -180,9 +216,9 @@ public:
   //   return 0;
   // }
 
-  bool setNext(uint32_t level, ConcurrentSkipListMapNode<K, V, MAX_LEVEL> *expected, ConcurrentSkipListMapNode<K, V, MAX_LEVEL> *to, typename GC::EpochGuard &scope)
+  bool setNext(uint32_t level, Node *expected, Node *to, typename GC::EpochGuard &scope)
   {
-    if (next[level].compare_exchange_strong(expected, to, std::memory_order_release, std::memory_order_acquire))
+    if (next(level).compare_exchange_strong(expected, to, std::memory_order_release, std::memory_order_acquire))
     {
       // to->debug[level] = debug;
       return true;
@@ -191,11 +227,12 @@ public:
   }
 };
 
-template <typename K, typename V, size_t MAX_LEVEL = 16> class ConcurrentSkipListMap
+// Allocator hands out node memory in bytes, see ConcurrentEpochGarbageCollector.
+template <typename K, typename V, size_t MAX_LEVEL = 16, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> class ConcurrentSkipListMap
 {
 private:
-  using Node = ConcurrentSkipListMapNode<K, V, MAX_LEVEL>;
-  using GC = ConcurrentEpochGarbageCollector<Node, CONCURRENT_EGC_CACHE_SIZE>;
+  using Node = ConcurrentSkipListMapNode<K, V, MAX_LEVEL, Allocator>;
+  using GC = typename Node::GC;
 
   GC epochGarbageCollector;
 
@@ -234,7 +271,8 @@ private:
   //     return std::min((int)MAX_LEVEL, level);
   // }
 
-  template <bool NeedSuccs = true> Node *find(const K &key, Node **preds, Node **succs, typename GC::EpochGuard &scope)
+  // Returns the first node with a key greater or equal to key, or tail if there is none.
+  template <bool NeedSuccs = true> Node *findGreaterOrEqual(const K &key, Node **preds, Node **succs, typename GC::EpochGuard &scope)
   {
     Node *curr = nullptr, *pred = nullptr;
     bool isMarked = false;
@@ -289,8 +327,35 @@ private:
       }
     }
 
+    return curr;
+  }
+
+  template <bool NeedSuccs = true> Node *find(const K &key, Node **preds, Node **succs, typename GC::EpochGuard &scope)
+  {
+    Node *curr = findGreaterOrEqual<NeedSuccs>(key, preds, succs, scope);
     return curr->key == key ? curr : nullptr;
   }
+
+  // Returns the first node after node on level 0 that is not logically deleted, or tail.
+  static Node *nextUnmarked(Node *node, Node *tail)
+  {
+    bool marked = false;
+    Node *curr = node->get(0);
+
+    while (curr != tail)
+    {
+      curr->get(0, marked);
+
+      if (!marked)
+      {
+        break;
+      }
+
+      curr = curr->get(0);
+    }
+
+    return curr;
+  }
   void clearInternal(typename GC::EpochGuard &scope)
   {
     bool marked = false;
@@ -351,7 +416,7 @@ public:
 
   class Iterator
   {
-    template <typename A, typename B, size_t C> friend class ConcurrentSkipListMap;
+    template <typename A, typename B, size_t C, typename D> friend class ConcurrentSkipListMap;
 
   private:
     Node *current;
@@ -520,7 +585,7 @@ public:
     Node *preds[MAX_LEVEL + 1] = {};
     Node *succs[MAX_LEVEL + 1] = {};
 
-    Node *newNode = epochGarbageCollector.allocate(scope, key, value, topLevel);
+    Node *newNode = epochGarbageCollector.allocateSized(scope, Node::sizeClass(topLevel), Node::sizeFor(topLevel), key, value, topLevel);
 
     while (true)
     {
@@ -549,7 +614,7 @@ public:
 
       for (int level = 0; level <= topLevel; ++level)
       {
-        newNode->next[level].store(succs[level]); //(level, nullptr, succs[level], scope, "insert/newNode linking");
+        newNode->next(level).store(succs[level]); //(level, nullptr, succs[level], scope, "insert/newNode linking");
       }
 
       Node *pred = preds[0];
@@ -741,6 +806,207 @@ public:
     return Iterator(found, tail, scope, false);
   }
 
+  // First element with a key greater or equal to key.
+  Iterator lowerBound(const K &key)
+  {
+    auto scope = epochGarbageCollector.openEpochGuard();
+
+    Node *found = findGreaterOrEqual<false>(key, nullptr, nullptr, scope);
+
+    return Iterator(found, tail, scope, false);
+  }
+
+  // First element with a key greater than key.
+  Iterator upperBound(const K &key)
+  {
+    auto scope = epochGarbageCollector.openEpochGuard();
+
+    Node *found = findGreaterOrEqual<false>(key, nullptr, nullptr, scope);
+
+    if (found != tail && found->key == key)
+    {
+      found = nextUnmarked(found, tail);
+    }
+
+    return Iterator(found, tail, scope, false);
+  }
+
+  // Elements with keys in [from, to). The range holds a single epoch guard for the whole scan,
+  // its iterators don't open or copy guards.
+  class Range
+  {
+    template <typename A, typename B, size_t C, typename D> friend class ConcurrentSkipListMap;
+
+  private:
+    typename GC::EpochGuard scope;
+    Node *first;
+    Node *tail;
+    K to;
+
+    Range(typename GC::EpochGuard &&scope, Node *first, Node *tail, const K &to) : scope(std::move(scope)), first(first), tail(tail), to(to)
+    {
+    }
+
+  public:
+    class Iterator
+    {
+      friend class Range;
+
+    private:
+      Node *current;
+      Node *tail;
+      const K *to;
+
+      Iterator(Node *current, Node *tail, const K *to) : current(current), tail(tail), to(to)
+      {
+        clamp();
+      }
+
+      void clamp()
+      {
+        if (current != tail && !(current->key < *to))
+        {
+          current = tail;
+        }
+      }
+
+    public:
+      const K &key() const
+      {
+        return current->key;
+      }
+
+      V &value()
+      {
+        return current->value;
+      }
+
+      std::pair<const K &, V &> operator*()
+      {
+        return std::pair<const K &, V &>(current->key, current->value);
+      }
+
+      Iterator &operator++()
+      {
+        current = nextUnmarked(current, tail);
+        clamp();
+        return *this;
+      }
+
+      bool operator==(const Iterator &other) const
+      {
+        return current == other.current;
+      }
+
+      bool operator!=(const Iterator &other) const
+      {
+        return current != other.current;
+      }
+    };
+
+    Iterator begin()
+    {
+      return Iterator(first, tail, &to);
+    }
+
+    Iterator end()
+    {
+      return Iterator(tail, tail, &to);
+    }
+  };
+
+  Range range(const K &from, const K &to)
+  {
+    auto scope = epochGarbageCollector.openEpochGuard();
+
+    Node *first = findGreaterOrEqual<false>(from, nullptr, nullptr, scope);
+
+    return Range(std::move(scope), first, tail, to);
+  }
+
+  // Loads pairs sorted by strictly increasing key, duplicated keys keep the first value.
+  // On an empty map the towers are linked privately and published with one CAS per level of head instead of
+  // one CAS insert per key. It is single threaded with respect to other writers, a writer racing the
+  // publication is caught by the assert on those CAS. Readers only observe fully linked nodes. Falls back to
+  // insert when the map is not empty.
+  template <typename InputIterator> void bulkLoad(InputIterator first, InputIterator last)
+  {
+    auto scope = epochGarbageCollector.openEpochGuard();
+
+    bool empty = true;
+
+    for (uint32_t level = 0; level <= MAX_LEVEL; ++level)
+    {
+      empty = empty && head->get(level) == tail;
+    }
+
+    if (!empty)
+    {
+      for (; first != last; ++first)
+      {
+        insert(first->first, first->second);
+      }
+
+      return;
+    }
+
+    Node *firstAt[MAX_LEVEL + 1] = {};
+    Node *lastAt[MAX_LEVEL + 1] = {};
+
+    Node *prev = nullptr;
+    uint64_t count = 0;
+
+    for (; first != last; ++first)
+    {
+      if (prev != nullptr && !(prev->key < first->first))
+      {
+        assert(prev->key == first->first && "bulkLoad input must be sorted");
+        continue;
+      }
+
+      int topLevel = randomLevel();
+
+      Node *node = epochGarbageCollector.allocateSized(scope, Node::sizeClass(topLevel), Node::sizeFor(topLevel), first->first, first->second, topLevel);
+
+      // One reference for each incoming link.
+      node->refCount.store(topLevel + 1, std::memory_order_relaxed);
+
+      for (int level = 0; level <= topLevel; ++level)
+      {
+        node->next(level).store(tail, std::memory_order_relaxed);
+
+        if (lastAt[level])
+        {
+          lastAt[level]->next(level).store(node, std::memory_order_relaxed);
+        }
+        else
+        {
+          firstAt[level] = node;
+        }
+
+        lastAt[level] = node;
+      }
+
+      prev = node;
+      count++;
+    }
+
+    // The links from head to tail are replaced by links from the last node of each level to tail,
+    // so the reference count of tail is unchanged.
+    for (uint32_t level = 0; level <= MAX_LEVEL; ++level)
+    {
+      if (firstAt[level])
+      {
+        Node *expected = tail;
+        bool published = head->next(level).compare_exchange_strong(expected, firstAt[level], std::memory_order_release, std::memory_order_relaxed);
+        assert(published && "bulkLoad must not run concurrently with other writers");
+        (void)published;
+      }
+    }
+
+    size_.fetch_add(count, std::memory_order_relaxed);
+  }
+
   int size() const
   {
     return size_.load(std::memory_order_relaxed);
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "algorithm/bit.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace lib
+{
+
+// Generational slot map, objects are stored in place in dense segments and addressed by a 64 bit handle
+// holding a 32 bit slot index and the 32 bit generation of the slot.
+//
+// Slots are never moved or freed before the map is destroyed. A slot generation is odd while the slot is
+// occupied and is bumped on every insert and erase, so stale handles are rejected by get with a single
+// comparison and the handle 0 is never valid. Free slots are kept on a lock-free stack whose head is tagged
+// with a counter to avoid ABA.
+//
+// insert, erase and get can be called concurrently, but erasing an object while another thread still uses a
+// pointer returned by get is up to the caller to prevent, as with any other container of raw objects.
+template <typename T> class ConcurrentSlotMap
+{
+public:
+  using Handle = uint64_t;
+
+  static constexpr Handle NULL_HANDLE = 0;
+
+  static inline uint32_t indexOf(Handle handle)
+  {
+    return static_cast<uint32_t>(handle);
+  }
+
+  static inline uint32_t generationOf(Handle handle)
+  {
+    return static_cast<uint32_t>(handle >> 32);
+  }
+
+private:
+  static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+  static constexpr size_t kFirstSegmentShift = 6;
+  static constexpr size_t kFirstSegmentSize = size_t(1) << kFirstSegmentShift;
+  static constexpr size_t kMaxSegments = std::numeric_limits<uint32_t>::digits - kFirstSegmentShift + 1;
+
+  struct Slot
+  {
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> nextFree;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    Slot() : generation(0), nextFree(EMPTY)
+    {
+    }
+
+    inline T *get()
+    {
+      return std::launder(reinterpret_cast<T *>(storage));
+    }
+  };
+
+  std::atomic<Slot *> segments[kMaxSegments];
+  std::atomic<uint32_t> slotCount;
+  std::atomic<size_t> liveCount;
+
+  // Tag in the high 32 bits, index of the first free slot in the low 32 bits.
+  std::atomic<uint64_t> freeHead;
+
+  static inline Handle makeHandle(uint32_t index, uint32_t generation)
+  {
+    return (static_cast<Handle>(generation) << 32) | index;
+  }
+
+  static inline size_t segmentIndex(size_t index)
+  {
+    return lib::bitWidth(index >> kFirstSegmentShift);
+  }
+
+  static inline size_t segmentBase(size_t segment)
+  {
+    return segment == 0 ? 0 : kFirstSegmentSize << (segment - 1);
+  }
+
+  static inline size_t segmentSize(size_t segment)
+  {
+    return segment == 0 ? kFirstSegmentSize : kFirstSegmentSize << (segment - 1);
+  }
+
+  Slot *ensureSegment(size_t segment)
+  {
+    Slot *current = segments[segment].load(std::memory_order_acquire);
+
+    if (current)
+    {
+      return current;
+    }
+
+    Slot *fresh = new Slot[segmentSize(segment)];
+
+    if (!segments[segment].compare_exchange_strong(current, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      // Another thread installed the segment first.
+      delete[] fresh;
+      return current;
+    }
+
+    return fresh;
+  }
+
+  // Returns nullptr for indices past the slots handed out so far, which only stale or forged handles can hold.
+  inline Slot *slotAt(uint32_t index) const
+  {
+    if (index >= slotCount.load(std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+
+    size_t segment = segmentIndex(index);
+    Slot *base = segments[segment].load(std::memory_order_acquire);
+
+    return base ? base + (index - segmentBase(segment)) : nullptr;
+  }
+
+  uint32_t popFree()
+  {
+    uint64_t head = freeHead.load(std::memory_order_acquire);
+
+    while (static_cast<uint32_t>(head) != EMPTY)
+    {
+      uint32_t index = static_cast<uint32_t>(head);
+      uint32_t next = slotAt(index)->nextFree.load(std::memory_order_relaxed);
+      uint64_t tag = (head >> 32) + 1;
+
+      if (freeHead.compare_exchange_weak(head, (tag << 32) | next, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        return index;
+      }
+    }
+
+    return EMPTY;
+  }
+
+  void pushFree(uint32_t index)
+  {
+    Slot *slot = slotAt(index);
+    uint64_t head = freeHead.load(std::memory_order_relaxed);
+    uint64_t tag;
+
+    do
+    {
+      slot->nextFree.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+      tag = (head >> 32) + 1;
+    } while (!freeHead.compare_exchange_weak(head, (tag << 32) | index, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  uint32_t claimSlot()
+  {
+    uint32_t index = popFree();
+
+    if (index != EMPTY)
+    {
+      return index;
+    }
+
+    index = slotCount.load(std::memory_order_relaxed);
+
+    do
+    {
+      if (index == EMPTY)
+      {
+        throw std::length_error("ConcurrentSlotMap is out of slots");
+      }
+
+      // Install the segment before the index becomes visible to slotAt.
+      ensureSegment(segmentIndex(index));
+    } while (!slotCount.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    return index;
+  }
+
+public:
+  ConcurrentSlotMap() : slotCount(0), liveCount(0), freeHead(EMPTY)
+  {
+    for (size_t i = 0; i < kMaxSegments; i++)
+    {
+      segments[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~ConcurrentSlotMap()
+  {
+    clear();
+
+    for (size_t i = 0; i < kMaxSegments; i++)
+    {
+      delete[] segments[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  ConcurrentSlotMap(const ConcurrentSlotMap &) = delete;
+  ConcurrentSlotMap &operator=(const ConcurrentSlotMap &) = delete;
+
+  template <typename... Args> Handle insert(Args &&...args)
+  {
+    uint32_t index = claimSlot();
+    Slot *slot = slotAt(index);
+
+    new (slot->storage) T(std::forward<Args>(args)...);
+
+    uint32_t generation = slot->generation.load(std::memory_order_relaxed) + 1;
+    slot->generation.store(generation, std::memory_order_release);
+
+    liveCount.fetch_add(1, std::memory_order_relaxed);
+
+    return makeHandle(index, generation);
+  }
+
+  // Destroys the object, returns false if the handle is stale.
+  bool erase(Handle handle)
+  {
+    uint32_t generation = generationOf(handle);
+    Slot *slot = slotAt(indexOf(handle));
+
+    if (slot == nullptr || (generation & 1) == 0)
+    {
+      return false;
+    }
+
+    // Only one eraser can move the generation forward, later ones see a stale handle.
+    if (!slot->generation.compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+    {
+      return false;
+    }
+
+    slot->get()->~T();
+
+    pushFree(indexOf(handle));
+    liveCount.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  inline T *get(Handle handle) const
+  {
+    Slot *slot = slotAt(indexOf(handle));
+
+    if (slot == nullptr || slot->generation.load(std::memory_order_acquire) != generationOf(handle) || (generationOf(handle) & 1) == 0)
+    {
+      return nullptr;
+    }
+
+    return slot->get();
+  }
+
+  inline bool contains(Handle handle) const
+  {
+    return get(handle) != nullptr;
+  }
+
+  // Calls f(handle, object) for every live object, not safe against concurrent erases.
+  template <typename F> void forEach(F &&f)
+  {
+    uint32_t count = slotCount.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      Slot *slot = slotAt(i);
+      uint32_t generation = slot->generation.load(std::memory_order_acquire);
+
+      if (generation & 1)
+      {
+        f(makeHandle(i, generation), *slot->get());
+      }
+    }
+  }
+
+  // Erases every live object, not safe against concurrent operations.
+  void clear()
+  {
+    forEach([this](Handle handle, T &) { erase(handle); });
+  }
+
+  size_t size() const
+  {
+    return liveCount.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+};
+
+} // namespace lib
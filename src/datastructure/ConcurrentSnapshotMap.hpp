@@ -0,0 +1,462 @@
+#pragma once
+
+#include "ConcurrentEpochGarbageCollector.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace lib
+{
+
+// Read-mostly hash map with the interface of ConcurrentHashMap.
+//
+// Readers pin an epoch and probe an immutable open addressing table, so a lookup is a handful of plain loads with
+// no compare-and-swap. Writers serialize on a mutex, build a new table from the current one and publish it with a
+// single store, the old table is reclaimed once every reader pinned before the publish is done. Each write copies
+// the table, so writes should be grouped in a Batch when there are many of them.
+//
+// Entries are allocated once and shared by every table that contains them, so values stay at the same address and
+// can be modified in place, synchronizing those modifications is up to the caller.
+template <typename K, typename V, typename Hasher = std::hash<K>> class ConcurrentSnapshotMap
+{
+  struct Entry
+  {
+    K key;
+    V value;
+    size_t hash;
+
+    Entry(const K &key, const V &value, size_t hash) : key(key), value(value), hash(hash)
+    {
+    }
+  };
+
+  struct Table
+  {
+    size_t mask;
+    size_t count;
+    std::vector<Entry *> slots;
+    // Entries removed when this table was replaced, freed together with it.
+    std::vector<Entry *> removed;
+
+    Table(size_t capacity) : mask(capacity - 1), count(0), slots(capacity, nullptr)
+    {
+    }
+
+    ~Table()
+    {
+      for (Entry *entry : removed)
+      {
+        delete entry;
+      }
+    }
+
+    Entry *find(const K &key, size_t hash) const
+    {
+      for (size_t i = hash & mask;; i = (i + 1) & mask)
+      {
+        Entry *entry = slots[i];
+
+        if (entry == nullptr || (entry->hash == hash && entry->key == key))
+        {
+          return entry;
+        }
+      }
+    }
+
+    void place(Entry *entry)
+    {
+      size_t i = entry->hash & mask;
+
+      while (slots[i] != nullptr)
+      {
+        i = (i + 1) & mask;
+      }
+
+      slots[i] = entry;
+      count += 1;
+    }
+
+    // Backward shift deletion, keeps every probe sequence free of holes.
+    void erase(Entry *entry)
+    {
+      size_t hole = entry->hash & mask;
+
+      while (slots[hole] != entry)
+      {
+        hole = (hole + 1) & mask;
+      }
+
+      for (size_t i = (hole + 1) & mask; slots[i] != nullptr; i = (i + 1) & mask)
+      {
+        size_t home = slots[i]->hash & mask;
+
+        // Move the entry back if the hole lies between its home slot and where it sits now.
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+          slots[hole] = slots[i];
+          hole = i;
+        }
+      }
+
+      slots[hole] = nullptr;
+      count -= 1;
+    }
+  };
+
+  using GC = ConcurrentEpochGarbageCollector<Table>;
+
+  std::atomic<Table *> current;
+  std::mutex writeLock;
+  Hasher hasher;
+  GC garbageCollector;
+
+  // At most half full.
+  static size_t capacityFor(size_t count)
+  {
+    size_t capacity = 16;
+
+    while (capacity < count * 2)
+    {
+      capacity *= 2;
+    }
+
+    return capacity;
+  }
+
+  struct Write
+  {
+    bool insert;
+    K key;
+    V value;
+  };
+
+  // Publishes a copy of the current table with the writes applied in order, writeLock must be held.
+  void publish(const std::vector<Write> &writes)
+  {
+    auto scope = garbageCollector.openEpochGuard();
+
+    Table *old = current.load(std::memory_order_relaxed);
+    Table *table = garbageCollector.allocate(scope, capacityFor(old->count + writes.size()));
+
+    for (Entry *entry : old->slots)
+    {
+      if (entry)
+      {
+        table->place(entry);
+      }
+    }
+
+    std::vector<Entry *> removed;
+
+    for (const Write &write : writes)
+    {
+      size_t hash = hasher(write.key);
+      Entry *entry = table->find(write.key, hash);
+
+      if (write.insert && entry == nullptr)
+      {
+        table->place(new Entry(write.key, write.value, hash));
+      }
+      else if (!write.insert && entry != nullptr)
+      {
+        table->erase(entry);
+
+        // Entries inserted by this same batch were never published and can go right away.
+        if (old->find(write.key, hash) == entry)
+        {
+          removed.push_back(entry);
+        }
+        else
+        {
+          delete entry;
+        }
+      }
+    }
+
+    old->removed = std::move(removed);
+
+    current.store(table, std::memory_order_release);
+    scope.retire(old);
+  }
+
+public:
+  class Iterator
+  {
+    template <typename, typename, typename> friend class ConcurrentSnapshotMap;
+
+  private:
+    typename GC::EpochGuard guard;
+    Table *table;
+    size_t index;
+    Entry *entry;
+
+    Iterator(typename GC::EpochGuard guard, Table *table, size_t index, Entry *entry) : guard(std::move(guard)), table(table), index(index), entry(entry)
+    {
+    }
+
+    void skip()
+    {
+      while (index < table->slots.size() && table->slots[index] == nullptr)
+      {
+        index++;
+      }
+
+      entry = index < table->slots.size() ? table->slots[index] : nullptr;
+    }
+
+  public:
+    Iterator() : guard(nullptr, nullptr), table(nullptr), index(0), entry(nullptr)
+    {
+    }
+
+    const K &key() const
+    {
+      return entry->key;
+    }
+
+    V &value()
+    {
+      return entry->value;
+    }
+
+    const V &value() const
+    {
+      return entry->value;
+    }
+
+    std::pair<const K &, V &> operator*()
+    {
+      return {entry->key, entry->value};
+    }
+
+    V *operator->()
+    {
+      return &entry->value;
+    }
+
+    const V *operator->() const
+    {
+      return &entry->value;
+    }
+
+    // Only iterators from begin walk the table, advancing one returned by find ends the iteration.
+    Iterator &operator++()
+    {
+      if (table == nullptr || index >= table->slots.size())
+      {
+        entry = nullptr;
+        return *this;
+      }
+
+      index++;
+      skip();
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const
+    {
+      return entry == other.entry;
+    }
+
+    bool operator!=(const Iterator &other) const
+    {
+      return entry != other.entry;
+    }
+  };
+
+  // Groups writes into a single new table, published by commit or when the batch goes out of scope.
+  class Batch
+  {
+    friend class ConcurrentSnapshotMap;
+
+    ConcurrentSnapshotMap *map;
+    std::vector<Write> writes;
+
+    Batch(ConcurrentSnapshotMap *map) : map(map)
+    {
+    }
+
+  public:
+    Batch(const Batch &) = delete;
+    Batch &operator=(const Batch &) = delete;
+
+    Batch(Batch &&other) noexcept : map(other.map), writes(std::move(other.writes))
+    {
+      other.map = nullptr;
+    }
+
+    ~Batch()
+    {
+      commit();
+    }
+
+    void insert(const K &key, const V &value)
+    {
+      writes.push_back(Write{true, key, value});
+    }
+
+    void remove(const K &key)
+    {
+      writes.push_back(Write{false, key, V{}});
+    }
+
+    void commit()
+    {
+      if (map == nullptr || writes.empty())
+      {
+        return;
+      }
+
+      std::lock_guard<std::mutex> guard(map->writeLock);
+      map->publish(writes);
+      writes.clear();
+    }
+  };
+
+  ConcurrentSnapshotMap() : garbageCollector()
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    current.store(garbageCollector.allocate(scope, capacityFor(0)), std::memory_order_relaxed);
+  }
+
+  ~ConcurrentSnapshotMap()
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    Table *table = current.load(std::memory_order_relaxed);
+
+    for (Entry *entry : table->slots)
+    {
+      delete entry;
+    }
+
+    scope.retire(table);
+  }
+
+  ConcurrentSnapshotMap(const ConcurrentSnapshotMap &) = delete;
+  ConcurrentSnapshotMap &operator=(const ConcurrentSnapshotMap &) = delete;
+
+  Batch batch()
+  {
+    return Batch(this);
+  }
+
+  // Inserts key if it is not present, returns end otherwise.
+  Iterator insert(const K &key, const V &value)
+  {
+    {
+      std::lock_guard<std::mutex> guard(writeLock);
+
+      if (find(key) != end())
+      {
+        return end();
+      }
+
+      publish({Write{true, key, value}});
+    }
+
+    return find(key);
+  }
+
+  bool remove(const K &key)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+
+    if (find(key) == end())
+    {
+      return false;
+    }
+
+    publish({Write{false, key, V{}}});
+    return true;
+  }
+
+  Iterator find(const K &key)
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    Table *table = current.load(std::memory_order_acquire);
+    Entry *entry = table->find(key, hasher(key));
+
+    if (entry == nullptr)
+    {
+      return end();
+    }
+
+    return Iterator(std::move(scope), table, table->slots.size(), entry);
+  }
+
+  bool contains(const K &key)
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    size_t hash = hasher(key);
+    return current.load(std::memory_order_acquire)->find(key, hash) != nullptr;
+  }
+
+  Iterator operator[](const K &key)
+  {
+    Iterator it = find(key);
+
+    if (it != end())
+    {
+      return it;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(writeLock);
+
+      if (find(key) == end())
+      {
+        publish({Write{true, key, V{}}});
+      }
+    }
+
+    return find(key);
+  }
+
+  Iterator begin()
+  {
+    auto scope = garbageCollector.openEpochGuard();
+    Table *table = current.load(std::memory_order_acquire);
+
+    Iterator it(std::move(scope), table, 0, nullptr);
+    it.skip();
+    return it;
+  }
+
+  Iterator end()
+  {
+    return Iterator();
+  }
+
+  uint64_t size()
+  {
+    // A writer may retire the table right after it is loaded.
+    auto scope = garbageCollector.openEpochGuard();
+    return current.load(std::memory_order_acquire)->count;
+  }
+
+  bool isEmpty()
+  {
+    return size() == 0;
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+
+    std::vector<Write> writes;
+
+    for (auto it = begin(); it != end(); ++it)
+    {
+      writes.push_back(Write{false, it.key(), V{}});
+    }
+
+    publish(writes);
+  }
+};
+
+} // namespace lib
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "datastructure/HazardPointer.hpp"
 #include "time/TimeSpan.hpp"
 #include <atomic>
@@ -6,6 +6,7 @@
 #include "os/Thread.hpp"
 #include <atomic>
 #include <cstddef>
+#include <new>
 
 namespace lib
 {
@@ -37,14 +38,16 @@ public:
   // so we dont need to achire them often. At destruction we iterate over the record list and release them.
   using HazardPointerManager = HazardPointer<2, ConcurrentStackNode<T>, Allocator>;
   using HazardPointerRecord = typename HazardPointerManager::Record;
-  HazardPointerManager hazardAllocator;
-
+  // Declared after the allocator, the manager hands the container's retired nodes back to it on destruction.
   Allocator allocator;
 
-  ConcurrentStackProducer(Allocator &allocator) : head(nullptr), allocator(allocator), size(0)
+  HazardPointerManager hazardAllocator;
+
+  ConcurrentStackProducer(Allocator &allocator, HazardPointerDomain &domain = HazardPointerDomain::global())
+      : head(nullptr), size(0), allocator(allocator), hazardAllocator(domain)
   {
   }
-  ConcurrentStackProducer() : head(nullptr), allocator(), size(0)
+  ConcurrentStackProducer(HazardPointerDomain &domain = HazardPointerDomain::global()) : head(nullptr), size(0), allocator(), hazardAllocator(domain)
   {
   }
 
@@ -55,14 +58,15 @@ public:
     while (curr)
     {
       ConcurrentStackNode<T> *next = curr->next.load();
-      delete curr;
+      curr->~ConcurrentStackNode<T>();
+      allocator.deallocate(curr, 1);
       curr = next;
     }
   }
 
   ConcurrentStackNode<T> *push(const T &value)
   {
-    ConcurrentStackNode<T> *newNode = new ConcurrentStackNode<T>(value);
+    ConcurrentStackNode<T> *newNode = new (allocator.allocate(1)) ConcurrentStackNode<T>(value);
     ConcurrentStackNode<T> *oldHead = nullptr;
 
     do
@@ -112,8 +116,10 @@ public:
 };
 } // namespace detail
 
-template <typename T> class ConcurrentStack
+template <typename T, typename Allocator = memory::allocator::SystemAllocator<detail::ConcurrentStackNode<T>>> class ConcurrentStack
 {
+  using Producer = detail::ConcurrentStackProducer<T, Allocator>;
+
   size_t concurrencyLevel;
 
 public:
@@ -124,10 +130,10 @@ public:
 
   ~ConcurrentStack()
   {
-    detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *node = threadLists.head.load(std::memory_order_acquire);
+    detail::ConcurrentStackNode<Producer *> *node = threadLists.head.load(std::memory_order_acquire);
     while (node)
     {
-      detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *next = node->next.load(std::memory_order_acquire);
+      detail::ConcurrentStackNode<Producer *> *next = node->next.load(std::memory_order_acquire);
       delete node->get();
       node = next;
     }
@@ -135,12 +141,12 @@ public:
 
   void push(T value)
   {
-    detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *local = nullptr;
+    detail::ConcurrentStackNode<Producer *> *local = nullptr;
 
     if (!localLists.get(local))
     {
       // NOTE: never delete local directly, it will be cleaned up on destruction.
-      detail::ConcurrentStackProducer<T> *producer = new detail::ConcurrentStackProducer<T>();
+      Producer *producer = new Producer();
       local = threadLists.push(producer);
       localLists.set(local);
     }
@@ -152,7 +158,7 @@ public:
 
   bool pop(T &value)
   {
-    detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *local = nullptr;
+    detail::ConcurrentStackNode<Producer *> *local = nullptr;
 
     localLists.get(local);
 
@@ -166,8 +172,8 @@ public:
       return false;
     }
 
-    detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *node = local;
-    detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *start = local;
+    detail::ConcurrentStackNode<Producer *> *node = local;
+    detail::ConcurrentStackNode<Producer *> *start = local;
 
     start = node;
 
@@ -196,8 +202,8 @@ public:
   }
 
 private:
-  ThreadLocalStorage<detail::ConcurrentStackNode<detail::ConcurrentStackProducer<T> *> *> localLists;
-  detail::ConcurrentStackProducer<detail::ConcurrentStackProducer<T> *> threadLists;
+  ThreadLocalStorage<detail::ConcurrentStackNode<Producer *> *> localLists;
+  detail::ConcurrentStackProducer<Producer *> threadLists;
   size_t time;
 };
 
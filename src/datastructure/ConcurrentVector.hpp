@@ -1,33 +1,69 @@
 #pragma once
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <new>
 #include <stdexcept>
 
+#include "algorithm/bit.hpp"
 #include "memory/SystemMemoryManager.hpp"
 #include "memory/allocator/SystemAllocator.hpp"
 
-#include <chrono>
-#include <iostream>
-#include <numeric>
-#include <thread>
-#include <vector>
-
-
 namespace lib
 {
 
+// Segmented vector, elements live in power-of-two segments that are allocated on demand and never moved,
+// so references returned by at/operator[] stay valid for the lifetime of the vector.
+//
+// Writers claim indices from reservedSize and mark the slot of each index ready once its element is constructed, or
+// failed when the constructor throws. Readers check the slot itself, so no writer waits on another one. committedSize is
+// the length of the prefix of settled slots, any writer advances it past slots settled by others, and size() stops at
+// the first slot that is still being written.
+//
+// Segment 0 holds indices [0, kFirstSegmentSize), segment k > 0 holds [kFirstSegmentSize << (k - 1), kFirstSegmentSize << k).
+// The segment of an index is then the bit width of index >> kFirstSegmentShift.
+//
+// Allocator can be any type exposing allocate(n) and deallocate(ptr, n), e.g. SystemAllocator or a
+// lib::allocator::BoundedHeapAllocator instance passed to the constructor.
 template <typename T, typename Allocator = lib::memory::allocator::SystemAllocator<T>> class ConcurrentVector
 {
 private:
-  std::atomic<T *> dataArray;
-  std::atomic<size_t> currentSize;
-  std::atomic<size_t> currentCapacity;
-  std::atomic_flag resizeLock = ATOMIC_FLAG_INIT;
+  static constexpr size_t kFirstSegmentShift = 3;
+  static constexpr size_t kFirstSegmentSize = size_t(1) << kFirstSegmentShift;
+  static constexpr size_t kMaxSegments = std::numeric_limits<size_t>::digits - kFirstSegmentShift + 1;
+
+  enum SlotState : uint8_t
+  {
+    SlotState_Empty = 0,
+    SlotState_Ready = 1,
+    SlotState_Failed = 2,
+  };
 
-  static constexpr size_t kInitialCapacity = 8;
+  std::atomic<T *> segments[kMaxSegments];
+  // Slot states of each segment, installed before the segment itself.
+  std::atomic<std::atomic<uint8_t> *> states[kMaxSegments];
+  std::atomic<size_t> reservedSize;
+  std::atomic<size_t> committedSize;
 
   Allocator allocator;
+  lib::memory::allocator::SystemAllocator<std::atomic<uint8_t>> stateAllocator;
+
+  static inline size_t segmentIndex(size_t index)
+  {
+    return lib::bitWidth(index >> kFirstSegmentShift);
+  }
+
+  static inline size_t segmentBase(size_t segment)
+  {
+    return segment == 0 ? 0 : kFirstSegmentSize << (segment - 1);
+  }
+
+  static inline size_t segmentSize(size_t segment)
+  {
+    return segment == 0 ? kFirstSegmentSize : kFirstSegmentSize << (segment - 1);
+  }
 
   template <typename... Args> void constructElement(T *ptr, Args &&...args)
   {
@@ -39,146 +75,255 @@ private:
     ptr->~T();
   }
 
-  void destroyElements(T *ptr, size_t count)
+  std::atomic<uint8_t> *ensureStates(size_t segment)
   {
-    for (size_t i = 0; i < count; ++i)
+    std::atomic<uint8_t> *current = states[segment].load(std::memory_order_acquire);
+
+    if (current)
     {
-      destroyElement(ptr + i);
+      return current;
     }
-  }
 
-  void deallocateMemory(T *ptr, size_t capacity)
-  {
-    if (ptr)
+    std::atomic<uint8_t> *fresh = stateAllocator.allocate(segmentSize(segment));
+
+    if (fresh == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+
+    for (size_t i = 0; i < segmentSize(segment); i++)
     {
-      allocator.deallocate(ptr, capacity);
+      new (fresh + i) std::atomic<uint8_t>(SlotState_Empty);
     }
+
+    if (!states[segment].compare_exchange_strong(current, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      stateAllocator.deallocate(fresh, segmentSize(segment));
+      return current;
+    }
+
+    return fresh;
   }
 
-  void resizeInternal(size_t oldSize, std::size_t oldCapacity)
+  T *ensureSegment(size_t segment)
   {
-    while (resizeLock.test_and_set(std::memory_order_acquire))
+    ensureStates(segment);
+
+    T *current = segments[segment].load(std::memory_order_acquire);
+
+    if (current)
     {
+      return current;
     }
 
-    size_t actualCurrentCapacity = currentCapacity.load(std::memory_order_relaxed);
-    size_t actualCurrentSize = currentSize.load(std::memory_order_relaxed);
+    T *fresh = allocator.allocate(segmentSize(segment));
 
-    if (actualCurrentCapacity >= actualCurrentSize + 1)
+    if (fresh == nullptr)
     {
-      resizeLock.clear(std::memory_order_release);
-      return;
+      throw std::bad_alloc();
     }
 
-    size_t newCapacity = (actualCurrentCapacity == 0) ? kInitialCapacity : actualCurrentCapacity * 2;
+    if (!segments[segment].compare_exchange_strong(current, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      // Another thread installed the segment first.
+      allocator.deallocate(fresh, segmentSize(segment));
+      return current;
+    }
 
-    T *oldData = dataArray.load(std::memory_order_relaxed);
-    T *newData = nullptr;
+    return fresh;
+  }
 
-    try
+  void ensureSegments(size_t first, size_t last)
+  {
+    for (size_t segment = segmentIndex(first); segment <= segmentIndex(last); segment++)
     {
-      newData = allocator.allocate(newCapacity);
+      ensureSegment(segment);
+    }
+  }
+
+  uint8_t slotState(size_t index, std::memory_order order) const
+  {
+    size_t segment = segmentIndex(index);
+    std::atomic<uint8_t> *slots = states[segment].load(std::memory_order_acquire);
+    return slots ? slots[index - segmentBase(segment)].load(order) : uint8_t(SlotState_Empty);
+  }
+
+  // Settles the slot of index, its segment states are installed by the writer that reserved it.
+  void settle(size_t index, SlotState state)
+  {
+    size_t segment = segmentIndex(index);
+    states[segment].load(std::memory_order_acquire)[index - segmentBase(segment)].store(state, std::memory_order_seq_cst);
+  }
 
-      if (actualCurrentSize > 0 && oldData)
+  // Moves committedSize past every settled slot that follows it. The slot stores and loads are sequentially consistent,
+  // so of two writers settling neighbouring slots at least one sees the other and no settled slot is left behind.
+  void advance()
+  {
+    size_t committed = committedSize.load(std::memory_order_seq_cst);
+
+    while (slotState(committed, std::memory_order_seq_cst) != SlotState_Empty)
+    {
+      if (committedSize.compare_exchange_weak(committed, committed + 1, std::memory_order_seq_cst))
       {
-        std::uninitialized_copy(oldData, oldData + actualCurrentSize, newData);
+        committed++;
       }
     }
-    catch (...)
+  }
+
+  // Marks the slots of [first, last) failed, a segment that could not be allocated leaves its slots empty and size()
+  // stops before them.
+  void fail(size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
     {
-      if (newData)
+      if (states[segmentIndex(i)].load(std::memory_order_acquire))
       {
-        allocator.deallocate(newData, newCapacity);
+        settle(i, SlotState_Failed);
       }
-      resizeLock.clear(std::memory_order_release);
-      throw;
     }
 
-    dataArray.store(newData, std::memory_order_release);
-    currentCapacity.store(newCapacity, std::memory_order_release);
+    advance();
+  }
+
+  template <typename Arg> size_t emplace(Arg &&value)
+  {
+    size_t index = reservedSize.fetch_add(1, std::memory_order_relaxed);
 
-    if (oldData)
+    try
+    {
+      T *segment = ensureSegment(segmentIndex(index));
+      constructElement(segment + (index - segmentBase(segmentIndex(index))), std::forward<Arg>(value));
+    }
+    catch (...)
     {
-      destroyElements(oldData, actualCurrentSize);
-      deallocateMemory(oldData, actualCurrentCapacity);
+      fail(index, index + 1);
+      throw;
     }
 
-    resizeLock.clear(std::memory_order_release);
+    settle(index, SlotState_Ready);
+    advance();
+    return index;
+  }
+
+  inline T *elementAt(size_t index) const
+  {
+    size_t segment = segmentIndex(index);
+    return segments[segment].load(std::memory_order_acquire) + (index - segmentBase(segment));
   }
 
 public:
-  explicit ConcurrentVector(const Allocator &alloc = Allocator()) : dataArray(nullptr), currentSize(0), currentCapacity(0), allocator(alloc)
+  explicit ConcurrentVector(const Allocator &alloc = Allocator()) : reservedSize(0), committedSize(0), allocator(alloc)
   {
+    for (size_t i = 0; i < kMaxSegments; i++)
+    {
+      segments[i].store(nullptr, std::memory_order_relaxed);
+      states[i].store(nullptr, std::memory_order_relaxed);
+    }
   }
 
   ~ConcurrentVector()
   {
-    T *currentData = dataArray.load(std::memory_order_acquire);
-    size_t currentVecSize = currentSize.load(std::memory_order_acquire);
-    size_t currentVecCapacity = currentCapacity.load(std::memory_order_acquire);
+    size_t reserved = reservedSize.load(std::memory_order_acquire);
+
+    for (size_t i = 0; i < reserved; i++)
+    {
+      if (slotState(i, std::memory_order_acquire) == SlotState_Ready)
+      {
+        destroyElement(elementAt(i));
+      }
+    }
 
-    destroyElements(currentData, currentVecSize);
-    deallocateMemory(currentData, currentVecCapacity);
+    for (size_t i = 0; i < kMaxSegments; i++)
+    {
+      T *segment = segments[i].load(std::memory_order_acquire);
+
+      if (segment)
+      {
+        allocator.deallocate(segment, segmentSize(i));
+      }
+
+      std::atomic<uint8_t> *slots = states[i].load(std::memory_order_acquire);
+
+      if (slots)
+      {
+        stateAllocator.deallocate(slots, segmentSize(i));
+      }
+    }
   }
 
   ConcurrentVector(const ConcurrentVector &) = delete;
   ConcurrentVector &operator=(const ConcurrentVector &) = delete;
 
-  void pushBack(const T &value)
+  // Returns the index of the inserted element. If the element constructor throws its index stays failed and at()
+  // rejects it.
+  size_t pushBack(const T &value)
+  {
+    return emplace(value);
+  }
+
+  size_t pushBack(T &&value)
+  {
+    return emplace(std::move(value));
+  }
+
+  // Appends count copies of value, returns the index of the first appended element.
+  size_t growBy(size_t count, const T &value = T())
   {
-    size_t currentVecSize;
-    size_t currentVecCapacity;
-    T *currentVecData;
+    if (count == 0)
+    {
+      return reservedSize.load(std::memory_order_acquire);
+    }
 
-    while (true)
+    size_t first = reservedSize.fetch_add(count, std::memory_order_relaxed);
+    size_t i = first;
+
+    try
     {
-      currentVecSize = currentSize.load(std::memory_order_acquire);
-      currentVecCapacity = currentCapacity.load(std::memory_order_acquire);
-      currentVecData = dataArray.load(std::memory_order_acquire);
+      ensureSegments(first, first + count - 1);
 
-      if (currentVecSize >= currentVecCapacity)
+      for (; i < first + count; i++)
       {
-        resizeInternal(currentVecSize, currentVecCapacity);
-        continue;
+        constructElement(elementAt(i), value);
+        settle(i, SlotState_Ready);
       }
+    }
+    catch (...)
+    {
+      fail(i, first + count);
+      throw;
+    }
 
-      if (currentSize.compare_exchange_weak(currentVecSize, currentVecSize + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
-      {
-        currentVecData = dataArray.load(std::memory_order_acquire);
-        if (currentVecData == nullptr)
-        {
-          throw std::runtime_error("Internal error: dataArray pointer is null.");
-        }
-
-        constructElement(currentVecData + currentVecSize, value);
-        return;
-      }
+    advance();
+    return first;
+  }
+
+  // Allocates the segments needed to hold n elements without constructing them.
+  void reserve(size_t n)
+  {
+    if (n > 0)
+    {
+      ensureSegments(0, n - 1);
     }
   }
 
   T &at(size_t index)
   {
-    size_t currentVecSize = currentSize.load(std::memory_order_acquire);
-    T *currentVecData = dataArray.load(std::memory_order_acquire);
-
-    if (index >= currentVecSize)
+    if (slotState(index, std::memory_order_acquire) != SlotState_Ready)
     {
       throw std::out_of_range("Index out of bounds in ConcurrentVector::at");
     }
-    return currentVecData[index];
+
+    return *elementAt(index);
   }
 
   const T &at(size_t index) const
   {
-    size_t currentVecSize = currentSize.load(std::memory_order_acquire);
-    T *currentVecData = dataArray.load(std::memory_order_acquire);
-
-    if (index >= currentVecSize)
+    if (slotState(index, std::memory_order_acquire) != SlotState_Ready)
     {
       throw std::out_of_range("Index out of bounds in ConcurrentVector::at (const)");
     }
 
-    return currentVecData[index];
+    return *elementAt(index);
   }
 
   T &operator[](size_t index)
@@ -191,20 +336,32 @@ public:
     return at(index);
   }
 
+  // Length of the prefix of settled slots, an element still being constructed and everything after it is not counted
+  // yet. Failed slots inside the prefix are counted and rejected by at().
   size_t size() const
   {
-    return currentSize.load(std::memory_order_acquire);
+    return committedSize.load(std::memory_order_acquire);
   }
 
   size_t capacity() const
   {
-    return currentCapacity.load(std::memory_order_acquire);
+    size_t result = 0;
+
+    for (size_t i = 0; i < kMaxSegments; i++)
+    {
+      if (segments[i].load(std::memory_order_acquire))
+      {
+        result += segmentSize(i);
+      }
+    }
+
+    return result;
   }
 
   bool empty() const
   {
-    return currentSize.load(std::memory_order_acquire) == 0;
+    return committedSize.load(std::memory_order_acquire) == 0;
   }
 };
 
-} // namespace lib
\ No newline at end of file
+} // namespace lib
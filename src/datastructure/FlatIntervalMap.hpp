@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace lib
+{
+
+// Tags the points of closed ranges [start, end], kept as disjoint intervals sorted by start in one contiguous array.
+//
+// assign splits the intervals it partially covers and merges the result with neighbours carrying an equal tag, so
+// the array stays as short as the number of distinct runs. Lookups binary search the first overlapping interval and
+// scan forward. clear keeps the capacity, a map can be reused across compiles without allocating.
+template <typename Tag, typename T> class FlatIntervalMap
+{
+public:
+  struct Interval
+  {
+    T start, end;
+    Tag tag;
+  };
+
+private:
+  std::vector<Interval> intervals;
+
+  // Index of the first interval ending at or after point.
+  size_t lowerBound(T point) const
+  {
+    return std::partition_point(intervals.begin(), intervals.end(), [point](const Interval &i) { return i.end < point; }) - intervals.begin();
+  }
+
+public:
+  FlatIntervalMap() = default;
+
+  explicit FlatIntervalMap(size_t capacity)
+  {
+    intervals.reserve(capacity);
+  }
+
+  void clear()
+  {
+    intervals.clear();
+  }
+
+  void reserve(size_t capacity)
+  {
+    intervals.reserve(capacity);
+  }
+
+  // Drops every interval and tags [start, end] as a whole.
+  void reset(T start, T end, const Tag &tag)
+  {
+    intervals.clear();
+    intervals.push_back(Interval{start, end, tag});
+  }
+
+  void assign(T start, T end, const Tag &tag)
+  {
+    if (start > end)
+    {
+      std::swap(start, end);
+    }
+
+    size_t first = lowerBound(start);
+    size_t last = first;
+
+    while (last < intervals.size() && intervals[last].start <= end)
+    {
+      last++;
+    }
+
+    Interval inserted{start, end, tag};
+    Interval pieces[3];
+    size_t count = 0;
+
+    // Left side, keep the uncovered part of a partially covered interval or merge with an equal neighbour.
+    if (first < last && intervals[first].start < start)
+    {
+      if (intervals[first].tag == tag)
+      {
+        inserted.start = intervals[first].start;
+      }
+      else
+      {
+        pieces[count++] = Interval{intervals[first].start, start - 1, intervals[first].tag};
+      }
+    }
+    else if (first > 0 && intervals[first - 1].end + 1 == start && intervals[first - 1].tag == tag)
+    {
+      first -= 1;
+      inserted.start = intervals[first].start;
+    }
+
+    Interval right;
+    bool hasRight = false;
+
+    if (first < last && intervals[last - 1].end > end)
+    {
+      if (intervals[last - 1].tag == tag)
+      {
+        inserted.end = intervals[last - 1].end;
+      }
+      else
+      {
+        right = Interval{end + 1, intervals[last - 1].end, intervals[last - 1].tag};
+        hasRight = true;
+      }
+    }
+    else if (last < intervals.size() && intervals[last].start - 1 == end && intervals[last].tag == tag)
+    {
+      inserted.end = intervals[last].end;
+      last += 1;
+    }
+
+    pieces[count++] = inserted;
+
+    if (hasRight)
+    {
+      pieces[count++] = right;
+    }
+
+    size_t removed = last - first;
+
+    if (removed < count)
+    {
+      intervals.insert(intervals.begin() + last, count - removed, Interval{});
+    }
+    else if (removed > count)
+    {
+      intervals.erase(intervals.begin() + first + count, intervals.begin() + last);
+    }
+
+    std::copy(pieces, pieces + count, intervals.begin() + first);
+  }
+
+  // Appends the parts of [start, end] tagged differently from tag.
+  void query(T start, T end, const Tag &tag, std::vector<Interval> &out) const
+  {
+    for (size_t i = lowerBound(start); i < intervals.size() && intervals[i].start <= end; i++)
+    {
+      if (intervals[i].tag != tag)
+      {
+        out.push_back(Interval{std::max(intervals[i].start, start), std::min(intervals[i].end, end), intervals[i].tag});
+      }
+    }
+  }
+
+  // Appends every tagged part of [start, end].
+  void queryAll(T start, T end, std::vector<Interval> &out) const
+  {
+    for (size_t i = lowerBound(start); i < intervals.size() && intervals[i].start <= end; i++)
+    {
+      out.push_back(Interval{std::max(intervals[i].start, start), std::min(intervals[i].end, end), intervals[i].tag});
+    }
+  }
+
+  size_t size() const
+  {
+    return intervals.size();
+  }
+
+  size_t capacity() const
+  {
+    return intervals.capacity();
+  }
+
+  typename std::vector<Interval>::const_iterator begin() const
+  {
+    return intervals.begin();
+  }
+
+  typename std::vector<Interval>::const_iterator end() const
+  {
+    return intervals.end();
+  }
+};
+
+} // namespace lib
@@ -0,0 +1,680 @@
+#pragma once
+
+#include "algorithm/bit.hpp"
+#include "algorithm/random.hpp"
+#include "memory/allocator/SystemAllocator.hpp"
+
+#include "simde/x86/sse2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace lib
+{
+namespace detail
+{
+
+// Open addressing hash table in the style of a Swiss table.
+//
+// Every slot has a control byte, kEmpty, kDeleted or the low 7 bits of the key hash (h2) when full.
+// Slots are grouped 16 at a time and a lookup compares a whole group of control bytes against h2 with one
+// SSE2 compare, only touching the slots whose control byte matched. The probe sequence walks groups
+// quadratically starting at h1 = hash >> 7 and stops at the first group with an empty slot.
+//
+// Single threaded, references are invalidated by rehashing.
+template <typename Slot, typename K, typename KeyOf, typename Hash, typename Eq, typename Allocator> class FlatTable
+{
+protected:
+  static constexpr size_t kGroupWidth = 16;
+  static constexpr size_t kMinCapacity = kGroupWidth;
+
+  static constexpr int8_t kEmpty = -128;
+  static constexpr int8_t kDeleted = -2;
+
+  static_assert(alignof(Slot) <= alignof(std::max_align_t), "FlatTable slots must not be over aligned");
+
+  struct Group
+  {
+    simde__m128i ctrl;
+
+    explicit Group(const int8_t *pos) : ctrl(simde_mm_loadu_si128(reinterpret_cast<const simde__m128i *>(pos)))
+    {
+    }
+
+    inline uint32_t match(int8_t h2) const
+    {
+      return static_cast<uint32_t>(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(simde_mm_set1_epi8(h2), ctrl)));
+    }
+
+    inline uint32_t matchEmpty() const
+    {
+      return match(kEmpty);
+    }
+
+    // kEmpty and kDeleted are the only control values below -1.
+    inline uint32_t matchEmptyOrDeleted() const
+    {
+      return static_cast<uint32_t>(simde_mm_movemask_epi8(simde_mm_cmpgt_epi8(simde_mm_set1_epi8(-1), ctrl)));
+    }
+
+    inline uint32_t matchFull() const
+    {
+      return ~static_cast<uint32_t>(simde_mm_movemask_epi8(ctrl)) & 0xffff;
+    }
+  };
+
+  uint8_t *memory = nullptr;
+  Slot *slots = nullptr;
+  int8_t *ctrl = nullptr;
+
+  size_t tableCapacity = 0;
+  size_t tableSize = 0;
+  size_t tableTombstones = 0;
+
+  Hash hasher;
+  Eq equals;
+  Allocator allocator;
+
+  static inline size_t maxLoad(size_t capacity)
+  {
+    return capacity - capacity / 8;
+  }
+
+  static inline size_t bytesFor(size_t capacity)
+  {
+    return capacity * sizeof(Slot) + capacity;
+  }
+
+  inline size_t hashKey(const K &key) const
+  {
+    return lib::hashInteger(static_cast<size_t>(hasher(key)));
+  }
+
+  static inline size_t h1(size_t hash)
+  {
+    return hash >> 7;
+  }
+
+  static inline int8_t h2(size_t hash)
+  {
+    return static_cast<int8_t>(hash & 0x7f);
+  }
+
+  void allocateTable(size_t capacity)
+  {
+    memory = allocator.allocate(bytesFor(capacity));
+
+    if (memory == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+
+    slots = reinterpret_cast<Slot *>(memory);
+    ctrl = reinterpret_cast<int8_t *>(memory + capacity * sizeof(Slot));
+    std::memset(ctrl, kEmpty, capacity);
+
+    tableCapacity = capacity;
+    tableTombstones = 0;
+  }
+
+  void destroySlots()
+  {
+    for (size_t i = 0; i < tableCapacity; i++)
+    {
+      if (ctrl[i] >= 0)
+      {
+        slots[i].~Slot();
+      }
+    }
+  }
+
+  void releaseTable()
+  {
+    if (memory)
+    {
+      destroySlots();
+      allocator.deallocate(memory, bytesFor(tableCapacity));
+    }
+
+    memory = nullptr;
+    slots = nullptr;
+    ctrl = nullptr;
+    tableCapacity = 0;
+    tableSize = 0;
+    tableTombstones = 0;
+  }
+
+  // Returns the slot index of key or tableCapacity if it is not present.
+  size_t findIndex(const K &key, size_t hash) const
+  {
+    if (tableCapacity == 0)
+    {
+      return tableCapacity;
+    }
+
+    size_t groupMask = tableCapacity / kGroupWidth - 1;
+    size_t group = h1(hash) & groupMask;
+
+    for (size_t step = 1;; step++)
+    {
+      Group g(ctrl + group * kGroupWidth);
+
+      for (uint32_t mask = g.match(h2(hash)); mask; mask &= mask - 1)
+      {
+        size_t index = group * kGroupWidth + lib::countrZero(mask);
+
+        if (equals(KeyOf::get(slots[index]), key))
+        {
+          return index;
+        }
+      }
+
+      if (g.matchEmpty())
+      {
+        return tableCapacity;
+      }
+
+      group = (group + step) & groupMask;
+    }
+  }
+
+  // First empty or deleted slot on the probe sequence of hash.
+  size_t findInsertIndex(size_t hash) const
+  {
+    size_t groupMask = tableCapacity / kGroupWidth - 1;
+    size_t group = h1(hash) & groupMask;
+
+    for (size_t step = 1;; step++)
+    {
+      Group g(ctrl + group * kGroupWidth);
+
+      if (uint32_t mask = g.matchEmptyOrDeleted())
+      {
+        return group * kGroupWidth + lib::countrZero(mask);
+      }
+
+      group = (group + step) & groupMask;
+    }
+  }
+
+  void rehash(size_t capacity)
+  {
+    uint8_t *oldMemory = memory;
+    Slot *oldSlots = slots;
+    int8_t *oldCtrl = ctrl;
+    size_t oldCapacity = tableCapacity;
+
+    allocateTable(capacity);
+
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+      if (oldCtrl[i] >= 0)
+      {
+        size_t hash = hashKey(KeyOf::get(oldSlots[i]));
+        size_t index = findInsertIndex(hash);
+
+        new (&slots[index]) Slot(std::move(oldSlots[i]));
+        ctrl[index] = h2(hash);
+        oldSlots[i].~Slot();
+      }
+    }
+
+    if (oldMemory)
+    {
+      allocator.deallocate(oldMemory, bytesFor(oldCapacity));
+    }
+  }
+
+  void growIfNeeded()
+  {
+    if (tableCapacity == 0)
+    {
+      allocateTable(kMinCapacity);
+      return;
+    }
+
+    if (tableSize + tableTombstones + 1 <= maxLoad(tableCapacity))
+    {
+      return;
+    }
+
+    // Mostly tombstones, rehashing in place is enough to make room.
+    if (tableSize + 1 <= maxLoad(tableCapacity) / 2)
+    {
+      rehash(tableCapacity);
+    }
+    else
+    {
+      rehash(tableCapacity * 2);
+    }
+  }
+
+  // Returns the index of key and whether a new slot was constructed from args.
+  template <typename... Args> std::pair<size_t, bool> findOrEmplace(const K &key, Args &&...args)
+  {
+    size_t hash = hashKey(key);
+    size_t index = findIndex(key, hash);
+
+    if (index != tableCapacity)
+    {
+      return std::make_pair(index, false);
+    }
+
+    growIfNeeded();
+
+    index = findInsertIndex(hash);
+
+    if (ctrl[index] == kDeleted)
+    {
+      tableTombstones--;
+    }
+
+    new (&slots[index]) Slot(std::forward<Args>(args)...);
+    ctrl[index] = h2(hash);
+    tableSize++;
+
+    return std::make_pair(index, true);
+  }
+
+  void eraseIndex(size_t index)
+  {
+    slots[index].~Slot();
+    tableSize--;
+
+    // If the group already has an empty slot no probe sequence continues past it,
+    // so the slot can be marked empty instead of leaving a tombstone.
+    Group g(ctrl + (index & ~(kGroupWidth - 1)));
+
+    if (g.matchEmpty())
+    {
+      ctrl[index] = kEmpty;
+    }
+    else
+    {
+      ctrl[index] = kDeleted;
+      tableTombstones++;
+    }
+  }
+
+  size_t nextFull(size_t index) const
+  {
+    while (index < tableCapacity)
+    {
+      size_t group = index & ~(kGroupWidth - 1);
+      uint32_t mask = Group(ctrl + group).matchFull() >> (index - group);
+
+      if (mask)
+      {
+        return index + lib::countrZero(mask);
+      }
+
+      index = group + kGroupWidth;
+    }
+
+    return tableCapacity;
+  }
+
+  void copyFrom(const FlatTable &other)
+  {
+    if (other.tableSize == 0)
+    {
+      return;
+    }
+
+    allocateTable(other.tableCapacity);
+
+    for (size_t i = 0; i < other.tableCapacity; i++)
+    {
+      if (other.ctrl[i] >= 0)
+      {
+        new (&slots[i]) Slot(other.slots[i]);
+      }
+
+      ctrl[i] = other.ctrl[i];
+    }
+
+    tableSize = other.tableSize;
+    tableTombstones = other.tableTombstones;
+  }
+
+  void moveFrom(FlatTable &other)
+  {
+    memory = other.memory;
+    slots = other.slots;
+    ctrl = other.ctrl;
+    tableCapacity = other.tableCapacity;
+    tableSize = other.tableSize;
+    tableTombstones = other.tableTombstones;
+
+    other.memory = nullptr;
+    other.slots = nullptr;
+    other.ctrl = nullptr;
+    other.tableCapacity = 0;
+    other.tableSize = 0;
+    other.tableTombstones = 0;
+  }
+
+public:
+  template <typename Value> class TableIterator
+  {
+    template <typename, typename, typename, typename, typename, typename> friend class FlatTable;
+
+  private:
+    const FlatTable *table;
+    size_t index;
+
+  public:
+    TableIterator() : table(nullptr), index(0)
+    {
+    }
+
+    TableIterator(const FlatTable *table, size_t index) : table(table), index(index)
+    {
+    }
+
+    Value &operator*() const
+    {
+      return table->slots[index];
+    }
+
+    Value *operator->() const
+    {
+      return &table->slots[index];
+    }
+
+    TableIterator &operator++()
+    {
+      index = table->nextFull(index + 1);
+      return *this;
+    }
+
+    TableIterator operator++(int)
+    {
+      TableIterator tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const TableIterator &other) const
+    {
+      return index == other.index && table == other.table;
+    }
+
+    bool operator!=(const TableIterator &other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  using Iterator = TableIterator<Slot>;
+  using ConstIterator = TableIterator<const Slot>;
+
+  explicit FlatTable(const Allocator &alloc = Allocator()) : allocator(alloc)
+  {
+  }
+
+  FlatTable(const FlatTable &other) : hasher(other.hasher), equals(other.equals), allocator(other.allocator)
+  {
+    copyFrom(other);
+  }
+
+  FlatTable(FlatTable &&other) noexcept : hasher(std::move(other.hasher)), equals(std::move(other.equals)), allocator(other.allocator)
+  {
+    moveFrom(other);
+  }
+
+  FlatTable &operator=(const FlatTable &other)
+  {
+    if (this != &other)
+    {
+      releaseTable();
+      copyFrom(other);
+    }
+
+    return *this;
+  }
+
+  FlatTable &operator=(FlatTable &&other) noexcept
+  {
+    if (this != &other)
+    {
+      releaseTable();
+      moveFrom(other);
+    }
+
+    return *this;
+  }
+
+  ~FlatTable()
+  {
+    releaseTable();
+  }
+
+  Iterator begin()
+  {
+    return Iterator(this, nextFull(0));
+  }
+
+  Iterator end()
+  {
+    return Iterator(this, tableCapacity);
+  }
+
+  ConstIterator begin() const
+  {
+    return ConstIterator(this, nextFull(0));
+  }
+
+  ConstIterator end() const
+  {
+    return ConstIterator(this, tableCapacity);
+  }
+
+  Iterator find(const K &key)
+  {
+    return Iterator(this, findIndex(key, hashKey(key)));
+  }
+
+  ConstIterator find(const K &key) const
+  {
+    return ConstIterator(this, findIndex(key, hashKey(key)));
+  }
+
+  bool contains(const K &key) const
+  {
+    return findIndex(key, hashKey(key)) != tableCapacity;
+  }
+
+  size_t count(const K &key) const
+  {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool erase(const K &key)
+  {
+    size_t index = findIndex(key, hashKey(key));
+
+    if (index == tableCapacity)
+    {
+      return false;
+    }
+
+    eraseIndex(index);
+    return true;
+  }
+
+  void erase(Iterator it)
+  {
+    eraseIndex(it.index);
+  }
+
+  // Makes room for n elements without rehashing.
+  void reserve(size_t n)
+  {
+    size_t capacity = tableCapacity == 0 ? kMinCapacity : tableCapacity;
+
+    while (maxLoad(capacity) < n)
+    {
+      capacity *= 2;
+    }
+
+    if (capacity != tableCapacity)
+    {
+      rehash(capacity);
+    }
+  }
+
+  // Destroys all elements but keeps the allocated table.
+  void clear()
+  {
+    if (memory)
+    {
+      destroySlots();
+      std::memset(ctrl, kEmpty, tableCapacity);
+    }
+
+    tableSize = 0;
+    tableTombstones = 0;
+  }
+
+  size_t size() const
+  {
+    return tableSize;
+  }
+
+  size_t capacity() const
+  {
+    return tableCapacity;
+  }
+
+  bool empty() const
+  {
+    return tableSize == 0;
+  }
+};
+
+template <typename K, typename V> struct FlatMapKeyOf
+{
+  static inline const K &get(const std::pair<K, V> &slot)
+  {
+    return slot.first;
+  }
+};
+
+template <typename K> struct FlatSetKeyOf
+{
+  static inline const K &get(const K &slot)
+  {
+    return slot;
+  }
+};
+
+} // namespace detail
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>>
+class FlatMap : public detail::FlatTable<std::pair<K, V>, K, detail::FlatMapKeyOf<K, V>, Hash, Eq, Allocator>
+{
+  using Table = detail::FlatTable<std::pair<K, V>, K, detail::FlatMapKeyOf<K, V>, Hash, Eq, Allocator>;
+
+public:
+  using Iterator = typename Table::Iterator;
+  using ConstIterator = typename Table::ConstIterator;
+
+  explicit FlatMap(const Allocator &alloc = Allocator()) : Table(alloc)
+  {
+  }
+
+  std::pair<Iterator, bool> insert(const K &key, const V &value)
+  {
+    auto [index, inserted] = this->findOrEmplace(key, key, value);
+    return std::make_pair(Iterator(this, index), inserted);
+  }
+
+  std::pair<Iterator, bool> insert(const K &key, V &&value)
+  {
+    auto [index, inserted] = this->findOrEmplace(key, key, std::move(value));
+    return std::make_pair(Iterator(this, index), inserted);
+  }
+
+  // Inserts or overwrites the value of key.
+  Iterator insertOrAssign(const K &key, const V &value)
+  {
+    auto [index, inserted] = this->findOrEmplace(key, key, value);
+
+    if (!inserted)
+    {
+      this->slots[index].second = value;
+    }
+
+    return Iterator(this, index);
+  }
+
+  V &operator[](const K &key)
+  {
+    auto [index, inserted] = this->findOrEmplace(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+    return this->slots[index].second;
+  }
+
+  V &at(const K &key)
+  {
+    size_t index = this->findIndex(key, this->hashKey(key));
+
+    if (index == this->tableCapacity)
+    {
+      throw std::out_of_range("Key not found in FlatMap::at");
+    }
+
+    return this->slots[index].second;
+  }
+
+  const V &at(const K &key) const
+  {
+    size_t index = this->findIndex(key, this->hashKey(key));
+
+    if (index == this->tableCapacity)
+    {
+      throw std::out_of_range("Key not found in FlatMap::at (const)");
+    }
+
+    return this->slots[index].second;
+  }
+};
+
+template <typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>, typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>>
+class FlatSet : public detail::FlatTable<K, K, detail::FlatSetKeyOf<K>, Hash, Eq, Allocator>
+{
+  using Table = detail::FlatTable<K, K, detail::FlatSetKeyOf<K>, Hash, Eq, Allocator>;
+
+public:
+  using Iterator = typename Table::ConstIterator;
+  using ConstIterator = typename Table::ConstIterator;
+
+  explicit FlatSet(const Allocator &alloc = Allocator()) : Table(alloc)
+  {
+  }
+
+  std::pair<ConstIterator, bool> insert(const K &key)
+  {
+    auto [index, inserted] = this->findOrEmplace(key, key);
+    return std::make_pair(ConstIterator(this, index), inserted);
+  }
+
+  ConstIterator begin() const
+  {
+    return Table::begin();
+  }
+
+  ConstIterator end() const
+  {
+    return Table::end();
+  }
+};
+
+} // namespace lib
@@ -5,36 +5,64 @@
 #include "datastructure/ThreadLocalStorage.hpp"
 #include "memory/allocator/SystemAllocator.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <unordered_set>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 namespace lib
 {
 
-template <size_t K, typename T, typename Allocator = memory::allocator::SystemAllocator<T>> class HazardPointer
+// Set of hazard pointer records shared by every HazardPointer manager bound to it.
+//
+// Records are never freed while the domain is alive, a record released by one container is reused by the next
+// acquire of any container on the same domain, so the record list stays around one record per thread instead of
+// one per thread per container. Retired pointers carry their own reclaim function, which lets records hold nodes
+// of containers with different node types and allocators.
+//
+// Scans are amortized: a record only scans once its retired list holds SCAN_FACTOR times the hazards that may be
+// live (MAX_HAZARDS per record), so each scan frees at least a constant fraction of the retired nodes.
+class HazardPointerDomain
 {
 public:
+  static constexpr size_t MAX_HAZARDS = 4;
+  static constexpr size_t SCAN_FACTOR = 2;
+  static constexpr size_t MIN_SCAN_THRESHOLD = 16;
+
+  using ReclaimFunction = void (*)(void *context, void *ptr);
+
+  struct Retired
+  {
+    void *ptr;
+    ReclaimFunction reclaim;
+    void *context;
+  };
+
   class Record
   {
-    const int R = 16;
-    friend class HazardPointer;
+    friend class HazardPointerDomain;
 
     std::atomic<uint32_t> refs;
 
-    HazardPointer *manager;
+    HazardPointerDomain *domain;
     Record *next;
 
     std::atomic<bool> isActive;
-    void *pointers[K];
+    std::atomic<void *> pointers[MAX_HAZARDS];
+
+    // Reclaim function and context of the manager that currently owns the record.
+    ReclaimFunction reclaim;
+    void *context;
 
-    std::vector<void *> retiredList;
-    Allocator &allocator;
+    std::vector<Retired> retiredList;
+    std::vector<uintptr_t> hazards;
 
-    Record(HazardPointer *manager, Allocator &allocator) : allocator(allocator), retiredList(), isActive(false), next(nullptr), manager(manager), refs(0)
+    Record(HazardPointerDomain *domain) : refs(0), domain(domain), next(nullptr), isActive(false), reclaim(nullptr), context(nullptr)
     {
-      for (size_t i = 0; i < K; i++)
+      for (size_t i = 0; i < MAX_HAZARDS; i++)
       {
-        pointers[i] = nullptr;
+        pointers[i].store(nullptr, std::memory_order_relaxed);
       }
     }
 
@@ -42,17 +70,28 @@ public:
     {
       for (size_t i = 0; i < retiredList.size(); i++)
       {
-        allocator.deallocate((T *)retiredList[i]);
+        retiredList[i].reclaim(retiredList[i].context, retiredList[i].ptr);
       }
 
       retiredList.clear();
     }
 
+    void removeRetired(size_t i)
+    {
+      retiredList[i] = retiredList.back();
+      retiredList.pop_back();
+    }
+
     void helpScan()
     {
       // Accumulate retired nodes from inactive records
-      for (Record *hprec = manager->head.load(); hprec != nullptr; hprec = hprec->next)
+      for (Record *hprec = domain->head.load(std::memory_order_acquire); hprec != nullptr; hprec = hprec->next)
       {
+        if (hprec == this)
+        {
+          continue;
+        }
+
         bool expected = false;
 
         if (!hprec->isActive.compare_exchange_strong(expected, true))
@@ -60,21 +99,16 @@ public:
           continue;
         }
 
-        // hprec->retiredLock.lock();
-
         while (hprec->retiredList.size() > 0)
         {
-          void *node = hprec->retiredList[hprec->retiredList.size() - 1];
-
+          retiredList.push_back(hprec->retiredList.back());
           hprec->retiredList.pop_back();
-          retiredList.push_back(node);
 
-          if (retiredList.size() > R)
+          if (retiredList.size() >= domain->scanThreshold())
           {
-            scan(manager->head.load());
+            scan();
           }
         }
-        // hprec->retiredLock.unlock();
 
         expected = true;
 
@@ -83,98 +117,104 @@ public:
       }
     }
 
-    void scan(Record *h)
+    void scan()
     {
-      std::vector<void *> hp;
-
-      hp.reserve(os::Thread::getHardwareConcurrency() * K);
-
-      size_t i = 0;
+      hazards.clear();
 
-      while (h)
+      for (Record *h = domain->head.load(std::memory_order_acquire); h != nullptr; h = h->next)
       {
-        for (size_t k = 0; k < K; k++)
+        if (!h->isActive.load(std::memory_order_acquire))
         {
-          if (h->pointers[k] != nullptr && h->isActive.load(std::memory_order_acquire))
+          continue;
+        }
+
+        for (size_t k = 0; k < MAX_HAZARDS; k++)
+        {
+          void *ptr = h->pointers[k].load(std::memory_order_acquire);
+
+          if (ptr != nullptr)
           {
-            hp.push_back(h->pointers[k]);
+            hazards.push_back(reinterpret_cast<uintptr_t>(ptr));
           }
         }
-
-        h = h->next;
       }
 
-      std::sort(hp.begin(), hp.end());
+      algorithm::sort::quickSort(hazards.data(), hazards.size());
 
       for (size_t i = 0; i < retiredList.size();)
       {
-        if (!std::binary_search(hp.begin(), hp.end(), retiredList[i]))
+        uintptr_t ptr = reinterpret_cast<uintptr_t>(retiredList[i].ptr);
+
+        if (algorithm::search::binarySearch(hazards.data(), ptr, hazards.size()) == hazards.size())
         {
-          allocator.deallocate((T *)retiredList[i]);
-          if (i != retiredList.size() - 1)
-          {
-            retiredList[i] = retiredList[retiredList.size() - 1];
-            retiredList[retiredList.size() - 1] = nullptr;
-          }
-          retiredList.pop_back();
+          retiredList[i].reclaim(retiredList[i].context, retiredList[i].ptr);
+          removeRetired(i);
         }
         else
         {
           i++;
         }
       }
-      // retiredLock.unlock();
     }
 
   public:
-    inline void assign(T *ref, uint32_t index = 0)
+    inline void assign(void *ref, uint32_t index = 0)
     {
-      // os::print("assigning %p\n", ref);
-      pointers[index] = (void *)ref;
+      assert(index < MAX_HAZARDS);
+      pointers[index].store(ref);
     }
 
     inline void unassign(uint32_t index = 0)
     {
-      pointers[index] = nullptr;
+      pointers[index].store(nullptr, std::memory_order_release);
     }
+
     inline void *get(uint32_t index)
     {
-      return pointers[index];
+      return pointers[index].load(std::memory_order_relaxed);
     }
 
     void retire(void *ptr)
     {
-      retiredList.push_back(ptr);
-      bool needScan = retiredList.size() >= R;
+      retiredList.push_back(Retired{ptr, reclaim, context});
 
-      if (needScan)
+      if (retiredList.size() >= domain->scanThreshold())
       {
-        scan(manager->head);
+        scan();
         helpScan();
       }
     }
   };
 
-  HazardPointer() : head(nullptr), listLen(0)
+  HazardPointerDomain() : head(nullptr), listLen(0)
   {
   }
 
-  ~HazardPointer()
+  ~HazardPointerDomain()
   {
     Record *curr = head.load();
+
     while (curr)
     {
-      // assert(!curr->isActive.test());
       Record *tmp = curr->next;
-
       delete curr;
       curr = tmp;
     }
   }
 
-  Record *acquire(Allocator &allocator)
+  HazardPointerDomain(const HazardPointerDomain &) = delete;
+  HazardPointerDomain &operator=(const HazardPointerDomain &) = delete;
+
+  // Process wide domain, used by managers that are not given one explicitly.
+  static HazardPointerDomain &global()
   {
-    Record *p = head;
+    static HazardPointerDomain domain;
+    return domain;
+  }
+
+  Record *acquire(ReclaimFunction reclaim, void *context)
+  {
+    Record *p = head.load(std::memory_order_acquire);
 
     for (; p; p = p->next)
     {
@@ -185,50 +225,39 @@ public:
         continue;
       }
 
-      uint32_t refs = p->refs.fetch_add(1);
-      assert(refs == 0);
-
-      return p;
+      break;
     }
 
-    int oldLen = listLen.load();
-    do
+    if (p == nullptr)
     {
-      oldLen = listLen.load();
-    } while (!listLen.compare_exchange_weak(oldLen, oldLen + 1, std::memory_order_release, std::memory_order_relaxed));
-
-    p = new Record(this, allocator);
+      listLen.fetch_add(1, std::memory_order_relaxed);
 
-    p->isActive.store(true);
+      p = new Record(this);
+      p->isActive.store(true);
 
-    uint32_t refs = p->refs.fetch_add(1);
-
-    assert(refs == 0);
+      Record *old = head.load(std::memory_order_relaxed);
 
-    for (size_t i = 0; i < K; i++)
-    {
-      p->pointers[i] = NULL;
+      do
+      {
+        p->next = old;
+      } while (!head.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
     }
 
-    Record *old = head;
-
-    do
-    {
-      old = head;
-      p->next = old;
-    } while (!head.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
+    uint32_t refs = p->refs.fetch_add(1);
+    assert(refs == 0);
 
-    assert(p->refs.load() == 1);
+    p->reclaim = reclaim;
+    p->context = context;
 
     return p;
   }
 
   void release(Record *rec)
   {
-    // for (size_t i = 0; i < K; i++)
-    // {
-    //   rec->pointers[i] = nullptr;
-    // }
+    for (size_t i = 0; i < MAX_HAZARDS; i++)
+    {
+      rec->pointers[i].store(nullptr, std::memory_order_relaxed);
+    }
 
     rec->refs.fetch_sub(1);
 
@@ -236,13 +265,109 @@ public:
     assert(rec->isActive.load());
 
     bool expected = true;
-    bool exchanged = rec->isActive.compare_exchange_strong(expected, false);
+    bool exchanged = rec->isActive.compare_exchange_strong(expected, false, std::memory_order_release);
     assert(exchanged);
   }
 
+  // Reclaims every retired pointer owned by context, called by a manager when its container is destroyed
+  // since its nodes may still be sitting in records that outlive it. No thread may hold hazards to them.
+  void reclaim(void *context)
+  {
+    for (Record *rec = head.load(std::memory_order_acquire); rec != nullptr; rec = rec->next)
+    {
+      bool expected = false;
+
+      while (!rec->isActive.compare_exchange_weak(expected, true, std::memory_order_acquire))
+      {
+        expected = false;
+      }
+
+      for (size_t i = 0; i < rec->retiredList.size();)
+      {
+        if (rec->retiredList[i].context == context)
+        {
+          rec->retiredList[i].reclaim(rec->retiredList[i].context, rec->retiredList[i].ptr);
+          rec->removeRetired(i);
+        }
+        else
+        {
+          i++;
+        }
+      }
+
+      rec->isActive.store(false, std::memory_order_release);
+    }
+  }
+
+  size_t records() const
+  {
+    return listLen.load(std::memory_order_relaxed);
+  }
+
 private:
   std::atomic<Record *> head;
-  std::atomic<int> listLen;
+  std::atomic<size_t> listLen;
+
+  inline size_t scanThreshold() const
+  {
+    size_t liveHazards = listLen.load(std::memory_order_relaxed) * MAX_HAZARDS;
+    return std::max(MIN_SCAN_THRESHOLD, SCAN_FACTOR * liveHazards);
+  }
+};
+
+// Per container view of a HazardPointerDomain, K is the number of hazards a record holds for this container.
+// Retired nodes are returned to the allocator passed to acquire.
+template <size_t K, typename T, typename Allocator = memory::allocator::SystemAllocator<T>> class HazardPointer
+{
+  static_assert(K <= HazardPointerDomain::MAX_HAZARDS, "HazardPointer K exceeds HazardPointerDomain::MAX_HAZARDS");
+
+public:
+  using Record = HazardPointerDomain::Record;
+
+  HazardPointer(HazardPointerDomain &domain = HazardPointerDomain::global()) : domain(domain), allocator(nullptr)
+  {
+  }
+
+  ~HazardPointer()
+  {
+    Allocator *owner = allocator.load(std::memory_order_acquire);
+
+    if (owner)
+    {
+      domain.reclaim(owner);
+    }
+  }
+
+  HazardPointer(const HazardPointer &) = delete;
+  HazardPointer &operator=(const HazardPointer &) = delete;
+
+  Record *acquire(Allocator &alloc)
+  {
+    // Containers always acquire with their own allocator, which doubles as the owner of their retired nodes.
+    assert(allocator.load(std::memory_order_relaxed) == nullptr || allocator.load(std::memory_order_relaxed) == &alloc);
+    allocator.store(&alloc, std::memory_order_relaxed);
+
+    return domain.acquire(&HazardPointer::reclaim, &alloc);
+  }
+
+  void release(Record *rec)
+  {
+    domain.release(rec);
+  }
+
+  HazardPointerDomain &getDomain()
+  {
+    return domain;
+  }
+
+private:
+  HazardPointerDomain &domain;
+  std::atomic<Allocator *> allocator;
+
+  static void reclaim(void *context, void *ptr)
+  {
+    static_cast<Allocator *>(context)->deallocate(static_cast<T *>(ptr));
+  }
 };
 
-} // namespace lib
\ No newline at end of file
+} // namespace lib
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace lib
+{
+
+// Dense width x height grid of tags, meant for small integer domains such as the mips and layers of a texture.
+//
+// Every cell is stored, so assigning a rectangle is a fill and reading one is a scan without any allocation once the
+// grid has grown. Queries return the cells as rectangles of equal tags, built from runs along y merged across
+// consecutive x. A grid whose cells all share one tag is kept as that tag alone, whole grid transitions and queries on
+// it never touch the cells. Equal decides which neighbouring cells a rectangle may merge.
+template <typename Tag, typename T, typename Equal = std::equal_to<Tag>> class TaggedGrid
+{
+public:
+  struct Rect
+  {
+    T x1, y1, x2, y2;
+    Tag tag;
+  };
+
+private:
+  std::vector<Tag> cells;
+  std::vector<size_t> open;
+  std::vector<size_t> extended;
+  Equal equal;
+  T width = 0;
+  T height = 0;
+  bool uniform = true;
+  Tag uniformTag;
+
+  Tag &at(T x, T y)
+  {
+    return cells[(size_t)x * height + y];
+  }
+
+  const Tag &at(T x, T y) const
+  {
+    return cells[(size_t)x * height + y];
+  }
+
+  bool covers(T x1, T y1, T x2, T y2) const
+  {
+    return x1 == 0 && y1 == 0 && x2 + 1 >= width && y2 + 1 >= height;
+  }
+
+  // Clips an inclusive rectangle to the grid, returns false when nothing is left.
+  bool clip(T &x1, T &y1, T &x2, T &y2) const
+  {
+    if (x1 > x2)
+    {
+      std::swap(x1, x2);
+    }
+
+    if (y1 > y2)
+    {
+      std::swap(y1, y2);
+    }
+
+    if (x1 >= width || y1 >= height)
+    {
+      return false;
+    }
+
+    x2 = std::min<T>(x2, width - 1);
+    y2 = std::min<T>(y2, height - 1);
+    return true;
+  }
+
+public:
+  // Resizes the grid and tags every cell, the cell storage is reused.
+  void reset(T gridWidth, T gridHeight, const Tag &tag)
+  {
+    width = gridWidth;
+    height = gridHeight;
+    uniform = true;
+    uniformTag = tag;
+  }
+
+  void assign(T x1, T y1, T x2, T y2, const Tag &tag)
+  {
+    if (!clip(x1, y1, x2, y2))
+    {
+      return;
+    }
+
+    if (covers(x1, y1, x2, y2))
+    {
+      uniform = true;
+      uniformTag = tag;
+      return;
+    }
+
+    if (uniform)
+    {
+      cells.assign((size_t)width * height, uniformTag);
+      uniform = false;
+    }
+
+    for (T x = x1; x <= x2; x++)
+    {
+      std::fill(&at(x, y1), &at(x, y2) + 1, tag);
+    }
+  }
+
+  void query(T x1, T y1, T x2, T y2, std::vector<Rect> &out)
+  {
+    out.clear();
+
+    if (!clip(x1, y1, x2, y2))
+    {
+      return;
+    }
+
+    if (uniform)
+    {
+      out.push_back(Rect{x1, y1, x2, y2, uniformTag});
+      return;
+    }
+
+    // Rectangles in out that reached the previous column, sorted by y1.
+    open.clear();
+
+    for (T x = x1; x <= x2; x++)
+    {
+      extended.clear();
+      size_t candidate = 0;
+
+      for (T y = y1; y <= y2;)
+      {
+        T end = y;
+        const Tag &tag = at(x, y);
+
+        while (end < y2 && equal(at(x, end + 1), tag))
+        {
+          end++;
+        }
+
+        while (candidate < open.size() && out[open[candidate]].y1 < y)
+        {
+          candidate++;
+        }
+
+        if (candidate < open.size() && out[open[candidate]].y1 == y && out[open[candidate]].y2 == end && equal(out[open[candidate]].tag, tag))
+        {
+          out[open[candidate]].x2 = x;
+          extended.push_back(open[candidate]);
+        }
+        else
+        {
+          extended.push_back(out.size());
+          out.push_back(Rect{x, y, x, end, tag});
+        }
+
+        y = end + 1;
+      }
+
+      std::swap(open, extended);
+    }
+  }
+
+  bool isUniform() const
+  {
+    return uniform;
+  }
+
+  T getWidth() const
+  {
+    return width;
+  }
+
+  T getHeight() const
+  {
+    return height;
+  }
+};
+
+} // namespace lib
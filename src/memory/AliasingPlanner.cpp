@@ -0,0 +1,150 @@
+#include "AliasingPlanner.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace lib;
+using namespace memory;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t AliasingPlanner::request(uint64_t size, uint64_t alignment, uint64_t firstUse, uint64_t lastUse)
+{
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  assert(firstUse <= lastUse);
+
+  requests.push_back(Request{size, alignment, firstUse, lastUse});
+  return requests.size() - 1;
+}
+
+void AliasingPlanner::clear()
+{
+  requests.clear();
+  offsets.clear();
+  peak = 0;
+  bound = 0;
+}
+
+void AliasingPlanner::plan()
+{
+  offsets.assign(requests.size(), 0);
+  order.resize(requests.size());
+  placed.clear();
+  peak = 0;
+
+  for (uint32_t i = 0; i < order.size(); i++)
+  {
+    order[i] = i;
+  }
+
+  // Largest first, ties by first use and then by index so the plan only depends on the requests.
+  std::sort(
+      order.begin(),
+      order.end(),
+      [this](uint32_t a, uint32_t b)
+      {
+        if (requests[a].size != requests[b].size)
+        {
+          return requests[a].size > requests[b].size;
+        }
+
+        if (requests[a].firstUse != requests[b].firstUse)
+        {
+          return requests[a].firstUse < requests[b].firstUse;
+        }
+
+        return a < b;
+      });
+
+  for (uint32_t index : order)
+  {
+    const Request &current = requests[index];
+
+    overlapping.clear();
+
+    for (uint32_t other : placed)
+    {
+      if (requests[other].firstUse <= current.lastUse && current.firstUse <= requests[other].lastUse)
+      {
+        overlapping.push_back(Placed{offsets[other], offsets[other] + requests[other].size});
+      }
+    }
+
+    std::sort(
+        overlapping.begin(),
+        overlapping.end(),
+        [](const Placed &a, const Placed &b)
+        {
+          return a.offset < b.offset;
+        });
+
+    uint64_t cursor = 0;
+    uint64_t bestOffset = UINT64_MAX;
+    uint64_t bestGap = UINT64_MAX;
+
+    for (const Placed &other : overlapping)
+    {
+      uint64_t offset = alignUp(cursor, current.alignment);
+
+      if (offset + current.size <= other.offset && other.offset - cursor < bestGap)
+      {
+        bestGap = other.offset - cursor;
+        bestOffset = offset;
+      }
+
+      cursor = std::max(cursor, other.end);
+    }
+
+    if (bestOffset == UINT64_MAX)
+    {
+      bestOffset = alignUp(cursor, current.alignment);
+    }
+
+    offsets[index] = bestOffset;
+    peak = std::max(peak, bestOffset + current.size);
+    placed.push_back(index);
+  }
+
+  // Sweep over lifetime boundaries, ends sort before starts at the same point since lastUse is inclusive.
+  events.clear();
+
+  for (const Request &request : requests)
+  {
+    events.emplace_back(request.firstUse, (int64_t)request.size);
+    events.emplace_back(request.lastUse + 1, -(int64_t)request.size);
+  }
+
+  std::sort(events.begin(), events.end());
+
+  int64_t alive = 0;
+  bound = 0;
+
+  for (const auto &[at, delta] : events)
+  {
+    alive += delta;
+    bound = std::max(bound, (uint64_t)alive);
+  }
+}
+
+uint64_t AliasingPlanner::offsetOf(uint32_t index) const
+{
+  return offsets[index];
+}
+
+size_t AliasingPlanner::count() const
+{
+  return requests.size();
+}
+
+uint64_t AliasingPlanner::size() const
+{
+  return peak;
+}
+
+uint64_t AliasingPlanner::lowerBound() const
+{
+  return bound;
+}
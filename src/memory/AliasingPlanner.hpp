@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace lib
+{
+namespace memory
+{
+
+// Offline placement of allocations with known lifetimes inside one block, allocations that are never alive at the
+// same time share bytes.
+//
+// Lifetimes are inclusive ranges of points in time, such as render graph levels. Allocations are placed largest first,
+// each one at the offset of the tightest gap left between the already placed allocations it overlaps in time, or past
+// the last of them when no gap fits. That keeps a large allocation from widening the space of everything that reuses
+// its bytes later. lowerBound() is the largest total size alive at a single point in time, no placement can use less.
+class AliasingPlanner
+{
+public:
+  struct Request
+  {
+    uint64_t size;
+    uint64_t alignment;
+    uint64_t firstUse;
+    uint64_t lastUse;
+  };
+
+  // Adds an allocation alive from firstUse to lastUse and returns its index, alignment must be a power of two.
+  uint32_t request(uint64_t size, uint64_t alignment, uint64_t firstUse, uint64_t lastUse);
+
+  // Places every request made since the last clear.
+  void plan();
+
+  // Forgets every request, keeping the storage for the next plan.
+  void clear();
+
+  uint64_t offsetOf(uint32_t index) const;
+  size_t count() const;
+
+  // Bytes spanned by the placed allocations.
+  uint64_t size() const;
+  uint64_t lowerBound() const;
+
+private:
+  struct Placed
+  {
+    uint64_t offset;
+    uint64_t end;
+  };
+
+  std::vector<Request> requests;
+  std::vector<uint64_t> offsets;
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> placed;
+  std::vector<Placed> overlapping;
+  std::vector<std::pair<uint64_t, int64_t>> events;
+
+  uint64_t peak = 0;
+  uint64_t bound = 0;
+};
+
+} // namespace memory
+} // namespace lib
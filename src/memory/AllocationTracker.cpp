@@ -0,0 +1,457 @@
+#include "AllocationTracker.hpp"
+#include "os/Logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+using namespace lib;
+using namespace memory;
+
+namespace
+{
+
+constexpr uint16_t kHeaderCheck = 0xa110;
+
+struct Header
+{
+  uint64_t size;
+  uint32_t offset;
+  uint16_t tag;
+  uint16_t check;
+};
+
+static_assert(sizeof(Header) == AllocationTracker::HEADER_SIZE, "Header must fill HEADER_SIZE");
+
+struct TagCounters
+{
+  std::atomic<uint64_t> allocations;
+  std::atomic<uint64_t> frees;
+  std::atomic<uint64_t> bytesAllocated;
+  std::atomic<uint64_t> bytesFreed;
+  std::atomic<uint64_t> histogram[AllocationTracker::HISTOGRAM_BUCKETS];
+
+  // Net bytes not yet flushed to the shared peak counters, only touched by the owner.
+  int64_t pendingBytes;
+};
+
+// Counters of one thread, only written by the thread that owns it and reused once that thread exits.
+struct alignas(64) Shard
+{
+  TagCounters tags[AllocationTracker::MAX_TAGS];
+  std::atomic<bool> owned;
+  Shard *next;
+};
+
+struct SharedCounters
+{
+  std::atomic<int64_t> liveBytes;
+  std::atomic<int64_t> peakBytes;
+};
+
+std::atomic<Shard *> shards(nullptr);
+SharedCounters shared[AllocationTracker::MAX_TAGS];
+
+std::mutex tagsLock;
+std::atomic<const char *> tagNames[AllocationTracker::MAX_TAGS];
+std::atomic<uint16_t> tagCount(1);
+
+thread_local uint16_t threadTag = AllocationTracker::UNTAGGED;
+thread_local Shard *threadShard = nullptr;
+
+std::mutex periodicLock;
+std::condition_variable periodicWake;
+std::thread periodicThread;
+bool periodicRunning = false;
+
+inline void bump(std::atomic<uint64_t> &counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline size_t histogramBucket(size_t size)
+{
+  if (size <= 16)
+  {
+    return 0;
+  }
+
+  size_t log2 = 64 - __builtin_clzll(size - 1);
+  return std::min(AllocationTracker::HISTOGRAM_BUCKETS - 1, log2 - 4);
+}
+
+void flush(uint16_t tag, TagCounters &counters)
+{
+  int64_t live = shared[tag].liveBytes.fetch_add(counters.pendingBytes, std::memory_order_relaxed) + counters.pendingBytes;
+  int64_t peak = shared[tag].peakBytes.load(std::memory_order_relaxed);
+
+  while (live > peak && !shared[tag].peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+  {
+  }
+
+  counters.pendingBytes = 0;
+}
+
+thread_local bool threadExited = false;
+
+// Flushes the pending bytes of the calling thread's shard and hands it back, does nothing once it was released.
+void releaseShard()
+{
+  if (threadShard == nullptr)
+  {
+    return;
+  }
+
+  for (uint16_t tag = 0; tag < AllocationTracker::MAX_TAGS; tag++)
+  {
+    if (threadShard->tags[tag].pendingBytes != 0)
+    {
+      flush(tag, threadShard->tags[tag]);
+    }
+  }
+
+  threadShard->owned.store(false, std::memory_order_release);
+  threadShard = nullptr;
+}
+
+struct ShardRelease
+{
+  ~ShardRelease()
+  {
+    releaseShard();
+    // Thread local destructors that run after this one can still allocate, the shard they take is released again
+    // after every charge.
+    threadExited = true;
+  }
+};
+
+thread_local ShardRelease shardRelease;
+
+// Shards come from libc directly, allocating them through SystemMemoryManager would recurse.
+Shard *localShard()
+{
+  if (threadShard)
+  {
+    return threadShard;
+  }
+
+  (void)&shardRelease;
+
+  for (Shard *shard = shards.load(std::memory_order_acquire); shard; shard = shard->next)
+  {
+    bool owned = false;
+
+    if (!shard->owned.load(std::memory_order_relaxed) && shard->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+    {
+      threadShard = shard;
+      return shard;
+    }
+  }
+
+  void *memory = std::aligned_alloc(alignof(Shard), sizeof(Shard));
+
+  if (memory == nullptr)
+  {
+    abort();
+  }
+
+  std::memset(memory, 0, sizeof(Shard));
+
+  Shard *shard = new (memory) Shard();
+  shard->owned.store(true, std::memory_order_relaxed);
+  shard->next = shards.load(std::memory_order_relaxed);
+
+  while (!shards.compare_exchange_weak(shard->next, shard, std::memory_order_release, std::memory_order_relaxed))
+  {
+  }
+
+  threadShard = shard;
+  return shard;
+}
+
+void charge(uint16_t tag, size_t size)
+{
+  TagCounters &counters = localShard()->tags[tag];
+
+  bump(counters.allocations, 1);
+  bump(counters.bytesAllocated, size);
+  bump(counters.histogram[histogramBucket(size)], 1);
+
+  counters.pendingBytes += size;
+
+  if (counters.pendingBytes >= AllocationTracker::PEAK_GRANULARITY)
+  {
+    flush(tag, counters);
+  }
+
+  if (threadExited)
+  {
+    releaseShard();
+  }
+}
+
+void discharge(uint16_t tag, size_t size)
+{
+  TagCounters &counters = localShard()->tags[tag];
+
+  bump(counters.frees, 1);
+  bump(counters.bytesFreed, size);
+
+  counters.pendingBytes -= size;
+
+  if (counters.pendingBytes <= -AllocationTracker::PEAK_GRANULARITY)
+  {
+    flush(tag, counters);
+  }
+
+  if (threadExited)
+  {
+    releaseShard();
+  }
+}
+
+} // namespace
+
+uint16_t AllocationTracker::registerTag(const char *name)
+{
+  std::lock_guard<std::mutex> guard(tagsLock);
+
+  uint16_t count = tagCount.load(std::memory_order_relaxed);
+
+  for (uint16_t tag = 1; tag < count; tag++)
+  {
+    if (strcmp(tagNames[tag].load(std::memory_order_relaxed), name) == 0)
+    {
+      return tag;
+    }
+  }
+
+  if (count == MAX_TAGS)
+  {
+    return UNTAGGED;
+  }
+
+  tagNames[count].store(name, std::memory_order_relaxed);
+  tagCount.store(count + 1, std::memory_order_release);
+
+  return count;
+}
+
+const char *AllocationTracker::tagName(uint16_t tag)
+{
+  if (tag == UNTAGGED || tag >= tagCount.load(std::memory_order_acquire))
+  {
+    return "untagged";
+  }
+
+  return tagNames[tag].load(std::memory_order_relaxed);
+}
+
+uint16_t AllocationTracker::currentTag()
+{
+  return threadTag;
+}
+
+uint16_t AllocationTracker::exchangeTag(uint16_t tag)
+{
+  uint16_t previous = threadTag;
+  threadTag = tag;
+  return previous;
+}
+
+void AllocationTracker::recordExternal(uint16_t tag, size_t size)
+{
+  if (enabled())
+  {
+    charge(tag, size);
+  }
+}
+
+void AllocationTracker::releaseExternal(uint16_t tag, size_t size)
+{
+  if (enabled())
+  {
+    discharge(tag, size);
+  }
+}
+
+void *AllocationTracker::track(void *base, size_t size, size_t offset)
+{
+  if (base == nullptr)
+  {
+    return nullptr;
+  }
+
+  assert(offset >= HEADER_SIZE);
+
+  char *ptr = static_cast<char *>(base) + offset;
+  Header *header = reinterpret_cast<Header *>(ptr - HEADER_SIZE);
+
+  header->size = size;
+  header->offset = static_cast<uint32_t>(offset);
+  header->tag = threadTag;
+  header->check = kHeaderCheck;
+
+  charge(header->tag, size);
+
+  return ptr;
+}
+
+void *AllocationTracker::untrack(void *ptr)
+{
+  if (ptr == nullptr)
+  {
+    return nullptr;
+  }
+
+  Header *header = reinterpret_cast<Header *>(static_cast<char *>(ptr) - HEADER_SIZE);
+
+  assert(header->check == kHeaderCheck && "Pointer was not allocated by SystemMemoryManager");
+
+  discharge(header->tag, header->size);
+
+  return static_cast<char *>(ptr) - header->offset;
+}
+
+AllocationTracker::Snapshot AllocationTracker::snapshot()
+{
+  Snapshot snapshot;
+  snapshot.time = lib::time::TimeSpan::now();
+
+  uint16_t count = tagCount.load(std::memory_order_acquire);
+
+  for (uint16_t tag = 0; tag < count; tag++)
+  {
+    TagSnapshot entry = {};
+    uint64_t frees = 0;
+    uint64_t bytesFreed = 0;
+
+    for (Shard *shard = shards.load(std::memory_order_acquire); shard; shard = shard->next)
+    {
+      TagCounters &counters = shard->tags[tag];
+
+      entry.allocations += counters.allocations.load(std::memory_order_relaxed);
+      entry.bytesAllocated += counters.bytesAllocated.load(std::memory_order_relaxed);
+      frees += counters.frees.load(std::memory_order_relaxed);
+      bytesFreed += counters.bytesFreed.load(std::memory_order_relaxed);
+
+      for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+      {
+        entry.histogram[i] += counters.histogram[i].load(std::memory_order_relaxed);
+      }
+    }
+
+    if (entry.allocations == 0 && frees == 0)
+    {
+      continue;
+    }
+
+    entry.tag = tag;
+    entry.name = tagName(tag);
+    entry.liveBytes = static_cast<int64_t>(entry.bytesAllocated - bytesFreed);
+    entry.liveAllocations = static_cast<int64_t>(entry.allocations - frees);
+
+    // Live bytes seen here are exact, keep them as a peak candidate for later snapshots.
+    int64_t peak = shared[tag].peakBytes.load(std::memory_order_relaxed);
+
+    while (entry.liveBytes > peak && !shared[tag].peakBytes.compare_exchange_weak(peak, entry.liveBytes, std::memory_order_relaxed))
+    {
+    }
+
+    entry.peakBytes = std::max(entry.liveBytes, peak);
+
+    snapshot.tags.push_back(entry);
+  }
+
+  return snapshot;
+}
+
+void AllocationTracker::log(const Snapshot &snapshot, const Snapshot *previous)
+{
+  double elapsed = previous ? (snapshot.time - previous->time).seconds() : 0.0;
+
+  for (const TagSnapshot &tag : snapshot.tags)
+  {
+    double rate = 0.0;
+
+    if (previous && elapsed > 0.0)
+    {
+      uint64_t before = 0;
+
+      for (const TagSnapshot &old : previous->tags)
+      {
+        if (old.tag == tag.tag)
+        {
+          before = old.allocations;
+        }
+      }
+
+      rate = (tag.allocations - before) / elapsed;
+    }
+
+    char histogram[HISTOGRAM_BUCKETS * 24] = {0};
+    size_t length = 0;
+
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS && length < sizeof(histogram); i++)
+    {
+      if (tag.histogram[i])
+      {
+        const char *format = i + 1 == HISTOGRAM_BUCKETS ? " >%zu:%llu" : " %zu:%llu";
+        size_t bound = i + 1 == HISTOGRAM_BUCKETS ? (size_t)16 << (i - 1) : (size_t)16 << i;
+        length += snprintf(histogram + length, sizeof(histogram) - length, format, bound, (unsigned long long)tag.histogram[i]);
+      }
+    }
+
+    os::Logger::logf("memory %-20s live %lld bytes in %lld blocks, peak %lld bytes, %llu allocations (%.1f/s), sizes%s", tag.name, (long long)tag.liveBytes,
+                     (long long)tag.liveAllocations, (long long)tag.peakBytes, (unsigned long long)tag.allocations, rate, histogram);
+  }
+}
+
+void AllocationTracker::startPeriodicLog(lib::time::TimeSpan interval)
+{
+  stopPeriodicLog();
+
+  std::lock_guard<std::mutex> guard(periodicLock);
+  periodicRunning = true;
+
+  periodicThread = std::thread(
+      [interval]()
+      {
+        Snapshot previous = snapshot();
+        std::unique_lock<std::mutex> lock(periodicLock);
+
+        while (!periodicWake.wait_for(lock, std::chrono::nanoseconds((int64_t)interval.nanoseconds()), []() { return !periodicRunning; }))
+        {
+          lock.unlock();
+
+          Snapshot current = snapshot();
+          log(current, &previous);
+          previous = std::move(current);
+
+          lock.lock();
+        }
+      });
+}
+
+void AllocationTracker::stopPeriodicLog()
+{
+  {
+    std::lock_guard<std::mutex> guard(periodicLock);
+    periodicRunning = false;
+  }
+
+  periodicWake.notify_all();
+
+  if (periodicThread.joinable())
+  {
+    periodicThread.join();
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "time/TimeSpan.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace lib
+{
+namespace memory
+{
+
+// Per subsystem accounting of SystemMemoryManager allocations, compiled in with ENGINE_MEMORY_TRACKING.
+//
+// Every allocation is charged to the tag on top of the calling thread's tag stack and carries a small header
+// recording its size and tag, so a free is charged back to the same tag from any thread. Counters live in per-thread
+// shards written without atomic read-modify-writes and are only summed by snapshot(). Peaks are kept on shared
+// counters that shards flush into every PEAK_GRANULARITY bytes, so a peak may be missed by up to that much per
+// thread. Without ENGINE_MEMORY_TRACKING tags can still be registered and scoped but nothing is counted.
+class AllocationTracker
+{
+public:
+  static constexpr uint16_t UNTAGGED = 0;
+  static constexpr size_t MAX_TAGS = 64;
+  // Allocation sizes are bucketed by power of two, bucket i counts sizes up to 16 << i bytes and the last one everything larger.
+  static constexpr size_t HISTOGRAM_BUCKETS = 16;
+  static constexpr int64_t PEAK_GRANULARITY = 64 * 1024;
+
+  struct TagSnapshot
+  {
+    uint16_t tag;
+    const char *name;
+    int64_t liveBytes;
+    int64_t liveAllocations;
+    int64_t peakBytes;
+    uint64_t allocations;
+    uint64_t bytesAllocated;
+    uint64_t histogram[HISTOGRAM_BUCKETS];
+  };
+
+  struct Snapshot
+  {
+    lib::time::TimeSpan time;
+    std::vector<TagSnapshot> tags;
+  };
+
+  static constexpr bool enabled()
+  {
+#if ENGINE_MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Returns the tag with the given name, registering it on first use. Names must have static storage.
+  static uint16_t registerTag(const char *name);
+  static const char *tagName(uint16_t tag);
+
+  static uint16_t currentTag();
+  // Replaces the calling thread's current tag, returning the previous one, AllocationTagScope is the usual way in.
+  static uint16_t exchangeTag(uint16_t tag);
+
+  // Accounts memory that does not come from SystemMemoryManager, such as fiber stacks.
+  static void recordExternal(uint16_t tag, size_t size);
+  static void releaseExternal(uint16_t tag, size_t size);
+
+  // Tags that never allocated are left out.
+  static Snapshot snapshot();
+
+  // Writes a snapshot through os::Logger, with allocation rates since previous when given.
+  static void log(const Snapshot &snapshot, const Snapshot *previous = nullptr);
+
+  // Logs a snapshot every interval from a background thread until stopPeriodicLog.
+  static void startPeriodicLog(lib::time::TimeSpan interval);
+  static void stopPeriodicLog();
+
+  // Header placed in front of every tracked allocation.
+  static constexpr size_t HEADER_SIZE = 16;
+
+  // Charges size bytes at base + offset to the current tag and returns the user pointer, base may be null.
+  static void *track(void *base, size_t size, size_t offset);
+  // Charges the allocation back and returns the pointer the backend handed out.
+  static void *untrack(void *ptr);
+};
+
+// Pushes a tag for the lifetime of the scope.
+class AllocationTagScope
+{
+public:
+  AllocationTagScope(uint16_t tag) : previous(AllocationTracker::exchangeTag(tag))
+  {
+  }
+
+  ~AllocationTagScope()
+  {
+    AllocationTracker::exchangeTag(previous);
+  }
+
+  AllocationTagScope(const AllocationTagScope &) = delete;
+  AllocationTagScope &operator=(const AllocationTagScope &) = delete;
+
+private:
+  uint16_t previous;
+};
+
+} // namespace memory
+} // namespace lib
@@ -0,0 +1,217 @@
+#include "ConcurrentBoundedHeap.hpp"
+#include "SystemMemoryManager.hpp"
+#include "o1heap/o1heap.h"
+#include "os/Thread.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+using namespace lib;
+using namespace memory;
+
+ConcurrentBoundedHeap::ConcurrentBoundedHeap(size_t capacity, size_t arenas) : nextArena(0)
+{
+  buffer = static_cast<char *>(SystemMemoryManager::allignedMalloc(capacity, O1HEAP_ALIGNMENT, 0));
+  ownsBuffer = true;
+
+  if (buffer == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  initialize(capacity, arenas);
+}
+
+ConcurrentBoundedHeap::ConcurrentBoundedHeap(void *buffer, size_t capacity, size_t arenas) : nextArena(0)
+{
+  this->buffer = static_cast<char *>(buffer);
+  ownsBuffer = false;
+
+  initialize(capacity, arenas);
+}
+
+ConcurrentBoundedHeap::~ConcurrentBoundedHeap()
+{
+  release(arenasCount);
+}
+
+void ConcurrentBoundedHeap::release(size_t constructed)
+{
+  for (size_t i = 0; i < constructed; i++)
+  {
+    arenas[i].~Arena();
+  }
+
+  SystemMemoryManager::free(arenas);
+
+  if (ownsBuffer)
+  {
+    SystemMemoryManager::free(buffer);
+  }
+}
+
+void ConcurrentBoundedHeap::initialize(size_t capacity, size_t count)
+{
+  assert(reinterpret_cast<uintptr_t>(buffer) % O1HEAP_ALIGNMENT == 0);
+
+  if (count == 0)
+  {
+    count = std::max<size_t>(1, os::Thread::getHardwareConcurrency());
+  }
+
+  arenasCount = count;
+  arenaSize = (capacity / count) & ~(size_t)(O1HEAP_ALIGNMENT - 1);
+  arenas = static_cast<Arena *>(SystemMemoryManager::allignedMalloc(sizeof(Arena) * count, alignof(Arena), 0));
+
+  if (arenas == nullptr)
+  {
+    release(0);
+    throw std::bad_alloc();
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    new (&arenas[i]) Arena();
+    arenas[i].instance = o1heapInit(buffer + i * arenaSize, arenaSize);
+
+    if (arenas[i].instance == nullptr)
+    {
+      // The destructor does not run for a constructor that throws.
+      release(i + 1);
+      throw std::bad_alloc();
+    }
+  }
+}
+
+ConcurrentBoundedHeap::Arena *ConcurrentBoundedHeap::localArena()
+{
+  Arena *arena = nullptr;
+
+  if (!threadArenas.get(arena))
+  {
+    arena = &arenas[nextArena.fetch_add(1, std::memory_order_relaxed) % arenasCount];
+    threadArenas.set(arena);
+  }
+
+  return arena;
+}
+
+ConcurrentBoundedHeap::Arena *ConcurrentBoundedHeap::arenaOf(void *ptr)
+{
+  size_t offset = static_cast<char *>(ptr) - buffer;
+  assert(offset < arenaSize * arenasCount);
+  return &arenas[offset / arenaSize];
+}
+
+void ConcurrentBoundedHeap::drainRemoteFrees(Arena *arena)
+{
+  RemoteBlock *block = arena->remoteFree.exchange(nullptr, std::memory_order_acquire);
+
+  while (block)
+  {
+    RemoteBlock *next = block->next;
+    o1heapFree(arena->instance, block);
+    arena->remoteFrees += 1;
+    block = next;
+  }
+}
+
+void *ConcurrentBoundedHeap::allocate(size_t size)
+{
+  Arena *arena = localArena();
+
+  arena->lock.lock();
+
+  if (arena->remoteFree.load(std::memory_order_relaxed) != nullptr)
+  {
+    drainRemoteFrees(arena);
+  }
+
+  void *ptr = o1heapAllocate(arena->instance, size);
+
+  arena->lock.unlock();
+
+  return ptr;
+}
+
+void ConcurrentBoundedHeap::free(void *ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+
+  Arena *owner = arenaOf(ptr);
+  Arena *arena = nullptr;
+
+  if (threadArenas.get(arena) && arena == owner)
+  {
+    owner->lock.lock();
+    o1heapFree(owner->instance, ptr);
+    owner->lock.unlock();
+    return;
+  }
+
+  // Every o1heap fragment has room for at least one pointer.
+  RemoteBlock *block = static_cast<RemoteBlock *>(ptr);
+  RemoteBlock *head = owner->remoteFree.load(std::memory_order_relaxed);
+
+  do
+  {
+    block->next = head;
+  } while (!owner->remoteFree.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ConcurrentBoundedHeap::reclaim()
+{
+  for (size_t i = 0; i < arenasCount; i++)
+  {
+    arenas[i].lock.lock();
+    drainRemoteFrees(&arenas[i]);
+    arenas[i].lock.unlock();
+  }
+}
+
+size_t ConcurrentBoundedHeap::arenaCount() const
+{
+  return arenasCount;
+}
+
+ConcurrentBoundedHeap::Diagnostics ConcurrentBoundedHeap::diagnostics(size_t index)
+{
+  Arena *arena = &arenas[index];
+
+  arena->lock.lock();
+  O1HeapDiagnostics diagnostics = o1heapGetDiagnostics(arena->instance);
+  uint64_t remoteFrees = arena->remoteFrees;
+  arena->lock.unlock();
+
+  return Diagnostics{
+    .capacity = diagnostics.capacity,
+    .allocated = diagnostics.allocated,
+    .peakAllocated = diagnostics.peak_allocated,
+    .peakRequestSize = diagnostics.peak_request_size,
+    .oomCount = diagnostics.oom_count,
+    .remoteFrees = remoteFrees,
+  };
+}
+
+ConcurrentBoundedHeap::Diagnostics ConcurrentBoundedHeap::diagnostics()
+{
+  Diagnostics total = {};
+
+  for (size_t i = 0; i < arenasCount; i++)
+  {
+    Diagnostics arena = diagnostics(i);
+
+    total.capacity += arena.capacity;
+    total.allocated += arena.allocated;
+    total.peakAllocated = std::max(total.peakAllocated, arena.peakAllocated);
+    total.peakRequestSize = std::max(total.peakRequestSize, arena.peakRequestSize);
+    total.oomCount += arena.oomCount;
+    total.remoteFrees += arena.remoteFrees;
+  }
+
+  return total;
+}
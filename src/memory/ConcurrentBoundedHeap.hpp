@@ -0,0 +1,90 @@
+#pragma once
+
+#include "datastructure/AtomicLock.hpp"
+#include "datastructure/ThreadLocalStorage.hpp"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+struct O1HeapInstance;
+
+namespace lib
+{
+namespace memory
+{
+
+// Thread-safe constant time heap for the frame critical path, built from one o1heap arena per worker thread.
+//
+// The capacity is split in equal arenas and every thread is bound to one of them on its first allocation, round
+// robin. Allocations and frees from threads bound to the arena of a block only take the arena lock, which is
+// uncontended as long as there are no more threads than arenas. Blocks freed by any other thread are pushed to a
+// lock-free list of their arena and handed back to o1heap by its next allocation, so a free never waits on another
+// thread. Arenas never borrow from each other, an exhausted arena returns nullptr and counts the failure.
+class ConcurrentBoundedHeap
+{
+public:
+  struct Diagnostics
+  {
+    size_t capacity;
+    size_t allocated;
+    size_t peakAllocated;
+    size_t peakRequestSize;
+    uint64_t oomCount;
+    uint64_t remoteFrees;
+  };
+
+  // Allocates capacity bytes from SystemMemoryManager, split in arenas, by default one per hardware thread.
+  ConcurrentBoundedHeap(size_t capacity, size_t arenas = 0);
+  // Uses a caller owned buffer, it must outlive the heap.
+  ConcurrentBoundedHeap(void *buffer, size_t capacity, size_t arenas = 0);
+  ~ConcurrentBoundedHeap();
+
+  ConcurrentBoundedHeap(const ConcurrentBoundedHeap &) = delete;
+  ConcurrentBoundedHeap &operator=(const ConcurrentBoundedHeap &) = delete;
+
+  void *allocate(size_t size);
+  void free(void *ptr);
+
+  // Hands every pending remote free back to its arena, for arenas whose thread stopped allocating.
+  void reclaim();
+
+  size_t arenaCount() const;
+  Diagnostics diagnostics(size_t arena);
+  // Sum of every arena, peaks are the largest peak of a single arena.
+  Diagnostics diagnostics();
+
+private:
+  struct RemoteBlock
+  {
+    RemoteBlock *next;
+  };
+
+  struct alignas(64) Arena
+  {
+    lib::AtomicLock lock;
+    O1HeapInstance *instance = nullptr;
+    uint64_t remoteFrees = 0;
+
+    alignas(64) std::atomic<RemoteBlock *> remoteFree{nullptr};
+  };
+
+  char *buffer;
+  bool ownsBuffer;
+  size_t arenaSize;
+  size_t arenasCount;
+  Arena *arenas;
+
+  std::atomic<size_t> nextArena;
+  lib::ThreadLocalStorage<Arena *> threadArenas;
+
+  void initialize(size_t capacity, size_t arenas);
+  // Destroys the first constructed arenas and frees the arena array and the owned buffer.
+  void release(size_t constructed);
+  Arena *localArena();
+  Arena *arenaOf(void *ptr);
+  static void drainRemoteFrees(Arena *arena);
+};
+
+} // namespace memory
+} // namespace lib
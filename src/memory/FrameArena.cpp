@@ -0,0 +1,186 @@
+#include "FrameArena.hpp"
+#include "AllocationTracker.hpp"
+#include "SystemMemoryManager.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+using namespace lib;
+using namespace memory;
+
+namespace
+{
+
+constexpr size_t kChunkAlignment = 64;
+
+inline char *alignUp(char *ptr, size_t alignment)
+{
+  return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+} // namespace
+
+FrameArena::FrameArena(size_t chunkSize) : chunkSize(chunkSize), states(nullptr), freeChunks(nullptr), chunks(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+  reset();
+
+  while (freeChunks)
+  {
+    Chunk *next = freeChunks->next;
+    SystemMemoryManager::free(freeChunks);
+    freeChunks = next;
+  }
+
+  while (states)
+  {
+    ThreadState *next = states->next;
+    states->~ThreadState();
+    SystemMemoryManager::free(states);
+    states = next;
+  }
+}
+
+FrameArena::ThreadState *FrameArena::localState()
+{
+  ThreadState *state = nullptr;
+
+  if (threadStates.get(state))
+  {
+    return state;
+  }
+
+  state = new (SystemMemoryManager::malloc(sizeof(ThreadState))) ThreadState();
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    state->next = states;
+    states = state;
+  }
+
+  threadStates.set(state);
+  return state;
+}
+
+void FrameArena::refill(ThreadState *state, size_t size, size_t alignment)
+{
+  size_t needed = sizeof(Chunk) + size + alignment;
+  Chunk *chunk = nullptr;
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (Chunk **curr = &freeChunks; *curr; curr = &(*curr)->next)
+    {
+      if ((*curr)->capacity >= needed)
+      {
+        chunk = *curr;
+        *curr = chunk->next;
+        break;
+      }
+    }
+  }
+
+  if (chunk == nullptr)
+  {
+    size_t capacity = needed > chunkSize ? needed : chunkSize;
+    capacity = (capacity + kChunkAlignment - 1) & ~(kChunkAlignment - 1);
+
+    static const uint16_t allocationTag = AllocationTracker::registerTag("frame arena");
+    AllocationTagScope tagScope(allocationTag);
+
+    chunk = static_cast<Chunk *>(SystemMemoryManager::allignedMalloc(capacity, kChunkAlignment, 0));
+
+    if (chunk == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+
+    chunk->capacity = capacity;
+    chunks.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  chunk->next = state->chunks;
+  state->chunks = chunk;
+  state->cursor = reinterpret_cast<char *>(chunk) + sizeof(Chunk);
+  state->end = reinterpret_cast<char *>(chunk) + chunk->capacity;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+  assert((alignment & (alignment - 1)) == 0);
+
+  ThreadState *state = localState();
+
+  char *ptr = state->cursor ? alignUp(state->cursor, alignment) : nullptr;
+
+  if (ptr == nullptr || ptr + size > state->end)
+  {
+    refill(state, size, alignment);
+    ptr = alignUp(state->cursor, alignment);
+  }
+
+  state->cursor = ptr + size;
+  state->allocated += size;
+
+  return ptr;
+}
+
+void FrameArena::addFinalizer(void *object, void (*destroy)(void *))
+{
+  Finalizer *finalizer = static_cast<Finalizer *>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+  ThreadState *state = localState();
+
+  finalizer->destroy = destroy;
+  finalizer->object = object;
+  finalizer->next = state->finalizers;
+  state->finalizers = finalizer;
+}
+
+void FrameArena::reset()
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  for (ThreadState *state = states; state; state = state->next)
+  {
+    // Newest first, objects may refer to older ones.
+    for (Finalizer *finalizer = state->finalizers; finalizer; finalizer = finalizer->next)
+    {
+      finalizer->destroy(finalizer->object);
+    }
+
+    state->finalizers = nullptr;
+
+    while (state->chunks)
+    {
+      Chunk *next = state->chunks->next;
+      state->chunks->next = freeChunks;
+      freeChunks = state->chunks;
+      state->chunks = next;
+    }
+
+    state->cursor = nullptr;
+    state->end = nullptr;
+    state->allocated = 0;
+  }
+}
+
+size_t FrameArena::chunkCount() const
+{
+  return chunks.load(std::memory_order_relaxed);
+}
+
+size_t FrameArena::bytesAllocated() const
+{
+  size_t total = 0;
+
+  for (ThreadState *state = states; state; state = state->next)
+  {
+    total += state->allocated;
+  }
+
+  return total;
+}
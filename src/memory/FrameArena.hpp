@@ -0,0 +1,115 @@
+#pragma once
+
+#include "datastructure/ThreadLocalStorage.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lib
+{
+namespace memory
+{
+
+// Linear allocator for data that only lives for one frame, such as recorded command arguments and render graph
+// compile scratch.
+//
+// Every thread bumps a pointer in its own chunk, so concurrent recording never synchronizes except when a chunk runs
+// out. reset() rewinds the arena at once, running the destructors of objects made with create, and keeps all chunks
+// for the next frame so that a steady state frame does not touch the system allocator. reset() must not run
+// concurrently with allocations and invalidates every pointer handed out before it.
+class FrameArena
+{
+public:
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  FrameArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template <typename T, typename... Args> T *create(Args &&...args)
+  {
+    if constexpr (std::is_trivially_destructible_v<T>)
+    {
+      return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+    else
+    {
+      T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      addFinalizer(object, [](void *ptr) { static_cast<T *>(ptr)->~T(); });
+      return object;
+    }
+  }
+
+  template <typename T> T *copy(const T *data, size_t count)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "FrameArena::copy only takes trivially copyable types");
+
+    if (count == 0)
+    {
+      return nullptr;
+    }
+
+    T *result = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+
+    for (size_t i = 0; i < count; i++)
+    {
+      result[i] = data[i];
+    }
+
+    return result;
+  }
+
+  void reset();
+
+  // Number of chunks owned by the arena and bytes handed out since the last reset, for tests and benchmarks.
+  size_t chunkCount() const;
+  size_t bytesAllocated() const;
+
+private:
+  struct Chunk
+  {
+    Chunk *next;
+    size_t capacity;
+  };
+
+  struct Finalizer
+  {
+    void (*destroy)(void *);
+    void *object;
+    Finalizer *next;
+  };
+
+  struct ThreadState
+  {
+    Chunk *chunks = nullptr;
+    char *cursor = nullptr;
+    char *end = nullptr;
+    size_t allocated = 0;
+    Finalizer *finalizers = nullptr;
+    ThreadState *next = nullptr;
+  };
+
+  const size_t chunkSize;
+
+  lib::ThreadLocalStorage<ThreadState *> threadStates;
+
+  std::mutex lock;
+  ThreadState *states;
+  Chunk *freeChunks;
+  std::atomic<size_t> chunks;
+
+  ThreadState *localState();
+  void refill(ThreadState *state, size_t size, size_t alignment);
+  void addFinalizer(void *object, void (*destroy)(void *));
+};
+
+} // namespace memory
+} // namespace lib
@@ -0,0 +1,232 @@
+#include "SlabMemoryManager.hpp"
+#include "SystemMemoryManager.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+using namespace lib;
+using namespace memory;
+
+namespace
+{
+
+struct Block
+{
+  Block *next;
+};
+
+struct ThreadHeap;
+
+struct alignas(64) Slab
+{
+  ThreadHeap *owner;
+  size_t sizeClass;
+};
+
+constexpr size_t kSlabHeaderSize = (sizeof(Slab) + SlabMemoryManager::GRANULARITY - 1) & ~(SlabMemoryManager::GRANULARITY - 1);
+
+struct SizeClassHeap
+{
+  // Owner only.
+  Block *magazine[SlabMemoryManager::MAGAZINE_SIZE];
+  size_t rounds = 0;
+  Block *freeList = nullptr;
+  char *bump = nullptr;
+  char *end = nullptr;
+
+  // Blocks freed by other threads.
+  alignas(64) std::atomic<Block *> remoteFree{nullptr};
+};
+
+struct ThreadHeap
+{
+  SizeClassHeap classes[SlabMemoryManager::SIZE_CLASSES];
+
+  std::atomic<bool> active{false};
+  ThreadHeap *next = nullptr;
+};
+
+std::atomic<ThreadHeap *> heaps{nullptr};
+std::atomic<size_t> slabs{0};
+
+ThreadHeap *acquireHeap()
+{
+  for (ThreadHeap *heap = heaps.load(std::memory_order_acquire); heap; heap = heap->next)
+  {
+    bool expected = false;
+
+    if (heap->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+    {
+      return heap;
+    }
+  }
+
+  // Heaps are never freed, blocks of a heap can be remotely freed at any time.
+  ThreadHeap *heap = new ThreadHeap();
+  heap->active.store(true, std::memory_order_relaxed);
+
+  ThreadHeap *head = heaps.load(std::memory_order_relaxed);
+
+  do
+  {
+    heap->next = head;
+  } while (!heaps.compare_exchange_weak(head, heap, std::memory_order_release, std::memory_order_relaxed));
+
+  return heap;
+}
+
+struct ThreadHeapHandle
+{
+  ThreadHeap *heap = nullptr;
+
+  ~ThreadHeapHandle()
+  {
+    if (heap)
+    {
+      heap->active.store(false, std::memory_order_release);
+      heap = nullptr;
+    }
+  }
+};
+
+thread_local ThreadHeapHandle currentHeap;
+
+inline ThreadHeap *localHeap()
+{
+  if (currentHeap.heap == nullptr)
+  {
+    currentHeap.heap = acquireHeap();
+  }
+
+  return currentHeap.heap;
+}
+
+inline size_t sizeClassOf(size_t size)
+{
+  return (size == 0 ? 0 : size - 1) / SlabMemoryManager::GRANULARITY;
+}
+
+inline size_t blockSizeOf(size_t sizeClass)
+{
+  return (sizeClass + 1) * SlabMemoryManager::GRANULARITY;
+}
+
+inline Slab *slabOf(void *ptr)
+{
+  return reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(SlabMemoryManager::SLAB_SIZE - 1));
+}
+
+void *carve(ThreadHeap *heap, SizeClassHeap &sizeClass, size_t index)
+{
+  size_t blockSize = blockSizeOf(index);
+
+  if (sizeClass.bump == nullptr || sizeClass.bump + blockSize > sizeClass.end)
+  {
+    void *memory = SystemMemoryManager::allignedMalloc(SlabMemoryManager::SLAB_SIZE, SlabMemoryManager::SLAB_SIZE, 0);
+
+    if (memory == nullptr)
+    {
+      return nullptr;
+    }
+
+    Slab *slab = new (memory) Slab();
+    slab->owner = heap;
+    slab->sizeClass = index;
+
+    sizeClass.bump = static_cast<char *>(memory) + kSlabHeaderSize;
+    sizeClass.end = static_cast<char *>(memory) + SlabMemoryManager::SLAB_SIZE;
+
+    slabs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void *block = sizeClass.bump;
+  sizeClass.bump += blockSize;
+  return block;
+}
+
+} // namespace
+
+void *SlabMemoryManager::malloc(size_t size)
+{
+  if (size > MAX_BLOCK_SIZE)
+  {
+    return SystemMemoryManager::malloc(size);
+  }
+
+  ThreadHeap *heap = localHeap();
+  size_t index = sizeClassOf(size);
+  SizeClassHeap &sizeClass = heap->classes[index];
+
+  if (sizeClass.rounds > 0)
+  {
+    return sizeClass.magazine[--sizeClass.rounds];
+  }
+
+  if (sizeClass.freeList == nullptr)
+  {
+    sizeClass.freeList = sizeClass.remoteFree.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  if (sizeClass.freeList)
+  {
+    Block *block = sizeClass.freeList;
+    sizeClass.freeList = block->next;
+    return block;
+  }
+
+  return carve(heap, sizeClass, index);
+}
+
+void SlabMemoryManager::free(void *ptr, size_t size)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+
+  if (size > MAX_BLOCK_SIZE)
+  {
+    return SystemMemoryManager::free(ptr);
+  }
+
+  Slab *slab = slabOf(ptr);
+  Block *block = static_cast<Block *>(ptr);
+
+  assert(slab->sizeClass == sizeClassOf(size));
+
+  ThreadHeap *heap = localHeap();
+  SizeClassHeap &sizeClass = slab->owner->classes[slab->sizeClass];
+
+  if (slab->owner != heap)
+  {
+    Block *head = sizeClass.remoteFree.load(std::memory_order_relaxed);
+
+    do
+    {
+      block->next = head;
+    } while (!sizeClass.remoteFree.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+
+    return;
+  }
+
+  if (sizeClass.rounds == MAGAZINE_SIZE)
+  {
+    // Spill half of the magazine to the local free list.
+    for (size_t i = MAGAZINE_SIZE / 2; i < MAGAZINE_SIZE; i++)
+    {
+      sizeClass.magazine[i]->next = sizeClass.freeList;
+      sizeClass.freeList = sizeClass.magazine[i];
+    }
+
+    sizeClass.rounds = MAGAZINE_SIZE / 2;
+  }
+
+  sizeClass.magazine[sizeClass.rounds++] = block;
+}
+
+size_t SlabMemoryManager::slabCount()
+{
+  return slabs.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace lib
+{
+namespace memory
+{
+
+// Size class slab allocator for small fixed size blocks such as container nodes.
+//
+// Blocks are carved from SLAB_SIZE aligned slabs, so the slab header of any block is found by masking its address.
+// Every thread owns a heap with one magazine (a small stack of free blocks) per size class, allocation and
+// deallocation of blocks owned by the calling thread never leave the magazine in the common case. Blocks freed by
+// another thread are pushed to a lock-free list of the owning heap and drained by its owner once its magazine and
+// local free list run dry. Heaps of exited threads are adopted whole by new threads, slabs are kept until exit.
+//
+// Requests larger than MAX_BLOCK_SIZE are forwarded to SystemMemoryManager, free must be given the same size that
+// was requested so both paths can be told apart.
+class SlabMemoryManager
+{
+public:
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+  static constexpr size_t GRANULARITY = 16;
+  static constexpr size_t MAX_BLOCK_SIZE = 512;
+  static constexpr size_t SIZE_CLASSES = MAX_BLOCK_SIZE / GRANULARITY;
+  static constexpr size_t MAGAZINE_SIZE = 64;
+
+  static void *malloc(size_t size);
+  static void free(void *ptr, size_t size);
+
+  // Number of slabs allocated so far, for tests and benchmarks.
+  static size_t slabCount();
+};
+
+} // namespace memory
+} // namespace lib
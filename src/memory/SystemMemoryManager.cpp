@@ -1,89 +1,162 @@
 #include "SystemMemoryManager.hpp"
+#include "AllocationTracker.hpp"
 #include "os/print.hpp"
 #include <atomic>
 #include <cstdlib>
-// #include <rpmalloc/rpmalloc.h>
+
+#if ENGINE_MEMORY_BACKEND_RPMALLOC
+#include "rpmalloc/rpmalloc.h"
+#endif
 
 using namespace lib;
 using namespace memory;
 
+namespace
+{
+thread_local uint64_t threadAllocations = 0;
+
+#if ENGINE_MEMORY_BACKEND_RPMALLOC
+
+inline void *backendMalloc(size_t size)
+{
+  return rpmalloc(size);
+}
+
+inline void *backendAlignedAlloc(size_t alignment, size_t size)
+{
+  return rpaligned_alloc(alignment, size);
+}
+
+inline void backendFree(void *ptr)
+{
+  rpfree(ptr);
+}
+
+#else
+
+inline void *backendMalloc(size_t size)
+{
+  return std::malloc(size);
+}
+
+// C11 aligned_alloc wants the size to be a multiple of the alignment.
+inline void *backendAlignedAlloc(size_t alignment, size_t size)
+{
+  return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+inline void backendFree(void *ptr)
+{
+  std::free(ptr);
+}
+
+#endif
+} // namespace
+
+#if ENGINE_MEMORY_BACKEND_RPMALLOC
+
 void SystemMemoryManager::init()
 {
-  /*
   if (rpmalloc_initialize(nullptr))
   {
     abort();
-}
- */
+  }
 }
 
 void SystemMemoryManager::shutdown()
 {
-  // return rpmalloc_finalize();
+  // With global new/delete routed to rpmalloc, static destructors and late frees still reach it after shutdown, so
+  // the heaps are left to the process exit instead of being finalized under them.
+#if !ENGINE_OVERRIDE_NEW
+  rpmalloc_finalize();
+#endif
 }
 
 void SystemMemoryManager::initializeThread()
 {
-  /*
   if (!rpmalloc_is_thread_initialized())
   {
     rpmalloc_thread_initialize();
   }
-    */
 }
 
 void SystemMemoryManager::finializeThread()
 {
-  // rpmalloc_thread_finalize();
+  rpmalloc_thread_finalize();
 }
 
-void *SystemMemoryManager::malloc(size_t size, void *hint)
+const char *SystemMemoryManager::backend()
 {
-  return std::malloc(size);
-  //  return rpmalloc(size);
+  return "rpmalloc";
 }
 
-inline void *aligned_malloc(std::size_t size, std::size_t alignment)
+#else
+
+void SystemMemoryManager::init()
 {
-#if defined(_MSC_VER) // Windows
-  return _aligned_malloc(size, alignment);
-#elif defined(__MINGW32__) // MinGW uses MSVCRT
-  return __mingw_aligned_malloc(size, alignment);
-#else                      // POSIX (Linux, macOS, etc.)
-  void *ptr = nullptr;
-  if (posix_memalign(&ptr, alignment, size) != 0)
-    return nullptr;
-  return ptr;
-#endif
 }
 
-inline void aligned_free(void *ptr)
+void SystemMemoryManager::shutdown()
+{
+}
+
+void SystemMemoryManager::initializeThread()
+{
+}
+
+void SystemMemoryManager::finializeThread()
+{
+}
+
+const char *SystemMemoryManager::backend()
+{
+  return "libc";
+}
+
+#endif
+
+void *SystemMemoryManager::malloc(size_t size, [[maybe_unused]] void *hint)
 {
-#if defined(_MSC_VER) || defined(__MINGW32__)
-  _aligned_free(ptr);
+  threadAllocations++;
+#if ENGINE_MEMORY_TRACKING
+  return AllocationTracker::track(backendMalloc(size + AllocationTracker::HEADER_SIZE), size, AllocationTracker::HEADER_SIZE);
 #else
-  free(ptr);
+  return backendMalloc(size);
 #endif
 }
 
-void *SystemMemoryManager::allignedMalloc(size_t size, size_t alignment, void *hint)
+void *SystemMemoryManager::allignedMalloc(size_t size, size_t alignment, [[maybe_unused]] void *hint)
 {
-  return aligned_alloc(alignment, size);
+  return alignedAlloc(alignment, size);
+}
 
-  // return rpaligned_alloc(alignment, size);
+void *SystemMemoryManager::alignedAlloc(size_t alignment, size_t size)
+{
+  threadAllocations++;
+#if ENGINE_MEMORY_TRACKING
+  // The header sits right before the block, an offset of one alignment keeps the block aligned.
+  size_t offset = alignment > AllocationTracker::HEADER_SIZE ? alignment : AllocationTracker::HEADER_SIZE;
+  return AllocationTracker::track(backendAlignedAlloc(alignment, size + offset), size, offset);
+#else
+  return backendAlignedAlloc(alignment, size);
+#endif
 }
+
 void SystemMemoryManager::free(void *ptr)
 {
-  std::free(ptr);
-  // return rpfree(ptr);
+#if ENGINE_MEMORY_TRACKING
+  ptr = AllocationTracker::untrack(ptr);
+#endif
+  backendFree(ptr);
 }
 
-void *SystemMemoryManager::alignedAlloc(size_t alignment, size_t size)
+uint64_t SystemMemoryManager::threadAllocationCount()
 {
-  // return rpaligned_alloc(alignment, size);
-  return aligned_alloc(alignment, size);
+  return threadAllocations;
 }
 
+#if ENGINE_OVERRIDE_NEW
+
 void *operator new(std::size_t size) noexcept(false)
 {
   if (size == 0)
@@ -212,4 +285,6 @@ void operator delete(void *ptr, const std::nothrow_t &) noexcept
 {
   lib::memory::SystemMemoryManager::free(ptr);
 }
-#endif
\ No newline at end of file
+#endif
+
+#endif
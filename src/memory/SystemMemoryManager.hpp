@@ -2,12 +2,18 @@
 
 #include <new>
 #include <stddef.h>
+#include <stdint.h>
 
 namespace lib
 {
 namespace memory
 {
 
+// Process wide allocator. The backend is picked at configure time with ENGINE_MEMORY_BACKEND, libc by default or
+// rpmalloc, in which case every thread that allocates should call initializeThread/finializeThread around its work.
+// Global new/delete are routed here unless ENGINE_OVERRIDE_NEW is disabled.
+// With ENGINE_MEMORY_TRACKING every block carries an AllocationTracker header, large alignments pay one alignment
+// of padding for it.
 class SystemMemoryManager
 {
 public:
@@ -20,6 +26,12 @@ public:
   static void *alignedAlloc(size_t alignment, size_t size);
   static void free(void *ptr);
 
+  // Name of the compiled in backend.
+  static const char *backend();
+
+  // Number of allocations made by the calling thread so far.
+  static uint64_t threadAllocationCount();
+
   template <typename T> T *allocate(size_t n, void *hint = 0)
   {
     return (T *)SystemMemoryManager::malloc(n * sizeof(T));
@@ -34,6 +46,7 @@ public:
 
 } // namespace lib
 
+#if ENGINE_OVERRIDE_NEW
 void *operator new(std::size_t size) noexcept(false);
 void *operator new[](std::size_t size) noexcept(false);
 void *operator new(std::size_t size, const std::nothrow_t &tag) noexcept;
@@ -57,3 +70,4 @@ void *operator new[](std::size_t size, std::align_val_t align) noexcept(false);
 void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &tag) noexcept;
 void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &tag) noexcept;
 #endif
+#endif
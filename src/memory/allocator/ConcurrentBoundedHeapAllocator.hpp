@@ -0,0 +1,58 @@
+#pragma once
+
+#include "memory/ConcurrentBoundedHeap.hpp"
+
+#include <new>
+
+namespace lib
+{
+namespace memory
+{
+namespace allocator
+{
+// Standard allocator over a ConcurrentBoundedHeap, containers may be filled and released from different threads.
+template <typename T> class ConcurrentBoundedHeapAllocator
+{
+public:
+  using value_type = T;
+
+  ConcurrentBoundedHeap *heap;
+
+  ConcurrentBoundedHeapAllocator(ConcurrentBoundedHeap *heap) : heap(heap)
+  {
+  }
+
+  template <typename U> ConcurrentBoundedHeapAllocator(const ConcurrentBoundedHeapAllocator<U> &other) : heap(other.heap)
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    T *ptr = static_cast<T *>(heap->allocate(sizeof(T) * n));
+
+    if (ptr == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+
+    return ptr;
+  }
+
+  void deallocate(T *ptr, [[maybe_unused]] size_t n)
+  {
+    heap->free(ptr);
+  }
+
+  template <typename U> bool operator==(const ConcurrentBoundedHeapAllocator<U> &other) const
+  {
+    return heap == other.heap;
+  }
+
+  template <typename U> bool operator!=(const ConcurrentBoundedHeapAllocator<U> &other) const
+  {
+    return heap != other.heap;
+  }
+};
+} // namespace allocator
+} // namespace memory
+} // namespace lib
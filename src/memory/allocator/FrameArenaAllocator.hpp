@@ -0,0 +1,65 @@
+#pragma once
+
+#include "memory/FrameArena.hpp"
+#include "memory/SystemMemoryManager.hpp"
+
+#include <type_traits>
+
+namespace lib
+{
+namespace memory
+{
+namespace allocator
+{
+// Standard allocator over a FrameArena, deallocation is a no-op and storage is reclaimed when the arena is reset.
+// A default constructed allocator is not bound to any arena and forwards to SystemMemoryManager, so containers
+// can be declared as members and bound to an arena when they are filled.
+template <typename T> class FrameArenaAllocator
+{
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  FrameArena *arena;
+
+  FrameArenaAllocator(FrameArena *arena = nullptr) : arena(arena)
+  {
+  }
+
+  template <typename U> FrameArenaAllocator(const FrameArenaAllocator<U> &other) : arena(other.arena)
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    if (arena)
+    {
+      return static_cast<T *>(arena->allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    return static_cast<T *>(lib::memory::SystemMemoryManager::malloc(sizeof(T) * n));
+  }
+
+  void deallocate(T *ptr, [[maybe_unused]] size_t n)
+  {
+    if (arena == nullptr)
+    {
+      lib::memory::SystemMemoryManager::free(ptr);
+    }
+  }
+
+  template <typename U> bool operator==(const FrameArenaAllocator<U> &other) const
+  {
+    return arena == other.arena;
+  }
+
+  template <typename U> bool operator!=(const FrameArenaAllocator<U> &other) const
+  {
+    return arena != other.arena;
+  }
+};
+} // namespace allocator
+} // namespace memory
+} // namespace lib
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "memory/SlabMemoryManager.hpp"
+
+namespace lib
+{
+namespace memory
+{
+namespace allocator
+{
+// Drop in replacement for SystemAllocator backed by SlabMemoryManager, meant for containers that allocate
+// many fixed size nodes. Memory must be returned with the same n it was allocated with.
+template <typename T> class SlabAllocator
+{
+  static_assert(alignof(T) <= SlabMemoryManager::GRANULARITY, "SlabAllocator blocks are only GRANULARITY aligned");
+
+public:
+  SlabAllocator()
+  {
+  }
+
+  ~SlabAllocator()
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    return (T *)lib::memory::SlabMemoryManager::malloc(sizeof(T) * n);
+  }
+
+  void deallocate(T *ptr, size_t n)
+  {
+    return lib::memory::SlabMemoryManager::free(ptr, sizeof(T) * n);
+  }
+
+  void deallocate(T *ptr)
+  {
+    return lib::memory::SlabMemoryManager::free(ptr, sizeof(T));
+  }
+};
+} // namespace allocator
+} // namespace memory
+} // namespace lib
@@ -1,4 +1,5 @@
 #include "Logger.hpp"
+#include "memory/AllocationTracker.hpp"
 #include <cstdlib>
 #include <ctime>
 #include <iomanip>
@@ -15,6 +16,7 @@ std::atomic<bool> Logger::s_started{false};
 std::atomic<bool> Logger::s_running{false};
 std::atomic<bool> Logger::s_consoleEnabled{true};
 std::atomic<int> Logger::s_idleSleep{10};
+std::atomic<int> Logger::s_level{(int)Logger::Level::Info};
 std::thread Logger::s_worker;
 
 lib::ConcurrentQueue<Logger::LogItem> Logger::s_queue;
@@ -106,6 +108,11 @@ void Logger::setIdleSleep(lib::time::TimeSpan span)
   s_idleSleep.store(span.milliseconds());
 }
 
+void Logger::setLevel(Level level)
+{
+  s_level.store((int)level);
+}
+
 void Logger::log(std::string_view msg)
 {
   enqueue(Level::Info, msg);
@@ -128,9 +135,15 @@ void Logger::ensureStarted()
 
 void Logger::enqueue(Level lvl, std::string_view msg)
 {
+  if ((int)lvl < s_level.load(std::memory_order_relaxed))
+    return;
+
   ensureStarted();
   waitForQueueSpace();
 
+  static const uint16_t allocationTag = lib::memory::AllocationTracker::registerTag("logger");
+  lib::memory::AllocationTagScope tagScope(allocationTag);
+
   LogItem item;
   item.level = lvl;
   item.text.assign(msg.begin(), msg.end());
@@ -258,6 +271,9 @@ void Logger::workerLoop()
 
 void Logger::enqueuef(Level lvl, const char *fmt, va_list args)
 {
+  if ((int)lvl < s_level.load(std::memory_order_relaxed))
+    return;
+
   ensureStarted();
 
   va_list args_copy;
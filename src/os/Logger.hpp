@@ -26,6 +26,8 @@ public:
   static void setOutputFile(const std::string &path, bool append = false);
   static void setConsoleEnabled(bool enabled);
   static void setIdleSleep(lib::time::TimeSpan span);
+  // Messages below level are dropped before they are formatted, Info by default.
+  static void setLevel(Level level);
 
   static void log(std::string_view msg);
   static void warning(std::string_view msg);
@@ -61,6 +63,7 @@ private:
   static std::atomic<bool> s_running;
   static std::atomic<bool> s_consoleEnabled;
   static std::atomic<int> s_idleSleep;
+  static std::atomic<int> s_level;
   static std::thread s_worker;
   static lib::ConcurrentQueue<LogItem> s_queue;
 
@@ -101,6 +101,11 @@ public:
 
   virtual std::vector<CommandBuffer> allocateCommandBuffers(Queue queue, uint32_t count) = 0;
   virtual void releaseCommandBuffer(std::vector<CommandBuffer> &buffers) = 0;
+  // Command buffers that outlive their submissions, they can be submitted again without being recorded and are only
+  // freed by releaseCommandBuffer. resetCommandBuffer waits for the last submission and resets the pool of the buffer
+  // so it can be recorded again.
+  virtual std::vector<CommandBuffer> allocatePersistentCommandBuffers(Queue queue, uint32_t count) = 0;
+  virtual void resetCommandBuffer(CommandBuffer) = 0;
 
   virtual void beginCommandBuffer(CommandBuffer) = 0;
   virtual void endCommandBuffer(CommandBuffer) = 0;
@@ -108,7 +113,7 @@ public:
   virtual void cmdBeginRenderPass(CommandBuffer, const RenderPassInfo &) = 0;
   virtual void cmdEndRenderPass(CommandBuffer) = 0;
 
-  virtual void cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount) = 0;
+  virtual void cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, const uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount) = 0;
   virtual void cmdBindGraphicsPipeline(CommandBuffer, GraphicsPipeline) = 0;
   virtual void cmdBindComputePipeline(CommandBuffer, ComputePipeline) = 0;
   virtual void cmdBindVertexBuffer(CommandBuffer, uint32_t slot, Buffer, uint64_t offset) = 0;
@@ -148,6 +153,8 @@ public:
       uint32_t size,
       Queue src_queue_family,
       Queue dst_queue_family) = 0;
+  // Records every barrier of the batch with a single pipeline barrier.
+  virtual void cmdBarriers(CommandBuffer cmd, const BufferBarrierInfo *buffers, uint32_t bufferCount, const TextureBarrierInfo *textures, uint32_t textureCount) = 0;
   virtual void cmdMemoryBarrier(CommandBuffer cmd, PipelineStage src_stage, PipelineStage dst_stage, AccessPattern src_access, AccessPattern dst_access) = 0;
   virtual void cmdPipelineBarrier(CommandBuffer cmd, PipelineStage src_stage, PipelineStage dst_stage, AccessPattern src_access, AccessPattern dst_access) = 0;
   virtual GPUFuture submit(Queue queue, CommandBuffer *commandBuffers, uint32_t count, GPUFuture *wait, uint32_t waitCount) = 0;
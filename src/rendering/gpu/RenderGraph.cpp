@@ -1,13 +1,20 @@
 #include "RenderGraph.hpp"
 #include "os/Logger.hpp"
 #include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <map>
+#include <numeric>
 #include <sstream>
 #include <unordered_map>
 
-#include "datastructure/BoundedTaggedRectTreap.hpp"
+#include "async/async.hpp"
 #include "datastructure/ConcurrentQueue.hpp"
-#include "datastructure/TaggedInternvalTree.hpp"
+#include "datastructure/FlatIntervalMap.hpp"
+#include "datastructure/FlatMap.hpp"
+#include "datastructure/TaggedGrid.hpp"
+#include "memory/AllocationTracker.hpp"
+#include "os/Thread.hpp"
 #include "time/TimeSpan.hpp"
 
 #define RENDER_GRAPH_FATAL(...)                                                                                                                                                    \
@@ -349,28 +356,20 @@ std::string bufferUsageToString(int usage)
   return oss.str();
 }
 
-struct BufferSlice
+void RenderGraph::registerConsumer(uint32_t resourceId, const InputResource &res, uint32_t taskId, Queue queue)
 {
-  std::string bufferId;
-  size_t offset;
-  size_t size;
-};
-
-void RenderGraph::registerConsumer(const std::string &name, const InputResource &res, uint32_t taskId, Queue queue)
-{
-
   switch (res.type)
   {
   case ResourceType::ResourceType_BufferView:
   {
-    auto id = resources.bufferMetadatas.find(name);
+    auto meta = resources.bufferMetadatas.get(resourceId);
 
-    if (id == resources.bufferMetadatas.end())
+    if (meta == nullptr)
     {
       throw std::runtime_error("Buffer not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         BufferResourceUsage{
           .view = res.bufferView,
           .consumer = taskId,
@@ -380,15 +379,14 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_TextureView:
   {
-    auto id = resources.textureMetadatas.find(name);
+    auto meta = resources.textureMetadatas.get(resourceId);
 
-    if (id == resources.textureMetadatas.end())
+    if (meta == nullptr)
     {
-      os::print("Texture %s\n", name.c_str());
       throw std::runtime_error("Texture not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         TextureResourceUsage{
           .view = res.textureView,
           .consumer = taskId,
@@ -398,14 +396,14 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_Sampler:
   {
-    auto id = resources.samplerMetadatas.find(name);
+    auto meta = resources.samplerMetadatas.get(resourceId);
 
-    if (id == resources.samplerMetadatas.end())
+    if (meta == nullptr)
     {
       throw std::runtime_error("Sampler not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         SamplerResourceUsage{
           .sampler = res.sampler,
           .consumer = taskId,
@@ -415,13 +413,13 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_BindingsLayout:
   {
-    auto id = resources.bindingsLayoutMetadata.find(name);
-    if (id == resources.bindingsLayoutMetadata.end())
+    auto meta = resources.bindingsLayoutMetadata.get(resourceId);
+    if (meta == nullptr)
     {
       throw std::runtime_error("BindingsLayout not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         BindingsLayoutResourceUsage{
           .consumer = taskId,
           .queue = queue,
@@ -430,13 +428,13 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_BindingGroups:
   {
-    auto id = resources.bindingGroupsMetadata.find(name);
-    if (id == resources.bindingGroupsMetadata.end())
+    auto meta = resources.bindingGroupsMetadata.get(resourceId);
+    if (meta == nullptr)
     {
       throw std::runtime_error("BindingGroups not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         BindingGroupsResourceUsage{
           .consumer = taskId,
           .queue = queue,
@@ -445,13 +443,13 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_ComputePipeline:
   {
-    auto id = resources.computePipelineMetadata.find(name);
-    if (id == resources.computePipelineMetadata.end())
+    auto meta = resources.computePipelineMetadata.get(resourceId);
+    if (meta == nullptr)
     {
       throw std::runtime_error("ComputePipeline not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         ComputePipelineResourceUsage{
           .consumer = taskId,
           .queue = queue,
@@ -460,13 +458,13 @@ void RenderGraph::registerConsumer(const std::string &name, const InputResource
   break;
   case ResourceType::ResourceType_GraphicsPipeline:
   {
-    auto id = resources.graphicsPipelineMetadata.find(name);
-    if (id == resources.graphicsPipelineMetadata.end())
+    auto meta = resources.graphicsPipelineMetadata.get(resourceId);
+    if (meta == nullptr)
     {
       throw std::runtime_error("GraphicsPipeline not found");
     }
 
-    id->usages.push_back(
+    meta->usages.push_back(
         GraphicsPipelineResourceUsage{
           .consumer = taskId,
           .queue = queue,
@@ -486,6 +484,45 @@ RHIResources::RHIResources(RenderGraph *renderGraph) : renderGraph(renderGraph)
 RenderGraph::RenderGraph(RHI *renderingHardwareInterface) : rhi(renderingHardwareInterface), resources(this)
 {
   compiled = false;
+  executions = 0;
+  compiles = 0;
+  frameArenaIndex = 0;
+  compiledResourcesVersion = 0;
+  resourcesVersion.store(0);
+
+  for (auto &slot : commandBufferSlots)
+  {
+    slot.compile = 0;
+  }
+
+  for (auto &count : commandBuffersCount)
+  {
+    count = 0;
+  }
+}
+
+RenderGraph::~RenderGraph()
+{
+  for (auto &slot : commandBufferSlots)
+  {
+    for (auto &commandBuffers : slot.commandBuffers)
+    {
+      if (!commandBuffers.empty())
+      {
+        rhi->releaseCommandBuffer(commandBuffers);
+      }
+    }
+  }
+}
+
+lib::memory::FrameArena &RenderGraph::recordingArena()
+{
+  return frameArenas[frameArenaIndex & 1];
+}
+
+lib::memory::FrameArena &RenderGraph::compiledArena()
+{
+  return frameArenas[(frameArenaIndex + 1) & 1];
 }
 
 // void RenderGraph::analyseCommands(RHICommandBuffer &recorder)
@@ -519,22 +556,24 @@ RenderGraph::RenderGraph(RHI *renderingHardwareInterface) : rhi(renderingHardwar
 //   }
 // }
 
-Queue inferQueue(const std::vector<Command> &commands)
+Queue inferQueue(const CommandRange &commands)
 {
-  if (commands.size() == 0)
+  if (commands.empty())
   {
     return Queue::None;
   }
-  auto type = commands.back().type;
 
-  for (int i = commands.size() - 1; i >= 0; i--)
+  // Type of the last command that is not a binding group or timer, or of the first one when they all are.
+  auto type = commands.first->type;
+
+  for (const auto &cmd : commands)
   {
-    type = commands[i].type;
-    if (type != BindBindingGroups && type != StartTimer && type != StopTimer)
+    if (cmd.type != BindBindingGroups && cmd.type != StartTimer && cmd.type != StopTimer)
     {
-      break;
+      type = cmd.type;
     }
   }
+
   switch (type)
   {
   case BeginRenderPass:
@@ -553,12 +592,37 @@ Queue inferQueue(const std::vector<Command> &commands)
     return Queue::Transfer;
 
   default:
-    RENDER_GRAPH_FATAL("[RenderGraph] Invalid command type %u on sequence of size %u", type, commands.size());
+    RENDER_GRAPH_FATAL("[RenderGraph] Invalid command type %u", type);
   }
 
   return Queue::None;
 }
 
+// Shader stages of the work a node records, shader accesses of its resources happen in these stages.
+static PipelineStage inferShaderStages(const CommandRange &commands)
+{
+  PipelineStage stages = PipelineStage::NONE;
+
+  for (const auto &cmd : commands)
+  {
+    switch (cmd.type)
+    {
+    case Dispatch:
+      stages = stages | PipelineStage::COMPUTE_SHADER;
+      break;
+    case Draw:
+    case DrawIndexed:
+    case DrawIndexedIndirect:
+      stages = stages | PipelineStage::VERTEX_SHADER | PipelineStage::FRAGMENT_SHADER;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return stages;
+}
+
 static bool isTransferOnlyCommand(CommandType type)
 {
   return type == CopyBuffer;
@@ -569,17 +633,16 @@ static bool isDrawCommand(CommandType type)
   return type == Draw || type == DrawIndexed || type == DrawIndexedIndirect;
 }
 
-std::vector<RHICommandBuffer::CommandSequence> splitCommands(RHICommandBuffer::CommandSequence &cmds)
+// Splits the commands of a pass in ranges ending at each dispatch or copy, the ranges point into the stream.
+FrameVector<CommandRange> splitCommands(lib::memory::FrameArena &arena, const CommandStream &cmds)
 {
-  // TODO: improve
-  std::vector<RHICommandBuffer::CommandSequence> result;
-  // Queue lastQueue = Queue::None;
-  result.emplace_back();
+  FrameVector<CommandRange> result(&arena);
+  CommandRange all = cmds.range();
+  result.push_back(CommandRange{all.first, all.first});
 
-  for (auto &command : cmds.commands)
+  for (auto &command : all)
   {
-    Queue currentQueue = Queue::None;
-    result.back().commands.push_back(command);
+    result.back().last = command.next();
 
     switch (command.type)
     {
@@ -591,7 +654,7 @@ std::vector<RHICommandBuffer::CommandSequence> splitCommands(RHICommandBuffer::C
     case DrawIndexedIndirect:
     case Dispatch:
     case CopyBuffer:
-      result.emplace_back();
+      result.push_back(CommandRange{command.next(), command.next()});
       break;
     case BindComputePipeline:
     case BindGraphicsPipeline:
@@ -604,19 +667,6 @@ std::vector<RHICommandBuffer::CommandSequence> splitCommands(RHICommandBuffer::C
     default:
       RENDER_GRAPH_FATAL("[RenderGraph] Invalid command type %u", command.type);
     }
-
-    // if (result.empty())
-    // {
-    //   lastQueue = currentQueue;
-    // }
-    // if (currentQueue != lastQueue && currentQueue != Queue::None)
-    // {
-    //   if (result.back().commands.size() > 0 && result.back().commands.back().type != StartTimer && result.back().commands.back().type != StopTimer)
-    //   {
-    //     result.emplace_back();
-    //   }
-    //   lastQueue = currentQueue;
-    // }
   }
 
   for (size_t seqIndex = 0; seqIndex < result.size(); ++seqIndex)
@@ -630,7 +680,7 @@ std::vector<RHICommandBuffer::CommandSequence> splitCommands(RHICommandBuffer::C
     bool hasDispatch = false;
     bool hasOnlyTransfer = true;
 
-    for (auto &cmd : sequence.commands)
+    for (auto &cmd : sequence)
     {
       switch (cmd.type)
       {
@@ -705,375 +755,535 @@ std::vector<RHICommandBuffer::CommandSequence> splitCommands(RHICommandBuffer::C
   return result;
 }
 
-void RenderGraph::enqueuePass(std::string name, RHICommandBuffer &cmd)
+void RenderGraph::enqueuePass(std::string name, RHICommandBuffer &cmd, PassFlags flags)
 {
-  auto pass = RenderGraphPass{
-    .name = name,
-    .cmd = cmd,
-  };
-
-  passes.enqueue(pass);
+  passes.enqueue(RenderGraphPass{
+    .name = std::move(name),
+    .cmd = std::move(cmd),
+    .flags = flags,
+  });
 }
 
-void RenderGraph::analysePasses()
+// Hash of the parts of a pass the analysis reads, command types and the resources, views and pipelines they use.
+// Plain arguments such as draw counts, dynamic offsets or clear values are left out, they only end up in the commands.
+struct PassHash
 {
-  RenderGraphPass pass;
+  uint64_t value = 0;
 
-  while (passes.dequeue(pass))
+  void add(uint64_t v)
   {
-    RHICommandBuffer recorder = pass.cmd;
-    // analyseCommands(recorder);
+    value ^= v + 0x9e3779b97f4a7c15ULL + (value << 6) + (value >> 2);
+  }
 
-    uint32_t index = 0;
-    uint32_t dispatchId = nodes.size();
+  void add(const std::string &name)
+  {
+    add(std::hash<std::string>{}(name));
+  }
 
-    for (auto &recordedCommands : pass.cmd.recorded)
-    {
-      auto split = splitCommands(recordedCommands);
-      for (auto commands : split)
-      {
-        uint32_t id = nodes.size();
+  void add(const BufferViewArgs &view)
+  {
+    add(view.buffer);
+    add(view.offset);
+    add(view.size);
+    add((uint64_t)view.access);
+  }
 
-        if (commands.commands.size() == 0)
-        {
-          continue;
-        }
+  void add(const TextureViewArgs &view)
+  {
+    add(view.texture);
+    add(view.baseMipLevel);
+    add(view.levelCount);
+    add(view.baseArrayLayer);
+    add(view.layerCount);
+    add((uint64_t)view.access);
+    add((uint64_t)view.layout);
+  }
+};
 
-        auto node = RenderGraphNode();
+uint64_t RenderGraph::hashPass(const RenderGraphPass &pass)
+{
+  PassHash hash;
+  hash.add(pass.name);
+  hash.add((uint64_t)pass.flags);
 
-        node.name = pass.name + "[" + std::to_string(index++) + "]";
-        node.dispatchId = dispatchId;
-        node.commandBufferIndex = -1;
-        node.id = id;
-        node.level = 0;
-        node.priority = id;
-        node.commands = std::move(commands.commands);
-        node.queue = inferQueue(node.commands);
+  for (const auto &cmd : pass.cmd.commands)
+  {
+    hash.add((uint64_t)cmd.type);
 
-        if (node.queue == Queue::None)
-        {
-          RENDER_GRAPH_FATAL("[RenderGraph] %s is not submitted to any queue", pass.name.c_str());
-        }
+    switch (cmd.type)
+    {
+    case BeginRenderPass:
+    {
+      const auto &args = cmd.args<BeginRenderPassArgs>();
 
-        nodes.emplace_back(node);
+      for (uint32_t i = 0; i < args.colorAttachmentCount; i++)
+      {
+        hash.add(args.colorAttachments()[i].view);
+      }
+      if (args.depthStencilAttachment())
+      {
+        hash.add(args.depthStencilAttachment()->view);
+      }
+      break;
+    }
+    case CopyBuffer:
+      hash.add(cmd.args<CopyBufferArgs>().src);
+      hash.add(cmd.args<CopyBufferArgs>().dst);
+      break;
+    case BindBindingGroups:
+      hash.add(cmd.args<BindGroupsArgs>().groups);
+      break;
+    case BindVertexBuffer:
+      hash.add(cmd.args<BindVertexBufferArgs>().buffer);
+      break;
+    case BindIndexBuffer:
+      hash.add(cmd.args<BindIndexBufferArgs>().buffer);
+      break;
+    case BindComputePipeline:
+    case BindGraphicsPipeline:
+      hash.add(cmd.args<BindPipelineArgs>().pipeline);
+      break;
+    case DrawIndexedIndirect:
+      hash.add(cmd.args<DrawIndexedIndirectArgs>().buffer);
+      break;
+    default:
+      break;
+    }
+  }
 
-        auto symbol = resources.bindingGroupsMetadata.end();
+  return hash.value;
+}
 
-        for (const auto &cmd : node.commands)
-        {
-          switch (cmd.type)
-          {
-          case BeginRenderPass:
-            for (auto &attatchment : cmd.args.renderPassInfo->colorAttachments)
-            {
-              registerConsumer(
-                  attatchment.view.texture.name,
-                  InputResource{
-                    .type = ResourceType::ResourceType_TextureView,
-                    .textureView = attatchment.view,
-                    .layout = attatchment.view.layout,
-                    .access = attatchment.view.access,
-                  },
+template <typename T> static FrameVector<T> moveToArena(FrameVector<T> &from, lib::memory::FrameArena &arena)
+{
+  FrameVector<T> to(&arena);
+  to.reserve(from.size());
+  std::move(from.begin(), from.end(), std::back_inserter(to));
+  return to;
+}
 
-                  id,
-                  node.queue);
-            }
-            if (cmd.args.renderPassInfo->depthStencilAttachment)
-            {
-              auto &attatchment = *cmd.args.renderPassInfo->depthStencilAttachment;
-              registerConsumer(
-                  attatchment.view.texture.name,
-                  InputResource{
-                    .type = ResourceType::ResourceType_TextureView,
-                    .textureView = attatchment.view,
-                    .layout = attatchment.view.layout,
-                    .access = attatchment.view.access,
-                  },
-                  id,
-                  node.queue);
-            }
-            break;
-          case EndRenderPass:
-            break;
-          case CopyBuffer:
-          {
-            auto src = cmd.args.copyBuffer->src;
-            auto dst = cmd.args.copyBuffer->dst;
-            auto srcMeta = resources.bufferMetadatas.find(cmd.args.copyBuffer->src.buffer.name);
-            auto dstMeta = resources.bufferMetadatas.find(cmd.args.copyBuffer->dst.buffer.name);
+// Takes the commands of the pending passes into the nodes of the last compile, whose structure they match. The
+// results of the analysis are moved out of the arena the last compile used, which is recycled for recording.
+void RenderGraph::reuseCompile()
+{
+  frameArenaIndex += 1;
 
-            if (srcMeta == resources.bufferMetadatas.end())
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source buffer '%s' not found in metadata", src.buffer.name.c_str());
-            }
+  size_t id = 0;
 
-            if (dstMeta == resources.bufferMetadatas.end())
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Destination buffer '%s' not found in metadata", dst.buffer.name.c_str());
-            }
+  for (auto &pass : pendingPasses)
+  {
+    for (auto &commands : splitCommands(compiledArena(), pass.cmd.commands))
+    {
+      if (commands.empty())
+      {
+        continue;
+      }
 
-            const BufferInfo &srcInfo = srcMeta->bufferInfo;
-            const BufferInfo &dstInfo = dstMeta->bufferInfo;
+      if (id == nodes.size())
+      {
+        RENDER_GRAPH_FATAL("[RenderGraph] Pass %s does not match the compiled graph", pass.name.c_str());
+      }
 
-            /* ================= BASIC VALIDATION ================= */
+      nodes[id++].commands = commands;
+    }
+  }
 
-            if (src.size == 0)
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Copy size is zero (src='%s')", src.buffer.name.c_str());
-            }
+  if (id != nodes.size())
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Passes do not match the compiled graph");
+  }
 
-            if (src.buffer == dst.buffer)
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source and destination buffers are the same ('%s')", src.buffer.name.c_str());
-            }
+  for (auto &node : nodes)
+  {
+    size_t nameLength = strlen(node.name);
+    char *name = static_cast<char *>(compiledArena().allocate(nameLength + 1, 1));
+    memcpy(name, node.name, nameLength + 1);
+
+    node.name = name;
+    node.signalSemaphores = moveToArena(node.signalSemaphores, compiledArena());
+    node.waitSemaphores = moveToArena(node.waitSemaphores, compiledArena());
+    node.textureTransitions = moveToArena(node.textureTransitions, compiledArena());
+    node.bufferTransitions = moveToArena(node.bufferTransitions, compiledArena());
+  }
 
-            if (src.offset + src.size > srcInfo.size)
-            {
-              RENDER_GRAPH_FATAL(
-                  "[RHI][CopyBuffer] Source buffer '%s' overflow (offset=%llu size=%llu bufferSize=%llu)", src.buffer.name.c_str(), src.offset, src.size, srcInfo.size);
-            }
+  for (auto &nodeEdges : edges)
+  {
+    nodeEdges = moveToArena(nodeEdges, compiledArena());
+  }
 
-            if (dst.offset + dst.size > dstInfo.size)
-            {
-              RENDER_GRAPH_FATAL(
-                  "[RHI][CopyBuffer] Destination buffer '%s' overflow (offset=%llu size=%llu bufferSize=%llu)", dst.buffer.name.c_str(), dst.offset, dst.size, dstInfo.size);
-            }
+  recordingArena().reset();
+}
 
-            if (src.size != dst.size)
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source and destination copy sizes differ (src=%llu dst=%llu)", src.size, dst.size);
-            }
+void RenderGraph::analysePasses()
+{
+  for (auto &pass : pendingPasses)
+  {
+    uint32_t index = 0;
+    uint32_t dispatchId = nodes.size();
 
-            /* ================= USAGE VALIDATION (WebGPU-style) ================= */
+    for (auto &commands : splitCommands(compiledArena(), pass.cmd.commands))
+    {
+      uint32_t id = nodes.size();
 
-            if (!(srcInfo.usage & BufferUsage_CopySrc))
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source buffer '%s' missing BufferUsage_CopySrc", src.buffer.name.c_str());
-            }
+      if (commands.empty())
+      {
+        continue;
+      }
 
-            if (!(dstInfo.usage & BufferUsage_CopyDst))
-            {
-              RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Destination buffer '%s' missing BufferUsage_CopyDst", dst.buffer.name.c_str());
-            }
+      auto node = RenderGraphNode();
+
+      int nameLength = snprintf(nullptr, 0, "%s[%u]", pass.name.c_str(), index);
+      char *name = static_cast<char *>(compiledArena().allocate(nameLength + 1, 1));
+      snprintf(name, nameLength + 1, "%s[%u]", pass.name.c_str(), index++);
+
+      node.name = name;
+      node.dispatchId = dispatchId;
+      node.commandBufferIndex = -1;
+      node.id = id;
+      node.level = 0;
+      node.priority = id;
+      node.commands = commands;
+      node.signalSemaphores = FrameVector<uint64_t>(&compiledArena());
+      node.waitSemaphores = FrameVector<uint64_t>(&compiledArena());
+      node.textureTransitions = FrameVector<TextureBarrier>(&compiledArena());
+      node.bufferTransitions = FrameVector<BufferBarrier>(&compiledArena());
+      node.queue = inferQueue(node.commands);
+      node.shaderStages = inferShaderStages(node.commands);
+      node.isStatic = pass.flags & PassFlags_Static;
+
+      if (node.queue == Queue::None)
+      {
+        RENDER_GRAPH_FATAL("[RenderGraph] %s is not submitted to any queue", pass.name.c_str());
+      }
+
+      nodes.emplace_back(node);
+
+      BindingGroupsResourceMetadata *symbol = nullptr;
 
-            /* ================= RECORD COMMAND ================= */
+      for (const auto &cmd : node.commands)
+      {
+        switch (cmd.type)
+        {
+        case BeginRenderPass:
+        {
+          const auto &args = cmd.args<BeginRenderPassArgs>();
 
+          for (uint32_t i = 0; i < args.colorAttachmentCount; i++)
+          {
+            const auto &attatchment = args.colorAttachments()[i];
             registerConsumer(
-                cmd.args.copyBuffer->src.buffer.name,
+                attatchment.view.texture,
                 InputResource{
-                  .type = ResourceType::ResourceType_BufferView,
-                  .bufferView = cmd.args.copyBuffer->src,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = cmd.args.copyBuffer->src.access,
+                  .type = ResourceType::ResourceType_TextureView,
+                  .textureView = textureView(attatchment.view),
+                  .layout = attatchment.view.layout,
+                  .access = attatchment.view.access,
                 },
+
                 id,
                 node.queue);
+          }
+          if (args.depthStencilAttachment())
+          {
+            const auto &attatchment = *args.depthStencilAttachment();
             registerConsumer(
-                cmd.args.copyBuffer->dst.buffer.name,
+                attatchment.view.texture,
                 InputResource{
-                  .type = ResourceType::ResourceType_BufferView,
-                  .bufferView = cmd.args.copyBuffer->dst,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = cmd.args.copyBuffer->dst.access,
+                  .type = ResourceType::ResourceType_TextureView,
+                  .textureView = textureView(attatchment.view),
+                  .layout = attatchment.view.layout,
+                  .access = attatchment.view.access,
                 },
                 id,
                 node.queue);
           }
           break;
-          case BindBindingGroups:
-            symbol = resources.bindingGroupsMetadata.find(cmd.args.bindGroups->groups.name);
-            if (symbol == resources.bindingGroupsMetadata.end())
-            {
-              throw std::runtime_error("Bunding Groups not found");
-            }
-            registerConsumer(
-                symbol->groupsInfo.layout.name,
-                InputResource{
-                  .type = ResourceType::ResourceType_BindingsLayout,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = AccessPattern::NONE,
-                },
-                id,
-                node.queue);
-            registerConsumer(
-                cmd.args.bindGroups->groups.name,
-                InputResource{
-                  .type = ResourceType::ResourceType_BindingGroups,
-                  .bindingGroups = cmd.args.bindGroups->groups,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = AccessPattern::NONE,
-                },
-                id,
-                node.queue);
+        }
+        case EndRenderPass:
+          break;
+        case CopyBuffer:
+        {
+          const auto &src = cmd.args<CopyBufferArgs>().src;
+          const auto &dst = cmd.args<CopyBufferArgs>().dst;
+          auto srcMeta = resources.bufferMetadatas.get(src.buffer);
+          auto dstMeta = resources.bufferMetadatas.get(dst.buffer);
 
-            for (auto &group : symbol->groupsInfo.groups)
-            {
-              for (auto &buffer : group.buffers)
-              {
-                registerConsumer(
-                    buffer.bufferView.buffer.name,
-                    InputResource{
-                      .type = ResourceType::ResourceType_BufferView,
-                      .bufferView = buffer.bufferView,
-                      .layout = ResourceLayout::UNDEFINED,
-                      .access = buffer.bufferView.access,
-                    },
-                    id,
-                    node.queue);
-              }
+          if (srcMeta == nullptr)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source buffer '%s' not found in metadata", resources.bufferMetadatas.nameOf(src.buffer).c_str());
+          }
 
-              for (auto &texture : group.textures)
-              {
-                registerConsumer(
-                    texture.textureView.texture.name,
-                    InputResource{
-                      .type = ResourceType::ResourceType_TextureView,
-                      .textureView = texture.textureView,
-                      .layout = texture.textureView.layout,
-                      .access = texture.textureView.access,
-                    },
-                    id,
-                    node.queue);
-              }
+          if (dstMeta == nullptr)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Destination buffer '%s' not found in metadata", resources.bufferMetadatas.nameOf(dst.buffer).c_str());
+          }
 
-              for (auto &texture : group.storageTextures)
-              {
-                registerConsumer(
-                    texture.textureView.texture.name,
-                    InputResource{
-                      .type = ResourceType::ResourceType_TextureView,
-                      .textureView = texture.textureView,
-                      .layout = texture.textureView.layout,
-                      .access = texture.textureView.access,
-                    },
-                    id,
-                    node.queue);
-              }
+          const BufferInfo &srcInfo = srcMeta->bufferInfo;
+          const BufferInfo &dstInfo = dstMeta->bufferInfo;
 
-              for (auto &texture : group.samplers)
-              {
-                registerConsumer(
-                    texture.view.texture.name,
-                    InputResource{
-                      .type = ResourceType::ResourceType_TextureView,
-                      .textureView = texture.view,
-                      .layout = texture.view.layout,
-                      .access = texture.view.access,
-                    },
-                    id,
-                    node.queue);
-                registerConsumer(
-                    texture.sampler.name,
-                    InputResource{
-                      .type = ResourceType::ResourceType_Sampler,
-                      .sampler = texture.sampler,
-                      .layout = ResourceLayout::UNDEFINED,
-                      .access = AccessPattern::NONE,
-                    },
-                    id,
-                    node.queue);
-              }
-            }
-            break;
-          case BindVertexBuffer:
-            registerConsumer(
-                cmd.args.bindVertexBuffer->buffer.buffer.name,
-                InputResource{
-                  .type = ResourceType::ResourceType_BufferView,
-                  .bufferView = cmd.args.bindVertexBuffer->buffer,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = cmd.args.bindVertexBuffer->buffer.access,
-                },
-                id,
-                node.queue);
-            break;
-          case BindIndexBuffer:
-            registerConsumer(
-                cmd.args.bindIndexBuffer->buffer.buffer.name,
-                InputResource{
-                  .type = ResourceType::ResourceType_BufferView,
-                  .bufferView = cmd.args.bindIndexBuffer->buffer,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = cmd.args.bindIndexBuffer->buffer.access,
-                },
-                id,
-                node.queue);
-            break;
-          case BindComputePipeline:
-            registerConsumer(
-                cmd.args.computePipeline->name,
-                InputResource{
-                  .type = ResourceType::ResourceType_ComputePipeline,
-                  .computePipeline = *cmd.args.computePipeline,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = AccessPattern::NONE,
-                },
-                id,
-                node.queue);
-            break;
-          case BindGraphicsPipeline:
-            registerConsumer(
-                cmd.args.graphicsPipeline->name,
-                InputResource{
-                  .type = ResourceType::ResourceType_GraphicsPipeline,
-                  .graphicsPipeline = *cmd.args.graphicsPipeline,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = AccessPattern::NONE,
-                },
-                id,
-                node.queue);
-            break;
-          case DrawIndexedIndirect:
-            registerConsumer(
-                cmd.args.drawIndexedIndirect->buffer.buffer.name,
-                InputResource{
-                  .type = ResourceType::ResourceType_BufferView,
-                  .bufferView = cmd.args.drawIndexedIndirect->buffer,
-                  .layout = ResourceLayout::UNDEFINED,
-                  .access = cmd.args.drawIndexedIndirect->buffer.access,
-                },
-                id,
-                node.queue);
-            break;
-          case Draw:
-          case DrawIndexed:
-          case Dispatch:
-          case StartTimer:
-          case StopTimer:
-            break;
-          default:
-            RENDER_GRAPH_FATAL("Unsuported command");
-            break;
+          /* ================= BASIC VALIDATION ================= */
+
+          if (src.size == 0)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Copy size is zero (src='%s')", srcInfo.name.c_str());
           }
-        }
-        // taskData[id].registry.sortResources();
-      }
-    }
-  }
-}
 
-uint32_t RenderGraph::levelDFS(uint32_t id, std::vector<bool> &visited, uint32_t level)
-{
-  uint32_t max = level;
+          if (src.buffer == dst.buffer)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source and destination buffers are the same ('%s')", srcInfo.name.c_str());
+          }
 
-  if (nodes[id].level < level)
-  {
-    nodes[id].level = level;
-    for (auto &edge : edges[id])
-    {
-      uint32_t maxChilds = levelDFS(edge.taskId, visited, level + 1);
+          if (src.offset + src.size > srcInfo.size)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source buffer '%s' overflow (offset=%llu size=%llu bufferSize=%llu)", srcInfo.name.c_str(), src.offset, src.size, srcInfo.size);
+          }
 
-      if (maxChilds > max)
-      {
-        max = maxChilds;
-      }
-    }
-  }
+          if (dst.offset + dst.size > dstInfo.size)
+          {
+            RENDER_GRAPH_FATAL(
+                "[RHI][CopyBuffer] Destination buffer '%s' overflow (offset=%llu size=%llu bufferSize=%llu)", dstInfo.name.c_str(), dst.offset, dst.size, dstInfo.size);
+          }
+
+          if (src.size != dst.size)
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source and destination copy sizes differ (src=%llu dst=%llu)", src.size, dst.size);
+          }
+
+          /* ================= USAGE VALIDATION (WebGPU-style) ================= */
+
+          if (!(srcInfo.usage & BufferUsage_CopySrc))
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Source buffer '%s' missing BufferUsage_CopySrc", srcInfo.name.c_str());
+          }
+
+          if (!(dstInfo.usage & BufferUsage_CopyDst))
+          {
+            RENDER_GRAPH_FATAL("[RHI][CopyBuffer] Destination buffer '%s' missing BufferUsage_CopyDst", dstInfo.name.c_str());
+          }
+
+          /* ================= RECORD COMMAND ================= */
+
+          registerConsumer(
+              src.buffer,
+              InputResource{
+                .type = ResourceType::ResourceType_BufferView,
+                .bufferView = bufferView(src),
+                .layout = ResourceLayout::UNDEFINED,
+                .access = src.access,
+              },
+              id,
+              node.queue);
+          registerConsumer(
+              dst.buffer,
+              InputResource{
+                .type = ResourceType::ResourceType_BufferView,
+                .bufferView = bufferView(dst),
+                .layout = ResourceLayout::UNDEFINED,
+                .access = dst.access,
+              },
+              id,
+              node.queue);
+        }
+        break;
+        case BindBindingGroups:
+          symbol = resources.bindingGroupsMetadata.get(cmd.args<BindGroupsArgs>().groups);
+          if (symbol == nullptr)
+          {
+            throw std::runtime_error("Bunding Groups not found");
+          }
+          registerConsumer(
+              resources.bindingsLayoutMetadata.idOf(symbol->groupsInfo.layout),
+              InputResource{
+                .type = ResourceType::ResourceType_BindingsLayout,
+                .layout = ResourceLayout::UNDEFINED,
+                .access = AccessPattern::NONE,
+              },
+              id,
+              node.queue);
+          registerConsumer(
+              cmd.args<BindGroupsArgs>().groups,
+              InputResource{
+                .type = ResourceType::ResourceType_BindingGroups,
+                .layout = ResourceLayout::UNDEFINED,
+                .access = AccessPattern::NONE,
+              },
+              id,
+              node.queue);
+
+          for (auto &group : symbol->groupsInfo.groups)
+          {
+            for (auto &buffer : group.buffers)
+            {
+              registerConsumer(
+                  resources.bufferMetadatas.idOf(buffer.bufferView.buffer),
+                  InputResource{
+                    .type = ResourceType::ResourceType_BufferView,
+                    .bufferView = buffer.bufferView,
+                    .layout = ResourceLayout::UNDEFINED,
+                    .access = buffer.bufferView.access,
+                  },
+                  id,
+                  node.queue);
+            }
+
+            for (auto &texture : group.textures)
+            {
+              registerConsumer(
+                  resources.textureMetadatas.idOf(texture.textureView.texture),
+                  InputResource{
+                    .type = ResourceType::ResourceType_TextureView,
+                    .textureView = texture.textureView,
+                    .layout = texture.textureView.layout,
+                    .access = texture.textureView.access,
+                  },
+                  id,
+                  node.queue);
+            }
+
+            for (auto &texture : group.storageTextures)
+            {
+              registerConsumer(
+                  resources.textureMetadatas.idOf(texture.textureView.texture),
+                  InputResource{
+                    .type = ResourceType::ResourceType_TextureView,
+                    .textureView = texture.textureView,
+                    .layout = texture.textureView.layout,
+                    .access = texture.textureView.access,
+                  },
+                  id,
+                  node.queue);
+            }
+
+            for (auto &texture : group.samplers)
+            {
+              registerConsumer(
+                  resources.textureMetadatas.idOf(texture.view.texture),
+                  InputResource{
+                    .type = ResourceType::ResourceType_TextureView,
+                    .textureView = texture.view,
+                    .layout = texture.view.layout,
+                    .access = texture.view.access,
+                  },
+                  id,
+                  node.queue);
+              registerConsumer(
+                  resources.samplerMetadatas.idOf(texture.sampler),
+                  InputResource{
+                    .type = ResourceType::ResourceType_Sampler,
+                    .sampler = texture.sampler,
+                    .layout = ResourceLayout::UNDEFINED,
+                    .access = AccessPattern::NONE,
+                  },
+                  id,
+                  node.queue);
+            }
+          }
+          break;
+        case BindVertexBuffer:
+        {
+          const auto &buffer = cmd.args<BindVertexBufferArgs>().buffer;
+          registerConsumer(
+              buffer.buffer,
+              InputResource{
+                .type = ResourceType::ResourceType_BufferView,
+                .bufferView = bufferView(buffer),
+                .layout = ResourceLayout::UNDEFINED,
+                .access = buffer.access,
+              },
+              id,
+              node.queue);
+          break;
+        }
+        case BindIndexBuffer:
+        {
+          const auto &buffer = cmd.args<BindIndexBufferArgs>().buffer;
+          registerConsumer(
+              buffer.buffer,
+              InputResource{
+                .type = ResourceType::ResourceType_BufferView,
+                .bufferView = bufferView(buffer),
+                .layout = ResourceLayout::UNDEFINED,
+                .access = buffer.access,
+              },
+              id,
+              node.queue);
+          break;
+        }
+        case BindComputePipeline:
+          registerConsumer(
+              cmd.args<BindPipelineArgs>().pipeline,
+              InputResource{
+                .type = ResourceType::ResourceType_ComputePipeline,
+                .layout = ResourceLayout::UNDEFINED,
+                .access = AccessPattern::NONE,
+              },
+              id,
+              node.queue);
+          break;
+        case BindGraphicsPipeline:
+          registerConsumer(
+              cmd.args<BindPipelineArgs>().pipeline,
+              InputResource{
+                .type = ResourceType::ResourceType_GraphicsPipeline,
+                .layout = ResourceLayout::UNDEFINED,
+                .access = AccessPattern::NONE,
+              },
+              id,
+              node.queue);
+          break;
+        case DrawIndexedIndirect:
+        {
+          const auto &buffer = cmd.args<DrawIndexedIndirectArgs>().buffer;
+          registerConsumer(
+              buffer.buffer,
+              InputResource{
+                .type = ResourceType::ResourceType_BufferView,
+                .bufferView = bufferView(buffer),
+                .layout = ResourceLayout::UNDEFINED,
+                .access = buffer.access,
+              },
+              id,
+              node.queue);
+          break;
+        }
+        case Draw:
+        case DrawIndexed:
+        case Dispatch:
+        case StartTimer:
+        case StopTimer:
+          break;
+        default:
+          RENDER_GRAPH_FATAL("Unsuported command");
+          break;
+        }
+      }
+      // taskData[id].registry.sortResources();
+    }
+  }
+}
+
+uint32_t RenderGraph::levelDFS(uint32_t id, FrameVector<bool> &visited, uint32_t level)
+{
+  uint32_t max = level;
+
+  if (nodes[id].level < level)
+  {
+    nodes[id].level = level;
+    for (auto &edge : edges[id])
+    {
+      uint32_t maxChilds = levelDFS(edge.taskId, visited, level + 1);
+
+      if (maxChilds > max)
+      {
+        max = maxChilds;
+      }
+    }
+  }
 
   return max;
 }
 
-void RenderGraph::topologicalSortDFS(uint32_t id, std::vector<bool> &visited, std::stack<uint32_t> &topologicalSort, std::vector<bool> &isParent)
+void RenderGraph::topologicalSortDFS(uint32_t id, FrameVector<bool> &visited, FrameVector<uint32_t> &topologicalSort, FrameVector<bool> &isParent)
 {
   if (isParent[id])
   {
@@ -1094,15 +1304,16 @@ void RenderGraph::topologicalSortDFS(uint32_t id, std::vector<bool> &visited, st
   }
 
   isParent[id] = false;
-  topologicalSort.push(id);
+  topologicalSort.push_back(id);
 }
 
-void RenderGraph::tasksTopologicalSort(std::vector<uint32_t> &order)
+void RenderGraph::tasksTopologicalSort(FrameVector<uint32_t> &order)
 {
-  std::vector<bool> visited(nodes.size(), false);
-  std::vector<bool> recStack(nodes.size(), false);
+  FrameVector<bool> visited(nodes.size(), false, &compiledArena());
+  FrameVector<bool> recStack(nodes.size(), false, &compiledArena());
 
-  std::stack<uint32_t> topologicalSort;
+  FrameVector<uint32_t> topologicalSort(&compiledArena());
+  topologicalSort.reserve(nodes.size());
 
   for (uint32_t taskId = 0; taskId < nodes.size(); taskId++)
   {
@@ -1114,105 +1325,336 @@ void RenderGraph::tasksTopologicalSort(std::vector<uint32_t> &order)
     topologicalSortDFS(taskId, visited, topologicalSort, recStack);
   }
 
+  order.reserve(order.size() + topologicalSort.size());
+
   while (topologicalSort.size())
   {
-    order.push_back(topologicalSort.top());
-    topologicalSort.pop();
+    order.push_back(topologicalSort.back());
+    topologicalSort.pop_back();
+  }
+}
+
+// Runs body(i) for every i in [0, count), one job each when called from a job of the running job system and on the
+// calling thread otherwise, and returns once every call did.
+template <typename F> static void forEachJob(size_t count, F &&body)
+{
+  if (count < 2 || !async::isRunning() || !async::isInJob())
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      body(i);
+    }
+
+    return;
+  }
+
+  std::vector<async::Promise<void>> jobs;
+  jobs.reserve(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    jobs.push_back(async::enqueue([&body, i]() { body(i); }));
+  }
+
+  for (auto &job : jobs)
+  {
+    async::wait(job);
+  }
+}
+
+// Number of batches count items are split in, a few per hardware thread so that uneven batches balance out and a
+// single one when the caller is not a job of a running job system, the batches then run serially on it.
+static size_t batchesFor(size_t count, size_t minimumBatchSize)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  if (!async::isRunning() || !async::isInJob())
+  {
+    return 1;
   }
+
+  return std::max<size_t>(1, std::min<size_t>(os::Thread::getHardwareConcurrency() * 4, count / minimumBatchSize));
 }
 
 void RenderGraph::analyseTaskLevels()
 {
-  std::vector<uint32_t> topologicalOrder;
+  FrameVector<uint32_t> topologicalOrder(&compiledArena());
 
   tasksTopologicalSort(topologicalOrder);
 
-  for (auto &task : nodes)
-
-    for (uint32_t id : topologicalOrder)
+  // One pass in topological order settles every level, a node is only visited once all of its producers were.
+  for (uint32_t id : topologicalOrder)
+  {
+    uint32_t currentLevel = nodes[id].level;
+    for (auto &edge : edges[id])
     {
-      uint32_t currentLevel = nodes[id].level;
-      for (auto &edge : edges[id])
-      {
-        uint64_t increment = 1; // edge.type == EdgeType::ResourceShare ? 0 : 1;
-        nodes[edge.taskId].level = std::max(nodes[edge.taskId].level, currentLevel + increment);
-      }
+      uint64_t increment = 1; // edge.type == EdgeType::ResourceShare ? 0 : 1;
+      nodes[edge.taskId].level = std::max(nodes[edge.taskId].level, currentLevel + increment);
     }
+  }
 
   for (const auto &node : nodes)
   {
-    os::Logger::logf("[RenderGraph] %s dispatched at level %u", node.name.c_str(), node.level);
+    os::Logger::logf("[RenderGraph] %s dispatched at level %u", node.name, node.level);
+  }
 
-    for (auto &cmd : node.commands)
-    {
-      switch (cmd.type)
-      {
-      case CopyBuffer:
-      {
-        auto srcMeta = resources.bufferMetadatas.find(cmd.args.copyBuffer->src.buffer.name);
-        srcMeta->firstUsedAt = std::min(srcMeta->firstUsedAt, node.level);
-        srcMeta->lastUsedAt = std::max(srcMeta->lastUsedAt, node.level);
-        auto dstMeta = resources.bufferMetadatas.find(cmd.args.copyBuffer->dst.buffer.name);
-        dstMeta->firstUsedAt = std::min(dstMeta->firstUsedAt, node.level);
-        dstMeta->lastUsedAt = std::max(dstMeta->lastUsedAt, node.level);
-        break;
-      }
+  // Every batch of nodes narrows the levels its buffers are used at on its own, batches are then merged with min and
+  // max so the result does not depend on how the nodes were split.
+  uint32_t bufferIds = resources.bufferMetadatas.capacity();
+  size_t batches = batchesFor(nodes.size(), 256);
 
-      case BindBindingGroups:
+  levelBatches.resize(std::max(levelBatches.size(), batches));
+
+  forEachJob(
+      batches,
+      [&](size_t index)
       {
-        const auto &groupsMeta = resources.bindingGroupsMetadata[cmd.args.bindGroups->groups.name]->groupsInfo.groups;
-        for (const auto &group : groupsMeta)
+        std::vector<std::pair<uint64_t, uint64_t>> &usedAt = levelBatches[index];
+        usedAt.assign(bufferIds, {UINT64_MAX, 0});
+
+        auto use = [&usedAt](uint32_t id, uint64_t level)
+        {
+          if (id >= usedAt.size())
+          {
+            return;
+          }
+
+          usedAt[id].first = std::min(usedAt[id].first, level);
+          usedAt[id].second = std::max(usedAt[id].second, level);
+        };
+
+        for (size_t i = index * nodes.size() / batches; i < (index + 1) * nodes.size() / batches; i++)
         {
-          for (const auto &buffer : group.buffers)
+          const RenderGraphNode &node = nodes[i];
+
+          for (auto &cmd : node.commands)
           {
-            auto meta = resources.bufferMetadatas.find(buffer.bufferView.buffer.name);
-            meta->firstUsedAt = std::min(meta->firstUsedAt, node.level);
-            meta->lastUsedAt = std::max(meta->lastUsedAt, node.level);
+            switch (cmd.type)
+            {
+            case CopyBuffer:
+              use(cmd.args<CopyBufferArgs>().src.buffer, node.level);
+              use(cmd.args<CopyBufferArgs>().dst.buffer, node.level);
+              break;
+
+            case BindBindingGroups:
+            {
+              const auto &groupsMeta = resources.bindingGroupsMetadata.get(cmd.args<BindGroupsArgs>().groups)->groupsInfo.groups;
+              for (const auto &group : groupsMeta)
+              {
+                for (const auto &buffer : group.buffers)
+                {
+                  use(resources.bufferMetadatas.idOf(buffer.bufferView.buffer), node.level);
+                }
+              }
+              break;
+            }
+
+            case BindVertexBuffer:
+              use(cmd.args<BindVertexBufferArgs>().buffer.buffer, node.level);
+              break;
+
+            case BindIndexBuffer:
+              use(cmd.args<BindIndexBufferArgs>().buffer.buffer, node.level);
+              break;
+
+            case DrawIndexedIndirect:
+              use(cmd.args<DrawIndexedIndirectArgs>().buffer.buffer, node.level);
+              break;
+
+            case BeginRenderPass:
+            case EndRenderPass:
+            case BindComputePipeline:
+            case BindGraphicsPipeline:
+            case Draw:
+            case DrawIndexed:
+            case Dispatch:
+            case StartTimer:
+            case StopTimer:
+              break;
+
+            default:
+              RENDER_GRAPH_FATAL("Unsupported command");
+            }
           }
         }
-        break;
-      }
+      });
 
-      case BindVertexBuffer:
+  for (size_t i = 0; i < batches; i++)
+  {
+    for (uint32_t id = 0; id < bufferIds; id++)
+    {
+      auto [first, last] = levelBatches[i][id];
+
+      if (first == UINT64_MAX)
       {
-        auto meta = resources.bufferMetadatas.find(cmd.args.bindVertexBuffer->buffer.buffer.name);
-        meta->firstUsedAt = std::min(meta->firstUsedAt, node.level);
-        meta->lastUsedAt = std::max(meta->lastUsedAt, node.level);
-        break;
+        continue;
       }
 
-      case BindIndexBuffer:
+      auto meta = resources.bufferMetadatas.get(id);
+      meta->firstUsedAt = std::min(meta->firstUsedAt, first);
+      meta->lastUsedAt = std::max(meta->lastUsedAt, last);
+    }
+  }
+}
+
+void RenderGraph::reduceDependencyGraph()
+{
+  size_t edgesBefore = 0;
+  size_t pairsBefore = 0;
+
+  // Levels grow along every edge, so visiting nodes by level is a topological order.
+  std::vector<uint32_t> order(nodes.size());
+  std::vector<uint32_t> position(nodes.size());
+
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return nodes[a].level < nodes[b].level; });
+
+  for (uint32_t i = 0; i < order.size(); i++)
+  {
+    position[order[i]] = i;
+  }
+
+  // Every hazard between two nodes is an edge, one of them orders the pair as well as all of them do.
+  for (auto &nodeEdges : edges)
+  {
+    edgesBefore += nodeEdges.size();
+
+    std::sort(
+        nodeEdges.begin(),
+        nodeEdges.end(),
+        [&position](const RenderGraphEdge &a, const RenderGraphEdge &b)
+        {
+          return position[a.taskId] < position[b.taskId];
+        });
+
+    nodeEdges.erase(
+        std::unique(
+            nodeEdges.begin(),
+            nodeEdges.end(),
+            [](const RenderGraphEdge &a, const RenderGraphEdge &b)
+            {
+              return a.taskId == b.taskId;
+            }),
+        nodeEdges.end());
+
+    pairsBefore += nodeEdges.size();
+  }
+
+  // Any other path between the ends of an edge to the next level passes through a node in between, so only the
+  // targets of edges that skip levels can be reached some other way. They get the columns of the reachability bitsets.
+  std::vector<uint32_t> column(nodes.size(), UINT32_MAX);
+  std::vector<uint32_t> targets;
+
+  for (uint32_t id = 0; id < nodes.size(); id++)
+  {
+    for (const auto &edge : edges[id])
+    {
+      if (nodes[edge.taskId].level > nodes[id].level + 1 && column[edge.taskId] == UINT32_MAX)
       {
-        auto meta = resources.bufferMetadatas.find(cmd.args.bindIndexBuffer->buffer.buffer.name);
-        meta->firstUsedAt = std::min(meta->firstUsedAt, node.level);
-        meta->lastUsedAt = std::max(meta->lastUsedAt, node.level);
-        break;
+        column[edge.taskId] = 0;
+        targets.push_back(edge.taskId);
       }
+    }
+  }
 
-      case DrawIndexedIndirect:
+  std::sort(targets.begin(), targets.end(), [&position](uint32_t a, uint32_t b) { return position[a] < position[b]; });
+
+  for (uint32_t i = 0; i < targets.size(); i++)
+  {
+    column[targets[i]] = i;
+  }
+
+  // Columns are processed in chunks so the bitsets of every node stay within a few megabytes on large graphs.
+  size_t words = std::max<size_t>(1, std::min<size_t>((targets.size() + 63) / 64, (1 << 20) / std::max<size_t>(1, nodes.size())));
+  size_t chunkColumns = words * 64;
+
+  std::vector<uint64_t> descendants(words);
+
+  for (size_t firstColumn = 0; firstColumn < targets.size(); firstColumn += chunkColumns)
+  {
+    size_t lastColumn = std::min(targets.size(), firstColumn + chunkColumns);
+
+    // Nodes after the last target of the chunk can not reach any of its columns.
+    uint32_t lastPosition = position[targets[lastColumn - 1]];
+
+    reachability.assign((size_t)(lastPosition + 1) * words, 0);
+
+    // In reverse topological order every child already knows what it reaches. An edge is redundant when its target
+    // is reached through another child.
+    for (int64_t at = lastPosition; at >= 0; at--)
+    {
+      uint32_t id = order[at];
+
+      std::fill(descendants.begin(), descendants.end(), 0);
+
+      for (const auto &edge : edges[id])
       {
-        auto meta = resources.bufferMetadatas.find(cmd.args.drawIndexedIndirect->buffer.buffer.name);
-        meta->firstUsedAt = std::min(meta->firstUsedAt, node.level);
-        meta->lastUsedAt = std::max(meta->lastUsedAt, node.level);
-        break;
+        uint32_t child = position[edge.taskId];
+
+        if (child > lastPosition)
+        {
+          break;
+        }
+
+        for (size_t w = 0; w < words; w++)
+        {
+          descendants[w] |= reachability[child * words + w];
+        }
       }
 
-      case BeginRenderPass:
-      case EndRenderPass:
-      case BindComputePipeline:
-      case BindGraphicsPipeline:
-      case Draw:
-      case DrawIndexed:
-      case Dispatch:
-      case StartTimer:
-      case StopTimer:
-        break;
+      uint64_t *reach = &reachability[at * words];
 
-      default:
-        RENDER_GRAPH_FATAL("Unsupported command");
+      for (auto &edge : edges[id])
+      {
+        uint32_t c = column[edge.taskId];
+
+        if (c < firstColumn || c >= lastColumn)
+        {
+          continue;
+        }
+
+        c -= firstColumn;
+
+        if (descendants[c / 64] & (1ull << (c % 64)))
+        {
+          edge.taskId = UINT64_MAX;
+        }
+        else
+        {
+          reach[c / 64] |= 1ull << (c % 64);
+        }
+      }
+
+      for (size_t w = 0; w < words; w++)
+      {
+        reach[w] |= descendants[w];
       }
+
+      // Dropped edges are found again by the next chunk, removing them keeps their targets reachable.
+      edges[id].erase(
+          std::remove_if(
+              edges[id].begin(),
+              edges[id].end(),
+              [](const RenderGraphEdge &edge)
+              {
+                return edge.taskId == UINT64_MAX;
+              }),
+          edges[id].end());
     }
   }
+
+  size_t edgesAfter = 0;
+
+  for (const auto &nodeEdges : edges)
+  {
+    edgesAfter += nodeEdges.size();
+  }
+
+  // Every remaining edge joins a distinct pair of nodes and becomes one semaphore.
+  os::Logger::logf("[RenderGraph] transitive reduction: edges %zu -> %zu, semaphores %zu -> %zu", edgesBefore, edgesAfter, pairsBefore, edgesAfter);
 }
 
 bool intervalsOverlap(float aOffset, float aSize, float bOffset, float bSize)
@@ -1254,6 +1696,14 @@ struct AccessLayoutConsumerTriple
   }
 };
 
+struct SameConsumer
+{
+  bool operator()(const AccessLayoutConsumerTriple &a, const AccessLayoutConsumerTriple &b) const
+  {
+    return a == b && a.consumer == b.consumer;
+  }
+};
+
 struct AccessConsumerTupple
 {
   AccessPattern access;
@@ -1272,308 +1722,365 @@ struct AccessConsumerTupple
   }
 };
 
-void RenderGraph::analyseDependencyGraph()
+void RenderGraph::analyseBufferHazards(uint32_t id, BufferResourceMetadata &meta, HazardBatch &batch)
 {
-  edges.clear();
-  edges.resize(nodes.size());
+  std::sort(
+      meta.usages.begin(),
+      meta.usages.end(),
+      [this](BufferResourceUsage taskA, BufferResourceUsage taskB)
+      {
+        return nodes[taskA.consumer].priority < nodes[taskB.consumer].priority;
+      });
 
-  for (auto [name, meta] : resources.bufferMetadatas)
-  {
-    std::sort(
-        meta.usages.begin(),
-        meta.usages.end(),
-        [this](BufferResourceUsage taskA, BufferResourceUsage taskB)
-        {
-          return nodes[taskA.consumer].priority < nodes[taskB.consumer].priority;
-        });
+  // Kept across buffers and compiles so the interval storage is only allocated while it grows.
+  static thread_local std::vector<lib::FlatIntervalMap<AccessConsumerPair, uint64_t>::Interval> intervals;
+  static thread_local lib::FlatIntervalMap<AccessConsumerPair, uint64_t> bufferIntevals;
 
-    std::vector<lib::BoundedTaggedIntervalTree<AccessConsumerPair, uint64_t>::Interval> intervals;
+  intervals.clear();
 
-    intervals.reserve(4 * meta.usages.size());
+  bufferIntevals.reset(
+      0,
+      meta.bufferInfo.size - 1,
+      AccessConsumerPair{
+        .access = AccessPattern::NONE,
+        .consumer = (uint64_t)-1,
+        .queue = Queue::None,
+      });
 
-    lib::BoundedTaggedIntervalTree<AccessConsumerPair, uint64_t> bufferIntevals(meta.usages.size() * 4);
+  for (const auto &usage : meta.usages)
+  {
+    intervals.clear();
 
-    bufferIntevals.insert(
-        0,
-        meta.bufferInfo.size - 1,
-        AccessConsumerPair{
-          .access = AccessPattern::NONE,
-          .consumer = (uint64_t)-1,
-          .queue = Queue::None,
-        });
+    bufferIntevals.queryAll(usage.view.offset, usage.view.offset + usage.view.size - 1, intervals);
 
-    for (const auto &usage : meta.usages)
+    for (const auto &interval : intervals)
     {
-      intervals.clear();
-
-      bufferIntevals.queryAll(usage.view.offset, usage.view.offset + usage.view.size - 1, intervals);
-
-      for (const auto &interval : intervals)
+      batch.bufferTransitions.emplace_back(
+          usage.consumer,
+          BufferBarrier{
+            .resourceId = id,
+            .fromAccess = interval.tag.access,
+            .toAccess = usage.view.access,
+            .offset = interval.start,
+            .size = interval.end - interval.start + 1,
+            .toLevel = nodes[usage.consumer].level,
+            .fromQueue = interval.tag.queue,
+            .toQueue = nodes[usage.consumer].queue,
+            .fromNode = interval.tag.consumer,
+          });
+      if (interval.tag.consumer == usage.consumer)
       {
-        nodes[usage.consumer].bufferTransitions.emplace_back(
-            BufferBarrier{
-              .resourceId = meta.bufferInfo.name,
-              .fromAccess = interval.tag.access,
-              .toAccess = usage.view.access,
-              .offset = interval.start,
-              .size = interval.end - interval.start + 1,
-              .toLevel = nodes[usage.consumer].level,
-              .fromQueue = interval.tag.queue,
-              .toQueue = nodes[usage.consumer].queue,
-              .fromNode = interval.tag.consumer,
-            });
-        if (interval.tag.consumer == usage.consumer)
-        {
-
-          continue;
-        }
 
-        if (interval.tag.consumer != -1)
-        {
-          edges[interval.tag.consumer].emplace_back(
-              RenderGraphEdge{
-                .type = (interval.tag.access != usage.view.access || interval.tag.queue != usage.queue) ? EdgeType::ResourceDependency : EdgeType::ResourceShare,
-                .taskId = usage.consumer,
-                .resourceId = meta.bufferInfo.name,
-                .resourceType = ResourceType::ResourceType_BufferView,
-              });
-        }
+        continue;
+      }
 
-        bufferIntevals.remove(interval.start, interval.end, interval.tag);
-        bufferIntevals.insert(
-            interval.start,
-            interval.end,
-            AccessConsumerPair{
-              .access = usage.view.access,
-              .consumer = usage.consumer,
-              .queue = usage.queue,
+      if (interval.tag.consumer != (uint64_t)-1)
+      {
+        batch.edges.emplace_back(
+            interval.tag.consumer,
+            RenderGraphEdge{
+              .type = (interval.tag.access != usage.view.access || interval.tag.queue != usage.queue) ? EdgeType::ResourceDependency : EdgeType::ResourceShare,
+              .taskId = usage.consumer,
+              .resourceId = id,
+              .resourceType = ResourceType::ResourceType_BufferView,
             });
       }
+
+      bufferIntevals.assign(
+          interval.start,
+          interval.end,
+          AccessConsumerPair{
+            .access = usage.view.access,
+            .consumer = usage.consumer,
+            .queue = usage.queue,
+          });
     }
   }
+}
 
-  for (auto [name, meta] : resources.textureMetadatas)
-  {
-    std::sort(
-        meta.usages.begin(),
-        meta.usages.end(),
-        [this](TextureResourceUsage taskA, TextureResourceUsage taskB)
-        {
-          return nodes[taskA.consumer].priority < nodes[taskB.consumer].priority;
-        });
+void RenderGraph::analyseTextureHazards(uint32_t id, TextureResourceMetadata &meta, HazardBatch &batch)
+{
+  std::sort(
+      meta.usages.begin(),
+      meta.usages.end(),
+      [this](TextureResourceUsage taskA, TextureResourceUsage taskB)
+      {
+        return nodes[taskA.consumer].priority < nodes[taskB.consumer].priority;
+      });
 
-    std::vector<lib::BoundedTaggedRectTreap<AccessLayoutConsumerTriple, uint64_t>::Rect> intervals;
-    intervals.reserve(resources.textureMetadatas.size() * 4);
-    lib::BoundedTaggedRectTreap<AccessLayoutConsumerTriple, uint64_t> textureState(meta.usages.size() * 4);
-    textureState.insert(
-        0,
-        0,
-        meta.textureInfo.mipLevels,
-        meta.textureInfo.depth,
-        AccessLayoutConsumerTriple{
-          .access = AccessPattern::NONE,
-          .layout = ResourceLayout::UNDEFINED,
-          .consumer = (uint64_t)-1,
-          .queue = Queue::None,
-        });
+  // Rects merge only over subresources last used by the same consumer, each one becomes its own edge.
+  static thread_local std::vector<lib::TaggedGrid<AccessLayoutConsumerTriple, uint64_t, SameConsumer>::Rect> intervals;
+  static thread_local lib::TaggedGrid<AccessLayoutConsumerTriple, uint64_t, SameConsumer> textureState;
+
+  textureState.reset(
+      std::max<uint64_t>(meta.textureInfo.mipLevels, 1),
+      std::max<uint64_t>(meta.textureInfo.depth, 1),
+      AccessLayoutConsumerTriple{
+        .access = AccessPattern::NONE,
+        .layout = ResourceLayout::UNDEFINED,
+        .consumer = (uint64_t)-1,
+        .queue = Queue::None,
+      });
 
-    for (const auto &usage : meta.usages)
-    {
-      intervals.clear();
+  for (const auto &usage : meta.usages)
+  {
+    textureState.query(
+        usage.view.baseMipLevel,
+        usage.view.baseArrayLayer,
+        usage.view.baseMipLevel + usage.view.levelCount - 1,
+        usage.view.baseArrayLayer + usage.view.layerCount - 1,
+        intervals);
+
+    auto currentTag = AccessLayoutConsumerTriple{
+      .access = usage.view.access,
+      .layout = usage.view.layout,
+      .consumer = usage.consumer,
+      .queue = nodes[usage.consumer].queue,
+    };
 
-      textureState.queryAll(
-          usage.view.baseMipLevel,
-          usage.view.baseArrayLayer,
-          usage.view.baseMipLevel + usage.view.levelCount - 1,
-          usage.view.baseArrayLayer + usage.view.layerCount - 1,
-          intervals);
+    for (const auto &interval : intervals)
+    {
+      batch.textureTransitions.emplace_back(
+          usage.consumer,
+          TextureBarrier{
+            .resourceId = id,
+            .fromAccess = interval.tag.access,
+            .toAccess = usage.view.access,
+            .fromLayout = interval.tag.layout,
+            .toLayout = usage.view.layout,
+            .baseMip = interval.x1,
+            .mipCount = interval.x2 - interval.x1 + 1,
+            .baseLayer = interval.y1,
+            .layerCount = interval.y2 - interval.y1 + 1,
+            .toLevel = nodes[usage.consumer].level,
+            .fromQueue = interval.tag.queue,
+            .toQueue = nodes[usage.consumer].queue,
+            .fromNode = interval.tag.consumer,
+          });
 
-      auto currentTag = AccessLayoutConsumerTriple{
-        .access = usage.view.access,
-        .layout = usage.view.layout,
-        .consumer = usage.consumer,
-        .queue = nodes[usage.consumer].queue,
-      };
+      if (interval.tag.consumer == usage.consumer)
+      {
+        continue;
+      }
 
-      for (const auto &interval : intervals)
+      if (interval.tag.consumer != (uint64_t)-1)
       {
-        nodes[usage.consumer].textureTransitions.emplace_back(
-            TextureBarrier{
-              .resourceId = meta.textureInfo.name,
-              .fromAccess = interval.tag.access,
-              .toAccess = usage.view.access,
-              .fromLayout = interval.tag.layout,
-              .toLayout = usage.view.layout,
-              .baseMip = interval.x1,
-              .mipCount = interval.x2 - interval.x1 + 1,
-              .baseLayer = interval.y1,
-              .layerCount = interval.y2 - interval.y1 + 1,
-              .toLevel = nodes[usage.consumer].level,
-              .fromQueue = interval.tag.queue,
-              .toQueue = nodes[usage.consumer].queue,
-              .fromNode = interval.tag.consumer,
+        batch.edges.emplace_back(
+            interval.tag.consumer,
+            RenderGraphEdge{
+              .type = (interval.tag.access != currentTag.access || interval.tag.layout != currentTag.layout || interval.tag.queue != currentTag.queue)
+                          ? EdgeType::ResourceDependency
+                          : EdgeType::ResourceShare,
+              .taskId = usage.consumer,
+              .resourceId = id,
+              .resourceType = ResourceType::ResourceType_TextureView,
             });
-
-        if (interval.tag.consumer == usage.consumer)
-        {
-          continue;
-        }
-
-        if (interval.tag.consumer != -1)
-        {
-          edges[interval.tag.consumer].emplace_back(
-              RenderGraphEdge{
-                .type = (interval.tag.access != currentTag.access || interval.tag.layout != currentTag.layout || interval.tag.queue != currentTag.queue)
-                            ? EdgeType::ResourceDependency
-                            : EdgeType::ResourceShare,
-                .taskId = usage.consumer,
-                .resourceId = meta.textureInfo.name,
-                .resourceType = ResourceType::ResourceType_TextureView,
-              });
-        }
-
-        textureState.remove(interval.x1, interval.y1, interval.x2, interval.y2, interval.tag);
-        textureState.insert(interval.x1, interval.y1, interval.x2, interval.y2, currentTag);
       }
+
+      textureState.assign(interval.x1, interval.y1, interval.x2, interval.y2, currentTag);
     }
   }
 }
 
-struct Request
+void RenderGraph::analyseDependencyGraph()
 {
-  std::string id;
-  uint64_t size;
-  uint64_t start;
-  uint64_t end;
-};
+  edges.clear();
+  edges.resize(nodes.size(), FrameVector<RenderGraphEdge>(&compiledArena()));
 
-inline size_t alignUp(size_t value, size_t alignment)
-{
-  return (value + alignment - 1) & ~(alignment - 1);
-}
+  // Every resource is analysed on its own, batches cover consecutive ids so that appending them in order gives the
+  // barriers and edges a serial walk over the buffers and then the textures would.
+  uint32_t bufferIds = resources.bufferMetadatas.capacity();
+  uint32_t textureIds = resources.textureMetadatas.capacity();
+  size_t bufferBatches = batchesFor(bufferIds, 4);
+  size_t textureBatches = batchesFor(textureIds, 4);
 
-std::pair<std::map<std::string, BufferSlice>, size_t> allocateBuffersGraphColoring(std::vector<Request> &requests, size_t alignment)
-{
-  std::sort(
-      requests.begin(),
-      requests.end(),
-      [](const Request &a, const Request &b)
-      {
-        return a.start < b.start;
-      });
+  hazardBatches.resize(std::max(hazardBatches.size(), bufferBatches + textureBatches));
 
-  struct ColorSlot
-  {
-    uint64_t offsetBase;
-    uint64_t currentSize;
-    int lastEnd;
-  };
+  forEachJob(
+      bufferBatches + textureBatches,
+      [&](size_t index)
+      {
+        HazardBatch &batch = hazardBatches[index];
 
-  std::vector<ColorSlot> colors;
-  std::map<std::string, BufferSlice> allocations;
+        batch.bufferTransitions.clear();
+        batch.textureTransitions.clear();
+        batch.edges.clear();
 
-  for (size_t i = 0; i < requests.size(); ++i)
-  {
-    const Request &req = requests[i];
+        if (index < bufferBatches)
+        {
+          for (uint32_t id = index * bufferIds / bufferBatches; id < (index + 1) * bufferIds / bufferBatches; id++)
+          {
+            if (BufferResourceMetadata *meta = resources.bufferMetadatas.get(id))
+            {
+              analyseBufferHazards(id, *meta, batch);
+            }
+          }
+        }
+        else
+        {
+          index -= bufferBatches;
 
-    int chosenColor = -1;
+          for (uint32_t id = index * textureIds / textureBatches; id < (index + 1) * textureIds / textureBatches; id++)
+          {
+            if (TextureResourceMetadata *meta = resources.textureMetadatas.get(id))
+            {
+              analyseTextureHazards(id, *meta, batch);
+            }
+          }
+        }
+      });
 
-    for (size_t c = 0; c < colors.size(); ++c)
+  for (size_t i = 0; i < bufferBatches + textureBatches; i++)
+  {
+    for (auto &[consumer, transition] : hazardBatches[i].bufferTransitions)
     {
-      if (req.start > colors[c].lastEnd)
-      {
-        chosenColor = static_cast<int>(c);
-        break;
-      }
+      nodes[consumer].bufferTransitions.push_back(transition);
     }
 
-    if (chosenColor == -1)
+    for (auto &[consumer, transition] : hazardBatches[i].textureTransitions)
     {
-      size_t offsetBase = colors.empty() ? 0 : alignUp(colors.back().offsetBase + colors.back().currentSize, alignment);
-      colors.push_back(ColorSlot{offsetBase, 0, -1});
-      chosenColor = static_cast<int>(colors.size() - 1);
+      nodes[consumer].textureTransitions.push_back(transition);
     }
 
-    ColorSlot &slot = colors[chosenColor];
-    slot.currentSize = std::max(slot.currentSize, req.size);
-
-    slot.lastEnd = req.end;
-
-    allocations[req.id] = BufferSlice{
-      requests[i].id,
-      slot.offsetBase,
-      req.size,
-    };
-  }
-
-  size_t totalSize = 0;
-  for (size_t i = 0; i < colors.size(); ++i)
-  {
-    totalSize = alignUp(totalSize, alignment);
-    totalSize += colors[i].currentSize;
+    for (auto &[producer, edge] : hazardBatches[i].edges)
+    {
+      edges[producer].push_back(edge);
+    }
   }
-
-  return std::make_pair(allocations, totalSize);
 }
 
 void RenderGraph::analyseAllocations()
 {
   resources.scratchBuffers.clear();
 
-  std::unordered_map<BufferUsage, std::vector<Request>> memoryRequests;
+  lib::FlatMap<BufferUsage, std::vector<uint32_t>> memoryRequests;
 
-  for (auto [name, meta] : resources.bufferMetadatas)
+  for (auto [id, name, meta] : resources.bufferMetadatas)
   {
     if (meta.bufferInfo.scratch && meta.usages.size())
     {
-      const BufferInfo &info = meta.bufferInfo;
-
-      memoryRequests[info.usage].push_back(
-          Request{
-            .id = meta.bufferInfo.name,
-            .start = meta.firstUsedAt,
-            .end = meta.lastUsedAt,
-            .size = info.size,
-          });
+      memoryRequests[meta.bufferInfo.usage].push_back(id);
     }
   }
 
   resources.scratchMap.clear();
 
-  for (auto &[usage, requests] : memoryRequests)
+  // Publish every scratch buffer and slice in one table each instead of one per insert.
+  auto scratchBuffers = resources.scratchBuffers.batch();
+  auto scratchMap = resources.scratchMap.batch();
+
+  for (auto &[usage, ids] : memoryRequests)
   {
-    auto [allocations, totalSize] = allocateBuffersGraphColoring(requests, 16);
-    uint32_t bufferAllocationId = resources.bufferMetadatas.size();
+    // Scratch buffers of one usage share a buffer, those whose levels never overlap share bytes.
+    scratchPlanner.clear();
+
+    for (uint32_t id : ids)
+    {
+      auto meta = resources.bufferMetadatas.get(id);
+      scratchPlanner.request(meta->bufferInfo.size, 16, meta->firstUsedAt, meta->lastUsedAt);
+    }
+
+    scratchPlanner.plan();
 
     BufferInfo info;
     info.name = bufferUsageToString(usage) + ".buffer";
-    info.size = totalSize;
+    info.size = scratchPlanner.size();
     info.usage = usage;
 
     auto metadata = BufferResourceMetadata{
       .bufferInfo = info,
     };
 
-    resources.scratchBuffers.insert(usage, metadata);
+    scratchBuffers.insert(usage, metadata);
 
-    os::Logger::logf("[RenderGraph] Reserving %u bytes for %s", info.size, info.name.c_str());
+    os::Logger::logf(
+        "[RenderGraph] Reserving %zu bytes for %s, %zu bytes are alive at once at most (%.1f%%)",
+        info.size,
+        info.name.c_str(),
+        scratchPlanner.lowerBound(),
+        info.size ? 100.0 * scratchPlanner.lowerBound() / info.size : 100.0);
 
-    for (auto &allocation : allocations)
+    for (uint32_t i = 0; i < ids.size(); i++)
     {
-      auto scratch = resources.scratchMap[allocation.second.bufferId];
-
-      scratch->usage = usage;
-      scratch->offset = allocation.second.offset;
-      scratch->size = allocation.second.size;
+      const BufferInfo &sliceInfo = resources.bufferMetadatas.get(ids[i])->bufferInfo;
+
+      scratchMap.insert(
+          sliceInfo.name,
+          BufferAllocation{
+            .usage = usage,
+            .offset = scratchPlanner.offsetOf(i),
+            .size = sliceInfo.size,
+          });
 
       os::Logger::logf(
-          "[RenderGraph] Reserving slice of %s, offset = %u, size = %u, for %s",
-          info.name.c_str(),
-          allocation.second.offset,
-          allocation.second.size,
-          resources.bufferMetadatas[allocation.second.bufferId]->bufferInfo.name.c_str());
+          "[RenderGraph] Reserving slice of %s, offset = %zu, size = %zu, for %s", info.name.c_str(), scratchPlanner.offsetOf(i), sliceInfo.size, sliceInfo.name.c_str());
+    }
+
+    // Hazards are only found within a slice, so the last users of a slice and the first users of a later one placed
+    // over its bytes are ordered here. The edge gives them a semaphore, which across queues also makes the old writes
+    // available, on one queue the barrier over the shared bytes does.
+    for (uint32_t a = 0; a < ids.size(); a++)
+    {
+      for (uint32_t b = 0; b < ids.size(); b++)
+      {
+        auto before = resources.bufferMetadatas.get(ids[a]);
+        auto after = resources.bufferMetadatas.get(ids[b]);
+
+        uint64_t start = std::max(scratchPlanner.offsetOf(a), scratchPlanner.offsetOf(b));
+        uint64_t end = std::min(scratchPlanner.offsetOf(a) + before->bufferInfo.size, scratchPlanner.offsetOf(b) + after->bufferInfo.size);
+
+        if (before->lastUsedAt >= after->firstUsedAt || start >= end)
+        {
+          continue;
+        }
+
+        for (const auto &from : before->usages)
+        {
+          if (nodes[from.consumer].level != before->lastUsedAt)
+          {
+            continue;
+          }
+
+          for (const auto &to : after->usages)
+          {
+            if (nodes[to.consumer].level != after->firstUsedAt)
+            {
+              continue;
+            }
+
+            edges[from.consumer].push_back(
+                RenderGraphEdge{
+                  .taskId = to.consumer,
+                  .type = EdgeType::ResourceDependency,
+                  .resourceType = ResourceType::ResourceType_BufferView,
+                  .resourceId = ids[b],
+                });
+
+            if (nodes[from.consumer].queue != nodes[to.consumer].queue)
+            {
+              continue;
+            }
+
+            nodes[to.consumer].bufferTransitions.push_back(
+                BufferBarrier{
+                  .resourceId = ids[b],
+                  .offset = start - scratchPlanner.offsetOf(b),
+                  .size = end - start,
+                  .fromAccess = from.view.access,
+                  .toAccess = to.view.access,
+                  .toLevel = nodes[to.consumer].level,
+                  .fromQueue = nodes[from.consumer].queue,
+                  .toQueue = nodes[to.consumer].queue,
+                  .fromNode = from.consumer,
+                });
+          }
+        }
+      }
     }
   }
+
+  scratchBuffers.commit();
+  scratchMap.commit();
 }
 
 struct Interval
@@ -1598,28 +2105,19 @@ enum class RemainderMode
 
 void RenderGraph::analyseBufferStateTransition()
 {
-  std::vector<lib::BoundedTaggedIntervalTree<AccessConsumerTupple, uint64_t>::Interval> intervals;
-
-  uint64_t size = 0;
-
-  for (auto [name, meta] : resources.bufferMetadatas)
-  {
-    size += meta.usages.size();
-  }
-
-  intervals.reserve(4 * size);
+  static thread_local std::vector<lib::FlatIntervalMap<AccessConsumerTupple, uint64_t>::Interval> intervals;
+  static thread_local lib::FlatIntervalMap<AccessConsumerTupple, uint64_t> bufferIntevals;
   os::print(">>>> Usage %u\n", resources.bufferMetadatas.size());
-  for (auto [name, meta] : resources.bufferMetadatas)
+  for (auto [id, name, meta] : resources.bufferMetadatas)
   {
     os::print(">>>> Usage\n");
 
-    lib::BoundedTaggedIntervalTree<AccessConsumerTupple, uint64_t> bufferIntevals(meta.usages.size() * 4);
     if (meta.bufferInfo.size == 0)
     {
       continue;
     }
 
-    bufferIntevals.insert(
+    bufferIntevals.reset(
         0,
         meta.bufferInfo.size - 1,
         AccessConsumerTupple{
@@ -1654,8 +2152,7 @@ void RenderGraph::analyseBufferStateTransition()
         {
           // printf("interval %u %u\n", interval.start, interval.end);
 
-          bufferIntevals.remove(interval.start, interval.end, interval.tag);
-          bufferIntevals.insert(
+          bufferIntevals.assign(
               interval.start,
               interval.end,
               AccessConsumerTupple{
@@ -1666,7 +2163,7 @@ void RenderGraph::analyseBufferStateTransition()
 
           nodes[usage.consumer].bufferTransitions.emplace_back(
               BufferBarrier{
-                .resourceId = meta.bufferInfo.name,
+                .resourceId = id,
                 .fromAccess = interval.tag.access,
                 .toAccess = usage.view.access,
                 .offset = interval.start,
@@ -1699,34 +2196,20 @@ void RenderGraph::analyseBufferStateTransition()
 
 void RenderGraph::analyseTextureStateTransition()
 {
-  std::vector<lib::BoundedTaggedRectTreap<AccessLayoutConsumerTriple, uint64_t>::Rect> intervals;
-
-  uint64_t size = 0;
+  static thread_local std::vector<lib::TaggedGrid<AccessLayoutConsumerTriple, uint64_t>::Rect> intervals;
+  static thread_local lib::TaggedGrid<AccessLayoutConsumerTriple, uint64_t> textureState;
 
-  for (auto [name, meta] : resources.textureMetadatas)
+  for (auto [id, name, meta] : resources.textureMetadatas)
   {
-    size += meta.usages.size();
-  }
-
-  intervals.reserve(4 * size);
-
-  for (auto [name, meta] : resources.textureMetadatas)
-  {
-    lib::BoundedTaggedRectTreap<AccessLayoutConsumerTriple, uint64_t> textureState(meta.usages.size() * 4);
-
-    textureState.insert(
-        0,
-        0,
-        meta.textureInfo.mipLevels,
-        meta.textureInfo.depth,
+    textureState.reset(
+        std::max<uint64_t>(meta.textureInfo.mipLevels, 1),
+        std::max<uint64_t>(meta.textureInfo.depth, 1),
         AccessLayoutConsumerTriple{
           .access = AccessPattern::NONE,
           .layout = ResourceLayout::UNDEFINED,
           .queue = Queue::None,
         });
 
-    // textureState.print();
-
     std::sort(
         meta.usages.begin(),
         meta.usages.end(),
@@ -1737,8 +2220,6 @@ void RenderGraph::analyseTextureStateTransition()
 
     for (const auto &usage : meta.usages)
     {
-      intervals.clear();
-
       textureState.query(
           usage.view.baseMipLevel,
           usage.view.baseArrayLayer,
@@ -1756,12 +2237,11 @@ void RenderGraph::analyseTextureStateTransition()
       {
         if (interval.tag != currentTag)
         {
-          textureState.remove(interval.x1, interval.y1, interval.x2, interval.y2, interval.tag);
-          textureState.insert(interval.x1, interval.y1, interval.x2, interval.y2, currentTag);
+          textureState.assign(interval.x1, interval.y1, interval.x2, interval.y2, currentTag);
 
           nodes[usage.consumer].textureTransitions.emplace_back(
               TextureBarrier{
-                .resourceId = meta.textureInfo.name,
+                .resourceId = id,
                 .fromAccess = interval.tag.access,
                 .toAccess = usage.view.access,
                 .fromLayout = interval.tag.layout,
@@ -1834,7 +2314,7 @@ struct SemaphoreEq
 void RenderGraph::analyseSemaphores()
 {
   uint32_t fromTask = 0;
-  std::unordered_set<Semaphore, SemaphoreHash, SemaphoreEq> semaphoresSet;
+  lib::FlatSet<Semaphore, SemaphoreHash, SemaphoreEq> semaphoresSet;
 
   for (auto &taskEdges : edges)
   {
@@ -1891,9 +2371,13 @@ void RenderGraph::analyseCommandBuffers()
     count = 0;
   }
 
+  // Static nodes only share command buffers with other static nodes, so they can be replayed on their own.
+  bool lastStatic[Queue::QueuesCount] = {};
+
   for (auto &currentNode : nodes)
   {
-    bool canReuseCommandBuffer = true;
+    bool canReuseCommandBuffer = currentNode.isStatic == lastStatic[currentNode.queue];
+    lastStatic[currentNode.queue] = currentNode.isStatic;
 
     for (uint64_t wait : currentNode.waitSemaphores)
     {
@@ -1925,34 +2409,86 @@ void RenderGraph::analyseCommandBuffers()
 
 void RenderGraph::compile()
 {
+  static const uint16_t allocationTag = lib::memory::AllocationTracker::registerTag("render graph");
+  lib::memory::AllocationTagScope tagScope(allocationTag);
+
+  RenderGraphPass pass;
+  pendingPasses.clear();
+
+  while (passes.dequeue(pass))
+  {
+    pendingPasses.push_back(std::move(pass));
+  }
+
+  uint64_t version = resourcesVersion.load();
+  pendingPassHashes.clear();
+
+  for (const auto &pending : pendingPasses)
+  {
+    pendingPassHashes.push_back(hashPass(pending));
+  }
+
+  // The last compile is reused only when the whole graph matches it, there is no partial reuse of single phases.
+  bool unchanged = compiled && version == compiledResourcesVersion && pendingPassHashes.size() == compiledPassHashes.size();
+
+  for (size_t i = 0; i < pendingPassHashes.size() && unchanged; i++)
+  {
+    if (pendingPassHashes[i] != compiledPassHashes[i])
+    {
+      os::Logger::logf("[RenderGraph] %s changed, recompiling", pendingPasses[i].name.c_str());
+      unchanged = false;
+    }
+  }
+
+  if (unchanged)
+  {
+    lib::time::TimeSpan reuseStart = lib::time::TimeSpan::now();
+    reuseCompile();
+    lib::time::TimeSpan reuseEnd = lib::time::TimeSpan::now();
+
+    os::Logger::logf("[RenderGraph] structure unchanged, reused last compile in %fms", (reuseEnd - reuseStart).milliseconds());
+    pendingPasses.clear();
+    return;
+  }
+
+  std::swap(compiledPassHashes, pendingPassHashes);
+  compiledResourcesVersion = version;
+
   nodes.clear();
   edges.clear();
+  semaphores.clear();
+
+  // Nothing refers to the previous compile anymore, what was recorded since becomes the compiled arena.
+  compiledArena().reset();
+  frameArenaIndex += 1;
 
-  for (const auto &[name, meta] : resources.bufferMetadatas)
+  for (const auto &[id, name, meta] : resources.bufferMetadatas)
   {
     meta.usages.clear();
+    meta.firstUsedAt = UINT64_MAX;
+    meta.lastUsedAt = 0;
   }
-  for (const auto &[name, meta] : resources.textureMetadatas)
+  for (const auto &[id, name, meta] : resources.textureMetadatas)
   {
     meta.usages.clear();
   }
-  for (const auto &[name, meta] : resources.samplerMetadatas)
+  for (const auto &[id, name, meta] : resources.samplerMetadatas)
   {
     meta.usages.clear();
   }
-  for (const auto &[name, meta] : resources.bindingsLayoutMetadata)
+  for (const auto &[id, name, meta] : resources.bindingsLayoutMetadata)
   {
     meta.usages.clear();
   }
-  for (const auto &[name, meta] : resources.bindingGroupsMetadata)
+  for (const auto &[id, name, meta] : resources.bindingGroupsMetadata)
   {
     meta.usages.clear();
   }
-  for (const auto &[name, meta] : resources.graphicsPipelineMetadata)
+  for (const auto &[id, name, meta] : resources.graphicsPipelineMetadata)
   {
     meta.usages.clear();
   }
-  for (const auto &[name, meta] : resources.computePipelineMetadata)
+  for (const auto &[id, name, meta] : resources.computePipelineMetadata)
   {
     meta.usages.clear();
   }
@@ -1974,6 +2510,10 @@ void RenderGraph::compile()
   analyseTaskLevels();
   lib::time::TimeSpan analyseTaskLevelsEnd = lib::time::TimeSpan::now();
 
+  lib::time::TimeSpan reduceDependencyGraphStart = lib::time::TimeSpan::now();
+  reduceDependencyGraph();
+  lib::time::TimeSpan reduceDependencyGraphEnd = lib::time::TimeSpan::now();
+
   lib::time::TimeSpan analyseAllocationsStart = lib::time::TimeSpan::now();
   analyseAllocations();
   lib::time::TimeSpan analyseAllocationsEnd = lib::time::TimeSpan::now();
@@ -1994,13 +2534,14 @@ void RenderGraph::compile()
   // os::Logger::logf("[RenderGraph] analyseStateTransition time = %fms", (analyseStateTransitionEnd - analyseStateTransitionStart).milliseconds());
 
   os::Logger::logf("[RenderGraph] analyseTaskLevels time = %fms", (analyseTaskLevelsEnd - analyseTaskLevelsStart).milliseconds());
+  os::Logger::logf("[RenderGraph] reduceDependencyGraph time = %fms", (reduceDependencyGraphEnd - reduceDependencyGraphStart).milliseconds());
   os::Logger::logf("[RenderGraph] analyseAllocations time = %fms", (analyseAllocationsEnd - analyseAllocationsStart).milliseconds());
   os::Logger::logf("[RenderGraph] analyseSemaphores time = %fms", (analyseSemaphoresEnd - analyseSemaphoresStart).milliseconds());
   os::Logger::logf("[RenderGraph] analyseCommandBuffers time = %fms", (analyseCommandBuffersEnd - analyseCommandBuffersStart).milliseconds());
 
   // os::Logger::logf("[TimeScheduler] outputCommands time = %fns", (outputCommandsEnd - outputCommandsStart).nanoseconds());
 
-  for (const auto &[name, meta] : resources.bufferMetadatas)
+  for (const auto &[id, name, meta] : resources.bufferMetadatas)
   {
     if (meta.usages.empty())
     {
@@ -2008,21 +2549,21 @@ void RenderGraph::compile()
     }
   }
 
-  for (const auto &[name, meta] : resources.textureMetadatas)
+  for (const auto &[id, name, meta] : resources.textureMetadatas)
   {
     if (meta.usages.empty())
     {
       os::Logger::warningf("Buffer %s not used in current graph", name.c_str());
     }
   }
-  for (const auto &[name, meta] : resources.samplerMetadatas)
+  for (const auto &[id, name, meta] : resources.samplerMetadatas)
   {
     if (meta.usages.empty())
     {
       os::Logger::warningf("Sampler %s not used in current graph", name.c_str());
     }
   }
-  for (const auto &[name, meta] : resources.bindingsLayoutMetadata)
+  for (const auto &[id, name, meta] : resources.bindingsLayoutMetadata)
   {
     if (meta.usages.empty())
     {
@@ -2030,7 +2571,7 @@ void RenderGraph::compile()
     }
   }
 
-  for (const auto &[name, meta] : resources.bindingGroupsMetadata)
+  for (const auto &[id, name, meta] : resources.bindingGroupsMetadata)
   {
     if (meta.usages.empty())
     {
@@ -2038,14 +2579,14 @@ void RenderGraph::compile()
     }
   }
 
-  for (const auto &[name, meta] : resources.graphicsPipelineMetadata)
+  for (const auto &[id, name, meta] : resources.graphicsPipelineMetadata)
   {
     if (meta.usages.empty())
     {
       os::Logger::warningf("Graphics Pipeline %s not used in current graph", name.c_str());
     }
   }
-  for (const auto &[name, meta] : resources.computePipelineMetadata)
+  for (const auto &[id, name, meta] : resources.computePipelineMetadata)
   {
     if (meta.usages.empty())
     {
@@ -2053,7 +2594,9 @@ void RenderGraph::compile()
     }
   }
 
+  pendingPasses.clear();
   compiled = true;
+  compiles += 1;
 }
 
 // AccessPattern removeReadAccesses(AccessPattern access)
@@ -2068,63 +2611,681 @@ void RenderGraph::compile()
 //   return static_cast<AccessPattern>(static_cast<uint32_t>(access) & ~static_cast<uint32_t>(READ_ACCESS_MASK));
 // }
 
-void RenderGraph::run(Frame &frame)
+// Stages that perform access, the fixed function ones follow from the access itself and shader accesses from the
+// commands of the node.
+static PipelineStage accessStages(AccessPattern access, PipelineStage shaderStages)
 {
-  auto runStart = lib::time::TimeSpan::now();
+  PipelineStage stages = PipelineStage::NONE;
 
-  os::Logger::logf("[RenderGraph] ===== Begin run =====");
-  os::Logger::logf("[RenderGraph] Node count = %zu", nodes.size());
-  uint64_t maxLevel = 0;
+  if (access & (AccessPattern::VERTEX_ATTRIBUTE_READ | AccessPattern::INDEX_READ))
+    stages = stages | PipelineStage::VERTEX_INPUT;
+
+  if (access & AccessPattern::INDIRECT_COMMAND_READ)
+    stages = stages | PipelineStage::DRAW_INDIRECT;
+
+  if (access & (AccessPattern::UNIFORM_READ | AccessPattern::SHADER_READ | AccessPattern::SHADER_WRITE))
+    stages = stages | (shaderStages != PipelineStage::NONE ? shaderStages : PipelineStage::ALL_COMMANDS);
 
+  if (access & (AccessPattern::COLOR_ATTACHMENT_READ | AccessPattern::COLOR_ATTACHMENT_WRITE))
+    stages = stages | PipelineStage::COLOR_ATTACHMENT_OUTPUT;
+
+  if (access & (AccessPattern::DEPTH_STENCIL_ATTACHMENT_READ | AccessPattern::DEPTH_STENCIL_ATTACHMENT_WRITE))
+    stages = stages | PipelineStage::EARLY_FRAGMENT_TESTS | PipelineStage::LATE_FRAGMENT_TESTS;
+
+  if (access & (AccessPattern::TRANSFER_READ | AccessPattern::TRANSFER_WRITE))
+    stages = stages | PipelineStage::TRANSFER;
+
+  if (access & (AccessPattern::MEMORY_READ | AccessPattern::MEMORY_WRITE))
+    stages = stages | PipelineStage::ALL_COMMANDS;
+
+  return stages;
+}
+
+// Stages a transition blocks in the consumer. An access no stage performs, such as a layout only transition, still
+// needs a non empty mask without synchronization2, the same way the producer side falls back to TOP_OF_PIPE.
+static PipelineStage dstStages(AccessPattern access, PipelineStage shaderStages)
+{
+  PipelineStage stages = accessStages(access, shaderStages);
+  return stages != PipelineStage::NONE ? stages : PipelineStage::BOTTOM_OF_PIPE;
+}
+
+// Stages a transition recorded in the consumer waits on. Without a producer in the graph the resource may still be in
+// use by earlier submissions, and an acquire only has to wait on the semaphore, which covers every stage, so it waits
+// on the stages it blocks.
+PipelineStage RenderGraph::srcStages(uint64_t fromNode, AccessPattern fromAccess, bool acquire, PipelineStage dstStages)
+{
+  if (fromNode == (uint64_t)-1)
+  {
+    return PipelineStage::ALL_COMMANDS;
+  }
+
+  if (acquire)
+  {
+    return dstStages;
+  }
+
+  PipelineStage stages = accessStages(fromAccess, nodes[fromNode].shaderStages);
+  return stages != PipelineStage::NONE ? stages : PipelineStage::TOP_OF_PIPE;
+}
+
+void RenderGraph::addRelease(BarrierBatch &batch, const BufferBarrier &transition)
+{
+  PipelineStage stages = accessStages(transition.fromAccess, nodes[transition.fromNode].shaderStages);
+
+  // The destination stages of a release are ignored, the acquire in the consumer does the blocking.
+  batch.buffers.push_back(
+      BufferBarrierInfo{
+        .buffer = resources.bufferMetadatas.handleOf<Buffer>(transition.resourceId),
+        .srcStage = stages != PipelineStage::NONE ? stages : PipelineStage::TOP_OF_PIPE,
+        .dstStage = PipelineStage::BOTTOM_OF_PIPE,
+        .srcAccess = transition.fromAccess,
+        .dstAccess = AccessPattern::NONE,
+        .offset = transition.offset,
+        .size = transition.size,
+        .srcQueue = transition.fromQueue,
+        .dstQueue = transition.toQueue,
+      });
+}
+
+void RenderGraph::addRelease(BarrierBatch &batch, const TextureBarrier &transition)
+{
+  PipelineStage stages = accessStages(transition.fromAccess, nodes[transition.fromNode].shaderStages);
+
+  batch.textures.push_back(
+      TextureBarrierInfo{
+        .texture = resources.textureMetadatas.handleOf<Texture>(transition.resourceId),
+        .srcStage = stages != PipelineStage::NONE ? stages : PipelineStage::TOP_OF_PIPE,
+        .dstStage = PipelineStage::BOTTOM_OF_PIPE,
+        .srcAccess = transition.fromAccess,
+        .dstAccess = AccessPattern::NONE,
+        .oldLayout = transition.fromLayout,
+        .newLayout = transition.toLayout,
+        .aspect = GetImageAspectFlags(resources.textureMetadatas.get(transition.resourceId)->textureInfo.format),
+        .baseMip = (uint32_t)transition.baseMip,
+        .mipCount = (uint32_t)transition.mipCount,
+        .baseLayer = (uint32_t)transition.baseLayer,
+        .layerCount = (uint32_t)transition.layerCount,
+        .srcQueue = transition.fromQueue,
+        .dstQueue = transition.toQueue,
+      });
+}
+
+void RenderGraph::addAcquires(BarrierBatch &batch, const RenderGraphNode &currentNode)
+{
+  /* ================= BUFFER BARRIERS ================= */
+
+  for (auto &transition : currentNode.bufferTransitions)
+  {
+    auto buffer = resources.bufferMetadatas.handleOf<Buffer>(transition.resourceId);
+    bool transfer = transition.toQueue != transition.fromQueue && transition.fromNode != (uint64_t)-1;
+
+    PipelineStage dstStage = dstStages(transition.toAccess, currentNode.shaderStages);
+    PipelineStage srcStage = srcStages(transition.fromNode, transition.fromAccess, transfer, dstStage);
+
+    if (transition.toQueue != transition.fromQueue)
+    {
+      os::Logger::logf(
+          "[RenderGraph][Barrier][Buffer][QueueTransfer] '%s' fromNode=%u -> node=%u offset=%zu size=%zu fromAccess=%u toAccess=%u fromQueue=%s toQueue=%s, fromNode %u",
+          buffer.name.c_str(),
+          transition.fromNode,
+          currentNode.id,
+          transition.offset,
+          transition.size,
+          (uint32_t)transition.fromAccess,
+          (uint32_t)transition.toAccess,
+          logQueue(transition.fromQueue),
+          logQueue(transition.toQueue),
+          transition.fromNode);
+    }
+    else
+    {
+      os::Logger::logf(
+          "[RenderGraph][Barrier][Buffer] '%s' offset=%zu size=%zu fromAccess=%u toAccess=%u queue=%s",
+          buffer.name.c_str(),
+          transition.offset,
+          transition.size,
+          (uint32_t)transition.fromAccess,
+          (uint32_t)transition.toAccess,
+          logQueue(transition.fromQueue));
+    }
+
+    // The release half of a queue transfer was recorded into the producer's command buffer, a transition without a
+    // producer in the graph needs no ownership transfer.
+    batch.buffers.push_back(
+        BufferBarrierInfo{
+          .buffer = std::move(buffer),
+          .srcStage = srcStage,
+          .dstStage = dstStage,
+          .srcAccess = transfer ? AccessPattern::NONE : transition.fromAccess,
+          .dstAccess = transition.toAccess,
+          .offset = transition.offset,
+          .size = transition.size,
+          .srcQueue = transfer ? transition.fromQueue : Queue::None,
+          .dstQueue = transfer ? transition.toQueue : Queue::None,
+        });
+  }
+
+  /* ================= IMAGE BARRIERS ================= */
+
+  for (auto &transition : currentNode.textureTransitions)
+  {
+    auto texture = resources.textureMetadatas.handleOf<Texture>(transition.resourceId);
+    bool transfer = transition.toQueue != transition.fromQueue && transition.fromNode != (uint64_t)-1;
+
+    PipelineStage dstStage = dstStages(transition.toAccess, currentNode.shaderStages);
+    PipelineStage srcStage = srcStages(transition.fromNode, transition.fromAccess, transfer, dstStage);
+
+    if (transition.toQueue != transition.fromQueue)
+    {
+      os::Logger::logf(
+          "[RenderGraph][Barrier][Image][QueueTransfer] '%s' fromNode=%u -> node=%u layout %u -> %u access %u -> %u mips [%u..%u) layers [%u..%u) fromQueue=%s toQueue=%s",
+          texture.name.c_str(),
+          transition.fromNode,
+          currentNode.id,
+          (uint32_t)transition.fromLayout,
+          (uint32_t)transition.toLayout,
+          (uint32_t)transition.fromAccess,
+          (uint32_t)transition.toAccess,
+          transition.baseMip,
+          transition.baseMip + transition.mipCount,
+          transition.baseLayer,
+          transition.baseLayer + transition.layerCount,
+          logQueue(transition.fromQueue),
+          logQueue(transition.toQueue));
+    }
+    else
+    {
+      os::Logger::logf(
+          "[RenderGraph][Barrier][Image] '%s' layout %u -> %u access %u -> %u mips [%u..%u) layers [%u..%u) queue=%s",
+          texture.name.c_str(),
+          (uint32_t)transition.fromLayout,
+          (uint32_t)transition.toLayout,
+          (uint32_t)transition.fromAccess,
+          (uint32_t)transition.toAccess,
+          transition.baseMip,
+          transition.baseMip + transition.mipCount,
+          transition.baseLayer,
+          transition.baseLayer + transition.layerCount,
+          logQueue(transition.fromQueue));
+    }
+
+    batch.textures.push_back(
+        TextureBarrierInfo{
+          .texture = std::move(texture),
+          .srcStage = srcStage,
+          .dstStage = dstStage,
+          .srcAccess = transfer ? AccessPattern::NONE : transition.fromAccess,
+          .dstAccess = transition.toAccess,
+          .oldLayout = transition.fromLayout,
+          .newLayout = transition.toLayout,
+          .aspect = GetImageAspectFlags(resources.textureMetadatas.get(transition.resourceId)->textureInfo.format),
+          .baseMip = (uint32_t)transition.baseMip,
+          .mipCount = (uint32_t)transition.mipCount,
+          .baseLayer = (uint32_t)transition.baseLayer,
+          .layerCount = (uint32_t)transition.layerCount,
+          .srcQueue = transfer ? transition.fromQueue : Queue::None,
+          .dstQueue = transfer ? transition.toQueue : Queue::None,
+        });
+  }
+}
+
+void RenderGraph::flushBarriers(CommandBuffer commandBuffer, BarrierBatch &batch)
+{
+  if (batch.buffers.empty() && batch.textures.empty())
+  {
+    return;
+  }
+
+  // Ranges of one buffer that touch or overlap and only differ in their extent become one barrier. Ownership transfers
+  // are left alone since the acquire has to match the release recorded in another command buffer.
   std::sort(
-      nodes.begin(),
-      nodes.end(),
-      [&maxLevel](const RenderGraphNode &a, const RenderGraphNode &b)
+      batch.buffers.begin(),
+      batch.buffers.end(),
+      [](const BufferBarrierInfo &a, const BufferBarrierInfo &b)
       {
-        maxLevel = std::max(maxLevel, a.level);
-        maxLevel = std::max(maxLevel, b.level);
-        return a.level < b.level;
+        return a.buffer.id != b.buffer.id ? a.buffer.id < b.buffer.id : a.offset < b.offset;
       });
 
-  os::Logger::logf("[RenderGraph] Max level = %u", maxLevel);
+  size_t count = 0;
+
+  for (size_t i = 0; i < batch.buffers.size(); i++)
+  {
+    BufferBarrierInfo &current = batch.buffers[i];
+
+    if (count > 0)
+    {
+      BufferBarrierInfo &last = batch.buffers[count - 1];
 
-  frame.futures = std::vector<GPUFuture>(nodes.size());
+      bool sameBarrier = last.srcStage == current.srcStage && last.dstStage == current.dstStage && last.srcAccess == current.srcAccess && last.dstAccess == current.dstAccess;
+      bool ownershipTransfer = last.srcQueue != Queue::None || current.srcQueue != Queue::None;
 
-  std::vector<CommandBuffer> commandBuffers[Queue::QueuesCount];
+      if (last.buffer.id == current.buffer.id && sameBarrier && !ownershipTransfer && current.offset <= last.offset + last.size)
+      {
+        last.size = std::max(last.offset + last.size, current.offset + current.size) - last.offset;
+        continue;
+      }
+    }
+
+    if (count != i)
+    {
+      batch.buffers[count] = std::move(current);
+    }
+
+    count++;
+  }
+
+  batch.buffers.resize(count);
+
+  // Barriers of one call are not ordered between themselves, a texture transitioned twice, like a node that uses it
+  // with two layouts, starts a new call at its second transition.
+  size_t first = 0;
+
+  for (size_t i = 1; i <= batch.textures.size(); i++)
+  {
+    bool split = i == batch.textures.size();
+
+    for (size_t j = first; j < i && !split; j++)
+    {
+      const TextureBarrierInfo &a = batch.textures[j];
+      const TextureBarrierInfo &b = batch.textures[i];
+
+      split = a.texture.id == b.texture.id && a.baseMip < b.baseMip + b.mipCount && b.baseMip < a.baseMip + a.mipCount && a.baseLayer < b.baseLayer + b.layerCount &&
+              b.baseLayer < a.baseLayer + a.layerCount;
+    }
+
+    if (split)
+    {
+      rhi->cmdBarriers(commandBuffer, first == 0 ? batch.buffers.data() : nullptr, first == 0 ? batch.buffers.size() : 0, batch.textures.data() + first, i - first);
+      first = i;
+    }
+  }
 
-  if (commandBuffersCount[Queue::Compute] > 0)
+  if (batch.textures.empty())
   {
-    commandBuffers[Queue::Compute] = rhi->allocateCommandBuffers(Queue::Compute, commandBuffersCount[Queue::Compute]);
+    rhi->cmdBarriers(commandBuffer, batch.buffers.data(), batch.buffers.size(), nullptr, 0);
   }
-  if (commandBuffersCount[Queue::Graphics] > 0)
+
+  batch.buffers.clear();
+  batch.textures.clear();
+}
+
+void RenderGraph::recordNode(CommandBuffer commandBuffer, const RenderGraphNode &currentNode, BarrierBatch &batch)
+{
+  os::Logger::logf(
+      "[RenderGraph] * Recording %s (level=%u queue=%s, commandBuffer %u)", currentNode.name, currentNode.level, logQueue(currentNode.queue), currentNode.commandBufferIndex);
+
+  // Releases queued before the node are recorded on their own, a texture released to another queue may also be
+  // transitioned by this node and two layout transitions of one subresource can not share a pipeline barrier.
+  flushBarriers(commandBuffer, batch);
+
+  addAcquires(batch, currentNode);
+  flushBarriers(commandBuffer, batch);
+
+  /* ================= COMMANDS ================= */
+
+  for (auto &cmd : currentNode.commands)
   {
-    commandBuffers[Queue::Graphics] = rhi->allocateCommandBuffers(Queue::Graphics, commandBuffersCount[Queue::Graphics]);
+    switch (cmd.type)
+    {
+    case BeginRenderPass:
+    {
+      const auto &args = cmd.args<BeginRenderPassArgs>();
+
+      // Reused by the render passes a thread records, so that its attachments are only allocated while they grow.
+      static thread_local RenderPassInfo info;
+      info.name.assign(args.name(), args.nameLength);
+      info.viewport = args.viewport;
+      info.scissor = args.scissor;
+      info.colorAttachments.clear();
+      info.depthStencilAttachment = nullptr;
+
+      for (uint32_t i = 0; i < args.colorAttachmentCount; i++)
+      {
+        // The attachment name is not kept in the command stream, backends only name attachments by their texture.
+        info.colorAttachments.push_back(ColorAttachmentInfo{.name = {}, .view = textureView(args.colorAttachments()[i].view), .clearValue = args.colorAttachments()[i].clearValue});
+      }
+
+      DepthStencilAttachmentInfo depthStencil;
+
+      if (args.depthStencilAttachment())
+      {
+        depthStencil.view = textureView(args.depthStencilAttachment()->view);
+        depthStencil.clearDepth = args.depthStencilAttachment()->clearDepth;
+        depthStencil.clearStencil = args.depthStencilAttachment()->clearStencil;
+        info.depthStencilAttachment = &depthStencil;
+      }
+
+      os::Logger::logf("[RenderGraph][Cmd] BeginRenderPass '%s'", info.name.c_str());
+      rhi->cmdBeginRenderPass(commandBuffer, info);
+      break;
+    }
+
+    case EndRenderPass:
+      os::Logger::logf("[RenderGraph][Cmd] EndRenderPass");
+      rhi->cmdEndRenderPass(commandBuffer);
+      break;
+
+    case CopyBuffer:
+    {
+      const auto &args = cmd.args<CopyBufferArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] CopyBuffer '%s'[%zu] -> '%s'[%zu] size=%zu",
+          resources.bufferMetadatas.nameOf(args.src.buffer).c_str(),
+          args.src.offset,
+          resources.bufferMetadatas.nameOf(args.dst.buffer).c_str(),
+          args.dst.offset,
+          args.src.size);
+
+      rhi->cmdCopyBuffer(
+          commandBuffer,
+          resources.bufferMetadatas.handleOf<Buffer>(args.src.buffer),
+          resources.bufferMetadatas.handleOf<Buffer>(args.dst.buffer),
+          args.src.offset,
+          args.dst.offset,
+          args.src.size);
+      break;
+    }
+
+    case BindBindingGroups:
+    {
+      const auto &args = cmd.args<BindGroupsArgs>();
+      auto metadata = resources.bindingGroupsMetadata.get(args.groups);
+
+      const BindingGroupsInfo &info = metadata->groupsInfo;
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] BindBindingGroups '%s' groupCount=%zu dynamicOffsets=%zu", info.name.c_str(), info.groups.size(), (size_t)args.dynamicOffsetsCount);
+
+      /* ===== Dynamic Offsets ===== */
+
+      for (size_t i = 0; i < args.dynamicOffsetsCount; ++i)
+      {
+        os::Logger::logf("[RenderGraph]       [DynamicOffset] index=%zu value=%u", i, args.dynamicOffsets()[i]);
+      }
+
+      /* ===== Groups ===== */
+
+      for (size_t g = 0; g < info.groups.size(); ++g)
+      {
+        const GroupInfo &group = info.groups[g];
+
+        os::Logger::logf("[RenderGraph]       [BindingGroup] index=%zu name='%s'", g, group.name.c_str());
+
+        /* -------- Buffers -------- */
+
+        for (const BindingBuffer &buf : group.buffers)
+        {
+          const BufferView &view = buf.bufferView;
+
+          os::Logger::logf(
+              "[RenderGraph]          [Buffer] binding=%u name='%s' offset=%llu size=%llu access=%u",
+              buf.binding,
+              view.buffer.name.c_str(),
+              (unsigned long long)view.offset,
+              (unsigned long long)view.size,
+              (uint32_t)view.access);
+        }
+
+        /* -------- Samplers -------- */
+
+        for (const BindingSampler &sampler : group.samplers)
+        {
+          const TextureView &view = sampler.view;
+
+          const char *textureName = view.texture.name.c_str();
+
+          os::Logger::logf(
+              "[RenderGraph]          [Sampler] binding=%u sampler='%s' texture='%s' "
+              "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
+              sampler.binding,
+              sampler.sampler.name.c_str(),
+              textureName,
+              view.baseMipLevel,
+              view.baseMipLevel + view.levelCount,
+              view.baseArrayLayer,
+              view.baseArrayLayer + view.layerCount,
+              (uint32_t)view.flags,
+              (uint32_t)view.layout,
+              (uint32_t)view.access);
+        }
+
+        /* -------- Sampled Textures -------- */
+
+        for (const BindingTextureInfo &tex : group.textures)
+        {
+          const TextureView &view = tex.textureView;
+
+          const char *textureName = view.texture.name.c_str();
+
+          os::Logger::logf(
+              "[RenderGraph]          [Texture] binding=%u texture='%s' "
+              "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
+              tex.binding,
+              textureName,
+              view.baseMipLevel,
+              view.baseMipLevel + view.levelCount,
+              view.baseArrayLayer,
+              view.baseArrayLayer + view.layerCount,
+              (uint32_t)view.flags,
+              (uint32_t)view.layout,
+              (uint32_t)view.access);
+        }
+
+        /* -------- Storage Textures -------- */
+
+        for (const BindingStorageTextureInfo &tex : group.storageTextures)
+        {
+          const TextureView &view = tex.textureView;
+
+          const char *textureName = view.texture.name.c_str();
+
+          os::Logger::logf(
+              "[RenderGraph]          [StorageTexture] binding=%u texture='%s' "
+              "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
+              tex.binding,
+              textureName,
+              view.baseMipLevel,
+              view.baseMipLevel + view.levelCount,
+              view.baseArrayLayer,
+              view.baseArrayLayer + view.layerCount,
+              (uint32_t)view.flags,
+              (uint32_t)view.layout,
+              (uint32_t)view.access);
+        }
+      }
+
+      rhi->cmdBindBindingGroups(commandBuffer, resources.bindingGroupsMetadata.handleOf<BindingGroups>(args.groups), args.dynamicOffsets(), args.dynamicOffsetsCount);
+
+      break;
+    }
+
+    case BindGraphicsPipeline:
+    {
+      const std::string &name = resources.graphicsPipelineMetadata.nameOf(cmd.args<BindPipelineArgs>().pipeline);
+      os::Logger::logf("[RenderGraph][Cmd] BindGraphicsPipeline '%s'", name.c_str());
+      rhi->cmdBindGraphicsPipeline(commandBuffer, resources.graphicsPipelineMetadata.handleOf<GraphicsPipeline>(cmd.args<BindPipelineArgs>().pipeline));
+      break;
+    }
+
+    case BindComputePipeline:
+    {
+      const std::string &name = resources.computePipelineMetadata.nameOf(cmd.args<BindPipelineArgs>().pipeline);
+      os::Logger::logf("[RenderGraph][Cmd] BindComputePipeline '%s'", name.c_str());
+      rhi->cmdBindComputePipeline(commandBuffer, resources.computePipelineMetadata.handleOf<ComputePipeline>(cmd.args<BindPipelineArgs>().pipeline));
+      break;
+    }
+
+    case BindVertexBuffer:
+    {
+      const auto &args = cmd.args<BindVertexBufferArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] BindVertexBuffer slot=%u '%s' offset=%zu", args.slot, resources.bufferMetadatas.nameOf(args.buffer.buffer).c_str(), args.buffer.offset);
+
+      rhi->cmdBindVertexBuffer(commandBuffer, args.slot, resources.bufferMetadatas.handleOf<Buffer>(args.buffer.buffer), args.buffer.offset);
+      break;
+    }
+
+    case BindIndexBuffer:
+    {
+      const auto &args = cmd.args<BindIndexBufferArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] BindIndexBuffer '%s' offset=%zu type=%u", resources.bufferMetadatas.nameOf(args.buffer.buffer).c_str(), args.buffer.offset, (uint32_t)args.type);
+
+      rhi->cmdBindIndexBuffer(commandBuffer, resources.bufferMetadatas.handleOf<Buffer>(args.buffer.buffer), args.type, args.buffer.offset);
+      break;
+    }
+
+    case Draw:
+    {
+      const auto &args = cmd.args<DrawArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] Draw vertices=%u instances=%u firstVertex=%u firstInstance=%u", args.vertexCount, args.instanceCount, args.firstVertex, args.firstInstance);
+
+      rhi->cmdDraw(commandBuffer, args.vertexCount, args.instanceCount, args.firstVertex, args.firstInstance);
+      break;
+    }
+
+    case DrawIndexed:
+    {
+      const auto &args = cmd.args<DrawIndexedArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] DrawIndexed indices=%u instances=%u firstIndex=%u vertexOffset=%d firstInstance=%u",
+          args.indexCount,
+          args.instanceCount,
+          args.firstIndex,
+          args.vertexOffset,
+          args.firstInstance);
+
+      rhi->cmdDrawIndexed(commandBuffer, args.indexCount, args.instanceCount, args.firstIndex, args.vertexOffset, args.firstInstance);
+      break;
+    }
+
+    case DrawIndexedIndirect:
+    {
+      const auto &args = cmd.args<DrawIndexedIndirectArgs>();
+
+      os::Logger::logf(
+          "[RenderGraph][Cmd] DrawIndexedIndirect buffer='%s' offset=%zu count=%u stride=%u",
+          resources.bufferMetadatas.nameOf(args.buffer.buffer).c_str(),
+          args.buffer.offset,
+          args.drawCount,
+          args.stride);
+
+      rhi->cmdDrawIndexedIndirect(commandBuffer, resources.bufferMetadatas.handleOf<Buffer>(args.buffer.buffer), args.buffer.offset, args.drawCount, args.stride);
+      break;
+    }
+
+    case Dispatch:
+    {
+      const auto &args = cmd.args<DispatchArgs>();
+
+      os::Logger::logf("[RenderGraph][Cmd] Dispatch (%u, %u, %u)", args.x, args.y, args.z);
+
+      rhi->cmdDispatch(commandBuffer, args.x, args.y, args.z);
+      break;
+    }
+
+    case StartTimer:
+    {
+      const auto &args = cmd.args<TimerArgs>();
+      rhi->cmdStartTimer(commandBuffer, Timer{std::string(args.name(), args.nameLength)}, args.stage);
+      break;
+    }
+    case StopTimer:
+    {
+      const auto &args = cmd.args<TimerArgs>();
+      rhi->cmdStopTimer(commandBuffer, Timer{std::string(args.name(), args.nameLength)}, args.stage);
+      break;
+    }
+    }
   }
-  if (commandBuffersCount[Queue::Transfer] > 0)
+}
+
+void RenderGraph::recordCommandBuffer(CommandBuffer commandBuffer, const std::vector<RecordStep> &steps)
+{
+  // Command buffers are recorded by several jobs at once.
+  static thread_local BarrierBatch batch;
+
+  rhi->resetCommandBuffer(commandBuffer);
+  rhi->beginCommandBuffer(commandBuffer);
+
+  for (const RecordStep &step : steps)
   {
-    commandBuffers[Queue::Transfer] = rhi->allocateCommandBuffers(Queue::Transfer, commandBuffersCount[Queue::Transfer]);
+    const RenderGraphNode &node = nodes[step.node];
+
+    switch (step.type)
+    {
+    case RecordStep::Node:
+      recordNode(commandBuffer, node, batch);
+      break;
+    case RecordStep::BufferRelease:
+      addRelease(batch, node.bufferTransitions[step.barrier]);
+      break;
+    case RecordStep::TextureRelease:
+      addRelease(batch, node.textureTransitions[step.barrier]);
+      break;
+    }
   }
-  if (commandBuffersCount[Queue::Present] > 0)
+
+  flushBarriers(commandBuffer, batch);
+
+  rhi->endCommandBuffer(commandBuffer);
+}
+
+void RenderGraph::run(Frame &frame)
+{
+  auto runStart = lib::time::TimeSpan::now();
+
+  os::Logger::logf("[RenderGraph] ===== Begin run =====");
+  os::Logger::logf("[RenderGraph] Node count = %zu", nodes.size());
+  uint64_t maxLevel = 0;
+
+  // Semaphores, barriers and the reused compile refer to nodes by index, so nodes are visited in level order through a
+  // permutation instead of being sorted in place. Ties keep the node order, stable_sort would allocate its buffer.
+  runOrder.resize(nodes.size());
+  std::iota(runOrder.begin(), runOrder.end(), 0);
+  std::sort(runOrder.begin(), runOrder.end(), [this](uint32_t a, uint32_t b) { return nodes[a].level < nodes[b].level || (nodes[a].level == nodes[b].level && a < b); });
+
+  for (const auto &node : nodes)
   {
-    commandBuffers[Queue::Present] = rhi->allocateCommandBuffers(Queue::Present, commandBuffersCount[Queue::Present]);
+    maxLevel = std::max(maxLevel, node.level);
   }
 
-  for (auto &cmd : commandBuffers[Queue::Compute])
-  {
-    rhi->beginCommandBuffer(cmd);
-  }
-  for (auto &cmd : commandBuffers[Queue::Graphics])
-  {
-    rhi->beginCommandBuffer(cmd);
-  }
-  for (auto &cmd : commandBuffers[Queue::Transfer])
-  {
-    rhi->beginCommandBuffer(cmd);
-  }
-  for (auto &cmd : commandBuffers[Queue::Present])
-  {
-    rhi->beginCommandBuffer(cmd);
+  os::Logger::logf("[RenderGraph] Max level = %u", maxLevel);
+
+  frame.futures.assign(nodes.size(), GPUFuture());
+
+  CommandBufferSlot &slot = commandBufferSlots[executions & 1];
+  std::vector<CommandBuffer> *commandBuffers = slot.commandBuffers;
+
+  // The command buffers of the slot are reset and recorded again, they are only reallocated when a compile changed
+  // how many of them a queue needs.
+  for (auto queue = Queue::None; queue < Queue::QueuesCount; queue = Queue((uint64_t)queue + 1))
+  {
+    if (commandBuffers[queue].size() == commandBuffersCount[queue])
+    {
+      continue;
+    }
+
+    if (!commandBuffers[queue].empty())
+    {
+      rhi->releaseCommandBuffer(commandBuffers[queue]);
+      commandBuffers[queue].clear();
+    }
+
+    if (commandBuffersCount[queue] > 0)
+    {
+      commandBuffers[queue] = rhi->allocatePersistentCommandBuffers(queue, commandBuffersCount[queue]);
+    }
+
+    slot.compile = 0;
   }
+
   // for (auto &node : nodes)
   // {
   //   commandBuffers[node.id] = rhi->allocateCommandBuffers(node.queue, 1)[0];
@@ -2132,544 +3293,121 @@ void RenderGraph::run(Frame &frame)
   //   os::Logger::logf("[RenderGraph] Allocated CommandBuffer for node %u (level=%u queue=%d)", node.id, node.level, logQueue(node.queue));
   // }
 
-  std::unordered_map<CommandBuffer, std::unordered_set<CommandBuffer>> commandBufferWaits;
+  // Release halves of queue ownership transfers go into the producer's command buffer, so the steps of every command
+  // buffer are laid out first, in the order a serial recording would emit them. Command buffers then record
+  // independently of each other, batched into jobs when run is called from a job. They are numbered queue by queue.
+  uint64_t firstCommandBuffer[Queue::QueuesCount + 1] = {};
 
-  for (auto &currentNode : nodes)
+  for (uint64_t queue = 0; queue < Queue::QueuesCount; queue++)
+  {
+    firstCommandBuffer[queue + 1] = firstCommandBuffer[queue] + commandBuffers[queue].size();
+  }
+
+  auto queueOf = [&](uint64_t index) { return Queue(std::upper_bound(firstCommandBuffer, firstCommandBuffer + Queue::QueuesCount, index) - firstCommandBuffer - 1); };
+
+  uint64_t commandBufferCount = firstCommandBuffer[Queue::QueuesCount];
+
+  // Clearing keeps the capacity of every inner vector, the steps of a frame like the last one fit without allocating.
+  recordSteps.resize(std::max<size_t>(recordSteps.size(), commandBufferCount));
+  commandBufferWaits.resize(std::max<size_t>(commandBufferWaits.size(), commandBufferCount));
+
+  for (uint64_t i = 0; i < commandBufferCount; i++)
+  {
+    recordSteps[i].clear();
+    commandBufferWaits[i].clear();
+  }
+
+  for (uint32_t i : runOrder)
   {
-    CommandBuffer &commandBuffer = commandBuffers[currentNode.queue][currentNode.commandBufferIndex];
+    auto &currentNode = nodes[i];
+    uint64_t index = firstCommandBuffer[currentNode.queue] + currentNode.commandBufferIndex;
 
     for (auto &wait : currentNode.waitSemaphores)
     {
       auto &semaphore = semaphores[wait];
       auto &from = nodes[semaphore.signalTask];
+      uint32_t fromIndex = firstCommandBuffer[from.queue] + from.commandBufferIndex;
+      auto &waits = commandBufferWaits[index];
 
-      if (commandBuffer != commandBuffers[from.queue][from.commandBufferIndex])
+      if (fromIndex != index && std::find(waits.begin(), waits.end(), fromIndex) == waits.end())
       {
-        commandBufferWaits[commandBuffer].insert(commandBuffers[from.queue][from.commandBufferIndex]);
+        waits.push_back(fromIndex);
       }
     }
 
-    os::Logger::logf(
-        "[RenderGraph] * Recording %s (level=%u queue=%s, commandBuffer %u)",
-        currentNode.name.c_str(),
-        currentNode.level,
-        logQueue(currentNode.queue),
-        currentNode.commandBufferIndex);
-
-    /* ================= BUFFER BARRIERS ================= */
-
-    for (auto &transition : currentNode.bufferTransitions)
+    for (uint32_t t = 0; t < currentNode.bufferTransitions.size(); t++)
     {
+      auto &transition = currentNode.bufferTransitions[t];
 
-      auto buffer = getBuffer(transition.resourceId);
-      PipelineStage fromStage = PipelineStage::ALL_COMMANDS;
-      PipelineStage toStage = PipelineStage::ALL_COMMANDS;
-
-      if (transition.fromNode != -1)
+      if (transition.toQueue != transition.fromQueue && transition.fromNode != (uint64_t)-1)
       {
         auto &fromNode = nodes[transition.fromNode];
-        switch (fromNode.queue)
-        {
-        case Queue::Compute:
-          fromStage = PipelineStage::COMPUTE_SHADER;
-          break;
-        case Queue::Graphics:
-          fromStage = PipelineStage::ALL_GRAPHICS;
-          break;
-        case Queue::Transfer:
-          fromStage = PipelineStage::TRANSFER;
-          break;
-        default:
-          break;
-        }
-      }
-
-      switch (currentNode.queue)
-      {
-      case Queue::Compute:
-        toStage = PipelineStage::COMPUTE_SHADER;
-        break;
-      case Queue::Graphics:
-        toStage = PipelineStage::ALL_GRAPHICS;
-        break;
-      case Queue::Transfer:
-        toStage = PipelineStage::TRANSFER;
-        break;
-      default:
-        break;
+        recordSteps[firstCommandBuffer[fromNode.queue] + fromNode.commandBufferIndex].push_back(RecordStep{.type = RecordStep::BufferRelease, .node = i, .barrier = t});
       }
+    }
 
-      // if(currentNode.queue)
-
-      if (transition.toQueue != transition.fromQueue)
-      {
-        os::Logger::logf(
-            "[RenderGraph][Barrier][Buffer][QueueTransfer] '%s' fromNode=%u -> node=%u offset=%zu size=%zu fromAccess=%u toAccess=%u fromQueue=%s toQueue=%s, fromNode %u",
-            buffer.name.c_str(),
-            transition.fromNode,
-            currentNode.id,
-            transition.offset,
-            transition.size,
-            (uint32_t)transition.fromAccess,
-            (uint32_t)transition.toAccess,
-            logQueue(transition.fromQueue),
-            logQueue(transition.toQueue),
-            transition.fromNode);
-
-        if (transition.fromNode == -1)
-        {
-          rhi->cmdBufferBarrier(
-              commandBuffer, buffer, fromStage, toStage, transition.fromAccess, transition.toAccess, transition.offset, transition.size, Queue::None, Queue::None);
-        }
-        else
-        {
+    for (uint32_t t = 0; t < currentNode.textureTransitions.size(); t++)
+    {
+      auto &transition = currentNode.textureTransitions[t];
 
-          auto &fromNode = nodes[transition.fromNode];
-
-          rhi->cmdBufferBarrier(
-              commandBuffers[fromNode.queue][fromNode.commandBufferIndex],
-              buffer,
-              fromStage,
-              toStage,
-              transition.fromAccess,
-              AccessPattern::NONE,
-              transition.offset,
-              transition.size,
-              transition.fromQueue,
-              transition.toQueue);
-
-          rhi->cmdBufferBarrier(
-              commandBuffer, buffer, fromStage, toStage, AccessPattern::NONE, transition.toAccess, transition.offset, transition.size, transition.fromQueue, transition.toQueue);
-        }
-      }
-      else
+      if (transition.toQueue != transition.fromQueue && transition.fromNode != (uint64_t)-1)
       {
-        os::Logger::logf(
-            "[RenderGraph][Barrier][Buffer] '%s' offset=%zu size=%zu fromAccess=%u toAccess=%u queue=%s",
-            buffer.name.c_str(),
-            transition.offset,
-            transition.size,
-            (uint32_t)transition.fromAccess,
-            (uint32_t)transition.toAccess,
-            logQueue(transition.fromQueue));
-
-        rhi->cmdBufferBarrier(
-            commandBuffer, buffer, fromStage, toStage, transition.fromAccess, transition.toAccess, transition.offset, transition.size, transition.fromQueue, transition.toQueue);
+        auto &fromNode = nodes[transition.fromNode];
+        recordSteps[firstCommandBuffer[fromNode.queue] + fromNode.commandBufferIndex].push_back(RecordStep{.type = RecordStep::TextureRelease, .node = i, .barrier = t});
       }
     }
 
-    /* ================= IMAGE BARRIERS ================= */
+    recordSteps[index].push_back(RecordStep{.type = RecordStep::Node, .node = i, .barrier = 0});
+  }
 
-    for (auto &transition : currentNode.textureTransitions)
-    {
+  // Command buffers that only hold static nodes and were recorded for the current compile are submitted as they are.
+  recordedCommandBuffers.clear();
 
-      auto texture = getTexture(transition.resourceId);
-      PipelineStage fromStage = PipelineStage::ALL_COMMANDS;
-      PipelineStage toStage = PipelineStage::ALL_COMMANDS;
-      if (transition.fromNode != -1)
-      {
-        auto &fromNode = nodes[transition.fromNode];
-        switch (fromNode.queue)
-        {
-        case Queue::Compute:
-          fromStage = PipelineStage::COMPUTE_SHADER;
-          break;
-        case Queue::Graphics:
-          fromStage = PipelineStage::ALL_GRAPHICS;
-          break;
-        case Queue::Transfer:
-          fromStage = PipelineStage::TRANSFER;
-          break;
-        default:
-          break;
-        }
-      }
-      switch (currentNode.queue)
-      {
-      case Queue::Compute:
-        toStage = PipelineStage::COMPUTE_SHADER;
-        break;
-      case Queue::Graphics:
-        toStage = PipelineStage::ALL_GRAPHICS;
-        break;
-      case Queue::Transfer:
-        toStage = PipelineStage::TRANSFER;
-        break;
-      default:
-        break;
-      }
+  for (uint32_t i = 0; i < commandBufferCount; i++)
+  {
+    bool replay = slot.compile == compiles;
 
-      if (transition.toQueue != transition.fromQueue)
-      {
-        os::Logger::logf(
-            "[RenderGraph][Barrier][Image][QueueTransfer] '%s' fromNode=%u -> node=%u layout %u -> %u access %u -> %u mips [%u..%u) layers [%u..%u) fromQueue=%s toQueue=%s",
-            texture.name.c_str(),
-            transition.fromNode,
-            currentNode.id,
-            (uint32_t)transition.fromLayout,
-            (uint32_t)transition.toLayout,
-            (uint32_t)transition.fromAccess,
-            (uint32_t)transition.toAccess,
-            transition.baseMip,
-            transition.baseMip + transition.mipCount,
-            transition.baseLayer,
-            transition.baseLayer + transition.layerCount,
-            logQueue(transition.fromQueue),
-            logQueue(transition.toQueue));
-
-        if (transition.fromNode == -1)
-        {
-          rhi->cmdImageBarrier(
-              commandBuffer,
-              texture,
-              fromStage,
-              toStage,
-              transition.fromAccess,
-              transition.toAccess,
-              transition.fromLayout,
-              transition.toLayout,
-              GetImageAspectFlags(resources.textureMetadatas[transition.resourceId]->textureInfo.format),
-              transition.baseMip,
-              transition.mipCount,
-              transition.baseLayer,
-              transition.layerCount,
-              Queue::None,
-              Queue::None);
-        }
-        else
-        {
-          auto &fromNode = nodes[transition.fromNode];
-
-          rhi->cmdImageBarrier(
-              commandBuffers[fromNode.queue][fromNode.commandBufferIndex],
-              texture,
-              fromStage,
-              toStage,
-              transition.fromAccess,
-              AccessPattern::NONE,
-              transition.fromLayout,
-              transition.toLayout,
-              GetImageAspectFlags(resources.textureMetadatas[transition.resourceId]->textureInfo.format),
-              transition.baseMip,
-              transition.mipCount,
-              transition.baseLayer,
-              transition.layerCount,
-              transition.fromQueue,
-              transition.toQueue);
-          rhi->cmdImageBarrier(
-              commandBuffer,
-              texture,
-              fromStage,
-              toStage,
-              AccessPattern::NONE,
-              transition.toAccess,
-              transition.fromLayout,
-              transition.toLayout,
-              GetImageAspectFlags(resources.textureMetadatas[transition.resourceId]->textureInfo.format),
-              transition.baseMip,
-              transition.mipCount,
-              transition.baseLayer,
-              transition.layerCount,
-              transition.fromQueue,
-              transition.toQueue);
-        }
-      }
-      else
+    for (const RecordStep &step : recordSteps[i])
+    {
+      if (step.type == RecordStep::Node && !nodes[step.node].isStatic)
       {
-        os::Logger::logf(
-            "[RenderGraph][Barrier][Image] '%s' layout %u -> %u access %u -> %u mips [%u..%u) layers [%u..%u) queue=%s",
-            texture.name.c_str(),
-            (uint32_t)transition.fromLayout,
-            (uint32_t)transition.toLayout,
-            (uint32_t)transition.fromAccess,
-            (uint32_t)transition.toAccess,
-            transition.baseMip,
-            transition.baseMip + transition.mipCount,
-            transition.baseLayer,
-            transition.baseLayer + transition.layerCount,
-            logQueue(transition.fromQueue));
-
-        rhi->cmdImageBarrier(
-            commandBuffer,
-            texture,
-            fromStage,
-            toStage,
-            transition.fromAccess,
-            transition.toAccess,
-            transition.fromLayout,
-            transition.toLayout,
-            GetImageAspectFlags(resources.textureMetadatas[transition.resourceId]->textureInfo.format),
-            transition.baseMip,
-            transition.mipCount,
-            transition.baseLayer,
-            transition.layerCount,
-            transition.fromQueue,
-            transition.toQueue);
+        replay = false;
+        break;
       }
     }
 
-    /* ================= COMMANDS ================= */
-
-    for (auto &cmd : currentNode.commands)
+    if (!replay)
     {
-      switch (cmd.type)
-      {
-      case BeginRenderPass:
-        os::Logger::logf("[RenderGraph][Cmd] BeginRenderPass '%s'", cmd.args.renderPassInfo->name.c_str());
-        rhi->cmdBeginRenderPass(commandBuffer, *cmd.args.renderPassInfo);
-        break;
+      recordedCommandBuffers.push_back(i);
+    }
+  }
 
-      case EndRenderPass:
-        os::Logger::logf("[RenderGraph][Cmd] EndRenderPass");
-        rhi->cmdEndRenderPass(commandBuffer);
-        break;
+  os::Logger::logf("[RenderGraph] Replaying %zu of %zu command buffers", commandBufferCount - recordedCommandBuffers.size(), commandBufferCount);
 
-      case CopyBuffer:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] CopyBuffer '%s'[%zu] -> '%s'[%zu] size=%zu",
-            cmd.args.copyBuffer->src.buffer.name.c_str(),
-            cmd.args.copyBuffer->src.offset,
-            cmd.args.copyBuffer->dst.buffer.name.c_str(),
-            cmd.args.copyBuffer->dst.offset,
-            cmd.args.copyBuffer->src.size);
-
-        rhi->cmdCopyBuffer(
-            commandBuffer,
-            cmd.args.copyBuffer->src.buffer,
-            cmd.args.copyBuffer->dst.buffer,
-            cmd.args.copyBuffer->src.offset,
-            cmd.args.copyBuffer->dst.offset,
-            cmd.args.copyBuffer->src.size);
-        break;
+  size_t recordBatches = batchesFor(recordedCommandBuffers.size(), 1);
 
-      case BindBindingGroups:
+  forEachJob(
+      recordBatches,
+      [&](size_t index)
       {
-        auto metadata = resources.bindingGroupsMetadata[cmd.args.bindGroups->groups.name];
-
-        const BindingGroupsInfo &info = metadata->groupsInfo;
-
-        os::Logger::logf(
-            "[RenderGraph][Cmd] BindBindingGroups '%s' groupCount=%zu dynamicOffsets=%zu", info.name.c_str(), info.groups.size(), cmd.args.bindGroups->dynamicOffsets.size());
-
-        /* ===== Dynamic Offsets ===== */
-
-        for (size_t i = 0; i < cmd.args.bindGroups->dynamicOffsets.size(); ++i)
-        {
-          os::Logger::logf("[RenderGraph]       [DynamicOffset] index=%zu value=%u", i, cmd.args.bindGroups->dynamicOffsets[i]);
-        }
-
-        /* ===== Groups ===== */
-
-        for (size_t g = 0; g < info.groups.size(); ++g)
+        for (size_t j = index * recordedCommandBuffers.size() / recordBatches; j < (index + 1) * recordedCommandBuffers.size() / recordBatches; j++)
         {
-          const GroupInfo &group = info.groups[g];
-
-          os::Logger::logf("[RenderGraph]       [BindingGroup] index=%zu name='%s'", g, group.name.c_str());
-
-          /* -------- Buffers -------- */
-
-          for (const BindingBuffer &buf : group.buffers)
-          {
-            const BufferView &view = buf.bufferView;
-
-            os::Logger::logf(
-                "[RenderGraph]          [Buffer] binding=%u name='%s' offset=%llu size=%llu access=%u",
-                buf.binding,
-                view.buffer.name.c_str(),
-                (unsigned long long)view.offset,
-                (unsigned long long)view.size,
-                (uint32_t)view.access);
-          }
-
-          /* -------- Samplers -------- */
-
-          for (const BindingSampler &sampler : group.samplers)
-          {
-            const TextureView &view = sampler.view;
-
-            const char *textureName = view.texture.name.c_str();
-
-            os::Logger::logf(
-                "[RenderGraph]          [Sampler] binding=%u sampler='%s' texture='%s' "
-                "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
-                sampler.binding,
-                sampler.sampler.name.c_str(),
-                textureName,
-                view.baseMipLevel,
-                view.baseMipLevel + view.levelCount,
-                view.baseArrayLayer,
-                view.baseArrayLayer + view.layerCount,
-                (uint32_t)view.flags,
-                (uint32_t)view.layout,
-                (uint32_t)view.access);
-          }
-
-          /* -------- Sampled Textures -------- */
-
-          for (const BindingTextureInfo &tex : group.textures)
-          {
-            const TextureView &view = tex.textureView;
-
-            const char *textureName = view.texture.name.c_str();
-
-            os::Logger::logf(
-                "[RenderGraph]          [Texture] binding=%u texture='%s' "
-                "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
-                tex.binding,
-                textureName,
-                view.baseMipLevel,
-                view.baseMipLevel + view.levelCount,
-                view.baseArrayLayer,
-                view.baseArrayLayer + view.layerCount,
-                (uint32_t)view.flags,
-                (uint32_t)view.layout,
-                (uint32_t)view.access);
-          }
-
-          /* -------- Storage Textures -------- */
-
-          for (const BindingStorageTextureInfo &tex : group.storageTextures)
-          {
-            const TextureView &view = tex.textureView;
-
-            const char *textureName = view.texture.name.c_str();
-
-            os::Logger::logf(
-                "[RenderGraph]          [StorageTexture] binding=%u texture='%s' "
-                "mips=[%u..%u) layers=[%u..%u) aspect=%u layout=%u access=%u",
-                tex.binding,
-                textureName,
-                view.baseMipLevel,
-                view.baseMipLevel + view.levelCount,
-                view.baseArrayLayer,
-                view.baseArrayLayer + view.layerCount,
-                (uint32_t)view.flags,
-                (uint32_t)view.layout,
-                (uint32_t)view.access);
-          }
+          uint32_t i = recordedCommandBuffers[j];
+          Queue queue = queueOf(i);
+          recordCommandBuffer(commandBuffers[queue][i - firstCommandBuffer[queue]], recordSteps[i]);
         }
+      });
 
-        rhi->cmdBindBindingGroups(commandBuffer, cmd.args.bindGroups->groups, cmd.args.bindGroups->dynamicOffsets.data(), cmd.args.bindGroups->dynamicOffsets.size());
-
-        break;
-      }
-
-      case BindGraphicsPipeline:
-        os::Logger::logf("[RenderGraph][Cmd] BindGraphicsPipeline '%s'", cmd.args.graphicsPipeline->name.c_str());
-        rhi->cmdBindGraphicsPipeline(commandBuffer, *cmd.args.graphicsPipeline);
-        break;
-
-      case BindComputePipeline:
-        os::Logger::logf("[RenderGraph][Cmd] BindComputePipeline '%s'", cmd.args.computePipeline->name.c_str());
-        rhi->cmdBindComputePipeline(commandBuffer, *cmd.args.computePipeline);
-        break;
-
-      case BindVertexBuffer:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] BindVertexBuffer slot=%u '%s' offset=%zu",
-            cmd.args.bindVertexBuffer->slot,
-            cmd.args.bindVertexBuffer->buffer.buffer.name.c_str(),
-            cmd.args.bindVertexBuffer->buffer.offset);
-
-        rhi->cmdBindVertexBuffer(commandBuffer, cmd.args.bindVertexBuffer->slot, cmd.args.bindVertexBuffer->buffer.buffer, cmd.args.bindVertexBuffer->buffer.offset);
-        break;
-
-      case BindIndexBuffer:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] BindIndexBuffer '%s' offset=%zu type=%u",
-            cmd.args.bindIndexBuffer->buffer.buffer.name.c_str(),
-            cmd.args.bindIndexBuffer->buffer.offset,
-            (uint32_t)cmd.args.bindIndexBuffer->type);
-
-        rhi->cmdBindIndexBuffer(commandBuffer, cmd.args.bindIndexBuffer->buffer.buffer, cmd.args.bindIndexBuffer->type, cmd.args.bindIndexBuffer->buffer.offset);
-        break;
-
-      case Draw:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] Draw vertices=%u instances=%u firstVertex=%u firstInstance=%u",
-            cmd.args.draw->vertexCount,
-            cmd.args.draw->instanceCount,
-            cmd.args.draw->firstVertex,
-            cmd.args.draw->firstInstance);
-
-        rhi->cmdDraw(commandBuffer, cmd.args.draw->vertexCount, cmd.args.draw->instanceCount, cmd.args.draw->firstVertex, cmd.args.draw->firstInstance);
-        break;
-
-      case DrawIndexed:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] DrawIndexed indices=%u instances=%u firstIndex=%u vertexOffset=%d firstInstance=%u",
-            cmd.args.drawIndexed->indexCount,
-            cmd.args.drawIndexed->instanceCount,
-            cmd.args.drawIndexed->firstIndex,
-            cmd.args.drawIndexed->vertexOffset,
-            cmd.args.drawIndexed->firstInstance);
-
-        rhi->cmdDrawIndexed(
-            commandBuffer,
-            cmd.args.drawIndexed->indexCount,
-            cmd.args.drawIndexed->instanceCount,
-            cmd.args.drawIndexed->firstIndex,
-            cmd.args.drawIndexed->vertexOffset,
-            cmd.args.drawIndexed->firstInstance);
-        break;
-
-      case DrawIndexedIndirect:
-        os::Logger::logf(
-            "[RenderGraph][Cmd] DrawIndexedIndirect buffer='%s' offset=%zu count=%u stride=%u",
-            cmd.args.drawIndexedIndirect->buffer.buffer.name.c_str(),
-            cmd.args.drawIndexedIndirect->buffer.offset,
-            cmd.args.drawIndexedIndirect->drawCount,
-            cmd.args.drawIndexedIndirect->stride);
-
-        rhi->cmdDrawIndexedIndirect(
-            commandBuffer,
-            cmd.args.drawIndexedIndirect->buffer.buffer,
-            cmd.args.drawIndexedIndirect->buffer.offset,
-            cmd.args.drawIndexedIndirect->drawCount,
-            cmd.args.drawIndexedIndirect->stride);
-        break;
-
-      case Dispatch:
-        os::Logger::logf("[RenderGraph][Cmd] Dispatch (%u, %u, %u)", cmd.args.dispatch->x, cmd.args.dispatch->y, cmd.args.dispatch->z);
-
-        rhi->cmdDispatch(commandBuffer, cmd.args.dispatch->x, cmd.args.dispatch->y, cmd.args.dispatch->z);
-        break;
-
-      case StartTimer:
-        rhi->cmdStartTimer(commandBuffer, cmd.args.startTimer->timer, cmd.args.startTimer->stage);
-        break;
-      case StopTimer:
-        rhi->cmdStopTimer(commandBuffer, cmd.args.stopTimer->timer, cmd.args.stopTimer->stage);
-        break;
-      }
-    }
-  }
-
-  for (auto &cmd : commandBuffers[Queue::Compute])
-  {
-    rhi->endCommandBuffer(cmd);
-  }
-  for (auto &cmd : commandBuffers[Queue::Graphics])
-  {
-    rhi->endCommandBuffer(cmd);
-  }
-  for (auto &cmd : commandBuffers[Queue::Transfer])
-  {
-    rhi->endCommandBuffer(cmd);
-  }
+  slot.compile = compiles;
+  executions += 1;
 
   auto submitStart = lib::time::TimeSpan::now();
 
-  std::unordered_map<CommandBuffer, GPUFuture> futures;
+  // Futures of the submitted command buffers, a command buffer of a queue was submitted once at moved past it.
+  submittedFutures.resize(std::max<size_t>(submittedFutures.size(), commandBufferCount));
 
-  std::vector<CommandBuffer> orderedBuffers;
   uint64_t at[Queue::QueuesCount] = {};
 
-  for (auto queue = Queue::None; queue < Queue::QueuesCount; queue = Queue((uint64_t)queue + 1))
-  {
-    at[queue] = 0;
-  }
-
   while (true)
   {
     bool finished = true;
@@ -2687,9 +3425,7 @@ void RenderGraph::run(Frame &frame)
       break;
     }
 
-    std::vector<GPUFuture> waits;
-
-    CommandBuffer commandBuffer;
+    uint64_t index = 0;
 
     Queue queue;
 
@@ -2702,18 +3438,19 @@ void RenderGraph::run(Frame &frame)
 
       bool allDependenciesSubmitted = true;
 
-      waits.clear();
+      submitWaits.clear();
 
-      commandBuffer = commandBuffers[queue][at[queue]];
+      index = firstCommandBuffer[queue] + at[queue];
 
-      for (const auto &waitCommandBuffer : commandBufferWaits[commandBuffer])
+      for (uint32_t wait : commandBufferWaits[index])
       {
-        allDependenciesSubmitted = futures.count(waitCommandBuffer) > 0;
+        Queue waitQueue = queueOf(wait);
+        allDependenciesSubmitted = wait - firstCommandBuffer[waitQueue] < at[waitQueue];
         if (!allDependenciesSubmitted)
         {
           break;
         }
-        waits.push_back(futures[waitCommandBuffer]);
+        submitWaits.push_back(submittedFutures[wait]);
       }
 
       if (allDependenciesSubmitted)
@@ -2723,10 +3460,23 @@ void RenderGraph::run(Frame &frame)
       }
     }
 
-    futures[commandBuffer] = rhi->submit(queue, &commandBuffer, 1, waits.data(), waits.size());
-    os::Logger::logf("[RenderGraph][Submit] Submitting commandBuffer %u queue=%s waits=%zu", (uint64_t)commandBuffer, logQueue(queue), waits.size());
+    if (queue == Queue::QueuesCount)
+    {
+      RENDER_GRAPH_FATAL("[RenderGraph] Command buffers wait on each other");
+    }
+
+    CommandBuffer commandBuffer = commandBuffers[queue][index - firstCommandBuffer[queue]];
+
+    submittedFutures[index] = rhi->submit(queue, &commandBuffer, 1, submitWaits.data(), submitWaits.size());
+    os::Logger::logf("[RenderGraph][Submit] Submitting commandBuffer %u queue=%s waits=%zu", (uint64_t)commandBuffer, logQueue(queue), submitWaits.size());
+
+    frame.futures.push_back(submittedFutures[index]);
+  }
 
-    frame.futures.push_back(futures[commandBuffer]);
+  // Only the futures of this run are kept alive until the next one.
+  for (uint64_t i = commandBufferCount; i < submittedFutures.size(); i++)
+  {
+    submittedFutures[i] = GPUFuture();
   }
 
   auto runEnd = lib::time::TimeSpan::now();
@@ -2842,9 +3592,84 @@ static void validateBufferUsage(const BufferInfo &info)
   }
 }
 
-RHICommandBuffer::RHICommandBuffer()
+RHICommandBuffer::RHICommandBuffer(RenderGraph *renderGraph) : renderGraph(renderGraph), commands(renderGraph ? &renderGraph->recordingArena() : nullptr)
+{
+}
+
+RHIResources &RHICommandBuffer::resources()
+{
+  if (renderGraph == nullptr)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Command buffer is not bound to a render graph");
+  }
+
+  return renderGraph->resources;
+}
+
+BufferViewArgs RHICommandBuffer::encode(const BufferView &view)
+{
+  uint32_t id = resources().bufferMetadatas.idOf(view.buffer);
+
+  if (id == INVALID_RESOURCE_ID)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Buffer '%s' not found", view.buffer.name.c_str());
+  }
+
+  return BufferViewArgs{
+    .buffer = id,
+    .access = view.access,
+    .offset = view.offset,
+    .size = view.size,
+  };
+}
+
+TextureViewArgs RHICommandBuffer::encode(const TextureView &view)
+{
+  uint32_t id = resources().textureMetadatas.idOf(view.texture);
+
+  if (id == INVALID_RESOURCE_ID)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Texture '%s' not found", view.texture.name.c_str());
+  }
+
+  return TextureViewArgs{
+    .texture = id,
+    .swapChain = view.swapChain,
+    .index = view.index,
+    .flags = view.flags,
+    .baseMipLevel = view.baseMipLevel,
+    .levelCount = view.levelCount,
+    .baseArrayLayer = view.baseArrayLayer,
+    .layerCount = view.layerCount,
+    .access = view.access,
+    .layout = view.layout,
+  };
+}
+
+BufferView RenderGraph::bufferView(const BufferViewArgs &args)
+{
+  BufferView view;
+  view.buffer = resources.bufferMetadatas.handleOf<Buffer>(args.buffer);
+  view.offset = args.offset;
+  view.size = args.size;
+  view.access = args.access;
+  return view;
+}
+
+TextureView RenderGraph::textureView(const TextureViewArgs &args)
 {
-  recorded.push_back(CommandSequence());
+  TextureView view;
+  view.texture = resources.textureMetadatas.handleOf<Texture>(args.texture);
+  view.swapChain = args.swapChain;
+  view.index = args.index;
+  view.flags = args.flags;
+  view.baseMipLevel = args.baseMipLevel;
+  view.levelCount = args.levelCount;
+  view.baseArrayLayer = args.baseArrayLayer;
+  view.layerCount = args.layerCount;
+  view.access = args.access;
+  view.layout = args.layout;
+  return view;
 }
 
 void RenderGraph::deleteBuffer(const Buffer &name)
@@ -2854,6 +3679,7 @@ void RenderGraph::deleteBuffer(const Buffer &name)
     RENDER_GRAPH_FATAL("Buffer %s not found", name.name.c_str());
   }
 
+  resourcesVersion.fetch_add(1);
   rhi->deleteBuffer(name);
 }
 
@@ -2863,6 +3689,7 @@ void RenderGraph::deleteTexture(const Texture &name)
   {
     RENDER_GRAPH_FATAL("Texture %s not found", name.name.c_str());
   }
+  resourcesVersion.fetch_add(1);
   rhi->deleteTexture(name);
 }
 
@@ -2872,6 +3699,7 @@ void RenderGraph::deleteSampler(const Sampler &name)
   {
     RENDER_GRAPH_FATAL("Sampler %s not found", name.name.c_str());
   }
+  resourcesVersion.fetch_add(1);
   rhi->deleteSampler(name);
 }
 
@@ -2882,6 +3710,7 @@ void RenderGraph::deleteBindingsLayout(const BindingsLayout &name)
     RENDER_GRAPH_FATAL("Bindings Layout %s not found", name.name.c_str());
   }
 
+  resourcesVersion.fetch_add(1);
   rhi->deleteBindingsLayout(name);
 }
 
@@ -2892,6 +3721,7 @@ void RenderGraph::deleteBindingGroups(const BindingGroups &name)
     RENDER_GRAPH_FATAL("Binding Groups %s not found", name.name.c_str());
   }
 
+  resourcesVersion.fetch_add(1);
   rhi->deleteBindingGroups(name);
 }
 
@@ -2901,6 +3731,7 @@ void RenderGraph::deleteGraphicsPipeline(const GraphicsPipeline &name)
   {
     RENDER_GRAPH_FATAL("Graphics Pipeline %s not found", name.name.c_str());
   }
+  resourcesVersion.fetch_add(1);
   rhi->deleteGraphicsPipeline(name);
 }
 
@@ -2910,6 +3741,7 @@ void RenderGraph::deleteComputePipeline(const ComputePipeline &name)
   {
     RENDER_GRAPH_FATAL("Compute Pipeline %s not found", name.name.c_str());
   }
+  resourcesVersion.fetch_add(1);
   rhi->deleteComputePipeline(name);
 }
 
@@ -2924,15 +3756,20 @@ const Buffer RenderGraph::createBuffer(const BufferInfo &info)
 
   const auto &name = info.name;
 
-  resources.bufferMetadatas.insert(
+  Buffer buffer = rhi->createBuffer(info);
+
+  buffer.id = resources.bufferMetadatas.insert(
       name,
       BufferResourceMetadata{
         .bufferInfo = info,
         .firstUsedAt = UINT64_MAX,
         .lastUsedAt = 0,
-      });
+      },
+      buffer.handle);
+  buffer.generation = resources.bufferMetadatas.generationOf(buffer.id);
 
-  return rhi->createBuffer(info);
+  resourcesVersion.fetch_add(1);
+  return buffer;
 }
 
 const Texture RenderGraph::createTexture(const TextureInfo &info)
@@ -2942,13 +3779,18 @@ const Texture RenderGraph::createTexture(const TextureInfo &info)
   {
     throw std::runtime_error("Texture already created");
   }
-  resources.textureMetadatas.insert(
+  Texture texture = rhi->createTexture(info);
+
+  texture.id = resources.textureMetadatas.insert(
       name,
       TextureResourceMetadata{
         .textureInfo = info,
-      });
+      },
+      texture.handle);
+  texture.generation = resources.textureMetadatas.generationOf(texture.id);
 
-  return rhi->createTexture(info);
+  resourcesVersion.fetch_add(1);
+  return texture;
 }
 
 const Sampler RenderGraph::createSampler(const SamplerInfo &info)
@@ -2958,13 +3800,18 @@ const Sampler RenderGraph::createSampler(const SamplerInfo &info)
   {
     throw std::runtime_error("Sampler already created");
   }
-  resources.samplerMetadatas.insert(
+  Sampler sampler = rhi->createSampler(info);
+
+  sampler.id = resources.samplerMetadatas.insert(
       name,
       SamplerResourceMetadata{
         .samplerInfo = info,
-      });
+      },
+      sampler.handle);
+  sampler.generation = resources.samplerMetadatas.generationOf(sampler.id);
 
-  return rhi->createSampler(info);
+  resourcesVersion.fetch_add(1);
+  return sampler;
 }
 
 bool isSamplerCompatible(ResourceLayout layout)
@@ -2989,7 +3836,7 @@ const BindingGroups RenderGraph::createBindingGroups(const BindingGroupsInfo &in
     throw std::runtime_error("Binding Groups already created");
   }
 
-  auto layoutObject = resources.bindingsLayoutMetadata[info.layout.name];
+  auto layoutObject = resources.bindingsLayoutMetadata.resolve(info.layout);
 
   if (layoutObject->layoutsInfo.groups.size() != info.groups.size())
   {
@@ -3022,7 +3869,7 @@ const BindingGroups RenderGraph::createBindingGroups(const BindingGroupsInfo &in
     {
       if (layoutObject->layoutsInfo.groups[i].buffers[j].type == BufferBindingType::BufferBindingType_StorageBuffer)
       {
-        auto usage = resources.bufferMetadatas[info.groups[i].buffers[j].bufferView.buffer.name]->bufferInfo.usage;
+        auto usage = resources.bufferMetadatas.resolve(info.groups[i].buffers[j].bufferView.buffer)->bufferInfo.usage;
         if ((usage & BufferUsage::BufferUsage_Storage) == 0)
         {
           RENDER_GRAPH_FATAL(
@@ -3035,7 +3882,7 @@ const BindingGroups RenderGraph::createBindingGroups(const BindingGroupsInfo &in
 
       if (layoutObject->layoutsInfo.groups[i].buffers[j].type == BufferBindingType::BufferBindingType_UniformBuffer)
       {
-        auto usage = resources.bufferMetadatas[info.groups[i].buffers[j].bufferView.buffer.name]->bufferInfo.usage;
+        auto usage = resources.bufferMetadatas.resolve(info.groups[i].buffers[j].bufferView.buffer)->bufferInfo.usage;
         if ((usage & BufferUsage::BufferUsage_Uniform) == 0)
         {
           RENDER_GRAPH_FATAL(
@@ -3062,15 +3909,18 @@ const BindingGroups RenderGraph::createBindingGroups(const BindingGroupsInfo &in
     }
   }
 
-  resources.bindingGroupsMetadata.insert(
+  BindingGroups groups = rhi->createBindingGroups(info);
+
+  groups.id = resources.bindingGroupsMetadata.insert(
       name,
       BindingGroupsResourceMetadata{
         .groupsInfo = info,
-      });
+      },
+      groups.handle);
+  groups.generation = resources.bindingGroupsMetadata.generationOf(groups.id);
 
-  assert(resources.bindingGroupsMetadata.contains(name));
-
-  return rhi->createBindingGroups(info);
+  resourcesVersion.fetch_add(1);
+  return groups;
 }
 
 const GraphicsPipeline RenderGraph::createGraphicsPipeline(const GraphicsPipelineInfo &info)
@@ -3082,13 +3932,18 @@ const GraphicsPipeline RenderGraph::createGraphicsPipeline(const GraphicsPipelin
     throw std::runtime_error("Graphics Pipeline already created");
   }
 
-  resources.graphicsPipelineMetadata.insert(
+  GraphicsPipeline pipeline = rhi->createGraphicsPipeline(info);
+
+  pipeline.id = resources.graphicsPipelineMetadata.insert(
       name,
       GraphicsPipelineResourceMetadata{
         .pipelineInfo = info,
-      });
+      },
+      pipeline.handle);
+  pipeline.generation = resources.graphicsPipelineMetadata.generationOf(pipeline.id);
 
-  return rhi->createGraphicsPipeline(info);
+  resourcesVersion.fetch_add(1);
+  return pipeline;
 }
 
 const ComputePipeline RenderGraph::createComputePipeline(const ComputePipelineInfo &info)
@@ -3100,13 +3955,18 @@ const ComputePipeline RenderGraph::createComputePipeline(const ComputePipelineIn
     throw std::runtime_error("Compute Pipeline already created");
   }
 
-  resources.computePipelineMetadata.insert(
+  ComputePipeline pipeline = rhi->createComputePipeline(info);
+
+  pipeline.id = resources.computePipelineMetadata.insert(
       name,
       ComputePipelineResourceMetadata{
         .pipelineInfo = info,
-      });
+      },
+      pipeline.handle);
+  pipeline.generation = resources.computePipelineMetadata.generationOf(pipeline.id);
 
-  return rhi->createComputePipeline(info);
+  resourcesVersion.fetch_add(1);
+  return pipeline;
 }
 
 const BindingsLayout RenderGraph::createBindingsLayout(const BindingsLayoutInfo &info)
@@ -3118,14 +3978,18 @@ const BindingsLayout RenderGraph::createBindingsLayout(const BindingsLayoutInfo
     throw std::runtime_error("Binding Layout already created");
   }
 
-  resources.bindingsLayoutMetadata.insert(
+  BindingsLayout layout = rhi->createBindingsLayout(info);
+
+  layout.id = resources.bindingsLayoutMetadata.insert(
       name,
       BindingsLayoutResourceMetadata{
         .layoutsInfo = info,
-      });
+      },
+      layout.handle);
+  layout.generation = resources.bindingsLayoutMetadata.generationOf(layout.id);
 
-  assert(resources.bindingsLayoutMetadata.contains(name));
-  return rhi->createBindingsLayout(info);
+  resourcesVersion.fetch_add(1);
+  return layout;
 }
 
 const Shader RenderGraph::createShader(const ShaderInfo info)
@@ -3202,85 +4066,86 @@ void RenderGraph::bufferWrite(const Buffer &buffer, const uint64_t offset, const
 
 const Buffer RHIResources::getBuffer(const std::string &name)
 {
-  if (!bufferMetadatas.contains(name))
+  uint32_t id = bufferMetadatas.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("Buffer not found");
   }
 
-  return Buffer{
-    .name = name,
-  };
+  return bufferMetadatas.handleOf<Buffer>(id);
 }
 
 const BindingsLayout RHIResources::getBindingsLayout(const std::string &name)
 {
-  if (!bindingsLayoutMetadata.contains(name))
+  uint32_t id = bindingsLayoutMetadata.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("BindingsLayout not found");
   }
 
-  return BindingsLayout{
-    .name = name,
-  };
+  return bindingsLayoutMetadata.handleOf<BindingsLayout>(id);
 }
 
 const BindingGroups RHIResources::getBindingGroups(const std::string &name)
 {
-  if (!bindingGroupsMetadata.contains(name))
+  uint32_t id = bindingGroupsMetadata.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("BindingGroups not found");
   }
 
-  return BindingGroups{
-    .name = name,
-  };
+  return bindingGroupsMetadata.handleOf<BindingGroups>(id);
 }
 const GraphicsPipeline RHIResources::getGraphicsPipeline(const std::string &name)
 {
-  if (!graphicsPipelineMetadata.contains(name))
+  uint32_t id = graphicsPipelineMetadata.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("GraphicsPipeline not found");
   }
 
-  return GraphicsPipeline{
-    .name = name,
-  };
+  return graphicsPipelineMetadata.handleOf<GraphicsPipeline>(id);
 }
 
 const ComputePipeline RHIResources::getComputePipeline(const std::string &name)
 {
-  if (!computePipelineMetadata.contains(name))
+  uint32_t id = computePipelineMetadata.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("ComputePipeline not found");
   }
 
-  return ComputePipeline{
-    .name = name,
-  };
+  return computePipelineMetadata.handleOf<ComputePipeline>(id);
 }
 
 const Sampler RHIResources::getSampler(const std::string &name)
 {
-  if (!samplerMetadatas.contains(name))
+  uint32_t id = samplerMetadatas.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     throw std::runtime_error("Sampler not found");
   }
-  return Sampler{
-    .name = name,
-  };
+
+  return samplerMetadatas.handleOf<Sampler>(id);
 }
 
 const Texture RHIResources::getTexture(const std::string &name)
 {
-  if (!textureMetadatas.contains(name))
+  uint32_t id = textureMetadatas.idOf(name);
+
+  if (id == INVALID_RESOURCE_ID)
   {
     os::print("texture = %s\n", name.c_str());
     throw std::runtime_error("Texture not found");
   }
 
-  return Texture{
-    .name = name,
-  };
+  return textureMetadatas.handleOf<Texture>(id);
 }
 
 // const Buffer RenderGraph::getScratchBuffer(BufferInfo &info)
@@ -3327,125 +4192,142 @@ const Texture RenderGraph::getTexture(const std::string &name)
 
 void RHICommandBuffer::cmdBeginRenderPass(const RenderPassInfo &info)
 {
-  Command cmd{CommandType::BeginRenderPass};
-  cmd.args.renderPassInfo = new RenderPassInfo();
-  *cmd.args.renderPassInfo = info;
-  recorded.back().commands.push_back(std::move(cmd));
+  uint32_t colorAttachmentCount = info.colorAttachments.size();
+  size_t depthStencilSize = info.depthStencilAttachment ? sizeof(DepthStencilAttachmentArgs) : 0;
+
+  BeginRenderPassArgs *args = commands.push<BeginRenderPassArgs>(CommandType::BeginRenderPass, sizeof(ColorAttachmentArgs) * colorAttachmentCount + depthStencilSize + info.name.size());
+  args->viewport = info.viewport;
+  args->scissor = info.scissor;
+  args->colorAttachmentCount = colorAttachmentCount;
+  args->nameLength = info.name.size();
+  args->hasDepthStencil = info.depthStencilAttachment != nullptr;
+
+  // The trailing data is filled through the accessors that read it back.
+  ColorAttachmentArgs *colorAttachments = const_cast<ColorAttachmentArgs *>(args->colorAttachments());
+
+  for (uint32_t i = 0; i < colorAttachmentCount; i++)
+  {
+    colorAttachments[i] = ColorAttachmentArgs{encode(info.colorAttachments[i].view), info.colorAttachments[i].clearValue};
+  }
+
+  if (info.depthStencilAttachment)
+  {
+    *const_cast<DepthStencilAttachmentArgs *>(args->depthStencilAttachment()) = DepthStencilAttachmentArgs{
+      encode(info.depthStencilAttachment->view),
+      info.depthStencilAttachment->clearDepth,
+      info.depthStencilAttachment->clearStencil,
+    };
+  }
+
+  memcpy(const_cast<char *>(args->name()), info.name.data(), info.name.size());
 }
 
 void RHICommandBuffer::cmdStartTimer(const Timer timer, PipelineStage stage)
 {
-  Command cmd{CommandType::StartTimer};
-  cmd.args.startTimer = new StartTimerArgs();
-  cmd.args.startTimer->timer = timer;
-  cmd.args.startTimer->stage = stage;
-
-  recorded.back().commands.push_back(std::move(cmd));
+  TimerArgs *args = commands.push<TimerArgs>(CommandType::StartTimer, timer.name.size());
+  args->stage = stage;
+  args->nameLength = timer.name.size();
+  memcpy(const_cast<char *>(args->name()), timer.name.data(), timer.name.size());
 }
+
 void RHICommandBuffer::cmdStopTimer(const Timer timer, PipelineStage stage)
 {
-  Command cmd{CommandType::StopTimer};
-  cmd.args.stopTimer = new StopTimerArgs();
-  cmd.args.stopTimer->timer = timer;
-  cmd.args.stopTimer->stage = stage;
-  recorded.back().commands.push_back(std::move(cmd));
+  TimerArgs *args = commands.push<TimerArgs>(CommandType::StopTimer, timer.name.size());
+  args->stage = stage;
+  args->nameLength = timer.name.size();
+  memcpy(const_cast<char *>(args->name()), timer.name.data(), timer.name.size());
 }
 
 void RHICommandBuffer::cmdEndRenderPass()
 {
-  recorded.back().commands.push_back({CommandType::EndRenderPass});
+  commands.push(CommandType::EndRenderPass);
 }
 
 void RHICommandBuffer::cmdCopyBuffer(BufferView src, BufferView dst)
 {
-  Command cmd{CommandType::CopyBuffer};
-  cmd.args.copyBuffer = new CopyBufferArgs();
-  *cmd.args.copyBuffer = {src, dst};
-
-  recorded.back().commands.push_back(std::move(cmd));
+  CopyBufferArgs args = {encode(src), encode(dst)};
+  *commands.push<CopyBufferArgs>(CommandType::CopyBuffer) = args;
 }
 
-void RHICommandBuffer::cmdBindBindingGroups(BindingGroups groups, uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount)
+void RHICommandBuffer::cmdBindBindingGroups(BindingGroups groups, const uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount)
 {
-  Command cmd{CommandType::BindBindingGroups};
-  cmd.args.bindGroups = new BindGroupsArgs();
-  cmd.args.bindGroups->groups = groups;
-  cmd.args.bindGroups->dynamicOffsets.assign(dynamicOffsets, dynamicOffsets + dynamicOffsetsCount);
-  recorded.back().commands.push_back(std::move(cmd));
+  uint32_t id = resources().bindingGroupsMetadata.idOf(groups);
+
+  if (id == INVALID_RESOURCE_ID)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Binding groups '%s' not found", groups.name.c_str());
+  }
+
+  BindGroupsArgs *args = commands.push<BindGroupsArgs>(CommandType::BindBindingGroups, sizeof(uint32_t) * dynamicOffsetsCount);
+  args->groups = id;
+  args->dynamicOffsetsCount = dynamicOffsetsCount;
+
+  if (dynamicOffsetsCount)
+  {
+    memcpy(const_cast<uint32_t *>(args->dynamicOffsets()), dynamicOffsets, sizeof(uint32_t) * dynamicOffsetsCount);
+  }
 }
 
 void RHICommandBuffer::cmdBindGraphicsPipeline(GraphicsPipeline pipeline)
 {
-  Command cmd{CommandType::BindGraphicsPipeline};
-  cmd.args.graphicsPipeline = new GraphicsPipeline();
-  *cmd.args.graphicsPipeline = pipeline;
-  recorded.back().commands.push_back(std::move(cmd));
+  uint32_t id = resources().graphicsPipelineMetadata.idOf(pipeline);
+
+  if (id == INVALID_RESOURCE_ID)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Graphics pipeline '%s' not found", pipeline.name.c_str());
+  }
+
+  commands.push<BindPipelineArgs>(CommandType::BindGraphicsPipeline)->pipeline = id;
 }
 
 void RHICommandBuffer::cmdBindComputePipeline(ComputePipeline pipeline)
 {
-  Command cmd{CommandType::BindComputePipeline};
-  cmd.args.computePipeline = new ComputePipeline();
-  *cmd.args.computePipeline = pipeline;
-  recorded.back().commands.push_back(std::move(cmd));
+  uint32_t id = resources().computePipelineMetadata.idOf(pipeline);
+
+  if (id == INVALID_RESOURCE_ID)
+  {
+    RENDER_GRAPH_FATAL("[RenderGraph] Compute pipeline '%s' not found", pipeline.name.c_str());
+  }
+
+  commands.push<BindPipelineArgs>(CommandType::BindComputePipeline)->pipeline = id;
 }
 
 void RHICommandBuffer::cmdBindVertexBuffer(uint32_t slot, BufferView view)
 {
-  Command cmd{CommandType::BindVertexBuffer};
-  cmd.args.bindVertexBuffer = new BindVertexBufferArgs();
-  *cmd.args.bindVertexBuffer = {slot, view};
-  recorded.back().commands.push_back(std::move(cmd));
+  BindVertexBufferArgs args = {slot, encode(view)};
+  *commands.push<BindVertexBufferArgs>(CommandType::BindVertexBuffer) = args;
 }
 
 void RHICommandBuffer::cmdBindIndexBuffer(BufferView view, Type type)
 {
-  Command cmd{CommandType::BindIndexBuffer};
-  cmd.args.bindIndexBuffer = new BindIndexBufferArgs();
-  *cmd.args.bindIndexBuffer = {view, type};
-  recorded.back().commands.push_back(std::move(cmd));
+  BindIndexBufferArgs args = {encode(view), type};
+  *commands.push<BindIndexBufferArgs>(CommandType::BindIndexBuffer) = args;
 }
 
 void RHICommandBuffer::cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
 {
-  Command cmd{CommandType::Draw};
-  cmd.args.draw = new DrawArgs();
-  *cmd.args.draw = {vertexCount, instanceCount, firstVertex, firstInstance};
-  recorded.back().commands.push_back(std::move(cmd));
-  // recorded.push_back(CommandSequence());
+  *commands.push<DrawArgs>(CommandType::Draw) = {vertexCount, instanceCount, firstVertex, firstInstance};
 }
 
 void RHICommandBuffer::cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstance)
 {
-  Command cmd{CommandType::DrawIndexed};
-  cmd.args.drawIndexed = new DrawIndexedArgs();
-  *cmd.args.drawIndexed = {indexCount, instanceCount, firstIndex, firstInstance, vertexOffset};
-  recorded.back().commands.push_back(std::move(cmd));
-  // recorded.push_back(CommandSequence());
+  *commands.push<DrawIndexedArgs>(CommandType::DrawIndexed) = {indexCount, instanceCount, firstIndex, firstInstance, vertexOffset};
 }
 
 void RHICommandBuffer::cmdDrawIndexedIndirect(BufferView buffer, uint32_t offset, uint32_t drawCount, uint32_t stride)
 {
-  Command cmd{CommandType::DrawIndexedIndirect};
-  cmd.args.drawIndexedIndirect = new DrawIndexedIndirectArgs();
-  *cmd.args.drawIndexedIndirect = {buffer, offset, drawCount, stride};
-  recorded.back().commands.push_back(std::move(cmd));
-  // recorded.push_back(CommandSequence());
+  DrawIndexedIndirectArgs args = {encode(buffer), offset, drawCount, stride};
+  *commands.push<DrawIndexedIndirectArgs>(CommandType::DrawIndexedIndirect) = args;
 }
 
 void RHICommandBuffer::cmdDispatch(uint32_t x, uint32_t y, uint32_t z)
 {
-  Command cmd{CommandType::Dispatch};
-  cmd.args.dispatch = new DispatchArgs();
-  *cmd.args.dispatch = {x, y, z};
-  recorded.back().commands.push_back(std::move(cmd));
-  // recorded.push_back(CommandSequence());
+  *commands.push<DispatchArgs>(CommandType::Dispatch) = {x, y, z};
 }
 
 void RenderGraph::addSwapChainImages(SwapChain sc)
 {
   uint64_t imagesCount = rhi->getSwapChainImagesCount(sc);
-
   for (uint64_t index = 0; index < imagesCount; index++)
   {
     TextureInfo info = {
@@ -3465,16 +4347,19 @@ void RenderGraph::addSwapChainImages(SwapChain sc)
           .textureInfo = info,
         });
   }
+
+  resourcesVersion.fetch_add(1);
 }
 void RenderGraph::removeSwapChainImages(SwapChain sc)
 {
   uint64_t imagesCount = rhi->getSwapChainImagesCount(sc);
-
   for (uint64_t index = 0; index < imagesCount; index++)
   {
     auto name = "_SwapChainImage[" + std::to_string((uint64_t)sc) + "," + std::to_string(index) + "].texture";
     resources.textureMetadatas.remove(name);
   }
+
+  resourcesVersion.fetch_add(1);
 }
 
 const Timer RenderGraph::createTimer(const TimerInfo &info)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ResourceDatabase.hpp"
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -8,14 +9,24 @@
 #include "RHI.hpp"
 #include "Types.hpp"
 #include <stack>
+#include <tuple>
+#include <type_traits>
 
 #include "datastructure/ConcurrentHashMap.hpp"
 #include "datastructure/ConcurrentQueue.hpp"
+#include "datastructure/ConcurrentSnapshotMap.hpp"
+#include "datastructure/ConcurrentVector.hpp"
 #include "datastructure/ThreadLocalStorage.hpp"
+#include "memory/AliasingPlanner.hpp"
+#include "memory/FrameArena.hpp"
+#include "memory/allocator/FrameArenaAllocator.hpp"
 
 namespace rendering
 {
 
+// Vector whose storage comes from a render graph frame arena, valid until that arena is reset.
+template <typename T> using FrameVector = std::vector<T, lib::memory::allocator::FrameArenaAllocator<T>>;
+
 enum CommandType
 {
   BeginRenderPass,
@@ -40,7 +51,7 @@ enum CommandType
 
 struct BufferBarrier
 {
-  std::string resourceId;
+  uint32_t resourceId;
   uint64_t offset;
   uint64_t size;
   AccessPattern fromAccess;
@@ -54,7 +65,7 @@ struct BufferBarrier
 
 struct TextureBarrier
 {
-  std::string resourceId;
+  uint32_t resourceId;
   uint64_t toLevel;
   uint64_t baseMip;
   uint64_t mipCount;
@@ -69,26 +80,99 @@ struct TextureBarrier
   uint64_t fromNode;
 };
 
+// Recorded commands refer to resources by the id the render graph gave them, every argument is plain data that is
+// copied inline into a command stream.
+struct BufferViewArgs
+{
+  uint32_t buffer;
+  AccessPattern access;
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct TextureViewArgs
+{
+  uint32_t texture;
+  SwapChain swapChain;
+  uint32_t index;
+  ImageAspectFlags flags;
+  uint32_t baseMipLevel;
+  uint32_t levelCount;
+  uint32_t baseArrayLayer;
+  uint32_t layerCount;
+  AccessPattern access;
+  ResourceLayout layout;
+};
+
+struct ColorAttachmentArgs
+{
+  TextureViewArgs view;
+  Color clearValue;
+};
+
+struct DepthStencilAttachmentArgs
+{
+  TextureViewArgs view;
+  float clearDepth;
+  uint32_t clearStencil;
+};
+
+// Followed by the color attachments, the depth stencil attachment when there is one and the name.
+struct BeginRenderPassArgs
+{
+  Viewport viewport;
+  Rect2D scissor;
+  uint32_t colorAttachmentCount;
+  uint32_t nameLength;
+  bool hasDepthStencil;
+
+  const ColorAttachmentArgs *colorAttachments() const
+  {
+    return reinterpret_cast<const ColorAttachmentArgs *>(this + 1);
+  }
+
+  const DepthStencilAttachmentArgs *depthStencilAttachment() const
+  {
+    return hasDepthStencil ? reinterpret_cast<const DepthStencilAttachmentArgs *>(colorAttachments() + colorAttachmentCount) : nullptr;
+  }
+
+  const char *name() const
+  {
+    return reinterpret_cast<const char *>(colorAttachments() + colorAttachmentCount) + (hasDepthStencil ? sizeof(DepthStencilAttachmentArgs) : 0);
+  }
+};
+
 struct CopyBufferArgs
 {
-  BufferView src, dst;
+  BufferViewArgs src, dst;
 };
 
+// Followed by the dynamic offsets.
 struct BindGroupsArgs
 {
-  BindingGroups groups;
-  std::vector<uint32_t> dynamicOffsets;
+  uint32_t groups;
+  uint32_t dynamicOffsetsCount;
+
+  const uint32_t *dynamicOffsets() const
+  {
+    return reinterpret_cast<const uint32_t *>(this + 1);
+  }
+};
+
+struct BindPipelineArgs
+{
+  uint32_t pipeline;
 };
 
 struct BindVertexBufferArgs
 {
   uint32_t slot;
-  BufferView buffer;
+  BufferViewArgs buffer;
 };
 
 struct BindIndexBufferArgs
 {
-  BufferView buffer;
+  BufferViewArgs buffer;
   Type type;
 };
 
@@ -105,7 +189,7 @@ struct DrawIndexedArgs
 
 struct DrawIndexedIndirectArgs
 {
-  BufferView buffer;
+  BufferViewArgs buffer;
   uint32_t offset;
   uint32_t drawCount, stride;
 };
@@ -115,42 +199,165 @@ struct DispatchArgs
   uint32_t x, y, z;
 };
 
-// struct GetNextSwapChainImageArgs
-// {
-//   SwapChain swapChain;
-// };
-struct StartTimerArgs
+// Followed by the timer name.
+struct TimerArgs
 {
-  Timer timer;
   PipelineStage stage;
+  uint32_t nameLength;
+
+  const char *name() const
+  {
+    return reinterpret_cast<const char *>(this + 1);
+  }
 };
-struct StopTimerArgs
+
+// Header of a recorded command, its arguments follow it inline. size is the length of the whole command in bytes,
+// rounded up so that the next header stays aligned.
+struct alignas(8) Command
 {
-  Timer timer;
-  PipelineStage stage;
+  CommandType type;
+  uint32_t size;
+
+  template <typename Args> const Args &args() const
+  {
+    return *reinterpret_cast<const Args *>(this + 1);
+  }
+
+  const Command *next() const
+  {
+    return reinterpret_cast<const Command *>(reinterpret_cast<const char *>(this) + size);
+  }
 };
 
-struct Command
+// Consecutive commands of a stream.
+struct CommandRange
 {
-  CommandType type;
-  union
-  {
-    RenderPassInfo *renderPassInfo;
-    CopyBufferArgs *copyBuffer;
-    BindGroupsArgs *bindGroups;
-    GraphicsPipeline *graphicsPipeline;
-    ComputePipeline *computePipeline;
-    BindVertexBufferArgs *bindVertexBuffer;
-    BindIndexBufferArgs *bindIndexBuffer;
-    DrawArgs *draw;
-    DrawIndexedArgs *drawIndexed;
-    DrawIndexedIndirectArgs *drawIndexedIndirect;
-    DispatchArgs *dispatch;
-    StartTimerArgs *startTimer;
-    StopTimerArgs *stopTimer;
-
-    // GetNextSwapChainImageArgs *getNextSwapChainImageArgs;
-  } args;
+  class Iterator
+  {
+    const Command *at;
+
+  public:
+    Iterator(const Command *at) : at(at)
+    {
+    }
+
+    const Command &operator*() const
+    {
+      return *at;
+    }
+
+    const Command *operator->() const
+    {
+      return at;
+    }
+
+    Iterator &operator++()
+    {
+      at = at->next();
+      return *this;
+    }
+
+    bool operator!=(const Iterator &other) const
+    {
+      return at != other.at;
+    }
+
+    bool operator==(const Iterator &other) const
+    {
+      return at == other.at;
+    }
+  };
+
+  const Command *first = nullptr;
+  const Command *last = nullptr;
+
+  bool empty() const
+  {
+    return first == last;
+  }
+
+  Iterator begin() const
+  {
+    return Iterator(first);
+  }
+
+  Iterator end() const
+  {
+    return Iterator(last);
+  }
+};
+
+// Commands packed one after the other in a single buffer, each a Command header followed by its arguments. Reading
+// walks the buffer in order without following any pointer, moving a stream hands over its buffer.
+class CommandStream
+{
+  FrameVector<uint64_t> words;
+
+  Command *append(CommandType type, size_t argsSize)
+  {
+    size_t bytes = sizeof(Command) + argsSize;
+    size_t at = words.size();
+
+    words.resize(at + (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+
+    Command *command = reinterpret_cast<Command *>(words.data() + at);
+    command->type = type;
+    command->size = (words.size() - at) * sizeof(uint64_t);
+    return command;
+  }
+
+public:
+  CommandStream(lib::memory::FrameArena *arena = nullptr) : words(arena)
+  {
+  }
+
+  void push(CommandType type)
+  {
+    append(type, 0);
+  }
+
+  // Appends a command whose arguments are followed by extra bytes, returns the zeroed arguments and trailing bytes to
+  // fill in. They are valid until the next push.
+  template <typename Args> Args *push(CommandType type, size_t extra = 0)
+  {
+    static_assert(std::is_trivially_copyable_v<Args> && alignof(Args) <= alignof(Command), "Command arguments must be plain data");
+    return reinterpret_cast<Args *>(append(type, sizeof(Args) + extra) + 1);
+  }
+
+  void reserve(size_t bytes)
+  {
+    words.reserve((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  }
+
+  void clear()
+  {
+    words.clear();
+  }
+
+  size_t bytes() const
+  {
+    return words.size() * sizeof(uint64_t);
+  }
+
+  const void *data() const
+  {
+    return words.data();
+  }
+
+  CommandRange range() const
+  {
+    return CommandRange{reinterpret_cast<const Command *>(words.data()), reinterpret_cast<const Command *>(words.data() + words.size())};
+  }
+
+  CommandRange::Iterator begin() const
+  {
+    return range().begin();
+  }
+
+  CommandRange::Iterator end() const
+  {
+    return range().end();
+  }
 };
 
 enum ResourceType
@@ -174,6 +381,15 @@ enum DependencyType
   DependencyType_ResouceWrite,
 };
 
+enum PassFlags
+{
+  PassFlags_None = 0,
+  // The pass records the same commands every frame. Once recorded, its command buffers are submitted again without
+  // being recorded until the graph is compiled from changed passes. Commands that change per frame, such as swap
+  // chain image indices or timers, must not be used by static passes.
+  PassFlags_Static = 1 << 0,
+};
+
 enum EdgeType
 {
   ResourceDependency,
@@ -187,7 +403,7 @@ struct RenderGraphEdge
   EdgeType type;
 
   ResourceType resourceType;
-  std::string resourceId;
+  uint32_t resourceId;
 };
 
 // struct Surface
@@ -373,13 +589,14 @@ struct InputResource
 {
   // uint64_t id;
   ResourceType type;
-  BufferView bufferView;
-  TextureView textureView;
-  ComputePipeline computePipeline;
-  GraphicsPipeline graphicsPipeline;
-  BindingGroups bindingGroups;
-  BindingsLayout bindingLayout;
-  Sampler sampler;
+  // Only the member of type is set by consumers, the others stay empty.
+  BufferView bufferView = {};
+  TextureView textureView = {};
+  ComputePipeline computePipeline = {};
+  GraphicsPipeline graphicsPipeline = {};
+  BindingGroups bindingGroups = {};
+  BindingsLayout bindingLayout = {};
+  Sampler sampler = {};
   AccessPattern access;
   ResourceLayout layout;
 };
@@ -422,12 +639,24 @@ struct BufferAllocation
   uint64_t size;
 };
 
+class RenderGraph;
+class RHIResources;
+
+// Commands are recorded into a stream allocated from the recording frame arena of renderGraph, a command buffer must be
+// recorded and enqueued in between two calls to RenderGraph::compile. Resources are resolved to their ids as they are
+// recorded and must exist by then.
 class RHICommandBuffer
 {
+  RenderGraph *renderGraph;
+
+  RHIResources &resources();
+  BufferViewArgs encode(const BufferView &view);
+  TextureViewArgs encode(const TextureView &view);
+
 public:
   // const std::string swapChainImageName = "SwapChainImage.textureView";
 
-  RHICommandBuffer();
+  RHICommandBuffer(RenderGraph *renderGraph = nullptr);
 
   struct OutputResource
   {
@@ -440,24 +669,14 @@ public:
     ResourceLayout layout;
   };
 
-  struct CommandSequence
-  {
-    // std::vector<OutputResource> outputResources;
-    std::vector<Command> commands;
-    // std::vector<uint64_t> buffersAllocated;
-    // std::vector<uint64_t> texturesAllocated;
-    // std::vector<uint64_t> samplersAllocated;
-    // std::vector<uint64_t> bindingLayoutsAllocated;
-  };
-
-  std::vector<CommandSequence> recorded;
+  CommandStream commands;
 
   // const SwapChain createSwapChain(const SwapChainInfo &info);
 
   void cmdBeginRenderPass(const RenderPassInfo &info);
   void cmdEndRenderPass();
   void cmdCopyBuffer(BufferView src, BufferView dst);
-  void cmdBindBindingGroups(BindingGroups groups, uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount);
+  void cmdBindBindingGroups(BindingGroups groups, const uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount);
   void cmdBindGraphicsPipeline(GraphicsPipeline);
   void cmdBindComputePipeline(ComputePipeline);
   void cmdBindVertexBuffer(uint32_t slot, BufferView);
@@ -470,24 +689,235 @@ public:
   void cmdStopTimer(const Timer timer, PipelineStage stage);
 };
 
-class RenderGraph;
+// Metadata of one kind of resource, stored at the dense id handed out when the resource is created. Analysis and run
+// index it with the id carried by resource handles, names only resolve handles built without one, such as swap chain
+// views, and stay for debugging. Entries never move and the ids of deleted resources are reused, the generation of an
+// entry is odd while it is live and is bumped by every insert and remove, so handles to a removed resource stop
+// resolving instead of reaching the resource that reused its id. A reused entry is only written while its generation
+// is even and is published with a release store, removing a resource that is still being recorded stays a caller error.
+// Iterating yields the id, name and metadata of every live entry.
+constexpr uint32_t INVALID_RESOURCE_ID = UINT32_MAX;
+
+template <typename Meta> class ResourceTable
+{
+  struct Entry
+  {
+    std::string name;
+    Meta meta;
+    uint64_t handle = 0;
+    std::atomic<uint32_t> generation{0};
+
+    Entry() = default;
+
+    Entry(const std::string &name, const Meta &meta, uint64_t handle, uint32_t generation)
+        : name(name), meta(meta), handle(handle), generation(generation)
+    {
+    }
+
+    Entry(const Entry &other) : name(other.name), meta(other.meta), handle(other.handle), generation(other.generation.load(std::memory_order_relaxed))
+    {
+    }
+  };
+
+  lib::ConcurrentVector<Entry> entries;
+  lib::ConcurrentSnapshotMap<std::string, uint32_t> ids;
+  std::vector<uint32_t> freeIds;
+  std::mutex writeLock;
+  uint32_t count = 0;
+
+  bool live(uint32_t id) const
+  {
+    return id < entries.size() && (entries[id].generation.load(std::memory_order_acquire) & 1U);
+  }
+
+public:
+  class Iterator
+  {
+    ResourceTable *table;
+    uint32_t id;
+
+    void skip()
+    {
+      while (id < table->entries.size() && !table->live(id))
+      {
+        id++;
+      }
+    }
+
+  public:
+    Iterator(ResourceTable *table, uint32_t id) : table(table), id(id)
+    {
+      skip();
+    }
+
+    std::tuple<uint32_t, const std::string &, Meta &> operator*() const
+    {
+      Entry &entry = table->entries[id];
+      return {id, entry.name, entry.meta};
+    }
+
+    Iterator &operator++()
+    {
+      id++;
+      skip();
+      return *this;
+    }
+
+    bool operator!=(const Iterator &other) const
+    {
+      return id != other.id;
+    }
+  };
+
+  // Stores the metadata of a resource created under name, handle is its backend handle.
+  uint32_t insert(const std::string &name, const Meta &meta, uint64_t handle = 0)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    uint32_t id;
+
+    if (freeIds.size())
+    {
+      id = freeIds.back();
+      freeIds.pop_back();
+
+      Entry &entry = entries[id];
+      entry.name = name;
+      entry.meta = meta;
+      entry.handle = handle;
+      entry.generation.store(entry.generation.load(std::memory_order_relaxed) + 1U, std::memory_order_release);
+    }
+    else
+    {
+      id = entries.pushBack(Entry{name, meta, handle, 1U});
+    }
+
+    ids.insert(name, id);
+    count++;
+    return id;
+  }
+
+  bool remove(const std::string &name)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    auto it = ids.find(name);
+
+    if (it == ids.end())
+    {
+      return false;
+    }
+
+    uint32_t id = it.value();
+    ids.remove(name);
+
+    Entry &entry = entries[id];
+    entry.generation.store(entry.generation.load(std::memory_order_relaxed) + 1U, std::memory_order_release);
+    entry.meta = Meta{};
+    freeIds.push_back(id);
+    count--;
+    return true;
+  }
+
+  bool contains(const std::string &name)
+  {
+    return ids.contains(name);
+  }
+
+  uint32_t idOf(const std::string &name)
+  {
+    auto it = ids.find(name);
+    return it == ids.end() ? INVALID_RESOURCE_ID : it.value();
+  }
+
+  // Handles carrying an id resolve only while their generation matches the entry, stale ones are rejected rather than
+  // looked up by name.
+  template <typename Handle> uint32_t idOf(const Handle &handle)
+  {
+    if (handle.id == INVALID_RESOURCE_ID)
+    {
+      return idOf(handle.name);
+    }
+
+    bool current = handle.id < entries.size() && entries[handle.id].generation.load(std::memory_order_acquire) == handle.generation;
+    return current ? handle.id : INVALID_RESOURCE_ID;
+  }
+
+  // Generation of the resource live at id, stored in its handles next to the id.
+  uint32_t generationOf(uint32_t id) const
+  {
+    return entries[id].generation.load(std::memory_order_acquire);
+  }
+
+  Meta *get(uint32_t id)
+  {
+    return live(id) ? &entries[id].meta : nullptr;
+  }
+
+  Meta *get(const std::string &name)
+  {
+    return get(idOf(name));
+  }
+
+  template <typename Handle> Meta *resolve(const Handle &handle)
+  {
+    return get(idOf(handle));
+  }
+
+  const std::string &nameOf(uint32_t id)
+  {
+    return entries[id].name;
+  }
+
+  // Rebuilds the resource handle of id, with its name, backend handle, id and generation.
+  template <typename Handle> Handle handleOf(uint32_t id)
+  {
+    Handle result;
+    result.name = entries[id].name;
+    result.handle = entries[id].handle;
+    result.id = id;
+    result.generation = entries[id].generation.load(std::memory_order_acquire);
+    return result;
+  }
+
+  uint32_t size() const
+  {
+    return count;
+  }
+
+  // Upper bound of the ids in use, for arrays indexed by id.
+  uint32_t capacity() const
+  {
+    return entries.size();
+  }
+
+  Iterator begin()
+  {
+    return Iterator(this, 0);
+  }
+
+  Iterator end()
+  {
+    return Iterator(this, entries.size());
+  }
+};
 
 class RHIResources
 {
   friend class RenderGraph;
+  friend class RHICommandBuffer;
 
 private:
   RenderGraph *renderGraph;
-  lib::ConcurrentHashMap<std::string, ShaderResourceMetadata> shadersMetadatas;
-  lib::ConcurrentHashMap<std::string, BufferAllocation> scratchMap;
-  lib::ConcurrentHashMap<BufferUsage, BufferResourceMetadata> scratchBuffers;
-  lib::ConcurrentHashMap<std::string, BufferResourceMetadata> bufferMetadatas;
-  lib::ConcurrentHashMap<std::string, TextureResourceMetadata> textureMetadatas;
-  lib::ConcurrentHashMap<std::string, SamplerResourceMetadata> samplerMetadatas;
-  lib::ConcurrentHashMap<std::string, BindingsLayoutResourceMetadata> bindingsLayoutMetadata;
-  lib::ConcurrentHashMap<std::string, BindingGroupsResourceMetadata> bindingGroupsMetadata;
-  lib::ConcurrentHashMap<std::string, GraphicsPipelineResourceMetadata> graphicsPipelineMetadata;
-  lib::ConcurrentHashMap<std::string, ComputePipelineResourceMetadata> computePipelineMetadata;
+  // Written while compiling, read by every recording thread.
+  lib::ConcurrentSnapshotMap<std::string, ShaderResourceMetadata> shadersMetadatas;
+  lib::ConcurrentSnapshotMap<std::string, BufferAllocation> scratchMap;
+  lib::ConcurrentSnapshotMap<BufferUsage, BufferResourceMetadata> scratchBuffers;
+  ResourceTable<BufferResourceMetadata> bufferMetadatas;
+  ResourceTable<TextureResourceMetadata> textureMetadatas;
+  ResourceTable<SamplerResourceMetadata> samplerMetadatas;
+  ResourceTable<BindingsLayoutResourceMetadata> bindingsLayoutMetadata;
+  ResourceTable<BindingGroupsResourceMetadata> bindingGroupsMetadata;
+  ResourceTable<GraphicsPipelineResourceMetadata> graphicsPipelineMetadata;
+  ResourceTable<ComputePipelineResourceMetadata> computePipelineMetadata;
 
 public:
   RHIResources(RenderGraph *renderGraph);
@@ -507,44 +937,77 @@ class RenderGraph
 private:
   struct RenderGraphNode
   {
-    std::string name;
+    const char *name;
     uint64_t id;
     uint64_t level;
     uint64_t priority;
     uint64_t dispatchId;
     uint64_t commandBufferIndex;
 
-    std::vector<uint64_t> signalSemaphores;
-    std::vector<uint64_t> waitSemaphores;
+    FrameVector<uint64_t> signalSemaphores;
+    FrameVector<uint64_t> waitSemaphores;
 
     Queue queue;
-    std::vector<Command> commands;
+    PipelineStage shaderStages;
+    bool isStatic;
+    CommandRange commands;
 
-    std::vector<TextureBarrier> textureTransitions;
-    std::vector<BufferBarrier> bufferTransitions;
+    FrameVector<TextureBarrier> textureTransitions;
+    FrameVector<BufferBarrier> bufferTransitions;
   };
 
   struct RenderGraphPass
   {
     std::string name;
     RHICommandBuffer cmd;
+    PassFlags flags;
   };
 
   friend class Task;
+  friend class RHICommandBuffer;
   bool compiled;
   uint64_t executions;
   RHI *rhi;
 
+  // Commands are recorded into one arena while the other holds the nodes of the last compile and its scratch data,
+  // compile resets the old one and swaps them. Declared before anything that points into them.
+  lib::memory::FrameArena frameArenas[2];
+  uint64_t frameArenaIndex;
+
+  lib::memory::FrameArena &recordingArena();
+  lib::memory::FrameArena &compiledArena();
+
   lib::ConcurrentQueue<RenderGraphPass> passes;
+  std::vector<RenderGraphPass> pendingPasses;
+
+  // Structural hash of every pass of the last full compile, and the resources version it was made against. A compile
+  // whose passes all hash the same only swaps in the new commands and keeps every analysis result. The phases are not
+  // keyed on their own inputs, any other change, even to a single pass, runs every phase again.
+  std::vector<uint64_t> compiledPassHashes;
+  std::vector<uint64_t> pendingPassHashes;
+  uint64_t compiledResourcesVersion;
+  std::atomic<uint64_t> resourcesVersion;
 
   std::vector<RenderGraphNode> nodes;
-  std::vector<std::vector<RenderGraphEdge>> edges;
+  std::vector<FrameVector<RenderGraphEdge>> edges;
 
   // Runtime Info
   RHIResources resources;
   std::vector<Semaphore> semaphores;
 
   uint64_t commandBuffersCount[Queue::QueuesCount];
+
+  // Command buffers are kept across runs, one set per frame slot so a run can record while the previous one is still
+  // executing. compile is the full compile a slot was last recorded for, its static command buffers are submitted
+  // again while it matches compiles.
+  struct CommandBufferSlot
+  {
+    std::vector<CommandBuffer> commandBuffers[Queue::QueuesCount];
+    uint64_t compile;
+  };
+
+  CommandBufferSlot commandBufferSlots[2];
+  uint64_t compiles;
   // TODO: remove from here
   // std::vector<TextureBarrier> textureTransitions;
   // std::vector<BufferBarrier> bufferTransitions;
@@ -554,19 +1017,49 @@ private:
   // std::vector<SamplerAllocation> samplerAllocations;
   // std::vector<BindingsLayoutAllocation> bindingsLayoutsAllocations;
 
-  void registerConsumer(const std::string &name, const InputResource &res, uint32_t taskId, Queue queue);
+  void registerConsumer(uint32_t resourceId, const InputResource &res, uint32_t taskId, Queue queue);
+
+  // Rebuilds the views a recorded command refers to, with the full handles of their resources.
+  BufferView bufferView(const BufferViewArgs &args);
+  TextureView textureView(const TextureViewArgs &args);
 
-  uint32_t levelDFS(uint32_t id, std::vector<bool> &visited, uint32_t level);
+  uint32_t levelDFS(uint32_t id, FrameVector<bool> &visited, uint32_t level);
 
-  void topologicalSortDFS(uint32_t id, std::vector<bool> &visited, std::stack<uint32_t> &topologicalSort, std::vector<bool> &recstack);
-  void tasksTopologicalSort(std::vector<uint32_t> &outTopologicalOrder);
+  void topologicalSortDFS(uint32_t id, FrameVector<bool> &visited, FrameVector<uint32_t> &topologicalSort, FrameVector<bool> &recstack);
+  void tasksTopologicalSort(FrameVector<uint32_t> &outTopologicalOrder);
 
   void analyseTaskLevels();
 
+  // Barriers and edges found by the hazard analysis of a batch of resources, tagged with the node they belong to and
+  // in the order a serial analysis emits them.
+  struct HazardBatch
+  {
+    std::vector<std::pair<uint64_t, BufferBarrier>> bufferTransitions;
+    std::vector<std::pair<uint64_t, TextureBarrier>> textureTransitions;
+    std::vector<std::pair<uint64_t, RenderGraphEdge>> edges;
+  };
+
+  // Per batch scratch of the parallel compile phases, kept across compiles so it is only allocated while it grows.
+  std::vector<HazardBatch> hazardBatches;
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> levelBatches;
+
+  void analyseBufferHazards(uint32_t id, BufferResourceMetadata &meta, HazardBatch &batch);
+  void analyseTextureHazards(uint32_t id, TextureResourceMetadata &meta, HazardBatch &batch);
   void analyseDependencyGraph();
+
+  // Drops the edges implied by other paths of the graph, before semaphores are created from them. Reachability bits of
+  // every node, kept across compiles so they are only allocated while they grow.
+  std::vector<uint64_t> reachability;
+  void reduceDependencyGraph();
   // void analyseCommands(RHICommandBuffer &recorder);
 
+  uint64_t hashPass(const RenderGraphPass &pass);
+  void reuseCompile();
+
   void analysePasses();
+
+  // Places the scratch buffers of every usage in one buffer, kept across compiles so its storage is only allocated while it grows.
+  lib::memory::AliasingPlanner scratchPlanner;
   void analyseAllocations();
   void analyseBufferStateTransition();
   void analyseTextureStateTransition();
@@ -576,6 +1069,43 @@ private:
   void analyseCommandBuffers();
   // void outputCommands(RHIProgram &program);
 
+  // Work recorded into one command buffer, a node or the release half of a queue ownership transfer consumed by node,
+  // which belongs to the command buffer of the producer.
+  struct RecordStep
+  {
+    enum Type
+    {
+      Node,
+      BufferRelease,
+      TextureRelease,
+    } type;
+    uint32_t node;
+    uint32_t barrier;
+  };
+
+  // Scratch of run, indexed by command buffer and kept across runs so a frame like the last one does not allocate.
+  std::vector<uint32_t> runOrder;
+  std::vector<std::vector<RecordStep>> recordSteps;
+  std::vector<std::vector<uint32_t>> commandBufferWaits;
+  std::vector<uint32_t> recordedCommandBuffers;
+  std::vector<GPUFuture> submittedFutures;
+  std::vector<GPUFuture> submitWaits;
+
+  // Barriers waiting to be recorded with one RHI::cmdBarriers call.
+  struct BarrierBatch
+  {
+    std::vector<BufferBarrierInfo> buffers;
+    std::vector<TextureBarrierInfo> textures;
+  };
+
+  PipelineStage srcStages(uint64_t fromNode, AccessPattern fromAccess, bool acquire, PipelineStage dstStages);
+  void addRelease(BarrierBatch &batch, const BufferBarrier &transition);
+  void addRelease(BarrierBatch &batch, const TextureBarrier &transition);
+  void addAcquires(BarrierBatch &batch, const RenderGraphNode &node);
+  void flushBarriers(CommandBuffer commandBuffer, BarrierBatch &batch);
+  void recordNode(CommandBuffer commandBuffer, const RenderGraphNode &node, BarrierBatch &batch);
+  void recordCommandBuffer(CommandBuffer commandBuffer, const std::vector<RecordStep> &steps);
+
 public:
   struct Frame
   {
@@ -593,9 +1123,13 @@ public:
   }
 
   RenderGraph(RHI *rhi);
+  ~RenderGraph();
 
-  void enqueuePass(std::string name, RHICommandBuffer &);
+  // Takes the commands recorded into the command buffer, which is left empty.
+  void enqueuePass(std::string name, RHICommandBuffer &, PassFlags flags = PassFlags_None);
   void compile();
+  // Records every command buffer and submits them. Command buffers are recorded in parallel jobs when run is called
+  // from a job, and on the calling thread otherwise.
   void run(Frame &outFrame);
   void waitFrame(Frame &frame);
 
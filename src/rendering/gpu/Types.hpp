@@ -50,22 +50,28 @@ enum Queue
   QueuesCount,
 };
 
+// Bit flags, barriers combine the stages of every access they order.
 enum class PipelineStage
 {
+  NONE = 0,
+
   // Pseudo-stage representing the beginning of the pipeline
   // Used for barriers where no actual work has started yet
   // Common for initial resource transitions from UNDEFINED layout
-  TOP_OF_PIPE,
+  TOP_OF_PIPE = 1 << 0,
+
+  // Stage where indirect draw and dispatch parameters are read from buffers
+  DRAW_INDIRECT = 1 << 1,
 
   // Stage where vertex and index data is consumed from buffers
   // Includes vertex attribute fetching and index buffer reads
   // Used when transitioning buffers for vertex/index usage
-  VERTEX_INPUT,
+  VERTEX_INPUT = 1 << 2,
 
   // Vertex shader execution stage
   // Where per-vertex computations happen (transformations, lighting setup)
   // Resources accessed: vertex buffers, uniform buffers, textures
-  VERTEX_SHADER,
+  VERTEX_SHADER = 1 << 3,
 
   // // Tessellation control shader stage (optional)
   // // Determines tessellation levels and per-patch data
@@ -85,48 +91,48 @@ enum class PipelineStage
   // Fragment shader execution stage
   // Per-pixel/sample shading computations
   // Most common stage for texture sampling and lighting calculations
-  FRAGMENT_SHADER,
+  FRAGMENT_SHADER = 1 << 4,
 
-  // // Early depth and stencil testing stage
-  // // Happens before fragment shader to potentially discard fragments early
-  // // Includes depth bounds testing and stencil testing
-  // EARLY_FRAGMENT_TESTS,
+  // Early depth and stencil testing stage
+  // Happens before fragment shader to potentially discard fragments early
+  // Includes depth bounds testing and stencil testing
+  EARLY_FRAGMENT_TESTS = 1 << 5,
 
-  // // Late depth and stencil testing stage
-  // // Final depth/stencil operations after fragment shader
-  // // Used when fragment shader modifies depth or uses discard
-  // LATE_FRAGMENT_TESTS,
+  // Late depth and stencil testing stage
+  // Final depth/stencil operations after fragment shader
+  // Used when fragment shader modifies depth or uses discard
+  LATE_FRAGMENT_TESTS = 1 << 6,
 
-  // // Color attachment output stage
-  // // Where final color values are written to render targets
-  // // Includes blending operations with existing framebuffer contents
-  // COLOR_ATTACHMENT_OUTPUT,
+  // Color attachment output stage
+  // Where final color values are written to render targets
+  // Includes blending operations with existing framebuffer contents
+  COLOR_ATTACHMENT_OUTPUT = 1 << 7,
 
   // Compute shader execution stage
   // General purpose GPU computing outside of graphics pipeline
   // Can read/write arbitrary buffers and images
-  COMPUTE_SHADER,
+  COMPUTE_SHADER = 1 << 8,
 
   // Transfer operations stage
   // Copy operations between resources (buffer-to-buffer, buffer-to-image, etc.)
   // Includes clear operations and blit operations
-  TRANSFER,
+  TRANSFER = 1 << 9,
 
   // Pseudo-stage representing the end of the pipeline
   // Used for barriers where all previous work must complete
   // Common for final resource transitions or synchronization
-  BOTTOM_OF_PIPE,
+  BOTTOM_OF_PIPE = 1 << 10,
 
   // Covers all graphics pipeline stages (but not compute)
   // Equivalent to: VERTEX_INPUT | VERTEX_SHADER | ... | COLOR_ATTACHMENT_OUTPUT
   // Useful for broad synchronization in graphics-only contexts
-  ALL_GRAPHICS,
+  ALL_GRAPHICS = 1 << 11,
 
-  HOST,
+  HOST = 1 << 12,
   // Covers all possible pipeline stages
   // Most conservative option - ensures all work completes
   // Can hurt performance if overused, but guarantees correctness
-  ALL_COMMANDS
+  ALL_COMMANDS = 1 << 13
 };
 
 enum DeviceFeatures
@@ -636,13 +642,20 @@ struct SamplerInfo
   float maxLod = 1.0f;
 };
 
+// handle is the backend object handle assigned at creation and lets the backend resolve the object without a name
+// lookup, it is 0 for resources only known by name. id is the dense index the render graph assigns at creation,
+// UINT32_MAX for handles built from a name alone, and generation tells apart the resources that reuse an id. Handles
+// compare by id, generation and backend handle, the name only resolves handles without an id and is kept for debugging.
 struct Buffer
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
 
   bool operator==(const Buffer &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const Buffer &other) const noexcept
   {
@@ -653,10 +666,13 @@ struct Buffer
 struct Texture
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
 
   bool operator==(const Texture &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const Texture &other) const noexcept
   {
@@ -667,10 +683,13 @@ struct Texture
 struct Sampler
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
 
   bool operator==(const Sampler &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const Sampler &other) const noexcept
   {
@@ -680,6 +699,7 @@ struct Sampler
 struct Shader
 {
   std::string name;
+  uint64_t handle = 0;
   bool operator==(const Shader &other) const noexcept
   {
     return name == other.name;
@@ -693,9 +713,12 @@ struct Shader
 struct BindingsLayout
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
   bool operator==(const BindingsLayout &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const BindingsLayout &other) const noexcept
   {
@@ -706,9 +729,12 @@ struct BindingsLayout
 struct GraphicsPipeline
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
   bool operator==(const GraphicsPipeline &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const GraphicsPipeline &other) const noexcept
   {
@@ -719,9 +745,12 @@ struct GraphicsPipeline
 struct ComputePipeline
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
   bool operator==(const ComputePipeline &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const ComputePipeline &other) const noexcept
   {
@@ -732,9 +761,12 @@ struct ComputePipeline
 struct BindingGroups
 {
   std::string name;
+  uint64_t handle = 0;
+  uint32_t id = UINT32_MAX;
+  uint32_t generation = 0;
   bool operator==(const BindingGroups &other) const noexcept
   {
-    return name == other.name;
+    return id == other.id && generation == other.generation && handle == other.handle;
   }
   bool operator!=(const BindingGroups &other) const noexcept
   {
@@ -786,6 +818,39 @@ struct TextureView
   }
 };
 
+// One buffer or texture transition of a batch recorded with RHI::cmdBarriers. Stages are the ones the transition
+// waits on and blocks, queues differ only for the halves of a queue ownership transfer.
+struct BufferBarrierInfo
+{
+  Buffer buffer;
+  PipelineStage srcStage;
+  PipelineStage dstStage;
+  AccessPattern srcAccess;
+  AccessPattern dstAccess;
+  uint64_t offset;
+  uint64_t size;
+  Queue srcQueue;
+  Queue dstQueue;
+};
+
+struct TextureBarrierInfo
+{
+  Texture texture;
+  PipelineStage srcStage;
+  PipelineStage dstStage;
+  AccessPattern srcAccess;
+  AccessPattern dstAccess;
+  ResourceLayout oldLayout;
+  ResourceLayout newLayout;
+  ImageAspectFlags aspect;
+  uint32_t baseMip;
+  uint32_t mipCount;
+  uint32_t baseLayer;
+  uint32_t layerCount;
+  Queue srcQueue;
+  Queue dstQueue;
+};
+
 struct ColorAttachmentInfo
 {
   std::string name;
@@ -987,7 +1052,10 @@ template <> struct std::hash<rendering::Buffer>
 {
   std::size_t operator()(const rendering::Buffer &b) const noexcept
   {
-    return std::hash<std::string>{}(b.name);
+    std::size_t h = std::hash<uint32_t>{}(b.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(b.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(b.handle));
+    return h;
   }
 };
 
@@ -995,7 +1063,10 @@ template <> struct std::hash<rendering::BindingGroups>
 {
   std::size_t operator()(const rendering::BindingGroups &b) const noexcept
   {
-    return std::hash<std::string>{}(b.name);
+    std::size_t h = std::hash<uint32_t>{}(b.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(b.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(b.handle));
+    return h;
   }
 };
 
@@ -1003,7 +1074,10 @@ template <> struct std::hash<rendering::GraphicsPipeline>
 {
   std::size_t operator()(const rendering::GraphicsPipeline &b) const noexcept
   {
-    return std::hash<std::string>{}(b.name);
+    std::size_t h = std::hash<uint32_t>{}(b.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(b.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(b.handle));
+    return h;
   }
 };
 
@@ -1011,14 +1085,20 @@ template <> struct std::hash<rendering::BindingsLayout>
 {
   std::size_t operator()(const rendering::BindingsLayout &b) const noexcept
   {
-    return std::hash<std::string>{}(b.name);
+    std::size_t h = std::hash<uint32_t>{}(b.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(b.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(b.handle));
+    return h;
   }
 };
 template <> struct std::hash<rendering::ComputePipeline>
 {
   std::size_t operator()(const rendering::ComputePipeline &b) const noexcept
   {
-    return std::hash<std::string>{}(b.name);
+    std::size_t h = std::hash<uint32_t>{}(b.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(b.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(b.handle));
+    return h;
   }
 };
 
@@ -1026,14 +1106,20 @@ template <> struct std::hash<rendering::Texture>
 {
   std::size_t operator()(const rendering::Texture &t) const noexcept
   {
-    return std::hash<std::string>{}(t.name);
+    std::size_t h = std::hash<uint32_t>{}(t.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(t.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(t.handle));
+    return h;
   }
 };
 template <> struct std::hash<rendering::Sampler>
 {
   std::size_t operator()(const rendering::Sampler &s) const noexcept
   {
-    return std::hash<std::string>{}(s.name);
+    std::size_t h = std::hash<uint32_t>{}(s.id);
+    rendering::hash_combine(h, std::hash<uint32_t>{}(s.generation));
+    rendering::hash_combine(h, std::hash<uint64_t>{}(s.handle));
+    return h;
   }
 };
 
@@ -1074,6 +1160,16 @@ inline bool operator&(rendering::AccessPattern a, rendering::AccessPattern b)
   return (static_cast<uint64_t>(a) & static_cast<uint64_t>(b)) != 0;
 }
 
+inline rendering::PipelineStage operator|(rendering::PipelineStage a, rendering::PipelineStage b)
+{
+  return static_cast<rendering::PipelineStage>(static_cast<uint64_t>(a) | static_cast<uint64_t>(b));
+}
+
+inline bool operator&(rendering::PipelineStage a, rendering::PipelineStage b)
+{
+  return (static_cast<uint64_t>(a) & static_cast<uint64_t>(b)) != 0;
+}
+
 inline rendering::BufferUsage operator|(rendering::BufferUsage a, rendering::BufferUsage b)
 {
   return static_cast<rendering::BufferUsage>(static_cast<uint64_t>(a) | static_cast<uint64_t>(b));
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <set>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vulkan/vulkan_format_traits.hpp>
 
 // #define VULKAN_RHI_LOGS
@@ -793,8 +795,61 @@ void VulkanRHI::setupDebugMessenger()
   }
 }
 
+// Rough driver memory per cached object, only used to budget the object caches.
+static constexpr size_t kObjectCacheBudget = 32 * 1024 * 1024;
+static constexpr size_t kSamplerCost = 256;
+static constexpr size_t kDescriptorCost = 256;
+static constexpr size_t kPipelineCost = 64 * 1024;
+
+// Cache key made of the bytes of every field that affects the backend object. Resources referenced by a
+// description are keyed by name and table handle, so a resource recreated under the same name never matches.
+struct VulkanContentKey
+{
+  std::string bytes;
+
+  template <typename T> VulkanContentKey &add(const T &value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Only plain fields can be part of a key");
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    return *this;
+  }
+
+  VulkanContentKey &add(const std::string &value)
+  {
+    add(value.size());
+    bytes.append(value);
+    return *this;
+  }
+
+  VulkanContentKey &add(const char *value)
+  {
+    return add(std::string(value ? value : ""));
+  }
+};
+
 VulkanRHI::VulkanRHI(VulkanVersion version, DeviceRequiredLimits requiredLimits, DeviceFeatures requestedFeatures, std::vector<std::string> extensions)
-    : RHI(), commandBuffersAllocated(0), eventLoop(VulkanAsyncHandler::getStatus)
+    : RHI(), commandBuffersAllocated(0), eventLoop(VulkanAsyncHandler::getStatus),
+      samplerCache(kObjectCacheBudget, [this](const std::string &, VkSampler &sampler) { vkDestroySampler(device, sampler, nullptr); }),
+      bindingGroupsCache(kObjectCacheBudget,
+                         [this](const std::string &, std::vector<VulkanBindingGroup> &groups)
+                         {
+                           for (auto &group : groups)
+                           {
+                             vkDestroyDescriptorPool(device, group.descriptorPool, nullptr);
+
+                             for (auto &view : group.textureViews)
+                             {
+                               destroyTextureView(view);
+                             }
+                           }
+                         }),
+      graphicsPipelineCache(kObjectCacheBudget,
+                            [this](const std::string &, std::pair<VkPipeline, VkRenderPass> &pipeline)
+                            {
+                              vkDestroyPipeline(device, pipeline.first, nullptr);
+                              vkDestroyRenderPass(device, pipeline.second, nullptr);
+                            }),
+      computePipelineCache(kObjectCacheBudget, [this](const std::string &, VkPipeline &pipeline) { vkDestroyPipeline(device, pipeline, nullptr); })
 {
 
   this->version = version;
@@ -1294,52 +1349,51 @@ void VulkanRHI::createLogicalDevice()
   }
 }
 
-VulkanBuffer &VulkanRHI::allocateBuffer(const BufferInfo &info)
+uint64_t VulkanRHI::allocateBuffer(const BufferInfo &info)
 {
-  VulkanBuffer *vkBuf = new VulkanBuffer();
+  VulkanBuffer vkBuf;
 
-  vkBuf->info = info;
-  vkBuf->size = info.size;
+  vkBuf.info = info;
+  vkBuf.size = info.size;
 
-  vkBuf->usageFlags = toVkBufferUsageFlags(info.usage);
-  vkBuf->memoryFlags = toVkMemoryPropertyFlags(info.usage, false);
+  vkBuf.usageFlags = toVkBufferUsageFlags(info.usage);
+  vkBuf.memoryFlags = toVkMemoryPropertyFlags(info.usage, false);
 
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = info.size;
-  bufferInfo.usage = vkBuf->usageFlags;
+  bufferInfo.usage = vkBuf.usageFlags;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if (vkCreateBuffer(device, &bufferInfo, nullptr, &vkBuf->buffer) != VK_SUCCESS)
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &vkBuf.buffer) != VK_SUCCESS)
   {
     throw std::runtime_error("Failed to create Vulkan buffer!");
   }
 
   VkMemoryRequirements memRequirements;
-  vkGetBufferMemoryRequirements(device, vkBuf->buffer, &memRequirements);
+  vkGetBufferMemoryRequirements(device, vkBuf.buffer, &memRequirements);
 
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, vkBuf->memoryFlags, physicalDevice);
+  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, vkBuf.memoryFlags, physicalDevice);
 
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &vkBuf->memory) != VK_SUCCESS)
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &vkBuf.memory) != VK_SUCCESS)
   {
     throw std::runtime_error("Failed to allocate buffer memory!");
   }
 
-  vkBindBufferMemory(device, vkBuf->buffer, vkBuf->memory, 0);
+  vkBindBufferMemory(device, vkBuf.buffer, vkBuf.memory, 0);
 
-  // if (vkBuf->memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+  // if (vkBuf.memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
   // {
-  //   vkMapMemory(device, vkBuf->memory, 0, info.size, 0, &vkBuf->mapped);
+  //   vkMapMemory(device, vkBuf.memory, 0, info.size, 0, &vkBuf.mapped);
   // }
 
-  vkBuffers.insert(info.name, vkBuf);
-  return *vkBuf;
+  return vkBuffers.insert(info.name, std::move(vkBuf));
 }
 
-void VulkanRHI::releaseBuffer(VulkanBuffer &buf)
+void VulkanRHI::releaseBuffer(VulkanBuffer &buf, uint64_t handle)
 {
   if (buf.mapped)
   {
@@ -1362,60 +1416,58 @@ void VulkanRHI::releaseBuffer(VulkanBuffer &buf)
   buf.size = 0;
   buf.usageFlags = 0;
   buf.memoryFlags = 0;
-  buf.info = BufferInfo{};
 
-  vkBuffers.remove(buf.info.name);
+  vkBuffers.remove(handle, buf.info.name);
 }
 
-VulkanTexture &VulkanRHI::allocateTexture(const TextureInfo &info)
+uint64_t VulkanRHI::allocateTexture(const TextureInfo &info)
 {
-  VulkanTexture *tex = new VulkanTexture();
-  tex->info = info;
-  tex->format = toVkFormat(info.format);
-  tex->extent = {info.width, info.height, std::max(1u, info.depth)};
-  tex->mipLevels = std::max(1u, info.mipLevels);
-  tex->usageFlags = toVkImageUsageFlags(info.usage);
-  tex->memoryFlags = toVkMemoryPropertyFlags(info.memoryProperties, false);
+  VulkanTexture tex;
+  tex.info = info;
+  tex.format = toVkFormat(info.format);
+  tex.extent = {info.width, info.height, std::max(1u, info.depth)};
+  tex.mipLevels = std::max(1u, info.mipLevels);
+  tex.usageFlags = toVkImageUsageFlags(info.usage);
+  tex.memoryFlags = toVkMemoryPropertyFlags(info.memoryProperties, false);
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = info.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
-  imageInfo.extent = tex->extent;
-  imageInfo.mipLevels = tex->mipLevels;
+  imageInfo.extent = tex.extent;
+  imageInfo.mipLevels = tex.mipLevels;
   imageInfo.arrayLayers = 1;
-  imageInfo.format = tex->format;
+  imageInfo.format = tex.format;
   imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
   imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  imageInfo.usage = tex->usageFlags;
+  imageInfo.usage = tex.usageFlags;
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
   imageInfo.flags = 0;
 
-  if (vkCreateImage(device, &imageInfo, nullptr, &tex->image) != VK_SUCCESS)
+  if (vkCreateImage(device, &imageInfo, nullptr, &tex.image) != VK_SUCCESS)
   {
     throw std::runtime_error("Failed to create Vulkan image!");
   }
 
   VkMemoryRequirements memRequirements;
-  vkGetImageMemoryRequirements(device, tex->image, &memRequirements);
+  vkGetImageMemoryRequirements(device, tex.image, &memRequirements);
 
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, tex->memoryFlags, physicalDevice);
+  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, tex.memoryFlags, physicalDevice);
 
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &tex->memory) != VK_SUCCESS)
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &tex.memory) != VK_SUCCESS)
   {
     throw std::runtime_error("Failed to allocate image memory!");
   }
 
-  vkBindImageMemory(device, tex->image, tex->memory, 0);
+  vkBindImageMemory(device, tex.image, tex.memory, 0);
 
-  tex->currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  vkTextures.insert(info.name, tex);
-  return *tex;
+  tex.currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  return vkTextures.insert(info.name, std::move(tex));
 }
 
-void VulkanRHI::releaseTexture(VulkanTexture &vkTex)
+void VulkanRHI::releaseTexture(VulkanTexture &vkTex, uint64_t handle)
 {
   if (vkTex.image != VK_NULL_HANDLE)
   {
@@ -1436,13 +1488,13 @@ void VulkanRHI::releaseTexture(VulkanTexture &vkTex)
   vkTex.memoryFlags = 0;
   vkTex.currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-  vkTextures.remove(vkTex.info.name);
+  vkTextures.remove(handle, vkTex.info.name);
 }
 
 VulkanTextureView VulkanRHI::createTextureView(const TextureView &view)
 {
   VulkanTextureView vkView{};
-  const VulkanTexture &tex = getVulkanTexture(view.texture.name);
+  const VulkanTexture &tex = getVulkanTexture(view.texture);
 
   vkView.image = tex.image;
   vkView.format = tex.format;
@@ -1482,53 +1534,66 @@ void VulkanRHI::destroyTextureView(VulkanTextureView view)
   view.range = {};
 }
 
-VulkanSampler &VulkanRHI::allocateSampler(const SamplerInfo &info)
+uint64_t VulkanRHI::allocateSampler(const SamplerInfo &info)
 {
-  VulkanSampler *vkSampler = new VulkanSampler();
-  vkSampler->info = info;
+  VulkanSampler vkSampler;
+  vkSampler.info = info;
 
-  VkSamplerCreateInfo samplerInfo{};
-  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  samplerInfo.magFilter = toVkFilter(info.magFilter);
-  samplerInfo.minFilter = toVkFilter(info.minFilter);
-  samplerInfo.addressModeU = toVkSamplerAddressMode(info.addressModeU);
-  samplerInfo.addressModeV = toVkSamplerAddressMode(info.addressModeV);
-  samplerInfo.addressModeW = toVkSamplerAddressMode(info.addressModeW);
-  samplerInfo.anisotropyEnable = info.anisotropyEnable ? VK_TRUE : VK_FALSE;
-  samplerInfo.maxAnisotropy = info.anisotropyEnable ? info.maxAnisotropy : 1.0f;
-  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-  samplerInfo.unnormalizedCoordinates = VK_FALSE;
-  samplerInfo.compareEnable = VK_FALSE;
-  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-  samplerInfo.minLod = 0.0f;
-  samplerInfo.maxLod = info.maxLod;
+  VulkanContentKey key;
+  key.add(info.minFilter).add(info.magFilter).add(info.addressModeU).add(info.addressModeV).add(info.addressModeW).add(info.anisotropyEnable);
+  key.add(info.maxAnisotropy).add(info.maxLod);
 
-  if (vkCreateSampler(device, &samplerInfo, nullptr, &vkSampler->sampler) != VK_SUCCESS)
-  {
-    throw std::runtime_error("Failed to create Vulkan sampler!");
-  }
+  vkSampler.cacheKey = std::move(key.bytes);
+  vkSampler.sampler = samplerCache.acquire(
+      vkSampler.cacheKey,
+      [&]()
+      {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = toVkFilter(info.magFilter);
+        samplerInfo.minFilter = toVkFilter(info.minFilter);
+        samplerInfo.addressModeU = toVkSamplerAddressMode(info.addressModeU);
+        samplerInfo.addressModeV = toVkSamplerAddressMode(info.addressModeV);
+        samplerInfo.addressModeW = toVkSamplerAddressMode(info.addressModeW);
+        samplerInfo.anisotropyEnable = info.anisotropyEnable ? VK_TRUE : VK_FALSE;
+        samplerInfo.maxAnisotropy = info.anisotropyEnable ? info.maxAnisotropy : 1.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = info.maxLod;
+
+        VkSampler sampler = VK_NULL_HANDLE;
+
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        {
+          throw std::runtime_error("Failed to create Vulkan sampler!");
+        }
+
+        return std::make_pair(sampler, kSamplerCost);
+      });
 
-  vkSamplers.insert(info.name, vkSampler);
-  return *vkSampler;
+  return vkSamplers.insert(info.name, std::move(vkSampler));
 }
 
-void VulkanRHI::releaseSampler(VulkanSampler &sampler)
+void VulkanRHI::releaseSampler(VulkanSampler &sampler, uint64_t handle)
 {
   if (sampler.sampler != VK_NULL_HANDLE)
   {
-    vkDestroySampler(device, sampler.sampler, nullptr);
+    samplerCache.release(sampler.cacheKey);
     sampler.sampler = VK_NULL_HANDLE;
   }
 
-  vkSamplers.remove(sampler.info.name);
+  vkSamplers.remove(handle, sampler.info.name);
 }
 
-VulkanBindingsLayout &VulkanRHI::allocateBindingsLayout(const BindingsLayoutInfo &info)
+uint64_t VulkanRHI::allocateBindingsLayout(const BindingsLayoutInfo &info)
 {
-  VulkanBindingsLayout *vkLayout = new VulkanBindingsLayout();
-  vkLayout->name = info.name;
-  vkLayout->groups = info.groups;
+  VulkanBindingsLayout vkLayout;
+  vkLayout.name = info.name;
+  vkLayout.groups = info.groups;
 
   for (const BindingGroupLayout &group : info.groups)
   {
@@ -1566,15 +1631,15 @@ VulkanBindingsLayout &VulkanRHI::allocateBindingsLayout(const BindingsLayoutInfo
       throw std::runtime_error("Failed to create descriptor set layout!");
     }
 
-    vkLayout->setLayouts.push_back(setLayout);
+    vkLayout.setLayouts.push_back(setLayout);
   }
 
   // const VulkanBindingsLayout& layout = getVulkanBindingsLayout(info.name);
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(vkLayout->setLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = vkLayout->setLayouts.data();
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(vkLayout.setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = vkLayout.setLayouts.data();
   pipelineLayoutInfo.pushConstantRangeCount = 0;
   pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
@@ -1583,13 +1648,12 @@ VulkanBindingsLayout &VulkanRHI::allocateBindingsLayout(const BindingsLayoutInfo
   {
     throw std::runtime_error("Failed to create pipeline layout!");
   }
-  vkLayout->pipelineLayout = pipelineLayout;
+  vkLayout.pipelineLayout = pipelineLayout;
 
-  vkBindingsLayout.insert(info.name, vkLayout);
-  return *vkLayout;
+  return vkBindingsLayout.insert(info.name, std::move(vkLayout));
 }
 
-void VulkanRHI::releaseBindingsLayout(VulkanBindingsLayout &layout)
+void VulkanRHI::releaseBindingsLayout(VulkanBindingsLayout &layout, uint64_t handle)
 {
   for (VkDescriptorSetLayout setLayout : layout.setLayouts)
   {
@@ -1601,249 +1665,286 @@ void VulkanRHI::releaseBindingsLayout(VulkanBindingsLayout &layout)
 
   layout.setLayouts.clear();
   layout.groups.clear();
-  layout.name.clear();
 
-  vkBindingsGroups.remove(layout.name);
+  vkBindingsLayout.remove(handle, layout.name);
 }
 
-VulkanBindingGroups &VulkanRHI::allocateBindings(const BindingGroupsInfo &groups, const VulkanBindingsLayout &layout)
+uint64_t VulkanRHI::allocateBindings(const BindingGroupsInfo &groups, const VulkanBindingsLayout &layout)
 {
-  auto *resultGroups = new VulkanBindingGroups();
-  resultGroups->info = groups;
+  VulkanBindingGroups resultGroups;
+  resultGroups.info = groups;
 
-  resultGroups->groups.reserve(groups.groups.size());
+  VulkanContentKey key;
+  key.add(layout.name).add(vkBindingsLayout.handleOf(groups.layout));
 
-  for (size_t groupIndex = 0; groupIndex < groups.groups.size(); ++groupIndex)
+  auto addTextureView = [&](const TextureView &view)
   {
-    const GroupInfo &groupInfo = groups.groups[groupIndex];
-    const auto &groupLayout = layout.groups[groupIndex];
-
-    VulkanBindingGroup vkGroup{};
-    vkGroup.info = groupInfo;
-
-    /* -----------------------------------------------------------
-     * Descriptor pool sizing
-     * ----------------------------------------------------------- */
+    key.add(view.texture.name).add(vkTextures.handleOf(view.texture)).add(view.flags).add(view.baseMipLevel).add(view.levelCount).add(view.baseArrayLayer);
+    key.add(view.layerCount).add(view.layout);
+  };
 
-    std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
+  for (const GroupInfo &groupInfo : groups.groups)
+  {
+    key.add(groupInfo.buffers.size()).add(groupInfo.samplers.size()).add(groupInfo.textures.size()).add(groupInfo.storageTextures.size());
 
-    for (const auto &b : groupLayout.buffers)
+    for (const auto &binding : groupInfo.buffers)
     {
-      VkDescriptorType type = b.type == BufferBindingType_UniformBuffer ? (b.isDynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-                                                                        : (b.isDynamic ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
-
-      descriptorCounts[type]++;
+      const Buffer &buffer = binding.bufferView.buffer;
+      key.add(binding.binding).add(buffer.name).add(vkBuffers.handleOf(buffer)).add(binding.bufferView.offset).add(binding.bufferView.size);
     }
 
-    if (!groupInfo.samplers.empty())
-      descriptorCounts[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] += static_cast<uint32_t>(groupInfo.samplers.size());
-
-    if (!groupInfo.textures.empty())
-      descriptorCounts[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE] += static_cast<uint32_t>(groupInfo.textures.size());
-
-    if (!groupInfo.storageTextures.empty())
-      descriptorCounts[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE] += static_cast<uint32_t>(groupInfo.storageTextures.size());
-
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    poolSizes.reserve(descriptorCounts.size());
-
-    for (auto &[type, count] : descriptorCounts)
-      poolSizes.push_back({type, count});
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 1;
-    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &vkGroup.descriptorPool) != VK_SUCCESS)
+    for (const auto &binding : groupInfo.samplers)
     {
-      throw std::runtime_error("Failed to create descriptor pool");
+      key.add(binding.binding).add(binding.sampler.name).add(vkSamplers.handleOf(binding.sampler));
+      addTextureView(binding.view);
     }
 
-    /* -----------------------------------------------------------
-     * Allocate descriptor set
-     * ----------------------------------------------------------- */
-
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = vkGroup.descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &layout.setLayouts[groupIndex];
-
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    for (const auto &binding : groupInfo.textures)
     {
-      throw std::runtime_error("Failed to allocate descriptor set");
+      key.add(binding.binding);
+      addTextureView(binding.textureView);
     }
 
-    vkGroup.descriptorSets.push_back(descriptorSet);
-
-    /* -----------------------------------------------------------
-     * Descriptor write storage (must outlive vkUpdateDescriptorSets)
-     * ----------------------------------------------------------- */
-
-    std::vector<VkWriteDescriptorSet> writes;
-    writes.reserve(groupInfo.buffers.size() + groupInfo.samplers.size() + groupInfo.textures.size() + groupInfo.storageTextures.size());
-
-    std::vector<VkDescriptorBufferInfo> bufferInfos;
-    bufferInfos.reserve(groupInfo.buffers.size());
+    for (const auto &binding : groupInfo.storageTextures)
+    {
+      key.add(binding.binding);
+      addTextureView(binding.textureView);
+    }
+  }
 
-    std::vector<VkDescriptorImageInfo> imageInfos;
-    imageInfos.reserve(groupInfo.samplers.size() + groupInfo.textures.size() + groupInfo.storageTextures.size());
+  resultGroups.cacheKey = std::move(key.bytes);
+  resultGroups.groups = bindingGroupsCache.acquire(
+      resultGroups.cacheKey,
+      [&]()
+      {
+        std::vector<VulkanBindingGroup> result;
+        result.reserve(groups.groups.size());
 
-    /* -----------------------------------------------------------
-     * Buffers
-     * ----------------------------------------------------------- */
+        size_t descriptors = 0;
 
-    assert(groupLayout.buffers.size() == groupInfo.buffers.size());
+        for (size_t groupIndex = 0; groupIndex < groups.groups.size(); ++groupIndex)
+        {
+          const GroupInfo &groupInfo = groups.groups[groupIndex];
+          const auto &groupLayout = layout.groups[groupIndex];
 
-    for (size_t i = 0; i < groupInfo.buffers.size(); ++i)
-    {
-      const BindingBuffer &binding = groupInfo.buffers[i];
-      const auto &layoutBinding = groupLayout.buffers[i];
+          VulkanBindingGroup vkGroup{};
+          vkGroup.info = groupInfo;
 
-      VulkanBuffer buf = getVulkanBuffer(binding.bufferView.buffer.name);
+          /* -----------------------------------------------------------
+           * Descriptor pool sizing
+           * ----------------------------------------------------------- */
 
-      bufferInfos.push_back({
-        .buffer = buf.buffer,
-        .offset = binding.bufferView.offset,
-        .range = binding.bufferView.size,
-      });
+          std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
 
-      VkDescriptorType type = layoutBinding.type == BufferBindingType_UniformBuffer
-                                  ? (layoutBinding.isDynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-                                  : (layoutBinding.isDynamic ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+          for (const auto &b : groupLayout.buffers)
+          {
+            VkDescriptorType type = b.type == BufferBindingType_UniformBuffer ? (b.isDynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                                                                              : (b.isDynamic ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = descriptorSet;
-      write.dstBinding = binding.binding;
-      write.descriptorCount = 1;
-      write.descriptorType = type;
-      write.pBufferInfo = &bufferInfos.back();
+            descriptorCounts[type]++;
+          }
 
-      writes.push_back(write);
-    }
+          if (!groupInfo.samplers.empty())
+            descriptorCounts[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] += static_cast<uint32_t>(groupInfo.samplers.size());
 
-    /* -----------------------------------------------------------
-     * Samplers
-     * ----------------------------------------------------------- */
+          if (!groupInfo.textures.empty())
+            descriptorCounts[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE] += static_cast<uint32_t>(groupInfo.textures.size());
 
-    for (const auto &binding : groupInfo.samplers)
-    {
-      const VulkanSampler &sampler = getVulkanSampler(binding.sampler.name);
+          if (!groupInfo.storageTextures.empty())
+            descriptorCounts[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE] += static_cast<uint32_t>(groupInfo.storageTextures.size());
 
-      VulkanTextureView view = createTextureView(binding.view);
+          std::vector<VkDescriptorPoolSize> poolSizes;
+          poolSizes.reserve(descriptorCounts.size());
 
-      vkGroup.textureViews.push_back(view);
+          for (auto &[type, count] : descriptorCounts)
+            poolSizes.push_back({type, count});
 
-      imageInfos.push_back({
-        .sampler = sampler.sampler,
-        .imageView = view.view,
-        .imageLayout = toVkImageLayout(binding.view.layout),
-      });
+          VkDescriptorPoolCreateInfo poolInfo{};
+          poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+          poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+          poolInfo.pPoolSizes = poolSizes.data();
+          poolInfo.maxSets = 1;
+          poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = descriptorSet;
-      write.dstBinding = binding.binding;
-      write.descriptorCount = 1;
-      write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      write.pImageInfo = &imageInfos.back();
+          if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &vkGroup.descriptorPool) != VK_SUCCESS)
+          {
+            throw std::runtime_error("Failed to create descriptor pool");
+          }
 
-      writes.push_back(write);
-    }
+          /* -----------------------------------------------------------
+           * Allocate descriptor set
+           * ----------------------------------------------------------- */
 
-    /* -----------------------------------------------------------
-     * Sampled textures
-     * ----------------------------------------------------------- */
+          VkDescriptorSetAllocateInfo allocInfo{};
+          allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+          allocInfo.descriptorPool = vkGroup.descriptorPool;
+          allocInfo.descriptorSetCount = 1;
+          allocInfo.pSetLayouts = &layout.setLayouts[groupIndex];
 
-    for (const auto &binding : groupInfo.textures)
-    {
-      VulkanTextureView view = createTextureView(binding.textureView);
+          VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+          if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+          {
+            throw std::runtime_error("Failed to allocate descriptor set");
+          }
 
-      vkGroup.textureViews.push_back(view);
+          vkGroup.descriptorSets.push_back(descriptorSet);
 
-      imageInfos.push_back({
-        .sampler = VK_NULL_HANDLE,
-        .imageView = view.view,
-        .imageLayout = toVkImageLayout(binding.textureView.layout),
-      });
+          /* -----------------------------------------------------------
+           * Descriptor write storage (must outlive vkUpdateDescriptorSets)
+           * ----------------------------------------------------------- */
 
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = descriptorSet;
-      write.dstBinding = binding.binding;
-      write.descriptorCount = 1;
-      write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-      write.pImageInfo = &imageInfos.back();
+          std::vector<VkWriteDescriptorSet> writes;
+          writes.reserve(groupInfo.buffers.size() + groupInfo.samplers.size() + groupInfo.textures.size() + groupInfo.storageTextures.size());
 
-      writes.push_back(write);
-    }
+          std::vector<VkDescriptorBufferInfo> bufferInfos;
+          bufferInfos.reserve(groupInfo.buffers.size());
 
-    /* -----------------------------------------------------------
-     * Storage textures
-     * ----------------------------------------------------------- */
+          std::vector<VkDescriptorImageInfo> imageInfos;
+          imageInfos.reserve(groupInfo.samplers.size() + groupInfo.textures.size() + groupInfo.storageTextures.size());
 
-    for (const auto &binding : groupInfo.storageTextures)
-    {
-      VulkanTextureView view = createTextureView(binding.textureView);
+          /* -----------------------------------------------------------
+           * Buffers
+           * ----------------------------------------------------------- */
 
-      vkGroup.textureViews.push_back(view);
+          assert(groupLayout.buffers.size() == groupInfo.buffers.size());
 
-      imageInfos.push_back({
-        .sampler = VK_NULL_HANDLE,
-        .imageView = view.view,
-        .imageLayout = toVkImageLayout(binding.textureView.layout),
-      });
+          for (size_t i = 0; i < groupInfo.buffers.size(); ++i)
+          {
+            const BindingBuffer &binding = groupInfo.buffers[i];
+            const auto &layoutBinding = groupLayout.buffers[i];
+
+            const VulkanBuffer &buf = getVulkanBuffer(binding.bufferView.buffer);
+
+            bufferInfos.push_back({
+              .buffer = buf.buffer,
+              .offset = binding.bufferView.offset,
+              .range = binding.bufferView.size,
+            });
+
+            VkDescriptorType type = layoutBinding.type == BufferBindingType_UniformBuffer
+                                        ? (layoutBinding.isDynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                                        : (layoutBinding.isDynamic ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = descriptorSet;
-      write.dstBinding = binding.binding;
-      write.descriptorCount = 1;
-      write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-      write.pImageInfo = &imageInfos.back();
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = binding.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = type;
+            write.pBufferInfo = &bufferInfos.back();
 
-      writes.push_back(write);
-    }
+            writes.push_back(write);
+          }
+
+          /* -----------------------------------------------------------
+           * Samplers
+           * ----------------------------------------------------------- */
+
+          for (const auto &binding : groupInfo.samplers)
+          {
+            const VulkanSampler &sampler = getVulkanSampler(binding.sampler);
+
+            VulkanTextureView view = createTextureView(binding.view);
+
+            vkGroup.textureViews.push_back(view);
+
+            imageInfos.push_back({
+              .sampler = sampler.sampler,
+              .imageView = view.view,
+              .imageLayout = toVkImageLayout(binding.view.layout),
+            });
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = binding.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &imageInfos.back();
+
+            writes.push_back(write);
+          }
+
+          /* -----------------------------------------------------------
+           * Sampled textures
+           * ----------------------------------------------------------- */
+
+          for (const auto &binding : groupInfo.textures)
+          {
+            VulkanTextureView view = createTextureView(binding.textureView);
+
+            vkGroup.textureViews.push_back(view);
+
+            imageInfos.push_back({
+              .sampler = VK_NULL_HANDLE,
+              .imageView = view.view,
+              .imageLayout = toVkImageLayout(binding.textureView.layout),
+            });
 
-    /* -----------------------------------------------------------
-     * Update descriptors (safe)
-     * ----------------------------------------------------------- */
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = binding.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            write.pImageInfo = &imageInfos.back();
 
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+            writes.push_back(write);
+          }
+
+          /* -----------------------------------------------------------
+           * Storage textures
+           * ----------------------------------------------------------- */
+
+          for (const auto &binding : groupInfo.storageTextures)
+          {
+            VulkanTextureView view = createTextureView(binding.textureView);
+
+            vkGroup.textureViews.push_back(view);
+
+            imageInfos.push_back({
+              .sampler = VK_NULL_HANDLE,
+              .imageView = view.view,
+              .imageLayout = toVkImageLayout(binding.textureView.layout),
+            });
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSet;
+            write.dstBinding = binding.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            write.pImageInfo = &imageInfos.back();
+
+            writes.push_back(write);
+          }
+
+          /* -----------------------------------------------------------
+           * Update descriptors (safe)
+           * ----------------------------------------------------------- */
+
+          vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+          descriptors += writes.size();
+          result.push_back(vkGroup);
+        }
 
-    resultGroups->groups.push_back(vkGroup);
-  }
+        return std::make_pair(std::move(result), kDescriptorCost * (descriptors + 1));
+      });
 
-  vkBindingsGroups.insert(groups.name, resultGroups);
-  return *resultGroups;
+  return vkBindingsGroups.insert(groups.name, std::move(resultGroups));
 }
 
-void VulkanRHI::releaseBindingGroup(VulkanBindingGroups &groups)
+void VulkanRHI::releaseBindingGroup(VulkanBindingGroups &groups, uint64_t handle)
 {
-  for (auto &group : groups.groups)
+  if (groups.cacheKey.size())
   {
-    if (group.descriptorPool != VK_NULL_HANDLE)
-    {
-      vkDestroyDescriptorPool(device, group.descriptorPool, nullptr);
-      group.descriptorPool = VK_NULL_HANDLE;
-    }
-
-    group.descriptorSets.clear();
-
-    for (auto &view : group.textureViews)
-    {
-      destroyTextureView(view);
-    }
+    bindingGroupsCache.release(groups.cacheKey);
   }
 
   groups.groups.clear();
 
-  vkBindingsGroups.remove(groups.info.name);
+  vkBindingsGroups.remove(handle, groups.info.name);
 }
 
 VulkanSwapChainSupportDetails querySwapChainSupport(VkSurfaceKHR surface, VkPhysicalDevice device)
@@ -2024,16 +2125,16 @@ const SwapChain VulkanRHI::createSwapChain(uint32_t surfaceIndex, uint32_t width
     view->image = images[i];
     view->format = surfaceFormat.format;
 
-    VulkanTexture *texture = new VulkanTexture();
+    VulkanTexture image;
 
-    texture->image = images[i];
-    texture->format = surfaceFormat.format;
-    texture->info.depth = 1;
-    texture->info.memoryProperties = BufferUsage::BufferUsage_None;
-    texture->info.mipLevels = 1;
-    texture->info.name = "_SwapChainImage[" + std::to_string((uint64_t)surfaceIndex) + "," + std::to_string(i) + "].texture";
-    texture->info.height = getSwapChainImagesHeight((SwapChain)surfaceIndex);
-    texture->info.width = getSwapChainImagesWidth((SwapChain)surfaceIndex);
+    image.image = images[i];
+    image.format = surfaceFormat.format;
+    image.info.depth = 1;
+    image.info.memoryProperties = BufferUsage::BufferUsage_None;
+    image.info.mipLevels = 1;
+    image.info.name = "_SwapChainImage[" + std::to_string((uint64_t)surfaceIndex) + "," + std::to_string(i) + "].texture";
+    image.info.height = getSwapChainImagesHeight((SwapChain)surfaceIndex);
+    image.info.width = getSwapChainImagesWidth((SwapChain)surfaceIndex);
 
     // view->fence = VK_NULL_HANDLE;
     // view->achireSemaphore = VK_NULL_HANDLE;
@@ -2045,10 +2146,11 @@ const SwapChain VulkanRHI::createSwapChain(uint32_t surfaceIndex, uint32_t width
     // TextureViewInfo info;
     // info.name = "SwapChainImage";
     // info.flags = ImageAspectFlags::Color;
+    std::string name = image.info.name;
+    VulkanTexture *texture = vkTextures.objects.get(vkTextures.insert(name, std::move(image)));
+
     swapChainImp->swapChainImages.push_back(texture);
     swapChainImp->swapChainImageViews.push_back(view);
-
-    vkTextures.insert(texture->info.name, texture);
   }
 
   swapChainImp->swapChainImageFormat = surfaceFormat.format;
@@ -2180,103 +2282,199 @@ const uint32_t VulkanRHI::getSwapChainImagesHeight(SwapChain swapChainHandle)
 
 const VulkanTexture &VulkanRHI::getVulkanTexture(const std::string &obj)
 {
-  auto result = vkTextures.find(obj);
+  VulkanTexture *result = vkTextures.find(obj);
 
-  if (result == vkTextures.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanTexture not found");
   }
 
-  return *result.value(); //->value();
+  return *result;
+}
+
+const VulkanTexture &VulkanRHI::getVulkanTexture(const Texture &obj)
+{
+  VulkanTexture *result = vkTextures.find(obj.handle, obj.name);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanTexture not found");
+  }
+
+  return *result;
 }
 
 const VulkanSampler &VulkanRHI::getVulkanSampler(const std::string &obj)
 {
-  auto result = vkSamplers.find(obj);
+  VulkanSampler *result = vkSamplers.find(obj);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanSampler not found");
+  }
+
+  return *result;
+}
+
+const VulkanSampler &VulkanRHI::getVulkanSampler(const Sampler &obj)
+{
+  VulkanSampler *result = vkSamplers.find(obj.handle, obj.name);
 
-  if (result == vkSamplers.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanSampler not found");
   }
 
-  return *result.value();
+  return *result;
 }
 
 const VulkanBuffer &VulkanRHI::getVulkanBuffer(const std::string &obj)
 {
-  auto result = vkBuffers.find(obj);
+  VulkanBuffer *result = vkBuffers.find(obj);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanBuffer not found");
+  }
+
+  return *result;
+}
+
+const VulkanBuffer &VulkanRHI::getVulkanBuffer(const Buffer &obj)
+{
+  VulkanBuffer *result = vkBuffers.find(obj.handle, obj.name);
 
-  if (result == vkBuffers.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanBuffer not found");
   }
 
-  return *result.value();
+  return *result;
 }
 
 const VulkanBindingsLayout &VulkanRHI::getVulkanBindingsLayout(const std::string &obj)
 {
-  auto result = vkBindingsLayout.find(obj);
+  VulkanBindingsLayout *result = vkBindingsLayout.find(obj);
 
-  if (result == vkBindingsLayout.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanBindingsLayout not found");
   }
 
-  return *result.value();
+  return *result;
+}
+
+const VulkanBindingsLayout &VulkanRHI::getVulkanBindingsLayout(const BindingsLayout &obj)
+{
+  VulkanBindingsLayout *result = vkBindingsLayout.find(obj.handle, obj.name);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanBindingsLayout not found");
+  }
+
+  return *result;
 }
 
 const VulkanBindingGroups &VulkanRHI::getVulkanBindingGroups(const std::string &obj)
 {
-  auto result = vkBindingsGroups.find(obj);
+  VulkanBindingGroups *result = vkBindingsGroups.find(obj);
 
-  if (result == vkBindingsGroups.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanBindingGroups not found");
   }
 
-  return *result.value();
+  return *result;
+}
+
+const VulkanBindingGroups &VulkanRHI::getVulkanBindingGroups(const BindingGroups &obj)
+{
+  VulkanBindingGroups *result = vkBindingsGroups.find(obj.handle, obj.name);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanBindingGroups not found");
+  }
+
+  return *result;
 }
 
 const VulkanGraphicsPipeline &VulkanRHI::getVulkanGraphicsPipeline(const std::string &obj)
 {
-  auto result = vkGraphicsPipeline.find(obj);
+  VulkanGraphicsPipeline *result = vkGraphicsPipeline.find(obj);
 
-  if (result == vkGraphicsPipeline.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanGraphicsPipeline not found");
   }
 
-  return *result.value();
+  return *result;
+}
+
+const VulkanGraphicsPipeline &VulkanRHI::getVulkanGraphicsPipeline(const GraphicsPipeline &obj)
+{
+  VulkanGraphicsPipeline *result = vkGraphicsPipeline.find(obj.handle, obj.name);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanGraphicsPipeline not found");
+  }
+
+  return *result;
 }
 
 const VulkanComputePipeline &VulkanRHI::getVulkanComputePipeline(const std::string &obj)
 {
-  auto result = vkComputePipeline.find(obj);
+  VulkanComputePipeline *result = vkComputePipeline.find(obj);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanComputePipeline not found");
+  }
+
+  return *result;
+}
+
+const VulkanComputePipeline &VulkanRHI::getVulkanComputePipeline(const ComputePipeline &obj)
+{
+  VulkanComputePipeline *result = vkComputePipeline.find(obj.handle, obj.name);
 
-  if (result == vkComputePipeline.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanComputePipeline not found");
   }
 
-  return *result.value();
+  return *result;
 }
 
 const VulkanShader &VulkanRHI::getVulkanShader(const std::string &obj)
 {
-  auto result = vkShaders.find(obj);
+  VulkanShader *result = vkShaders.find(obj);
 
-  if (result == vkShaders.end())
+  if (result == nullptr)
   {
     throw std::runtime_error("VulkanShader not found");
   }
 
-  return *result.value();
-};
+  return *result;
+}
+
+const VulkanShader &VulkanRHI::getVulkanShader(const Shader &obj)
+{
+  VulkanShader *result = vkShaders.find(obj.handle, obj.name);
+
+  if (result == nullptr)
+  {
+    throw std::runtime_error("VulkanShader not found");
+  }
+
+  return *result;
+}
 
 void VulkanRHI::bufferRead(const Buffer &buffer, const uint64_t offset, const uint64_t size, std::function<void(const void *)> callback)
 {
-  const VulkanBuffer &heap = getVulkanBuffer(buffer.name);
+  const VulkanBuffer &heap = getVulkanBuffer(buffer);
   void *ptr;
   vkMapMemory(device, heap.memory, offset, size, 0, &ptr);
   callback(ptr);
@@ -2286,7 +2484,7 @@ void VulkanRHI::bufferRead(const Buffer &buffer, const uint64_t offset, const ui
 void VulkanRHI::bufferWrite(const Buffer &buffer, const uint64_t offset, const uint64_t size, void *data)
 {
   void *ptr;
-  const VulkanBuffer &heap = getVulkanBuffer(buffer.name);
+  const VulkanBuffer &heap = getVulkanBuffer(buffer);
   auto result = vkMapMemory(device, heap.memory, offset, size, 0, &ptr);
   if (result != VK_SUCCESS)
   {
@@ -2437,326 +2635,365 @@ VkRenderPass VulkanRHI::createRenderPass(const ColorAttatchment *attachments, ui
   return renderPass;
 }
 
-VulkanGraphicsPipeline &VulkanRHI::allocateGraphicsPipeline(const GraphicsPipelineInfo &info)
+uint64_t VulkanRHI::allocateGraphicsPipeline(const GraphicsPipelineInfo &info)
 {
 #ifdef VULKAN_DEVICE_LOG
   os::Logger::logf("VulkanDevice creating (GraphicsPipeline)%s", info.name.c_str());
 #endif
-  // VkViewport viewport = {0};
-  // viewport.x = 0.0f;
-  // viewport.y = 0.0f;
-  // viewport.width = renderPasses[renderPass].width;
-  // viewport.height = renderPasses[renderPass].height;
-
-  // VkRect2D scissor;
-  // scissor.offset.x = 0;
-  // scissor.offset.y = 0;
-  // scissor.extent.width = renderPasses[renderPass].width;
-  // scissor.extent.width = renderPasses[renderPass].height;
-
-  std::vector<VkDynamicState> dynamicStates = {
-    VK_DYNAMIC_STATE_VIEWPORT,
-    VK_DYNAMIC_STATE_SCISSOR,
-  };
+  VulkanContentKey key;
+  key.add(info.layout.name).add(vkBindingsLayout.handleOf(info.layout));
+  key.add(info.vertexStage.vertexShader.name).add(vkShaders.handleOf(info.vertexStage.vertexShader)).add(info.vertexStage.shaderEntry);
+  key.add(info.vertexStage.primitiveType).add(info.vertexStage.cullType).add(info.vertexStage.vertexLayoutElements.size());
 
-  VkPipelineDynamicStateCreateInfo dynamicState = {};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamicState.dynamicStateCount = dynamicStates.size();
-  dynamicState.pDynamicStates = dynamicStates.data();
-  dynamicState.pNext = nullptr;
-
-  VkPipelineViewportStateCreateInfo viewportState = {};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.pNext = nullptr;
-  viewportState.viewportCount = 1;
-  viewportState.scissorCount = 1;
-  viewportState.pViewports = nullptr;
-  viewportState.pScissors = nullptr;
-
-  VkPipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.pNext = nullptr;
-  rasterizer.flags = 0;
-  rasterizer.depthClampEnable = VK_FALSE;
-  rasterizer.rasterizerDiscardEnable = VK_FALSE;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.depthBiasEnable = VK_FALSE;
-
-  switch (info.vertexStage.cullType)
-  {
-  case PrimitiveCullType_None:
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
-    break;
-  case PrimitiveCullType_CCW:
-    rasterizer.cullMode = VK_CULL_MODE_FRONT_BIT;
-    break;
-  case PrimitiveCullType_CW:
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    break;
-  default:
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
-    break;
-  }
-  switch (info.vertexStage.cullType)
+  for (const VertexLayoutElement &element : info.vertexStage.vertexLayoutElements)
   {
-  case PrimitiveCullType_CCW:
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    break;
-  case PrimitiveCullType_CW:
-  default:
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    break;
+    key.add(element.type).add(element.binding).add(element.offset).add(element.location);
   }
 
-  rasterizer.depthBiasEnable = VK_FALSE;
-  rasterizer.depthBiasSlopeFactor = 1.0f;
-  rasterizer.lineWidth = 1.0f;
-
-  VkPipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.pNext = nullptr;
-  multisampling.flags = 0;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-  multisampling.sampleShadingEnable = VK_FALSE;
-
-  VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-
-  colorBlendAttachment.blendEnable = VK_TRUE;
-  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-  colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-  colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-  colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  key.add(info.fragmentStage.fragmentShader.name).add(vkShaders.handleOf(info.fragmentStage.fragmentShader)).add(info.fragmentStage.shaderEntry);
+  key.add(info.fragmentStage.colorAttatchments.size());
 
-  VkPipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.pNext = nullptr;
-  colorBlending.flags = 0;
-  colorBlending.logicOpEnable = VK_FALSE;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &colorBlendAttachment;
-
-  VkGraphicsPipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-
-  std::vector<VkVertexInputAttributeDescription> attributes;
-  std::unordered_map<uint32_t, uint32_t> bindingStrideMap;
-
-  for (int i = 0; i < info.vertexStage.vertexLayoutElements.size(); i++)
+  for (const ColorAttatchment &attachment : info.fragmentStage.colorAttatchments)
   {
-    VkVertexInputAttributeDescription desc = {};
-    desc.format = toVkFormat(typeToFormat(info.vertexStage.vertexLayoutElements[i].type));
-    desc.binding = info.vertexStage.vertexLayoutElements[i].binding;
-    desc.location = info.vertexStage.vertexLayoutElements[i].location;
-    desc.offset = info.vertexStage.vertexLayoutElements[i].offset;
-    attributes.push_back(desc);
-
-    uint32_t attributeEndOffset = desc.offset + GetVkFormatSize(desc.format);
-    bindingStrideMap[desc.binding] = std::max(bindingStrideMap[desc.binding], attributeEndOffset);
+    key.add(attachment.format).add(attachment.loadOp).add(attachment.storeOp);
   }
 
-  std::vector<VkVertexInputBindingDescription> bindings;
-  for (auto const &[bindingId, stride] : bindingStrideMap)
+  key.add(info.fragmentStage.depthAttatchment != nullptr);
+
+  if (info.fragmentStage.depthAttatchment)
   {
-    VkVertexInputBindingDescription bindDesc = {};
-    bindDesc.binding = bindingId;
-    bindDesc.stride = stride;
-    bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    bindings.push_back(bindDesc);
+    key.add(info.fragmentStage.depthAttatchment->format).add(info.fragmentStage.depthAttatchment->loadOp).add(info.fragmentStage.depthAttatchment->storeOp);
   }
 
-  std::sort(
-      bindings.begin(),
-      bindings.end(),
-      [](const VkVertexInputBindingDescription &a, const VkVertexInputBindingDescription &b)
+  VulkanGraphicsPipeline result;
+  result.cacheKey = std::move(key.bytes);
+
+  std::tie(result.pipeline, result.renderPass) = graphicsPipelineCache.acquire(
+      result.cacheKey,
+      [&]()
       {
-        return a.binding < b.binding;
-      });
+        // VkViewport viewport = {0};
+        // viewport.x = 0.0f;
+        // viewport.y = 0.0f;
+        // viewport.width = renderPasses[renderPass].width;
+        // viewport.height = renderPasses[renderPass].height;
+
+        // VkRect2D scissor;
+        // scissor.offset.x = 0;
+        // scissor.offset.y = 0;
+        // scissor.extent.width = renderPasses[renderPass].width;
+        // scissor.extent.width = renderPasses[renderPass].height;
+
+        std::vector<VkDynamicState> dynamicStates = {
+          VK_DYNAMIC_STATE_VIEWPORT,
+          VK_DYNAMIC_STATE_SCISSOR,
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = dynamicStates.size();
+        dynamicState.pDynamicStates = dynamicStates.data();
+        dynamicState.pNext = nullptr;
+
+        VkPipelineViewportStateCreateInfo viewportState = {};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.pNext = nullptr;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+        viewportState.pViewports = nullptr;
+        viewportState.pScissors = nullptr;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.pNext = nullptr;
+        rasterizer.flags = 0;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        switch (info.vertexStage.cullType)
+        {
+        case PrimitiveCullType_None:
+          rasterizer.cullMode = VK_CULL_MODE_NONE;
+          break;
+        case PrimitiveCullType_CCW:
+          rasterizer.cullMode = VK_CULL_MODE_FRONT_BIT;
+          break;
+        case PrimitiveCullType_CW:
+          rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+          break;
+        default:
+          rasterizer.cullMode = VK_CULL_MODE_NONE;
+          break;
+        }
+        switch (info.vertexStage.cullType)
+        {
+        case PrimitiveCullType_CCW:
+          rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+          break;
+        case PrimitiveCullType_CW:
+        default:
+          rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+          break;
+        }
 
-  // Set up VkPipelineVertexInputStateCreateInfo
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
-  vertexInputInfo.pVertexBindingDescriptions = bindings.data();
-  vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
-  vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+        rasterizer.depthBiasEnable = VK_FALSE;
+        rasterizer.depthBiasSlopeFactor = 1.0f;
+        rasterizer.lineWidth = 1.0f;
 
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.pNext = nullptr;
-  inputAssembly.flags = 0;
-  inputAssembly.primitiveRestartEnable = VK_FALSE;
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.pNext = nullptr;
+        multisampling.flags = 0;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling.sampleShadingEnable = VK_FALSE;
 
-  switch (info.vertexStage.primitiveType)
-  {
-  case PrimitiveType_Triangles:
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    break;
-  case PrimitiveType_TrianglesFan:
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN;
-    break;
-  case PrimitiveType_TrianglesStrip:
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-    break;
-  case PrimitiveType_Points:
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
-    break;
-  case PrimitiveType_Lines:
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
-    break;
-  default:
-    abort();
-  }
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 
-  inputAssembly.primitiveRestartEnable = VK_FALSE;
+        colorBlendAttachment.blendEnable = VK_TRUE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
-  const VulkanShader &vertex = getVulkanShader(info.vertexStage.vertexShader.name);
-  const VulkanShader &fragment = getVulkanShader(info.fragmentStage.fragmentShader.name);
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 
-  if (vertex.shaderModule == VK_NULL_HANDLE)
-  {
-    throw std::runtime_error("Invalid vertex shader!");
-  }
-  if (fragment.shaderModule == VK_NULL_HANDLE)
-  {
-    throw std::runtime_error("Invalid fragment shader!");
-  }
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.pNext = nullptr;
+        colorBlending.flags = 0;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
 
-  VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-  vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  vertShaderStageInfo.pNext = nullptr;
-  vertShaderStageInfo.flags = 0;
-  vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = vertex.shaderModule;
-  vertShaderStageInfo.pName = info.vertexStage.shaderEntry.c_str();
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 
-  VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-  fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  fragShaderStageInfo.pNext = nullptr;
-  fragShaderStageInfo.flags = 0;
-  fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragShaderStageInfo.module = fragment.shaderModule;
-  fragShaderStageInfo.pName = info.fragmentStage.shaderEntry.c_str();
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        std::unordered_map<uint32_t, uint32_t> bindingStrideMap;
 
-  VkPipelineShaderStageCreateInfo shaderStages[] = {
-    vertShaderStageInfo,
-    fragShaderStageInfo,
-  };
+        for (int i = 0; i < info.vertexStage.vertexLayoutElements.size(); i++)
+        {
+          VkVertexInputAttributeDescription desc = {};
+          desc.format = toVkFormat(typeToFormat(info.vertexStage.vertexLayoutElements[i].type));
+          desc.binding = info.vertexStage.vertexLayoutElements[i].binding;
+          desc.location = info.vertexStage.vertexLayoutElements[i].location;
+          desc.offset = info.vertexStage.vertexLayoutElements[i].offset;
+          attributes.push_back(desc);
+
+          uint32_t attributeEndOffset = desc.offset + GetVkFormatSize(desc.format);
+          bindingStrideMap[desc.binding] = std::max(bindingStrideMap[desc.binding], attributeEndOffset);
+        }
+
+        std::vector<VkVertexInputBindingDescription> bindings;
+        for (auto const &[bindingId, stride] : bindingStrideMap)
+        {
+          VkVertexInputBindingDescription bindDesc = {};
+          bindDesc.binding = bindingId;
+          bindDesc.stride = stride;
+          bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+          bindings.push_back(bindDesc);
+        }
 
-  // pipelineInfo.pNext = &pipelineRenderingCreateInfo;
+        std::sort(
+            bindings.begin(),
+            bindings.end(),
+            [](const VkVertexInputBindingDescription &a, const VkVertexInputBindingDescription &b)
+            {
+              return a.binding < b.binding;
+            });
+
+        // Set up VkPipelineVertexInputStateCreateInfo
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+        vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.pNext = nullptr;
+        inputAssembly.flags = 0;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        switch (info.vertexStage.primitiveType)
+        {
+        case PrimitiveType_Triangles:
+          inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+          break;
+        case PrimitiveType_TrianglesFan:
+          inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN;
+          break;
+        case PrimitiveType_TrianglesStrip:
+          inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+          break;
+        case PrimitiveType_Points:
+          inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+          break;
+        case PrimitiveType_Lines:
+          inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+          break;
+        default:
+          abort();
+        }
 
-  VkPipelineDepthStencilStateCreateInfo depthStencil{};
-  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depthStencil.depthTestEnable = VK_FALSE;
-  depthStencil.depthWriteEnable = VK_FALSE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-  depthStencil.depthBoundsTestEnable = VK_FALSE;
-  depthStencil.stencilTestEnable = VK_FALSE;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-  if (info.fragmentStage.depthAttatchment != nullptr)
-  {
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-  }
+        const VulkanShader &vertex = getVulkanShader(info.vertexStage.vertexShader);
+        const VulkanShader &fragment = getVulkanShader(info.fragmentStage.fragmentShader);
 
-  pipelineInfo.pDepthStencilState = &depthStencil;
+        if (vertex.shaderModule == VK_NULL_HANDLE)
+        {
+          throw std::runtime_error("Invalid vertex shader!");
+        }
+        if (fragment.shaderModule == VK_NULL_HANDLE)
+        {
+          throw std::runtime_error("Invalid fragment shader!");
+        }
 
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = shaderStages;
+        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        vertShaderStageInfo.pNext = nullptr;
+        vertShaderStageInfo.flags = 0;
+        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        vertShaderStageInfo.module = vertex.shaderModule;
+        vertShaderStageInfo.pName = info.vertexStage.shaderEntry.c_str();
+
+        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.pNext = nullptr;
+        fragShaderStageInfo.flags = 0;
+        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShaderStageInfo.module = fragment.shaderModule;
+        fragShaderStageInfo.pName = info.fragmentStage.shaderEntry.c_str();
+
+        VkPipelineShaderStageCreateInfo shaderStages[] = {
+          vertShaderStageInfo,
+          fragShaderStageInfo,
+        };
+
+        // pipelineInfo.pNext = &pipelineRenderingCreateInfo;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = VK_FALSE;
+        depthStencil.depthWriteEnable = VK_FALSE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+
+        if (info.fragmentStage.depthAttatchment != nullptr)
+        {
+          depthStencil.depthTestEnable = VK_TRUE;
+          depthStencil.depthWriteEnable = VK_TRUE;
+          depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        }
 
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  const VulkanBindingsLayout &layout = getVulkanBindingsLayout(info.layout.name);
-  pipelineInfo.layout = layout.pipelineLayout;
+        pipelineInfo.pDepthStencilState = &depthStencil;
 
-  VkRenderPass renderPass = createRenderPass(info.fragmentStage.colorAttatchments.data(), info.fragmentStage.colorAttatchments.size(), info.fragmentStage.depthAttatchment);
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
 
-  pipelineInfo.renderPass = renderPass;
-  VkPipeline pipeline = VK_NULL_HANDLE;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        const VulkanBindingsLayout &layout = getVulkanBindingsLayout(info.layout);
+        pipelineInfo.layout = layout.pipelineLayout;
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
-  {
-    throw std::runtime_error("Failed to create graphics pipeline!");
-  }
+        VkRenderPass renderPass = createRenderPass(info.fragmentStage.colorAttatchments.data(), info.fragmentStage.colorAttatchments.size(), info.fragmentStage.depthAttatchment);
 
-  VulkanGraphicsPipeline *result = new VulkanGraphicsPipeline();
+        pipelineInfo.renderPass = renderPass;
+        VkPipeline pipeline = VK_NULL_HANDLE;
 
-  result->pipeline = pipeline;
-  result->renderPass = renderPass;
-  result->info = info;
-  result->layout = info.layout;
+        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
+        {
+          throw std::runtime_error("Failed to create graphics pipeline!");
+        }
 
-  vkGraphicsPipeline.insert(info.name, result);
-  return *result;
+        return std::make_pair(std::make_pair(pipeline, renderPass), kPipelineCost);
+      });
+
+  result.info = info;
+  result.layout = info.layout;
+
+  return vkGraphicsPipeline.insert(info.name, std::move(result));
 }
 
-void VulkanRHI::releaseGraphicsPipeline(VulkanGraphicsPipeline &handle)
+void VulkanRHI::releaseGraphicsPipeline(VulkanGraphicsPipeline &pipeline, uint64_t handle)
 {
-  vkDestroyPipeline(device, handle.pipeline, NULL);
-  vkDestroyRenderPass(device, handle.renderPass, NULL);
-  vkGraphicsPipeline.remove(handle.info.name);
+  graphicsPipelineCache.release(pipeline.cacheKey);
+  vkGraphicsPipeline.remove(handle, pipeline.info.name);
 }
 
-VulkanComputePipeline &VulkanRHI::allocateComputePipeline(const ComputePipelineInfo &info)
+uint64_t VulkanRHI::allocateComputePipeline(const ComputePipelineInfo &info)
 {
-  VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
-  computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  VulkanContentKey key;
+  key.add(info.shader.name).add(vkShaders.handleOf(info.shader)).add(info.entry);
+  key.add(info.layout.name).add(vkBindingsLayout.handleOf(info.layout));
 
-  const VulkanShader &shader = getVulkanShader(info.shader.name);
-  if (shader.shaderModule == VK_NULL_HANDLE)
-  {
-    throw std::runtime_error("Invalid compute shader!");
-  }
-  computeShaderStageInfo.module = shader.shaderModule;
-  computeShaderStageInfo.pName = info.entry;
+  VulkanComputePipeline result;
+  result.cacheKey = std::move(key.bytes);
+  result.pipeline = computePipelineCache.acquire(
+      result.cacheKey,
+      [&]()
+      {
+        VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+        computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
 
-  const VulkanBindingsLayout &layout = getVulkanBindingsLayout(info.layout.name);
-  if (layout.pipelineLayout == VK_NULL_HANDLE)
-  {
-    throw std::runtime_error("Invalid pipeline layout in ComputePipelineInfo!");
-  }
+        const VulkanShader &shader = getVulkanShader(info.shader);
+        if (shader.shaderModule == VK_NULL_HANDLE)
+        {
+          throw std::runtime_error("Invalid compute shader!");
+        }
+        computeShaderStageInfo.module = shader.shaderModule;
+        computeShaderStageInfo.pName = info.entry;
 
-  VkComputePipelineCreateInfo pipelineInfo{};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-  pipelineInfo.stage = computeShaderStageInfo;
-  pipelineInfo.layout = layout.pipelineLayout;
-  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-  pipelineInfo.basePipelineIndex = -1;
+        const VulkanBindingsLayout &layout = getVulkanBindingsLayout(info.layout);
+        if (layout.pipelineLayout == VK_NULL_HANDLE)
+        {
+          throw std::runtime_error("Invalid pipeline layout in ComputePipelineInfo!");
+        }
 
-  VkPipeline pipeline = VK_NULL_HANDLE;
-  if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
-  {
-    throw std::runtime_error("Failed to create compute pipeline!");
-  }
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderStageInfo;
+        pipelineInfo.layout = layout.pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        {
+          throw std::runtime_error("Failed to create compute pipeline!");
+        }
 
-  VulkanComputePipeline *result = new VulkanComputePipeline();
-  result->pipeline = pipeline;
-  result->layout = info.layout;
-  result->info = info;
+        return std::make_pair(pipeline, kPipelineCost);
+      });
 
-  vkComputePipeline.insert(info.name, result);
-  return *result;
+  result.layout = info.layout;
+  result.info = info;
+
+  return vkComputePipeline.insert(info.name, std::move(result));
 }
 
-void VulkanRHI::releaseComputePipeline(VulkanComputePipeline &vkPipeline)
+void VulkanRHI::releaseComputePipeline(VulkanComputePipeline &vkPipeline, uint64_t handle)
 {
   if (vkPipeline.pipeline != VK_NULL_HANDLE)
   {
-    vkDestroyPipeline(device, vkPipeline.pipeline, nullptr);
+    computePipelineCache.release(vkPipeline.cacheKey);
   }
 
-  vkComputePipeline.remove(vkPipeline.info.name);
+  vkComputePipeline.remove(handle, vkPipeline.info.name);
 }
 
 VulkanCommandPool VulkanRHI::allocateCommandPool(uint32_t queueFamilyIndex)
@@ -2782,12 +3019,10 @@ void VulkanRHI::releaseCommandPool(VulkanCommandPool &pool)
   vkDestroyCommandPool(device, pool.commandPool, nullptr);
 }
 
-std::vector<CommandBuffer> VulkanRHI::allocateCommandBuffers(Queue queue, uint32_t count)
+VulkanCommandPool VulkanRHI::acquireCommandPool(Queue queue)
 {
-  VkCommandBufferAllocateInfo allocInfo{};
   VulkanCommandPool commandPool;
 
-  // TODO: reuse command pools
   switch (queue)
   {
   case Queue::Graphics:
@@ -2813,22 +3048,32 @@ std::vector<CommandBuffer> VulkanRHI::allocateCommandBuffers(Queue queue, uint32
     break;
   }
 
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = commandPool.commandPool;
-  allocInfo.level = VkCommandBufferLevel::VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = count;
-
-  std::vector<VkCommandBuffer> cmbs(count);
-
-  if (vkAllocateCommandBuffers(device, &allocInfo, cmbs.data()) != VK_SUCCESS)
-  {
-    throw std::runtime_error("Failed to allocate command buffers");
-  }
+  return commandPool;
+}
 
+std::vector<CommandBuffer> VulkanRHI::allocateCommandBuffers(Queue queue, uint32_t count)
+{
   std::vector<CommandBuffer> buffers;
 
   for (uint32_t i = 0; i < count; i++)
   {
+    // Every command buffer owns its pool until it is released, so command buffers can be recorded from different
+    // threads at the same time without synchronizing on a shared pool.
+    VulkanCommandPool commandPool = acquireCommandPool(queue);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool.commandPool;
+    allocInfo.level = VkCommandBufferLevel::VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer vkCommandBuffer;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &vkCommandBuffer) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to allocate command buffers");
+    }
+
     auto index = commandBuffersAllocated.fetch_add(1);
 
     auto commandBufferData = commandBuffers.insert(
@@ -2837,7 +3082,7 @@ std::vector<CommandBuffer> VulkanRHI::allocateCommandBuffers(Queue queue, uint32
           .submited = false,
           .fence = VK_NULL_HANDLE,
           .queue = queue,
-          .commandBuffer = cmbs[i],
+          .commandBuffer = vkCommandBuffer,
           .commandPool = commandPool,
           .hascomputePipeline = false,
           .hasGraphicsPipeline = false,
@@ -2852,6 +3097,59 @@ std::vector<CommandBuffer> VulkanRHI::allocateCommandBuffers(Queue queue, uint32
   return buffers;
 }
 
+std::vector<CommandBuffer> VulkanRHI::allocatePersistentCommandBuffers(Queue queue, uint32_t count)
+{
+  std::vector<CommandBuffer> buffers = allocateCommandBuffers(queue, count);
+
+  for (auto &buff : buffers)
+  {
+    commandBuffers[buff]->persistent = true;
+  }
+
+  return buffers;
+}
+
+// Views and framebuffers created while recording the render passes of a command buffer.
+static void destroyRenderPasses(VkDevice device, std::vector<VulkanCommandBufferRenderPass> &renderPasses)
+{
+  for (auto &renderPassData : renderPasses)
+  {
+    for (auto view : renderPassData.views)
+    {
+      vkDestroyImageView(device, view.view, nullptr);
+    }
+
+    vkDestroyFramebuffer(device, renderPassData.frameBuffer, nullptr);
+  }
+
+  renderPasses.clear();
+}
+
+void VulkanRHI::resetCommandBuffer(CommandBuffer handle)
+{
+  auto cmd = commandBuffers[handle];
+
+  if (cmd->submited)
+  {
+    vkWaitForFences(device, 1, &cmd->fence, VK_TRUE, UINT64_MAX);
+  }
+
+  destroyRenderPasses(device, cmd->renderPasses);
+
+  // The pool only holds this command buffer, resetting it recycles the memory of the last recording without freeing
+  // the command buffer.
+  if (vkResetCommandPool(device, cmd->commandPool.commandPool, 0) != VK_SUCCESS)
+  {
+    throw std::runtime_error("vkResetCommandPool failed");
+  }
+
+  cmd->submited = false;
+  cmd->hasGraphicsPipeline = false;
+  cmd->hascomputePipeline = false;
+  cmd->boundGraphicsPipeline = GraphicsPipeline{.name = ""};
+  cmd->boundComputePipeline = ComputePipeline{.name = ""};
+}
+
 void VulkanRHI::releaseCommandBuffer(std::vector<CommandBuffer> &buffers)
 {
   for (auto &buff : buffers)
@@ -2863,15 +3161,7 @@ void VulkanRHI::releaseCommandBuffer(std::vector<CommandBuffer> &buffers)
       vkWaitForFences(device, 1, &commandbuffer->fence, VK_TRUE, UINT64_MAX);
     }
 
-    for (auto renderPassData : commandbuffer->renderPasses)
-    {
-      for (auto view : renderPassData.views)
-      {
-        vkDestroyImageView(device, view.view, nullptr);
-      }
-
-      vkDestroyFramebuffer(device, renderPassData.frameBuffer, nullptr);
-    }
+    destroyRenderPasses(device, commandbuffer->renderPasses);
 
     vkFreeCommandBuffers(device, commandbuffer->commandPool.commandPool, 1, &(commandbuffer->commandBuffer));
 
@@ -2905,7 +3195,7 @@ void VulkanRHI::beginCommandBuffer(CommandBuffer handle)
     VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
   };
 
-  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.flags = cmd->persistent ? 0 : VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   beginInfo.pInheritanceInfo = nullptr;
 
   VkResult r = vkBeginCommandBuffer(cmd->commandBuffer, &beginInfo);
@@ -2933,8 +3223,8 @@ void VulkanRHI::cmdCopyBuffer(CommandBuffer cmdBuffer, Buffer src, Buffer dst, u
   copyRegion.dstOffset = dstOffset;
 
   copyRegion.size = size;
-  auto srcBuffer = getVulkanBuffer(src.name);
-  auto dstBuffer = getVulkanBuffer(dst.name);
+  const auto &srcBuffer = getVulkanBuffer(src);
+  const auto &dstBuffer = getVulkanBuffer(dst);
 
   vkCmdCopyBuffer(vkCmd, srcBuffer.buffer, dstBuffer.buffer, 1, &copyRegion);
 }
@@ -3044,7 +3334,7 @@ void VulkanRHI::cmdBindGraphicsPipeline(CommandBuffer handle, GraphicsPipeline p
 {
   auto commandBuffer = commandBuffers[handle]; // einterpret_cast<VulkanCommandBuffer *>(handle.get());
   VkCommandBuffer cmd = commandBuffer->commandBuffer;
-  auto pipeline = getVulkanGraphicsPipeline(pipelineHandle.name); // reinterpret_cast<VulkanGraphicsPipeline *>(pipelineHandle.get())->pipeline;
+  const auto &pipeline = getVulkanGraphicsPipeline(pipelineHandle); // reinterpret_cast<VulkanGraphicsPipeline *>(pipelineHandle.get())->pipeline;
 
   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
 
@@ -3063,7 +3353,7 @@ void VulkanRHI::cmdBindComputePipeline(CommandBuffer handle, ComputePipeline pip
   VkCommandBuffer cmd = commandBuffer->commandBuffer;
   // VkPipeline pipeline = reinterpret_cast<VulkanComputePipeline *>(pipelineHandle.get())->pipeline;
 
-  auto pipeline = getVulkanComputePipeline(pipelineHandle.name); // reinterpret_cast<VulkanGraphicsPipeline *>(pipelineHandle.get())->pipeline;
+  const auto &pipeline = getVulkanComputePipeline(pipelineHandle); // reinterpret_cast<VulkanGraphicsPipeline *>(pipelineHandle.get())->pipeline;
 
   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
 
@@ -3087,7 +3377,7 @@ void VulkanRHI::cmdBeginRenderPass(CommandBuffer cmdHandle, const RenderPassInfo
     throw std::runtime_error("no pipeline was bound");
   }
 
-  auto pipelineData = getVulkanGraphicsPipeline(commandBuffer->boundGraphicsPipeline.name);
+  const auto &pipelineData = getVulkanGraphicsPipeline(commandBuffer->boundGraphicsPipeline);
 
   if (pipelineData.renderPass == VK_NULL_HANDLE)
   {
@@ -3266,27 +3556,27 @@ void VulkanRHI::cmdEndRenderPass(CommandBuffer cmdHandle)
   vkCmdEndRenderPass(cmdBuffer->commandBuffer);
 }
 
-void VulkanRHI::cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount)
+void VulkanRHI::cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, const uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount)
 {
   auto commandBuffer = commandBuffers[cmdBuffer]; // reinterpret_cast<VulkanCommandBuffer *>(cmdBuffer.get());
   VkPipelineLayout layout = VK_NULL_HANDLE;
 
   if (commandBuffer->hascomputePipeline)
   {
-    auto pip = getVulkanComputePipeline(commandBuffer->boundComputePipeline.name);
-    layout = getVulkanBindingsLayout(pip.layout.name).pipelineLayout;
+    const auto &pip = getVulkanComputePipeline(commandBuffer->boundComputePipeline);
+    layout = getVulkanBindingsLayout(pip.layout).pipelineLayout;
   }
   else if (commandBuffer->hasGraphicsPipeline)
   {
-    auto pip = getVulkanGraphicsPipeline(commandBuffer->boundGraphicsPipeline.name);
-    layout = getVulkanBindingsLayout(pip.layout.name).pipelineLayout;
+    const auto &pip = getVulkanGraphicsPipeline(commandBuffer->boundGraphicsPipeline);
+    layout = getVulkanBindingsLayout(pip.layout).pipelineLayout;
   }
   else
   {
     throw std::runtime_error("No bound pipeline");
   }
 
-  auto vkGroups = getVulkanBindingGroups(groups.name);
+  const auto &vkGroups = getVulkanBindingGroups(groups);
 
   VkPipelineBindPoint point = VK_PIPELINE_BIND_POINT_MAX_ENUM;
 
@@ -3321,7 +3611,7 @@ void VulkanRHI::cmdBindVertexBuffer(CommandBuffer handle, uint32_t slot, Buffer
 {
   auto cmd = commandBuffers[handle]; // reinterpret_cast<VulkanCommandBuffer *>(cmdBuffer.get());
 
-  auto heap = getVulkanBuffer(buffer.name); // reinterpret_cast<VulkanBuffer *>(bufferHandle.buffer.get());
+  const auto &heap = getVulkanBuffer(buffer); // reinterpret_cast<VulkanBuffer *>(bufferHandle.buffer.get());
   VkBuffer vkBuf = heap.buffer;
   VkDeviceSize vkOffset = static_cast<VkDeviceSize>(offfset);
 
@@ -3331,7 +3621,7 @@ void VulkanRHI::cmdBindVertexBuffer(CommandBuffer handle, uint32_t slot, Buffer
 void VulkanRHI::cmdBindIndexBuffer(CommandBuffer handle, Buffer buffer, Type type, uint64_t offset)
 {
   auto cmd = commandBuffers[handle];        // reinterpret_cast<VulkanCommandBuffer *>(cmdBuffer.get());
-  auto heap = getVulkanBuffer(buffer.name); // reinterpret_cast<VulkanBuffer *>(bufferHandle.buffer.get());
+  const auto &heap = getVulkanBuffer(buffer); // reinterpret_cast<VulkanBuffer *>(bufferHandle.buffer.get());
 
   VkBuffer vkBuf = heap.buffer;
 
@@ -3360,7 +3650,7 @@ void VulkanRHI::cmdDrawIndexed(CommandBuffer handle, uint32_t indexCount, uint32
 void VulkanRHI::cmdDrawIndexedIndirect(CommandBuffer handle, Buffer indirectBuffer, size_t offset, uint32_t drawCount, uint32_t stride)
 {
   auto cmd = commandBuffers[handle];
-  auto heap = getVulkanBuffer(indirectBuffer.name);
+  const auto &heap = getVulkanBuffer(indirectBuffer);
   VkBuffer vkBuf = heap.buffer;
 
   VkDeviceSize vkOffset = static_cast<VkDeviceSize>(offset);
@@ -3430,46 +3720,58 @@ static VkAccessFlags toVulkanAccess(AccessPattern access)
   return flags;
 }
 
-static VkPipelineStageFlagBits toVulkanStage(PipelineStage stage)
-{
-  switch (stage)
-  {
-  case PipelineStage::TOP_OF_PIPE:
-    return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-  case PipelineStage::VERTEX_INPUT:
-    return VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
-  case PipelineStage::VERTEX_SHADER:
-    return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
-    //   case PipelineStage::TESSELLATION_CONTROL_SHADER:
-    //     return VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT;
-    //   case PipelineStage::TESSELLATION_EVALUATION_SHADER:
-    //     return VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT;
-    //   case PipelineStage::GEOMETRY_SHADER:
-    //     return VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT;
-  case PipelineStage::FRAGMENT_SHADER:
-    return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    //   case PipelineStage::EARLY_FRAGMENT_TESTS:
-    //     return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    //   case PipelineStage::LATE_FRAGMENT_TESTS:
-    //     return VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    //   case PipelineStage::COLOR_ATTACHMENT_OUTPUT:
-    return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  case PipelineStage::COMPUTE_SHADER:
-    return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-  case PipelineStage::TRANSFER:
-    return VK_PIPELINE_STAGE_TRANSFER_BIT;
-  case PipelineStage::BOTTOM_OF_PIPE:
-    return VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-  case PipelineStage::ALL_GRAPHICS:
-    return VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-  case PipelineStage::ALL_COMMANDS:
-    return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-  case PipelineStage::HOST:
-    return VK_PIPELINE_STAGE_HOST_BIT;
-  default:
-    assert(false && "Invalid pipeline stage");
-    return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-  }
+static VkPipelineStageFlags toVulkanStage(PipelineStage stage)
+{
+  VkPipelineStageFlags flags = 0;
+  uint64_t bits = static_cast<uint64_t>(stage);
+
+  if (bits & static_cast<uint64_t>(PipelineStage::TOP_OF_PIPE))
+    flags |= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::DRAW_INDIRECT))
+    flags |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::VERTEX_INPUT))
+    flags |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::VERTEX_SHADER))
+    flags |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::FRAGMENT_SHADER))
+    flags |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::EARLY_FRAGMENT_TESTS))
+    flags |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::LATE_FRAGMENT_TESTS))
+    flags |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::COLOR_ATTACHMENT_OUTPUT))
+    flags |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::COMPUTE_SHADER))
+    flags |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::TRANSFER))
+    flags |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::BOTTOM_OF_PIPE))
+    flags |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::ALL_GRAPHICS))
+    flags |= VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::HOST))
+    flags |= VK_PIPELINE_STAGE_HOST_BIT;
+
+  if (bits & static_cast<uint64_t>(PipelineStage::ALL_COMMANDS))
+    flags |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+  // A barrier needs at least one stage, an empty mask waits on or blocks nothing.
+  if (flags == 0)
+    flags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  return flags;
 }
 
 static VkBufferMemoryBarrier createBufferBarrier(
@@ -3608,7 +3910,20 @@ void VulkanRHI::cleanupSubmitCallback(VulkanRHI::VulkanAsyncHandler &future)
 {
   // future.device->fences.enqueue(future.fence);
   // future.device->semaphores.enqueue(future.semaphore);
-  future.device->releaseCommandBuffer(future.commandBuffers);
+  std::vector<CommandBuffer> released;
+
+  // Persistent command buffers stay alive for their next submission, or were already released by their owner.
+  for (auto &buff : future.commandBuffers)
+  {
+    auto commandBuffer = future.device->commandBuffers.find(buff);
+
+    if (commandBuffer != future.device->commandBuffers.end() && !commandBuffer->persistent)
+    {
+      released.push_back(buff);
+    }
+  }
+
+  future.device->releaseCommandBuffer(released);
 }
 
 VulkanRHI::VulkanAsyncHandler::VulkanAsyncHandler(VulkanRHI *device, std::vector<CommandBuffer> cb, VkFence f, VkSemaphore s)
@@ -3740,6 +4055,12 @@ GPUFuture VulkanRHI::submit(Queue queueType, CommandBuffer *cmds, uint32_t count
   {
     auto cmdBuf = commandBuffers[cmds[i]];
 
+    // A persistent command buffer can not be pending twice, it was recorded without the simultaneous use flag.
+    if (cmdBuf->persistent && cmdBuf->submited)
+    {
+      vkWaitForFences(device, 1, &cmdBuf->fence, VK_TRUE, UINT64_MAX);
+    }
+
     vkCmds.push_back(cmdBuf->commandBuffer);
 
     cmdBuf->fence = fence;
@@ -3820,86 +4141,86 @@ bool VulkanRHI::isCompleted(GPUFuture &future)
 
 const Buffer VulkanRHI::createBuffer(const BufferInfo &info)
 {
-  auto buffer = allocateBuffer(info);
-  return Buffer{.name = info.name};
+  uint64_t handle = allocateBuffer(info);
+  return Buffer{.name = info.name, .handle = handle};
 }
 
 const Texture VulkanRHI::createTexture(const TextureInfo &info)
 {
-  auto texture = allocateTexture(info);
-  return Texture{.name = info.name};
+  uint64_t handle = allocateTexture(info);
+  return Texture{.name = info.name, .handle = handle};
 }
 const Sampler VulkanRHI::createSampler(const SamplerInfo &info)
 {
-  auto sampler = allocateSampler(info);
-  return Sampler{.name = info.name};
+  uint64_t handle = allocateSampler(info);
+  return Sampler{.name = info.name, .handle = handle};
 }
 
 const BindingsLayout VulkanRHI::createBindingsLayout(const BindingsLayoutInfo &info)
 {
-  auto bindings = allocateBindingsLayout(info);
-  return BindingsLayout{.name = info.name};
+  uint64_t handle = allocateBindingsLayout(info);
+  return BindingsLayout{.name = info.name, .handle = handle};
 }
 
 const BindingGroups VulkanRHI::createBindingGroups(const BindingGroupsInfo &info)
 {
-  auto vkLayout = getVulkanBindingsLayout(info.layout.name);
-  auto bindings = allocateBindings(info, vkLayout);
-  return BindingGroups{.name = info.name};
+  auto vkLayout = getVulkanBindingsLayout(info.layout);
+  uint64_t handle = allocateBindings(info, vkLayout);
+  return BindingGroups{.name = info.name, .handle = handle};
 }
 
 const GraphicsPipeline VulkanRHI::createGraphicsPipeline(const GraphicsPipelineInfo &info)
 {
-  auto pipeline = allocateGraphicsPipeline(info);
-  return GraphicsPipeline{.name = info.name};
+  uint64_t handle = allocateGraphicsPipeline(info);
+  return GraphicsPipeline{.name = info.name, .handle = handle};
 }
 
 const ComputePipeline VulkanRHI::createComputePipeline(const ComputePipelineInfo &info)
 {
-  auto pipeline = allocateComputePipeline(info);
-  return ComputePipeline{.name = info.name};
+  uint64_t handle = allocateComputePipeline(info);
+  return ComputePipeline{.name = info.name, .handle = handle};
 }
 
 void VulkanRHI::deleteBuffer(const Buffer &name)
 {
-  auto buffer = getVulkanBuffer(name.name);
-  releaseBuffer(buffer);
+  auto buffer = getVulkanBuffer(name);
+  releaseBuffer(buffer, vkBuffers.handleOf(name));
 }
 
 void VulkanRHI::deleteTexture(const Texture &name)
 {
-  auto texture = getVulkanTexture(name.name);
-  releaseTexture(texture);
+  auto texture = getVulkanTexture(name);
+  releaseTexture(texture, vkTextures.handleOf(name));
 }
 
 void VulkanRHI::deleteSampler(const Sampler &name)
 {
-  auto sampler = getVulkanSampler(name.name);
-  releaseSampler(sampler);
+  auto sampler = getVulkanSampler(name);
+  releaseSampler(sampler, vkSamplers.handleOf(name));
 }
 
 void VulkanRHI::deleteBindingsLayout(const BindingsLayout &name)
 {
-  auto layout = getVulkanBindingsLayout(name.name);
-  releaseBindingsLayout(layout);
+  auto layout = getVulkanBindingsLayout(name);
+  releaseBindingsLayout(layout, vkBindingsLayout.handleOf(name));
 }
 
 void VulkanRHI::deleteBindingGroups(const BindingGroups &name)
 {
-  auto groups = getVulkanBindingGroups(name.name);
-  releaseBindingGroup(groups);
+  auto groups = getVulkanBindingGroups(name);
+  releaseBindingGroup(groups, vkBindingsGroups.handleOf(name));
 }
 
 void VulkanRHI::deleteGraphicsPipeline(const GraphicsPipeline &name)
 {
-  auto pipeline = getVulkanGraphicsPipeline(name.name);
-  releaseGraphicsPipeline(pipeline);
+  auto pipeline = getVulkanGraphicsPipeline(name);
+  releaseGraphicsPipeline(pipeline, vkGraphicsPipeline.handleOf(name));
 }
 
 void VulkanRHI::deleteComputePipeline(const ComputePipeline &name)
 {
-  auto pipeline = getVulkanComputePipeline(name.name);
-  releaseComputePipeline(pipeline);
+  auto pipeline = getVulkanComputePipeline(name);
+  releaseComputePipeline(pipeline, vkComputePipeline.handleOf(name));
 }
 
 const Shader VulkanRHI::createShader(const ShaderInfo info)
@@ -3922,21 +4243,22 @@ const Shader VulkanRHI::createShader(const ShaderInfo info)
     throw std::runtime_error("failed to create shader module!");
   }
 
-  VulkanShader *s = new VulkanShader();
-  s->shaderModule = shaderModule;
-  s->info = info;
+  VulkanShader shader;
+  shader.shaderModule = shaderModule;
+  shader.info = info;
 
-  vkShaders.insert(info.name, s);
+  uint64_t handle = vkShaders.insert(info.name, std::move(shader));
 
   return Shader{
     .name = info.name,
+    .handle = handle,
   };
 }
 
 void VulkanRHI::deleteShader(Shader handle)
 {
-  auto vkShader = getVulkanShader(handle.name);
-  vkShaders.remove(handle.name);
+  auto vkShader = getVulkanShader(handle);
+  vkShaders.remove(vkShaders.handleOf(handle), handle.name);
   vkDestroyShaderModule(device, vkShader.shaderModule, nullptr);
 }
 
@@ -3993,14 +4315,14 @@ void VulkanRHI::cmdStartTimer(CommandBuffer handle, const Timer &timer, Pipeline
   auto cmd = commandBuffers[handle];
   auto vkTimer = vkTimers[timer.name];
   vkCmdResetQueryPool(cmd->commandBuffer, vkTimer.value()->queryPool, 0, 2);
-  vkCmdWriteTimestamp(cmd->commandBuffer, toVulkanStage(stage), vkTimer.value()->queryPool, 0);
+  vkCmdWriteTimestamp(cmd->commandBuffer, (VkPipelineStageFlagBits)toVulkanStage(stage), vkTimer.value()->queryPool, 0);
 }
 
 void VulkanRHI::cmdStopTimer(CommandBuffer handle, const Timer &timer, PipelineStage stage)
 {
   auto cmd = commandBuffers[handle];
   auto vkTimer = vkTimers[timer.name];
-  vkCmdWriteTimestamp(cmd->commandBuffer, toVulkanStage(stage), vkTimer.value()->queryPool, 1);
+  vkCmdWriteTimestamp(cmd->commandBuffer, (VkPipelineStageFlagBits)toVulkanStage(stage), vkTimer.value()->queryPool, 1);
 }
 
 double VulkanRHI::readTimer(const Timer &timer)
@@ -4199,6 +4521,21 @@ static std::string vkImageAspectFlagsToString(VkImageAspectFlags flags)
 
 #endif // VULKAN_RHI_LOGS
 
+uint32_t VulkanRHI::queueFamilyIndex(Queue queue) const
+{
+  switch (queue)
+  {
+  case Queue::Compute:
+    return indices.computeFamily;
+  case Queue::Graphics:
+    return indices.graphicsFamily;
+  case Queue::Transfer:
+    return indices.transferFamily;
+  default:
+    return VK_QUEUE_FAMILY_IGNORED;
+  }
+}
+
 // Modified barrier functions with logging
 
 void VulkanRHI::cmdBufferBarrier(
@@ -4214,41 +4551,9 @@ void VulkanRHI::cmdBufferBarrier(
     Queue dst_queue_family)
 {
   auto commandBuffer = commandBuffers[cmd];
-  auto buffer = getVulkanBuffer(b.name);
-  uint32_t queueFamilySrc = VK_QUEUE_FAMILY_IGNORED;
-  uint32_t queueFamilyDst = VK_QUEUE_FAMILY_IGNORED;
-
-  switch (src_queue_family)
-  {
-  case Queue::Compute:
-    queueFamilySrc = indices.computeFamily;
-    break;
-  case Queue::Graphics:
-    queueFamilySrc = indices.graphicsFamily;
-    break;
-  case Queue::Transfer:
-    queueFamilySrc = indices.transferFamily;
-    break;
-  default:
-    queueFamilySrc = VK_QUEUE_FAMILY_IGNORED;
-    break;
-  }
-
-  switch (dst_queue_family)
-  {
-  case Queue::Compute:
-    queueFamilyDst = indices.computeFamily;
-    break;
-  case Queue::Graphics:
-    queueFamilyDst = indices.graphicsFamily;
-    break;
-  case Queue::Transfer:
-    queueFamilyDst = indices.transferFamily;
-    break;
-  default:
-    queueFamilyDst = VK_QUEUE_FAMILY_IGNORED;
-    break;
-  }
+  const auto &buffer = getVulkanBuffer(b);
+  uint32_t queueFamilySrc = queueFamilyIndex(src_queue_family);
+  uint32_t queueFamilyDst = queueFamilyIndex(dst_queue_family);
 
   VkBufferMemoryBarrier barrier = createBufferBarrier(buffer.buffer, src_stage, dst_stage, src_access, dst_access, offset, size, queueFamilySrc, queueFamilyDst);
 
@@ -4298,42 +4603,10 @@ void VulkanRHI::cmdImageBarrier(
     Queue dst_queue_family)
 {
   auto commandBuffer = commandBuffers[cmd];
-  auto vkImage = getVulkanTexture(image.name);
+  const auto &vkImage = getVulkanTexture(image);
 
-  uint32_t queueFamilySrc = VK_QUEUE_FAMILY_IGNORED;
-  uint32_t queueFamilyDst = VK_QUEUE_FAMILY_IGNORED;
-
-  switch (src_queue_family)
-  {
-  case Queue::Compute:
-    queueFamilySrc = indices.computeFamily;
-    break;
-  case Queue::Graphics:
-    queueFamilySrc = indices.graphicsFamily;
-    break;
-  case Queue::Transfer:
-    queueFamilySrc = indices.transferFamily;
-    break;
-  default:
-    queueFamilySrc = VK_QUEUE_FAMILY_IGNORED;
-    break;
-  }
-
-  switch (dst_queue_family)
-  {
-  case Queue::Compute:
-    queueFamilyDst = indices.computeFamily;
-    break;
-  case Queue::Graphics:
-    queueFamilyDst = indices.graphicsFamily;
-    break;
-  case Queue::Transfer:
-    queueFamilyDst = indices.transferFamily;
-    break;
-  default:
-    queueFamilyDst = VK_QUEUE_FAMILY_IGNORED;
-    break;
-  }
+  uint32_t queueFamilySrc = queueFamilyIndex(src_queue_family);
+  uint32_t queueFamilyDst = queueFamilyIndex(dst_queue_family);
 
   VkImageAspectFlags vkAspectMask = imageAspectFlagsToVkImageAspectFlags(aspect_mask);
 
@@ -4392,6 +4665,93 @@ void VulkanRHI::cmdImageBarrier(
   vkCmdPipelineBarrier(commandBuffer->commandBuffer, toVulkanStage(src_stage), toVulkanStage(dst_stage), VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
+void VulkanRHI::cmdBarriers(CommandBuffer cmd, const BufferBarrierInfo *buffers, uint32_t bufferCount, const TextureBarrierInfo *textures, uint32_t textureCount)
+{
+  if (bufferCount == 0 && textureCount == 0)
+  {
+    return;
+  }
+
+  auto commandBuffer = commandBuffers[cmd];
+
+  // Command buffers of one queue can be recorded on different threads.
+  static thread_local std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  static thread_local std::vector<VkImageMemoryBarrier> imageBarriers;
+
+  bufferBarriers.clear();
+  imageBarriers.clear();
+
+  // vkCmdPipelineBarrier takes one stage pair for the whole batch, it is the union of the stages of every barrier.
+  PipelineStage srcStage = PipelineStage::NONE;
+  PipelineStage dstStage = PipelineStage::NONE;
+
+  for (uint32_t i = 0; i < bufferCount; i++)
+  {
+    const BufferBarrierInfo &info = buffers[i];
+
+    srcStage = srcStage | info.srcStage;
+    dstStage = dstStage | info.dstStage;
+
+    bufferBarriers.push_back(createBufferBarrier(
+        getVulkanBuffer(info.buffer).buffer,
+        info.srcStage,
+        info.dstStage,
+        info.srcAccess,
+        info.dstAccess,
+        info.offset,
+        info.size,
+        queueFamilyIndex(info.srcQueue),
+        queueFamilyIndex(info.dstQueue)));
+  }
+
+  for (uint32_t i = 0; i < textureCount; i++)
+  {
+    const TextureBarrierInfo &info = textures[i];
+
+    srcStage = srcStage | info.srcStage;
+    dstStage = dstStage | info.dstStage;
+
+    imageBarriers.push_back(createImageBarrier(
+        getVulkanTexture(info.texture).image,
+        info.srcStage,
+        info.dstStage,
+        info.srcAccess,
+        info.dstAccess,
+        info.oldLayout,
+        info.newLayout,
+        imageAspectFlagsToVkImageAspectFlags(info.aspect),
+        info.baseMip,
+        info.mipCount,
+        info.baseLayer,
+        info.layerCount,
+        queueFamilyIndex(info.srcQueue),
+        queueFamilyIndex(info.dstQueue)));
+  }
+
+#ifdef VULKAN_RHI_LOGS
+  os::Logger::logf(
+      "[VulkanRHI][Barrier] vkCmdPipelineBarrier buffers=%u images=%u\n"
+      "  srcStage: %s\n"
+      "  dstStage: %s",
+      bufferCount,
+      textureCount,
+      vkPipelineStageFlagsToString(toVulkanStage(srcStage)).c_str(),
+      vkPipelineStageFlagsToString(toVulkanStage(dstStage)).c_str());
+#endif
+
+  vkCmdPipelineBarrier(
+      commandBuffer->commandBuffer,
+      toVulkanStage(srcStage),
+      toVulkanStage(dstStage),
+      VK_DEPENDENCY_BY_REGION_BIT,
+      0,
+      nullptr,
+      bufferBarriers.size(),
+      bufferBarriers.data(),
+      imageBarriers.size(),
+      imageBarriers.data());
+}
+
 void VulkanRHI::cmdMemoryBarrier(CommandBuffer cmd, PipelineStage src_stage, PipelineStage dst_stage, AccessPattern src_access, AccessPattern dst_access)
 {
   auto commandBuffer = commandBuffers[cmd];
@@ -1,4 +1,6 @@
+#include "datastructure/ConcurrentBoundedCache.hpp"
 #include "datastructure/ConcurrentHashMap.hpp"
+#include "datastructure/ConcurrentSlotMap.hpp"
 #include "rendering/gpu/EventLoop.hpp"
 #include "rendering/gpu/RenderGraph.hpp"
 #include <vector>
@@ -61,10 +63,12 @@ struct VulkanTextureView
   VulkanTextureViewRender renderData;
 };
 
+// Objects that come from a VulkanRHI cache keep the key they were acquired with, so they can be released.
 struct VulkanSampler
 {
   VkSampler sampler = VK_NULL_HANDLE;
   SamplerInfo info;
+  std::string cacheKey;
 };
 
 struct VulkanBindingsLayout
@@ -87,6 +91,7 @@ struct VulkanBindingGroups
 {
   BindingGroupsInfo info;
   std::vector<VulkanBindingGroup> groups;
+  std::string cacheKey;
 };
 
 struct VulkanSurface
@@ -151,6 +156,7 @@ struct VulkanGraphicsPipeline
   VkRenderPass renderPass;
   BindingsLayout layout;
   GraphicsPipelineInfo info;
+  std::string cacheKey;
 };
 
 struct VulkanComputePipeline
@@ -158,6 +164,7 @@ struct VulkanComputePipeline
   VkPipeline pipeline;
   BindingsLayout layout;
   ComputePipelineInfo info;
+  std::string cacheKey;
 };
 
 struct VulkanAttatchment
@@ -193,6 +200,8 @@ struct VulkanCommandBuffer
   GraphicsPipeline boundGraphicsPipeline;
   ComputePipeline boundComputePipeline;
   std::vector<VulkanCommandBufferRenderPass> renderPasses;
+  // Kept alive after its submissions complete, see RHI::allocatePersistentCommandBuffers.
+  bool persistent = false;
 };
 
 struct VulkanTimer
@@ -201,6 +210,64 @@ struct VulkanTimer
   VkQueryPool queryPool;
 };
 
+// Backend objects are stored in place in a generational slot map, so a resource handle resolves to its object
+// with a single indexed load. Names only map to handles for resources that are still referenced by name, a handle
+// that carries a slot is never resolved by name, so a stale handle cannot reach an object recreated under its name.
+template <typename T> struct VulkanObjectTable
+{
+  lib::ConcurrentSlotMap<T> objects;
+  lib::ConcurrentHashMap<std::string, uint64_t> handles;
+
+  uint64_t insert(const std::string &name, T &&object)
+  {
+    uint64_t handle = objects.insert(std::move(object));
+    handles.insert(name, handle);
+    return handle;
+  }
+
+  uint64_t handle(const std::string &name)
+  {
+    auto it = handles.find(name);
+    return it == handles.end() ? lib::ConcurrentSlotMap<T>::NULL_HANDLE : it.value();
+  }
+
+  // Slot of a resource handle, only handles built from a name alone are looked up by name.
+  template <typename Handle> uint64_t handleOf(const Handle &resource)
+  {
+    return resource.handle != lib::ConcurrentSlotMap<T>::NULL_HANDLE ? resource.handle : handle(resource.name);
+  }
+
+  T *find(const std::string &name)
+  {
+    return objects.get(handle(name));
+  }
+
+  // nullptr when handle is stale, callers holding only a name resolve it with find(name).
+  T *find(uint64_t handle, const std::string &name)
+  {
+    return handle != lib::ConcurrentSlotMap<T>::NULL_HANDLE ? objects.get(handle) : find(name);
+  }
+
+  // Erases the slot of handle. The name is unmapped only while it still refers to that slot, not when it was taken
+  // by a newer object.
+  bool remove(uint64_t handle, const std::string &name)
+  {
+    if (!objects.erase(handle))
+    {
+      return false;
+    }
+
+    auto it = handles.find(name);
+
+    if (it != handles.end() && it.value() == handle)
+    {
+      handles.remove(name);
+    }
+
+    return true;
+  }
+};
+
 class VulkanRHI : public RHI
 {
 private:
@@ -274,14 +341,21 @@ private:
   VulkanQueueFamilyIndices findQueueFamilyIndices();
 
   lib::ConcurrentHashMap<std::string, VulkanTimer *> vkTimers;
-  lib::ConcurrentHashMap<std::string, VulkanBuffer *> vkBuffers;
-  lib::ConcurrentHashMap<std::string, VulkanTexture *> vkTextures;
-  lib::ConcurrentHashMap<std::string, VulkanSampler *> vkSamplers;
-  lib::ConcurrentHashMap<std::string, VulkanShader *> vkShaders;
-  lib::ConcurrentHashMap<std::string, VulkanBindingsLayout *> vkBindingsLayout;
-  lib::ConcurrentHashMap<std::string, VulkanBindingGroups *> vkBindingsGroups;
-  lib::ConcurrentHashMap<std::string, VulkanGraphicsPipeline *> vkGraphicsPipeline;
-  lib::ConcurrentHashMap<std::string, VulkanComputePipeline *> vkComputePipeline;
+  VulkanObjectTable<VulkanBuffer> vkBuffers;
+  VulkanObjectTable<VulkanTexture> vkTextures;
+  VulkanObjectTable<VulkanSampler> vkSamplers;
+  VulkanObjectTable<VulkanShader> vkShaders;
+  VulkanObjectTable<VulkanBindingsLayout> vkBindingsLayout;
+  VulkanObjectTable<VulkanBindingGroups> vkBindingsGroups;
+  VulkanObjectTable<VulkanGraphicsPipeline> vkGraphicsPipeline;
+  VulkanObjectTable<VulkanComputePipeline> vkComputePipeline;
+
+  // Backend objects keyed by the content of their description, resources created from identical descriptions share
+  // them. Objects stay cached after the last resource using them is deleted and are destroyed when evicted.
+  lib::ConcurrentBoundedCache<std::string, VkSampler> samplerCache;
+  lib::ConcurrentBoundedCache<std::string, std::vector<VulkanBindingGroup>> bindingGroupsCache;
+  lib::ConcurrentBoundedCache<std::string, std::pair<VkPipeline, VkRenderPass>> graphicsPipelineCache;
+  lib::ConcurrentBoundedCache<std::string, VkPipeline> computePipelineCache;
 
   lib::ConcurrentShardedQueue<VulkanCommandPool> graphicsCommandPool;
   lib::ConcurrentShardedQueue<VulkanCommandPool> transferCommandPool;
@@ -291,35 +365,39 @@ private:
   void processPresentations(CommandBuffer *cmds, uint32_t count, const std::vector<VkSemaphore> &signalSemaphores);
 
 protected:
-  VulkanBuffer &allocateBuffer(const BufferInfo &info);
-  void releaseBuffer(VulkanBuffer &buf);
+  uint64_t allocateBuffer(const BufferInfo &info);
+  void releaseBuffer(VulkanBuffer &buf, uint64_t handle);
 
-  VulkanTexture &allocateTexture(const TextureInfo &info);
-  void releaseTexture(VulkanTexture &tex);
+  uint64_t allocateTexture(const TextureInfo &info);
+  void releaseTexture(VulkanTexture &tex, uint64_t handle);
 
-  VulkanSampler &allocateSampler(const SamplerInfo &info);
-  void releaseSampler(VulkanSampler &sampler);
+  uint64_t allocateSampler(const SamplerInfo &info);
+  void releaseSampler(VulkanSampler &sampler, uint64_t handle);
 
-  VulkanBindingsLayout &allocateBindingsLayout(const BindingsLayoutInfo &info);
-  void releaseBindingsLayout(VulkanBindingsLayout &layout);
+  uint64_t allocateBindingsLayout(const BindingsLayoutInfo &info);
+  void releaseBindingsLayout(VulkanBindingsLayout &layout, uint64_t handle);
 
-  VulkanBindingGroups &allocateBindings(const BindingGroupsInfo &groups, const VulkanBindingsLayout &layout);
-  void releaseBindingGroup(VulkanBindingGroups &group);
+  uint64_t allocateBindings(const BindingGroupsInfo &groups, const VulkanBindingsLayout &layout);
+  void releaseBindingGroup(VulkanBindingGroups &group, uint64_t handle);
 
-  VulkanGraphicsPipeline &allocateGraphicsPipeline(const GraphicsPipelineInfo &info);
-  void releaseGraphicsPipeline(VulkanGraphicsPipeline &pipeline);
+  uint64_t allocateGraphicsPipeline(const GraphicsPipelineInfo &info);
+  void releaseGraphicsPipeline(VulkanGraphicsPipeline &pipeline, uint64_t handle);
 
-  VulkanComputePipeline &allocateComputePipeline(const ComputePipelineInfo &info);
-  void releaseComputePipeline(VulkanComputePipeline &pipeline);
+  uint64_t allocateComputePipeline(const ComputePipelineInfo &info);
+  void releaseComputePipeline(VulkanComputePipeline &pipeline, uint64_t handle);
 
   VulkanTextureView createTextureView(const TextureView &view);
   void destroyTextureView(VulkanTextureView view);
 
   VulkanCommandPool allocateCommandPool(uint32_t queueFamilyIndex);
+  // Takes a released pool of the queue's family or creates one, the pool goes back when its command buffer is released.
+  VulkanCommandPool acquireCommandPool(Queue queue);
   void releaseCommandPool(VulkanCommandPool &pool);
 
   std::vector<CommandBuffer> allocateCommandBuffers(Queue queue, uint32_t count) override;
   void releaseCommandBuffer(std::vector<CommandBuffer> &buffers) override;
+  std::vector<CommandBuffer> allocatePersistentCommandBuffers(Queue queue, uint32_t count) override;
+  void resetCommandBuffer(CommandBuffer) override;
 
   const VulkanShader &getVulkanShader(const std::string &obj);
   const VulkanTexture &getVulkanTexture(const std::string &obj);
@@ -330,12 +408,24 @@ protected:
   const VulkanGraphicsPipeline &getVulkanGraphicsPipeline(const std::string &obj);
   const VulkanComputePipeline &getVulkanComputePipeline(const std::string &obj);
 
+  const VulkanShader &getVulkanShader(const Shader &obj);
+  const VulkanTexture &getVulkanTexture(const Texture &obj);
+  const VulkanSampler &getVulkanSampler(const Sampler &obj);
+  const VulkanBuffer &getVulkanBuffer(const Buffer &obj);
+  const VulkanBindingsLayout &getVulkanBindingsLayout(const BindingsLayout &obj);
+  const VulkanBindingGroups &getVulkanBindingGroups(const BindingGroups &obj);
+  const VulkanGraphicsPipeline &getVulkanGraphicsPipeline(const GraphicsPipeline &obj);
+  const VulkanComputePipeline &getVulkanComputePipeline(const ComputePipeline &obj);
+
+  // Family of a queue for ownership transfers, VK_QUEUE_FAMILY_IGNORED when the queue is None.
+  uint32_t queueFamilyIndex(Queue queue) const;
+
   void beginCommandBuffer(CommandBuffer) override;
   void endCommandBuffer(CommandBuffer) override;
   void cmdCopyBuffer(CommandBuffer cmdBuffer, Buffer src, Buffer dst, uint32_t srcOffset, uint32_t dstOffset, uint32_t size) override;
   void cmdBeginRenderPass(CommandBuffer, const RenderPassInfo &) override;
   void cmdEndRenderPass(CommandBuffer) override;
-  void cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount) override;
+  void cmdBindBindingGroups(CommandBuffer cmdBuffer, BindingGroups groups, const uint32_t *dynamicOffsets, uint32_t dynamicOffsetsCount) override;
   void cmdBindGraphicsPipeline(CommandBuffer, GraphicsPipeline) override;
   void cmdBindComputePipeline(CommandBuffer, ComputePipeline) override;
   void cmdBindVertexBuffer(CommandBuffer, uint32_t slot, Buffer, uint64_t offset) override;
@@ -382,6 +472,7 @@ protected:
       Queue src_queue_family,
       Queue dst_queue_family) override;
 
+  void cmdBarriers(CommandBuffer cmd, const BufferBarrierInfo *buffers, uint32_t bufferCount, const TextureBarrierInfo *textures, uint32_t textureCount) override;
   void cmdMemoryBarrier(CommandBuffer cmd, PipelineStage src_stage, PipelineStage dst_stage, AccessPattern src_access, AccessPattern dst_access) override;
   void cmdPipelineBarrier(CommandBuffer cmd, PipelineStage src_stage, PipelineStage dst_stage, AccessPattern src_access, AccessPattern dst_access) override;
 
@@ -0,0 +1,823 @@
+#include "datastructure/ConcurrentHashMap.hpp"
+#include "datastructure/ConcurrentPriorityQueue.hpp"
+#include "datastructure/ConcurrentQueue.hpp"
+#include "datastructure/ConcurrentSkipListMap.hpp"
+#include "datastructure/ConcurrentStack.hpp"
+#include "datastructure/ThreadLocalStorage.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <stack>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Scaling benchmarks for the concurrent containers against std containers behind a std::mutex.
+//
+// Usage: DatastructureBenchmarks [--threads 1,2,4] [--operations n] [--keys n] [--reads percent] [--pops percent]
+//                                [--distribution uniform|zipf] [--zipf theta] [--no-pin] [--containers a,b]
+//                                [--output file.json] [--quick]
+//
+// Maps and thread local storage run reads% lookups and split the rest between inserts and removes, queues and stacks
+// run pops% pops and pushes otherwise, priority queues push then pop in two phases. Results are written as JSON, to stdout when no output file is given.
+
+struct Config
+{
+  std::vector<size_t> threads;
+  size_t operations = 100000;
+  size_t keys = 1 << 16;
+  uint32_t reads = 90;
+  uint32_t pops = 50;
+  bool zipf = false;
+  double theta = 0.99;
+  bool pin = true;
+  std::vector<std::string> containers;
+  const char *output = nullptr;
+};
+
+struct Result
+{
+  std::string container;
+  bool baseline;
+  size_t threads;
+  size_t operations;
+  double seconds;
+};
+
+struct Random
+{
+  uint64_t state;
+
+  Random(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1)
+  {
+  }
+
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+
+  double uniform()
+  {
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+};
+
+// Keys in [0, keys), either uniform or zipf distributed by rank through a shared cumulative table.
+class KeyGenerator
+{
+public:
+  KeyGenerator(const Config &config) : keys(config.keys)
+  {
+    if (!config.zipf)
+    {
+      return;
+    }
+
+    cdf.resize(keys);
+
+    double sum = 0;
+
+    for (size_t i = 0; i < keys; i++)
+    {
+      sum += 1.0 / std::pow((double)(i + 1), config.theta);
+      cdf[i] = sum;
+    }
+
+    for (size_t i = 0; i < keys; i++)
+    {
+      cdf[i] /= sum;
+    }
+  }
+
+  uint64_t next(Random &random) const
+  {
+    if (cdf.empty())
+    {
+      return random.next() % keys;
+    }
+
+    return std::lower_bound(cdf.begin(), cdf.end(), random.uniform()) - cdf.begin();
+  }
+
+private:
+  size_t keys;
+  std::vector<double> cdf;
+};
+
+struct SkipListMapAdapter
+{
+  static constexpr const char *name = "ConcurrentSkipListMap";
+  static constexpr bool baseline = false;
+  lib::ConcurrentSkipListMap<uint64_t, uint64_t> map;
+
+  void insert(uint64_t key)
+  {
+    map.insert(key, key);
+  }
+
+  bool find(uint64_t key)
+  {
+    return map.find(key) != map.end();
+  }
+
+  void remove(uint64_t key)
+  {
+    map.remove(key);
+  }
+};
+
+struct HashMapAdapter
+{
+  static constexpr const char *name = "ConcurrentHashMap";
+  static constexpr bool baseline = false;
+  lib::ConcurrentHashMap<uint64_t, uint64_t> map;
+
+  void insert(uint64_t key)
+  {
+    map.insert(key, key);
+  }
+
+  bool find(uint64_t key)
+  {
+    return map.find(key) != map.end();
+  }
+
+  void remove(uint64_t key)
+  {
+    map.remove(key);
+  }
+};
+
+template <typename Map> struct LockedMapAdapter
+{
+  std::mutex lock;
+  Map map;
+
+  void insert(uint64_t key)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    map.emplace(key, key);
+  }
+
+  bool find(uint64_t key)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return map.find(key) != map.end();
+  }
+
+  void remove(uint64_t key)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    map.erase(key);
+  }
+};
+
+struct LockedOrderedMapAdapter : LockedMapAdapter<std::map<uint64_t, uint64_t>>
+{
+  static constexpr const char *name = "std::map";
+  static constexpr bool baseline = true;
+};
+
+struct LockedUnorderedMapAdapter : LockedMapAdapter<std::unordered_map<uint64_t, uint64_t>>
+{
+  static constexpr const char *name = "std::unordered_map";
+  static constexpr bool baseline = true;
+};
+
+struct QueueAdapter
+{
+  static constexpr const char *name = "ConcurrentQueue";
+  static constexpr bool baseline = false;
+  lib::ConcurrentQueue<uint64_t> queue;
+
+  void push(uint64_t value)
+  {
+    queue.enqueue(value);
+  }
+
+  bool pop(uint64_t &value)
+  {
+    return queue.dequeue(value);
+  }
+};
+
+struct StackAdapter
+{
+  static constexpr const char *name = "ConcurrentStack";
+  static constexpr bool baseline = false;
+  lib::ConcurrentStack<uint64_t> stack;
+
+  void push(uint64_t value)
+  {
+    stack.push(value);
+  }
+
+  bool pop(uint64_t &value)
+  {
+    return stack.pop(value);
+  }
+};
+
+struct PriorityQueueAdapter
+{
+  static constexpr const char *name = "ConcurrentPriorityQueue";
+  static constexpr bool baseline = false;
+  lib::ConcurrentPriorityQueue<uint64_t, size_t> queue;
+
+  static std::atomic<uint64_t> threads;
+
+  // Priorities must be unique and non zero, every thread counts its own in a slot of the low bits.
+  void push(uint64_t value)
+  {
+    static thread_local uint64_t slot = threads.fetch_add(1);
+    static thread_local uint64_t sequence = 0;
+
+    queue.enqueue(value, ((++sequence) << 16) | (slot & 0xffff));
+  }
+
+  bool pop(uint64_t &value)
+  {
+    return queue.dequeue(value);
+  }
+};
+
+std::atomic<uint64_t> PriorityQueueAdapter::threads(0);
+
+struct LockedQueueAdapter
+{
+  static constexpr const char *name = "std::queue";
+  static constexpr bool baseline = true;
+  std::mutex lock;
+  std::queue<uint64_t> queue;
+
+  void push(uint64_t value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    queue.push(value);
+  }
+
+  bool pop(uint64_t &value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (queue.empty())
+    {
+      return false;
+    }
+
+    value = queue.front();
+    queue.pop();
+    return true;
+  }
+};
+
+struct LockedStackAdapter
+{
+  static constexpr const char *name = "std::stack";
+  static constexpr bool baseline = true;
+  std::mutex lock;
+  std::stack<uint64_t> stack;
+
+  void push(uint64_t value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stack.push(value);
+  }
+
+  bool pop(uint64_t &value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (stack.empty())
+    {
+      return false;
+    }
+
+    value = stack.top();
+    stack.pop();
+    return true;
+  }
+};
+
+struct LockedPriorityQueueAdapter
+{
+  static constexpr const char *name = "std::priority_queue";
+  static constexpr bool baseline = true;
+  std::mutex lock;
+  std::priority_queue<uint64_t> queue;
+
+  void push(uint64_t value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    queue.push(value);
+  }
+
+  bool pop(uint64_t &value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (queue.empty())
+    {
+      return false;
+    }
+
+    value = queue.top();
+    queue.pop();
+    return true;
+  }
+};
+
+struct ThreadLocalStorageAdapter
+{
+  static constexpr const char *name = "ThreadLocalStorage";
+  static constexpr bool baseline = false;
+  lib::ThreadLocalStorage<uint64_t> storage;
+
+  void set(uint64_t value)
+  {
+    storage.set(value);
+  }
+
+  bool get(uint64_t &value)
+  {
+    return storage.get(value);
+  }
+};
+
+struct LockedThreadLocalStorageAdapter
+{
+  static constexpr const char *name = "std::unordered_map<std::thread::id>";
+  static constexpr bool baseline = true;
+  std::mutex lock;
+  std::unordered_map<std::thread::id, uint64_t> storage;
+
+  void set(uint64_t value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    storage[std::this_thread::get_id()] = value;
+  }
+
+  bool get(uint64_t &value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = storage.find(std::this_thread::get_id());
+
+    if (it == storage.end())
+    {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+};
+
+// Runs body(thread, random) on every thread after a common start and returns the slowest thread's time.
+template <typename Body> double runThreads(const Config &config, size_t totalThreads, Body body)
+{
+  std::vector<os::Thread> threads(totalThreads);
+  std::vector<double> seconds(totalThreads, 0.0);
+
+  std::atomic<size_t> ready(0);
+  std::atomic<bool> start(false);
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          Random random(i + 1);
+
+          ready.fetch_add(1);
+          while (!start.load())
+          {
+          }
+
+          lib::time::TimeSpan then = lib::time::TimeSpan::now();
+          body(i, random);
+          seconds[i] = (lib::time::TimeSpan::now() - then).seconds();
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+
+    if (config.pin)
+    {
+      threads[i].setAffinity(i % os::Thread::getHardwareConcurrency());
+    }
+  }
+
+  while (ready.load() != totalThreads)
+  {
+  }
+
+  start.store(true);
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  return *std::max_element(seconds.begin(), seconds.end());
+}
+
+template <typename Adapter> Result benchmarkMap(const Config &config, const KeyGenerator &keys, size_t totalThreads)
+{
+  Adapter *adapter = new Adapter();
+
+  for (size_t key = 0; key < config.keys; key += 2)
+  {
+    adapter->insert(key);
+  }
+
+  double seconds = runThreads(
+      config, totalThreads,
+      [&](size_t, Random &random)
+      {
+        for (size_t i = 0; i < config.operations; i++)
+        {
+          uint64_t key = keys.next(random);
+          uint64_t roll = random.next();
+
+          if (roll % 100 < config.reads)
+          {
+            adapter->find(key);
+          }
+          else if ((roll >> 32) & 1)
+          {
+            adapter->insert(key);
+          }
+          else
+          {
+            adapter->remove(key);
+          }
+        }
+      });
+
+  delete adapter;
+
+  return Result{Adapter::name, Adapter::baseline, totalThreads, config.operations * totalThreads, seconds};
+}
+
+template <typename Adapter> Result benchmarkQueue(const Config &config, const KeyGenerator &keys, size_t totalThreads)
+{
+  Adapter *adapter = new Adapter();
+  Random random(0);
+
+  // Keeps pops from mostly hitting an empty container.
+  for (size_t i = 0; i < config.keys / 2; i++)
+  {
+    adapter->push(keys.next(random));
+  }
+
+  double seconds = runThreads(
+      config, totalThreads,
+      [&](size_t, Random &random)
+      {
+        uint64_t value;
+
+        for (size_t i = 0; i < config.operations; i++)
+        {
+          if (random.next() % 100 < config.pops)
+          {
+            adapter->pop(value);
+          }
+          else
+          {
+            adapter->push(keys.next(random));
+          }
+        }
+      });
+
+  uint64_t value;
+
+  while (adapter->pop(value))
+  {
+  }
+
+  delete adapter;
+
+  return Result{Adapter::name, Adapter::baseline, totalThreads, config.operations * totalThreads, seconds};
+}
+
+// ConcurrentPriorityQueue does not support pops interleaved with pushes, every thread pushes half of its operations
+// and pops them back once all threads are done pushing. The mutex baseline runs the same phases.
+template <typename Adapter> Result benchmarkPhasedQueue(const Config &config, const KeyGenerator &keys, size_t totalThreads)
+{
+  Adapter *adapter = new Adapter();
+  std::atomic<size_t> pushed(0);
+
+  double seconds = runThreads(
+      config, totalThreads,
+      [&](size_t, Random &random)
+      {
+        uint64_t value;
+
+        for (size_t i = 0; i < config.operations / 2; i++)
+        {
+          adapter->push(keys.next(random));
+        }
+
+        pushed.fetch_add(1);
+        while (pushed.load() != totalThreads)
+        {
+        }
+
+        for (size_t i = 0; i < config.operations / 2; i++)
+        {
+          adapter->pop(value);
+        }
+      });
+
+  delete adapter;
+
+  return Result{Adapter::name, Adapter::baseline, totalThreads, config.operations / 2 * 2 * totalThreads, seconds};
+}
+
+template <typename Adapter> Result benchmarkThreadLocalStorage(const Config &config, const KeyGenerator &keys, size_t totalThreads)
+{
+  Adapter *adapter = new Adapter();
+
+  double seconds = runThreads(
+      config, totalThreads,
+      [&](size_t, Random &random)
+      {
+        uint64_t value;
+
+        for (size_t i = 0; i < config.operations; i++)
+        {
+          if (random.next() % 100 < config.reads)
+          {
+            adapter->get(value);
+          }
+          else
+          {
+            adapter->set(keys.next(random));
+          }
+        }
+      });
+
+  delete adapter;
+
+  return Result{Adapter::name, Adapter::baseline, totalThreads, config.operations * totalThreads, seconds};
+}
+
+std::vector<size_t> parseList(const char *list)
+{
+  std::vector<size_t> values;
+
+  for (const char *curr = list; *curr;)
+  {
+    values.push_back(strtoull(curr, const_cast<char **>(&curr), 10));
+
+    if (*curr == ',')
+    {
+      curr++;
+    }
+    else if (*curr)
+    {
+      os::print("Invalid list '%s'\n", list);
+      exit(1);
+    }
+  }
+
+  return values;
+}
+
+std::vector<std::string> parseNames(const char *list)
+{
+  std::vector<std::string> names;
+  std::string curr;
+
+  for (const char *c = list;; c++)
+  {
+    if (*c == ',' || *c == '\0')
+    {
+      names.push_back(curr);
+      curr.clear();
+
+      if (*c == '\0')
+      {
+        break;
+      }
+    }
+    else
+    {
+      curr += *c;
+    }
+  }
+
+  return names;
+}
+
+Config parseArguments(int argc, char **argv)
+{
+  Config config;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (strcmp(arg, "--quick") == 0)
+    {
+      config.threads = {1, 2};
+      config.operations = 2000;
+      config.keys = 1024;
+    }
+    else if (strcmp(arg, "--no-pin") == 0)
+    {
+      config.pin = false;
+    }
+    else if (value == nullptr)
+    {
+      os::print("Missing value for %s\n", arg);
+      exit(1);
+    }
+    else if (strcmp(arg, "--threads") == 0)
+    {
+      config.threads = parseList(value);
+      i++;
+    }
+    else if (strcmp(arg, "--operations") == 0)
+    {
+      config.operations = strtoull(value, nullptr, 10);
+      i++;
+    }
+    else if (strcmp(arg, "--keys") == 0)
+    {
+      config.keys = std::max<size_t>(1, strtoull(value, nullptr, 10));
+      i++;
+    }
+    else if (strcmp(arg, "--reads") == 0)
+    {
+      config.reads = std::min(100, atoi(value));
+      i++;
+    }
+    else if (strcmp(arg, "--pops") == 0)
+    {
+      config.pops = std::min(100, atoi(value));
+      i++;
+    }
+    else if (strcmp(arg, "--distribution") == 0)
+    {
+      config.zipf = strcmp(value, "zipf") == 0;
+      i++;
+    }
+    else if (strcmp(arg, "--zipf") == 0)
+    {
+      config.zipf = true;
+      config.theta = atof(value);
+      i++;
+    }
+    else if (strcmp(arg, "--containers") == 0)
+    {
+      config.containers = parseNames(value);
+      i++;
+    }
+    else if (strcmp(arg, "--output") == 0)
+    {
+      config.output = value;
+      i++;
+    }
+    else
+    {
+      os::print("Unknown argument %s\n", arg);
+      exit(1);
+    }
+  }
+
+  if (config.threads.empty())
+  {
+    for (size_t threads = 1; threads < os::Thread::getHardwareConcurrency(); threads *= 2)
+    {
+      config.threads.push_back(threads);
+    }
+
+    config.threads.push_back(os::Thread::getHardwareConcurrency());
+  }
+
+  return config;
+}
+
+void writeJson(FILE *file, const Config &config, const std::vector<Result> &results)
+{
+  fprintf(file, "{\n  \"config\": {\"operationsPerThread\": %zu, \"keys\": %zu, \"reads\": %u, \"pops\": %u, ", config.operations, config.keys, config.reads, config.pops);
+  fprintf(file, "\"distribution\": \"%s\", \"theta\": %g, \"pinned\": %s, \"memoryBackend\": \"%s\"},\n", config.zipf ? "zipf" : "uniform", config.theta,
+          config.pin ? "true" : "false", lib::memory::SystemMemoryManager::backend());
+  fprintf(file, "  \"results\": [\n");
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result &result = results[i];
+
+    fprintf(file, "    {\"container\": \"%s\", \"baseline\": %s, \"threads\": %zu, \"operations\": %zu, \"seconds\": %.9f, \"mops\": %.3f, \"nsPerOperation\": %.3f}%s\n",
+            result.container.c_str(), result.baseline ? "true" : "false", result.threads, result.operations, result.seconds, result.operations / result.seconds / 1e6,
+            result.seconds * 1e9 * result.threads / result.operations, i + 1 == results.size() ? "" : ",");
+  }
+
+  fprintf(file, "  ]\n}\n");
+}
+
+bool selected(const Config &config, const char *group)
+{
+  return config.containers.empty() || std::find(config.containers.begin(), config.containers.end(), group) != config.containers.end();
+}
+
+int main(int argc, char **argv)
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  Config config = parseArguments(argc, argv);
+  KeyGenerator keys(config);
+
+  std::vector<Result> results;
+
+  for (size_t threads : config.threads)
+  {
+    if (selected(config, "skiplist"))
+    {
+      results.push_back(benchmarkMap<SkipListMapAdapter>(config, keys, threads));
+      results.push_back(benchmarkMap<LockedOrderedMapAdapter>(config, keys, threads));
+    }
+
+    if (selected(config, "hashmap"))
+    {
+      results.push_back(benchmarkMap<HashMapAdapter>(config, keys, threads));
+      results.push_back(benchmarkMap<LockedUnorderedMapAdapter>(config, keys, threads));
+    }
+
+    if (selected(config, "queue"))
+    {
+      results.push_back(benchmarkQueue<QueueAdapter>(config, keys, threads));
+      results.push_back(benchmarkQueue<LockedQueueAdapter>(config, keys, threads));
+    }
+
+    if (selected(config, "stack"))
+    {
+      results.push_back(benchmarkQueue<StackAdapter>(config, keys, threads));
+      results.push_back(benchmarkQueue<LockedStackAdapter>(config, keys, threads));
+    }
+
+    if (selected(config, "priorityqueue"))
+    {
+      results.push_back(benchmarkPhasedQueue<PriorityQueueAdapter>(config, keys, threads));
+      results.push_back(benchmarkPhasedQueue<LockedPriorityQueueAdapter>(config, keys, threads));
+    }
+
+    if (selected(config, "tls"))
+    {
+      results.push_back(benchmarkThreadLocalStorage<ThreadLocalStorageAdapter>(config, keys, threads));
+      results.push_back(benchmarkThreadLocalStorage<LockedThreadLocalStorageAdapter>(config, keys, threads));
+    }
+  }
+
+  if (config.output)
+  {
+    FILE *file = fopen(config.output, "w");
+
+    if (file == nullptr)
+    {
+      os::print("Could not open %s\n", config.output);
+      return 1;
+    }
+
+    writeJson(file, config, results);
+    fclose(file);
+
+    for (const Result &result : results)
+    {
+      os::print("%-40s %3zu threads %10.3f Mops/s\n", result.container.c_str(), result.threads, result.operations / result.seconds / 1e6);
+    }
+  }
+  else
+  {
+    writeJson(stdout, config, results);
+  }
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
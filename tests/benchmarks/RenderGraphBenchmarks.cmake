@@ -0,0 +1,9 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (RenderGraphBenchmarks)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(RenderGraphBenchmarks ${TEST_DIR}/RenderGraphBenchmarks.cpp)
+target_link_libraries(RenderGraphBenchmarks PRIVATE Engine)
+# Only checks that serial and parallel compiles agree, real numbers come from running it by hand on a quiet release build.
+add_test(NAME RenderGraphBenchmarks COMMAND RenderGraphBenchmarks --quick)
@@ -0,0 +1,811 @@
+#include "async/async.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Logger.hpp"
+#include "os/Thread.hpp"
+#include "rendering/gpu/RHI.hpp"
+#include "rendering/gpu/RenderGraph.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Compile time of synthetic render graphs, serial against the job system.
+//
+// Usage: RenderGraphBenchmarks [--passes 1000,10000,100000] [--threads n] [--quick]
+//
+// Every graph mixes copies, compute dispatches and render passes over sub-ranges of shared buffers and single mips of
+// shared textures, spread across the transfer, compute and graphics queues. Each graph is compiled and run once on the
+// calling thread, once from a job and once from a thread outside the job system while it runs, the commands every run
+// hands to the backend must be identical.
+
+using namespace rendering;
+
+struct Config
+{
+  std::vector<size_t> passes = {1000, 10000, 100000};
+  size_t threads = os::Thread::getHardwareConcurrency();
+};
+
+struct Result
+{
+  size_t passes;
+  double serialMs;
+  double parallelMs;
+  std::vector<uint64_t> serialHashes;
+  std::vector<uint64_t> parallelHashes;
+  std::vector<uint64_t> threadHashes;
+};
+
+struct Random
+{
+  uint64_t state;
+
+  Random(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1)
+  {
+  }
+
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+};
+
+struct NullFuture
+{
+  bool isValid() const
+  {
+    return true;
+  }
+
+  FenceStatus checkStatus() const
+  {
+    return FenceStatus();
+  }
+};
+
+// Backend that records nothing, every command folds its arguments into a hash of the command buffer it goes to.
+class NullRHI : public RHI
+{
+  uint64_t handles = 1;
+
+  void fold(CommandBuffer commandBuffer, uint64_t value)
+  {
+    uint64_t &hash = hashes[(uint64_t)commandBuffer];
+    hash = (hash ^ value) * 0x100000001b3ull;
+  }
+
+public:
+  // Indexed by command buffer, each one is only written by the job recording it.
+  std::vector<uint64_t> hashes;
+  // Returned by every submit, so that submitting does not allocate.
+  const GPUFuture completed = GPUFuture(NullFuture{});
+
+  void bufferRead(const Buffer &, const uint64_t, const uint64_t, std::function<void(const void *)>) override
+  {
+  }
+
+  void bufferWrite(const Buffer &, const uint64_t, const uint64_t, void *) override
+  {
+  }
+
+  const SwapChain createSwapChain(uint32_t, uint32_t, uint32_t) override
+  {
+    return SwapChain(0);
+  }
+
+  void destroySwapChain(SwapChain) override
+  {
+  }
+
+  Format getSwapChainFormat(SwapChain) override
+  {
+    return Format_RGBA8Uint;
+  }
+
+  const uint32_t getSwapChainImagesCount(SwapChain) override
+  {
+    return 0;
+  }
+
+  const uint32_t getSwapChainImagesWidth(SwapChain) override
+  {
+    return 0;
+  }
+
+  const uint32_t getSwapChainImagesHeight(SwapChain) override
+  {
+    return 0;
+  }
+
+  const TextureView getCurrentSwapChainTextureView(SwapChain, uint32_t) override
+  {
+    return TextureView();
+  }
+
+  std::vector<CommandBuffer> allocateCommandBuffers(Queue, uint32_t count) override
+  {
+    std::vector<CommandBuffer> buffers;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      buffers.push_back((CommandBuffer)hashes.size());
+      hashes.push_back(0xcbf29ce484222325ull);
+    }
+
+    return buffers;
+  }
+
+  void releaseCommandBuffer(std::vector<CommandBuffer> &) override
+  {
+  }
+
+  std::vector<CommandBuffer> allocatePersistentCommandBuffers(Queue queue, uint32_t count) override
+  {
+    return allocateCommandBuffers(queue, count);
+  }
+
+  void resetCommandBuffer(CommandBuffer commandBuffer) override
+  {
+    hashes[(uint64_t)commandBuffer] = 0xcbf29ce484222325ull;
+  }
+
+  void beginCommandBuffer(CommandBuffer) override
+  {
+  }
+
+  void endCommandBuffer(CommandBuffer) override
+  {
+  }
+
+  void cmdCopyBuffer(CommandBuffer commandBuffer, Buffer src, Buffer dst, uint32_t srcOffset, uint32_t dstOffset, uint32_t size) override
+  {
+    fold(commandBuffer, src.handle);
+    fold(commandBuffer, dst.handle);
+    fold(commandBuffer, ((uint64_t)srcOffset << 32) | dstOffset);
+    fold(commandBuffer, size);
+  }
+
+  void cmdBeginRenderPass(CommandBuffer commandBuffer, const RenderPassInfo &info) override
+  {
+    for (const ColorAttachmentInfo &attachment : info.colorAttachments)
+    {
+      fold(commandBuffer, attachment.view.texture.handle);
+      fold(commandBuffer, attachment.view.baseMipLevel);
+    }
+  }
+
+  void cmdEndRenderPass(CommandBuffer commandBuffer) override
+  {
+    fold(commandBuffer, 1);
+  }
+
+  void cmdBindBindingGroups(CommandBuffer commandBuffer, BindingGroups groups, const uint32_t *, uint32_t) override
+  {
+    fold(commandBuffer, groups.handle);
+  }
+
+  void cmdBindGraphicsPipeline(CommandBuffer commandBuffer, GraphicsPipeline pipeline) override
+  {
+    fold(commandBuffer, pipeline.handle);
+  }
+
+  void cmdBindComputePipeline(CommandBuffer commandBuffer, ComputePipeline pipeline) override
+  {
+    fold(commandBuffer, pipeline.handle);
+  }
+
+  void cmdBindVertexBuffer(CommandBuffer commandBuffer, uint32_t, Buffer buffer, uint64_t offset) override
+  {
+    fold(commandBuffer, buffer.handle);
+    fold(commandBuffer, offset);
+  }
+
+  void cmdBindIndexBuffer(CommandBuffer commandBuffer, Buffer buffer, Type, uint64_t offset) override
+  {
+    fold(commandBuffer, buffer.handle);
+    fold(commandBuffer, offset);
+  }
+
+  void cmdDraw(CommandBuffer commandBuffer, uint32_t vertexCount, uint32_t, uint32_t, uint32_t) override
+  {
+    fold(commandBuffer, vertexCount);
+  }
+
+  void cmdDrawIndexed(CommandBuffer commandBuffer, uint32_t indexCount, uint32_t, uint32_t, int32_t, uint32_t) override
+  {
+    fold(commandBuffer, indexCount);
+  }
+
+  void cmdDrawIndexedIndirect(CommandBuffer commandBuffer, Buffer buffer, size_t offset, uint32_t, uint32_t) override
+  {
+    fold(commandBuffer, buffer.handle);
+    fold(commandBuffer, offset);
+  }
+
+  void cmdStartTimer(CommandBuffer, const Timer &, PipelineStage) override
+  {
+  }
+
+  void cmdStopTimer(CommandBuffer, const Timer &, PipelineStage) override
+  {
+  }
+
+  void cmdDispatch(CommandBuffer commandBuffer, uint32_t x, uint32_t y, uint32_t z) override
+  {
+    fold(commandBuffer, ((uint64_t)x << 42) | ((uint64_t)y << 21) | z);
+  }
+
+  void cmdImageBarrier(
+      CommandBuffer commandBuffer,
+      Texture image,
+      PipelineStage srcStage,
+      PipelineStage dstStage,
+      AccessPattern srcAccess,
+      AccessPattern dstAccess,
+      ResourceLayout oldLayout,
+      ResourceLayout newLayout,
+      ImageAspectFlags,
+      uint32_t baseMipLevel,
+      uint32_t levelCount,
+      uint32_t baseArrayLayer,
+      uint32_t layerCount,
+      Queue srcQueue,
+      Queue dstQueue) override
+  {
+    fold(commandBuffer, image.handle);
+    fold(commandBuffer, ((uint64_t)srcStage << 32) | (uint64_t)dstStage);
+    fold(commandBuffer, ((uint64_t)srcAccess << 32) | (uint64_t)dstAccess);
+    fold(commandBuffer, ((uint64_t)oldLayout << 32) | (uint64_t)newLayout);
+    fold(commandBuffer, ((uint64_t)baseMipLevel << 48) | ((uint64_t)levelCount << 32) | ((uint64_t)baseArrayLayer << 16) | layerCount);
+    fold(commandBuffer, ((uint64_t)srcQueue << 32) | (uint64_t)dstQueue);
+  }
+
+  void cmdBufferBarrier(
+      CommandBuffer commandBuffer,
+      Buffer buffer,
+      PipelineStage srcStage,
+      PipelineStage dstStage,
+      AccessPattern srcAccess,
+      AccessPattern dstAccess,
+      uint32_t offset,
+      uint32_t size,
+      Queue srcQueue,
+      Queue dstQueue) override
+  {
+    fold(commandBuffer, buffer.handle);
+    fold(commandBuffer, ((uint64_t)srcStage << 32) | (uint64_t)dstStage);
+    fold(commandBuffer, ((uint64_t)srcAccess << 32) | (uint64_t)dstAccess);
+    fold(commandBuffer, ((uint64_t)offset << 32) | size);
+    fold(commandBuffer, ((uint64_t)srcQueue << 32) | (uint64_t)dstQueue);
+  }
+
+  void cmdBarriers(CommandBuffer commandBuffer, const BufferBarrierInfo *buffers, uint32_t bufferCount, const TextureBarrierInfo *textures, uint32_t textureCount) override
+  {
+    fold(commandBuffer, ((uint64_t)bufferCount << 32) | textureCount);
+
+    for (uint32_t i = 0; i < bufferCount; i++)
+    {
+      const BufferBarrierInfo &b = buffers[i];
+      cmdBufferBarrier(commandBuffer, b.buffer, b.srcStage, b.dstStage, b.srcAccess, b.dstAccess, b.offset, b.size, b.srcQueue, b.dstQueue);
+    }
+
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+      const TextureBarrierInfo &t = textures[i];
+      cmdImageBarrier(
+          commandBuffer,
+          t.texture,
+          t.srcStage,
+          t.dstStage,
+          t.srcAccess,
+          t.dstAccess,
+          t.oldLayout,
+          t.newLayout,
+          t.aspect,
+          t.baseMip,
+          t.mipCount,
+          t.baseLayer,
+          t.layerCount,
+          t.srcQueue,
+          t.dstQueue);
+    }
+  }
+
+  void cmdMemoryBarrier(CommandBuffer, PipelineStage, PipelineStage, AccessPattern, AccessPattern) override
+  {
+  }
+
+  void cmdPipelineBarrier(CommandBuffer, PipelineStage, PipelineStage, AccessPattern, AccessPattern) override
+  {
+  }
+
+  GPUFuture submit(Queue, CommandBuffer *, uint32_t, GPUFuture *, uint32_t) override
+  {
+    return completed;
+  }
+
+  void waitIdle() override
+  {
+  }
+
+  void blockUntil(GPUFuture &) override
+  {
+  }
+
+  bool isCompleted(GPUFuture &) override
+  {
+    return true;
+  }
+
+  const Timer createTimer(const TimerInfo info) override
+  {
+    return Timer{info.name};
+  }
+
+  void deleteTimer(const Timer &) override
+  {
+  }
+
+  double readTimer(const Timer &) override
+  {
+    return 0;
+  }
+
+  const Buffer createBuffer(const BufferInfo &info) override
+  {
+    return Buffer{info.name, handles++};
+  }
+
+  const Texture createTexture(const TextureInfo &info) override
+  {
+    return Texture{info.name, handles++};
+  }
+
+  const Sampler createSampler(const SamplerInfo &info) override
+  {
+    return Sampler{info.name, handles++};
+  }
+
+  const BindingsLayout createBindingsLayout(const BindingsLayoutInfo &info) override
+  {
+    return BindingsLayout{info.name, handles++};
+  }
+
+  const BindingGroups createBindingGroups(const BindingGroupsInfo &info) override
+  {
+    return BindingGroups{info.name, handles++};
+  }
+
+  const GraphicsPipeline createGraphicsPipeline(const GraphicsPipelineInfo &info) override
+  {
+    return GraphicsPipeline{info.name, handles++};
+  }
+
+  const ComputePipeline createComputePipeline(const ComputePipelineInfo &info) override
+  {
+    return ComputePipeline{info.name, handles++};
+  }
+
+  const Shader createShader(const ShaderInfo data) override
+  {
+    return Shader{data.name, handles++};
+  }
+
+  void deleteShader(Shader) override
+  {
+  }
+
+  void deleteBuffer(const Buffer &) override
+  {
+  }
+
+  void deleteTexture(const Texture &) override
+  {
+  }
+
+  void deleteSampler(const Sampler &) override
+  {
+  }
+
+  void deleteBindingsLayout(const BindingsLayout &) override
+  {
+  }
+
+  void deleteBindingGroups(const BindingGroups &) override
+  {
+  }
+
+  void deleteGraphicsPipeline(const GraphicsPipeline &) override
+  {
+  }
+
+  void deleteComputePipeline(const ComputePipeline &) override
+  {
+  }
+};
+
+// Keeps every buffer barrier it is handed, for graphs run on the calling thread.
+class BarrierRHI : public NullRHI
+{
+public:
+  std::vector<BufferBarrierInfo> bufferBarriers;
+
+  void cmdBarriers(CommandBuffer commandBuffer, const BufferBarrierInfo *buffers, uint32_t bufferCount, const TextureBarrierInfo *textures, uint32_t textureCount) override
+  {
+    bufferBarriers.insert(bufferBarriers.end(), buffers, buffers + bufferCount);
+    NullRHI::cmdBarriers(commandBuffer, buffers, bufferCount, textures, textureCount);
+  }
+};
+
+struct Scene
+{
+  std::vector<Buffer> buffers;
+  std::vector<Texture> textures;
+  std::vector<BindingGroups> groups;
+  ComputePipeline compute;
+  GraphicsPipeline graphics;
+};
+
+const uint64_t bufferSize = 1 << 16;
+const uint64_t rangeSize = 1 << 10;
+const uint32_t mipLevels = 4;
+
+Scene createScene(RenderGraph &renderGraph, size_t passes)
+{
+  Scene scene;
+
+  size_t buffers = 32 + passes / 64;
+  size_t textures = 8 + passes / 256;
+
+  for (size_t i = 0; i < buffers; i++)
+  {
+    scene.buffers.push_back(renderGraph.createBuffer(BufferInfo{
+      .name = "Buffer" + std::to_string(i),
+      .size = bufferSize,
+      .usage = BufferUsage(BufferUsage_Storage | BufferUsage_CopySrc | BufferUsage_CopyDst),
+    }));
+  }
+
+  for (size_t i = 0; i < textures; i++)
+  {
+    scene.textures.push_back(renderGraph.createTexture(TextureInfo{
+      .name = "Texture" + std::to_string(i),
+      .format = Format_RGBA8Uint,
+      .usage = ImageUsage_ColorAttachment,
+      .width = 256,
+      .height = 256,
+      .depth = 1,
+      .mipLevels = mipLevels,
+    }));
+  }
+
+  BindingsLayoutInfo layoutInfo;
+  layoutInfo.name = "Layout";
+  layoutInfo.groups = {BindingGroupLayout{
+    .buffers = {BindingGroupLayoutBufferEntry{
+      .name = "Data",
+      .binding = 0,
+      .type = BufferBindingType::BufferBindingType_StorageBuffer,
+      .visibility = BindingVisibility::BindingVisibility_Compute,
+    }},
+  }};
+
+  BindingsLayout layout = renderGraph.createBindingsLayout(layoutInfo);
+  Random random(3);
+
+  for (size_t i = 0; i < buffers * 4; i++)
+  {
+    scene.groups.push_back(renderGraph.createBindingGroups(BindingGroupsInfo{
+      .name = "Groups" + std::to_string(i),
+      .layout = layout,
+      .groups = {GroupInfo{
+        .buffers = {BindingBuffer{
+          .bufferView =
+              {
+                .buffer = scene.buffers[random.next() % buffers],
+                .offset = (random.next() % (bufferSize / rangeSize)) * rangeSize,
+                .size = rangeSize,
+                .access = i % 2 ? AccessPattern::SHADER_READ : AccessPattern::SHADER_WRITE,
+              },
+          .binding = 0,
+        }},
+      }},
+    }));
+  }
+
+  Shader shader = renderGraph.createShader(ShaderInfo{.name = "Shader", .src = "", .type = SpirV, .layout = layout});
+  scene.compute = renderGraph.createComputePipeline(ComputePipelineInfo{.name = "Compute", .shader = shader, .entry = "main", .layout = layout});
+
+  GraphicsPipelineInfo graphicsInfo;
+  graphicsInfo.name = "Graphics";
+  graphicsInfo.layout = layout;
+  scene.graphics = renderGraph.createGraphicsPipeline(graphicsInfo);
+
+  return scene;
+}
+
+BufferView randomRange(const Buffer &buffer, Random &random, AccessPattern access)
+{
+  return BufferView{
+    .buffer = buffer,
+    .offset = (random.next() % (bufferSize / rangeSize)) * rangeSize,
+    .size = rangeSize,
+    .access = access,
+  };
+}
+
+void recordPasses(RenderGraph &renderGraph, Scene &scene, size_t passes)
+{
+  Random random(passes);
+
+  for (size_t i = 0; i < passes; i++)
+  {
+    RHICommandBuffer commandBuffer(&renderGraph);
+
+    switch (random.next() % 3)
+    {
+    case 0:
+    {
+      size_t src = random.next() % scene.buffers.size();
+      size_t dst = (src + 1 + random.next() % (scene.buffers.size() - 1)) % scene.buffers.size();
+
+      commandBuffer.cmdCopyBuffer(randomRange(scene.buffers[src], random, AccessPattern::TRANSFER_READ), randomRange(scene.buffers[dst], random, AccessPattern::TRANSFER_WRITE));
+      break;
+    }
+
+    case 1:
+      commandBuffer.cmdBindComputePipeline(scene.compute);
+      commandBuffer.cmdBindBindingGroups(scene.groups[random.next() % scene.groups.size()], nullptr, 0);
+      commandBuffer.cmdDispatch(64, 1, 1);
+      break;
+
+    case 2:
+    {
+      RenderPassInfo info;
+      info.name = "Pass";
+      info.viewport = Viewport(256, 256);
+      info.scissor = Rect2D(0, 0, 256, 256);
+      info.colorAttachments.push_back(ColorAttachmentInfo{
+        .name = "Color",
+        .view =
+            TextureView{
+              .texture = scene.textures[random.next() % scene.textures.size()],
+              .baseMipLevel = (uint32_t)(random.next() % mipLevels),
+              .access = AccessPattern::COLOR_ATTACHMENT_WRITE,
+              .layout = ResourceLayout::COLOR_ATTACHMENT,
+            },
+      });
+
+      commandBuffer.cmdBeginRenderPass(info);
+      commandBuffer.cmdBindGraphicsPipeline(scene.graphics);
+      commandBuffer.cmdDraw(3);
+      commandBuffer.cmdEndRenderPass();
+      break;
+    }
+    }
+
+    renderGraph.enqueuePass("Pass" + std::to_string(i), commandBuffer);
+  }
+}
+
+// Builds the graph, returns the compile time in milliseconds and the hashes of every command buffer run recorded.
+double compileAndRun(size_t passes, std::vector<uint64_t> &hashes)
+{
+  NullRHI *rhi = new NullRHI();
+  RenderGraph *renderGraph = new RenderGraph(rhi);
+  Scene scene = createScene(*renderGraph, passes);
+
+  recordPasses(*renderGraph, scene, passes);
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+  renderGraph->compile();
+  double ms = (lib::time::TimeSpan::now() - then).milliseconds();
+
+  RenderGraph::Frame frame;
+  renderGraph->run(frame);
+  hashes = rhi->hashes;
+
+  delete renderGraph;
+  delete rhi;
+  return ms;
+}
+
+// Records the same passes frame after frame, once the first frames have compiled the graph and grown its scratch,
+// compiling and running a frame must not allocate.
+void steadyStateFrames(size_t passes)
+{
+  NullRHI *rhi = new NullRHI();
+  RenderGraph *renderGraph = new RenderGraph(rhi);
+  Scene scene = createScene(*renderGraph, passes);
+  RenderGraph::Frame frame;
+  uint64_t allocations = 0;
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    recordPasses(*renderGraph, scene, passes);
+
+    uint64_t before = lib::memory::SystemMemoryManager::threadAllocationCount();
+    renderGraph->compile();
+    renderGraph->run(frame);
+
+    if (i >= 4)
+    {
+      allocations += lib::memory::SystemMemoryManager::threadAllocationCount() - before;
+    }
+  }
+
+  assert(allocations == 0);
+
+  delete renderGraph;
+  delete rhi;
+}
+
+// Two scratch buffers of one usage whose lifetimes never overlap share their bytes, the pass writing the second one
+// must wait on the pass reading the first one with a barrier over the shared range.
+void scratchAliasing()
+{
+  BarrierRHI *rhi = new BarrierRHI();
+  RenderGraph *renderGraph = new RenderGraph(rhi);
+
+  auto create = [renderGraph](const char *name, bool scratch)
+  {
+    return renderGraph->createBuffer(BufferInfo{
+      .name = name,
+      .size = rangeSize,
+      .usage = BufferUsage(BufferUsage_CopySrc | BufferUsage_CopyDst),
+      .scratch = scratch,
+    });
+  };
+
+  Buffer source = create("Source", false);
+  Buffer middle = create("Middle", false);
+  Buffer target = create("Target", false);
+  Buffer first = create("ScratchA", true);
+  Buffer second = create("ScratchB", true);
+
+  auto copy = [renderGraph](const char *name, const Buffer &src, const Buffer &dst)
+  {
+    RHICommandBuffer commandBuffer(renderGraph);
+    commandBuffer.cmdCopyBuffer(
+        BufferView{.buffer = src, .offset = 0, .size = rangeSize, .access = AccessPattern::TRANSFER_READ},
+        BufferView{.buffer = dst, .offset = 0, .size = rangeSize, .access = AccessPattern::TRANSFER_WRITE});
+    renderGraph->enqueuePass(name, commandBuffer);
+  };
+
+  copy("WriteA", source, first);
+  copy("ReadA", first, middle);
+  copy("WriteB", middle, second);
+  copy("ReadB", second, target);
+
+  renderGraph->compile();
+
+  RenderGraph::Frame frame;
+  renderGraph->run(frame);
+
+  bool found = false;
+
+  for (const BufferBarrierInfo &barrier : rhi->bufferBarriers)
+  {
+    found |= barrier.buffer.handle == second.handle && barrier.srcAccess == AccessPattern::TRANSFER_READ && barrier.dstAccess == AccessPattern::TRANSFER_WRITE &&
+             barrier.offset == 0 && barrier.size == rangeSize;
+  }
+
+  assert(found);
+
+  delete renderGraph;
+  delete rhi;
+}
+
+static Config config;
+static std::vector<Result> results;
+
+void parallelCompiles()
+{
+  for (Result &result : results)
+  {
+    result.parallelMs = compileAndRun(result.passes, result.parallelHashes);
+
+    // A thread outside the job system compiles and records serially while the job system is running.
+    os::Thread thread(
+        [&result]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+          compileAndRun(result.passes, result.threadHashes);
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+
+    thread.join();
+  }
+
+  async::stop();
+}
+
+int main(int argc, char **argv)
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  // Unbounded and silent, so that the compile log neither blocks on the logger thread nor floods the output. Info
+  // messages are dropped before they are formatted, they would allocate in the steady state frames.
+  os::Logger::start(0);
+  os::Logger::setConsoleEnabled(false);
+  os::Logger::setLevel(os::Logger::Level::Warning);
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      config.passes = {1000};
+    }
+    else if (strcmp(argv[i], "--passes") == 0 && value)
+    {
+      config.passes.clear();
+
+      for (const char *curr = value; *curr; curr += *curr == ',')
+      {
+        config.passes.push_back(strtoull(curr, const_cast<char **>(&curr), 10));
+      }
+
+      i++;
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && value)
+    {
+      config.threads = std::max<size_t>(1, strtoull(value, nullptr, 10));
+      i++;
+    }
+    else
+    {
+      os::print("Unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  scratchAliasing();
+  steadyStateFrames(config.passes.front());
+
+  for (size_t passes : config.passes)
+  {
+    results.push_back(Result{.passes = passes});
+    results.back().serialMs = compileAndRun(passes, results.back().serialHashes);
+  }
+
+  async::SystemSettings settings;
+  settings.threadsCount = config.threads;
+  settings.jobsCapacity = 64;
+  settings.stackSize = 1024 * 1024;
+
+  async::init(parallelCompiles, settings);
+  async::shutdown();
+
+  for (const Result &result : results)
+  {
+    // Parallel compile must hand the backend exactly what the serial one did.
+    assert(result.serialHashes == result.parallelHashes);
+    assert(result.serialHashes == result.threadHashes);
+
+    os::print(
+        "%7zu passes: serial compile %10.3fms, %zu threads %10.3fms (%.2fx), %zu command buffers\n",
+        result.passes,
+        result.serialMs,
+        config.threads,
+        result.parallelMs,
+        result.serialMs / result.parallelMs,
+        result.serialHashes.size());
+  }
+
+  os::Logger::shutdown();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (ConcurrentBoundedCacheTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(ConcurrentBoundedCacheTests ${TEST_DIR}/ConcurrentBoundedCacheTests.cpp)
+target_link_libraries(ConcurrentBoundedCacheTests PRIVATE Engine)
+add_test(NAME ConcurrentBoundedCacheTests COMMAND ConcurrentBoundedCacheTests)
@@ -0,0 +1,147 @@
+#include "datastructure/ConcurrentBoundedCache.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Thread.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+using Cache = lib::ConcurrentBoundedCache<std::string, int>;
+
+void singleThreadTests()
+{
+  std::vector<std::string> evicted;
+  Cache cache(4, [&](const std::string &key, int &) { evicted.push_back(key); }, 1);
+
+  int created = 0;
+  auto create = [&]() { return std::make_pair(++created, (size_t)1); };
+
+  assert(cache.acquire("a", create) == 1);
+  assert(cache.acquire("a", create) == 1);
+  assert(created == 1 && cache.hits() == 1 && cache.misses() == 1);
+
+  assert(cache.acquire("b", create) == 2);
+  assert(cache.acquire("c", create) == 3);
+  assert(cache.acquire("d", create) == 4);
+  assert(cache.acquire("e", create) == 5);
+
+  // Everything is pinned, the cache goes over budget instead of evicting.
+  assert(cache.size() == 5 && evicted.empty());
+
+  assert(cache.release("a"));
+  assert(evicted.size() == 0);
+  assert(cache.release("a"));
+  assert(!cache.release("a"));
+
+  // a is unpinned and over budget, it goes once the clock hand clears its reference bit.
+  assert(evicted.size() == 1 && evicted[0] == "a");
+  assert(!cache.contains("a") && cache.size() == 4);
+
+  // Released entries under budget stay cached and come back as hits.
+  assert(cache.release("b"));
+  assert(cache.contains("b"));
+  assert(cache.acquire("b", create) == 2);
+  assert(created == 5);
+
+  for (const char *key : {"b", "c", "d", "e"})
+  {
+    assert(cache.release(key));
+  }
+
+  assert(cache.size() == 4);
+
+  // New entries push out the unreferenced ones first.
+  assert(cache.acquire("f", create) == 6);
+  assert(cache.size() == 4 && cache.contains("f"));
+  assert(evicted.size() == 2);
+
+  cache.clear();
+  assert(cache.size() == 1 && cache.contains("f"));
+  assert(cache.release("f"));
+  cache.clear();
+  assert(cache.size() == 0 && cache.cost() == 0);
+  assert(evicted.size() == 6);
+}
+
+void multiThreadTests()
+{
+  std::atomic<int> created(0);
+  std::atomic<int> destroyed(0);
+
+  {
+    Cache cache(64, [&](const std::string &, int &) { destroyed.fetch_add(1); });
+
+    std::atomic<int> can_start(0);
+
+    size_t totalThreads = os::Thread::getHardwareConcurrency();
+    os::Thread threads[totalThreads];
+
+    const int keys = 256;
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      threads[i] = os::Thread(
+          [&, i]()
+          {
+            lib::memory::SystemMemoryManager::initializeThread();
+
+            can_start.fetch_add(1);
+            while (can_start.load() != totalThreads)
+            {
+            }
+
+            for (int j = 0; j < 2000; j++)
+            {
+              int key = (j * 7 + i) % keys;
+              int value = cache.acquire(std::to_string(key),
+                                        [&]()
+                                        {
+                                          created.fetch_add(1);
+                                          return std::make_pair(key, (size_t)1);
+                                        });
+
+              // Every thread must see the value built for its key, never another one.
+              assert(value == key);
+              assert(cache.release(std::to_string(key)));
+            }
+
+            lib::memory::SystemMemoryManager::finializeThread();
+          });
+    }
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      if (threads[i].isRunning())
+      {
+        threads[i].join();
+      }
+    }
+
+    assert(cache.cost() <= 64 + 16);
+    assert(cache.hits() + cache.misses() == totalThreads * 2000);
+  }
+
+  // Every value that was built has been handed to the eviction callback once the cache is gone.
+  assert(created.load() == destroyed.load());
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+
+  for (size_t i = 0; i < 10; i++)
+  {
+    multiThreadTests();
+  }
+
+  os::print("ConcurrentBoundedCache tests passed\n");
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include "datastructure/ConcurrentMultiQueue.hpp"
 #include "datastructure/ConcurrentPriorityQueue.hpp"
 #include "os/Thread.hpp"
 
@@ -6,6 +7,7 @@
 #include "time/TimeSpan.hpp"
 #include "os/print.hpp"
 #include <assert.h>
+#include <vector>
 
 void multiThreadTests()
 {
@@ -88,6 +90,184 @@ void multiThreadTests()
   delete pq;
 }
 
+void multiQueueTests()
+{
+  lib::ConcurrentMultiQueue<int, size_t> mq;
+
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  std::atomic<size_t> started(0);
+  std::atomic<size_t> dequeing(0);
+
+  std::vector<std::atomic<int>> seen((totalThreads + 1) * 1000);
+
+  for (size_t i = 0; i < seen.size(); i++)
+  {
+    seen[i].store(0);
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [i, &started, &dequeing, &mq, &seen, totalThreads]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+          started.fetch_add(1);
+          while (started.load() < totalThreads)
+          {
+          }
+
+          for (size_t j = 0; j < 1000; j++)
+          {
+            assert(mq.enqueue((i + 1) * 1000 + j, (i + 1) * 1000 + j));
+          }
+
+          dequeing.fetch_add(1);
+
+          while (dequeing.load() < totalThreads)
+          {
+          }
+
+          int x;
+
+          for (size_t j = 0; j < 1000; j++)
+          {
+            while (!mq.dequeue(x))
+            {
+            }
+
+            // Order is relaxed, but every element must come out exactly once.
+            assert(seen[x].fetch_add(1) == 0);
+          }
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i].join();
+  }
+
+  int x;
+  assert(!mq.dequeue(x));
+  assert(mq.isEmpty());
+
+  // Single threaded, each dequeue compares two heaps so the rank error stays small.
+  lib::ConcurrentMultiQueue<int, size_t> sequential(2, 4);
+
+  for (int i = 1; i <= 1000; i++)
+  {
+    sequential.enqueue(i, i);
+  }
+
+  size_t totalRank = 0;
+  std::vector<bool> removed(1001, false);
+
+  for (int i = 0; i < 1000; i++)
+  {
+    assert(sequential.dequeue(x));
+
+    size_t rank = 0;
+
+    for (int k = 1; k < x; k++)
+    {
+      rank += removed[k] ? 0 : 1;
+    }
+
+    removed[x] = true;
+    totalRank += rank;
+  }
+
+  os::print("MultiQueue average rank error is %f\n", (double)totalRank / 1000);
+}
+
+template <typename Queue> double benchmarkQueue(Queue &queue, size_t totalThreads, size_t operations)
+{
+  os::Thread threads[totalThreads];
+
+  std::atomic<size_t> started(0);
+  std::atomic<size_t> dequeing(0);
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [i, &started, &dequeing, &queue, totalThreads, operations]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+          started.fetch_add(1);
+          while (started.load() < totalThreads)
+          {
+          }
+
+          int x;
+
+          // ConcurrentPriorityQueue requires unique priorities.
+          for (size_t j = 0; j < operations; j++)
+          {
+            queue.enqueue(j, j * totalThreads + i + 1);
+          }
+
+          dequeing.fetch_add(1);
+          while (dequeing.load() < totalThreads)
+          {
+          }
+
+          for (size_t j = 0; j < operations; j++)
+          {
+            while (!queue.dequeue(x))
+            {
+            }
+          }
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i].join();
+  }
+
+  return (lib::time::TimeSpan::now() - then).milliseconds();
+}
+
+void multiQueueBenchmarks()
+{
+  size_t maxThreads = os::Thread::getHardwareConcurrency();
+  size_t operations = 20000;
+
+  for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    lib::ConcurrentPriorityQueue<int, size_t> *pq = new lib::ConcurrentPriorityQueue<int, size_t>();
+    lib::ConcurrentMultiQueue<int, size_t> mq(2, threads);
+
+    double pqTime = benchmarkQueue(*pq, threads, operations);
+    double mqTime = benchmarkQueue(mq, threads, operations);
+
+    delete pq;
+
+    os::print(
+        "%zu threads: ConcurrentPriorityQueue %f ops/ms, ConcurrentMultiQueue %f ops/ms\n",
+        threads,
+        2 * threads * operations / pqTime,
+        2 * threads * operations / mqTime);
+
+    if (threads == maxThreads)
+    {
+      break;
+    }
+
+    if (threads * 2 > maxThreads)
+    {
+      threads = maxThreads / 2;
+    }
+  }
+}
+
 int main()
 {
   lib::memory::SystemMemoryManager::init();
@@ -95,7 +275,10 @@ int main()
   for (size_t i = 0; i < 10; i++)
   {
     multiThreadTests();
+    multiQueueTests();
   }
 
+  multiQueueBenchmarks();
+
   lib::memory::SystemMemoryManager::shutdown();
 }
\ No newline at end of file
@@ -3,16 +3,17 @@
 #include "os/Thread.hpp"
 
 #include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/SlabAllocator.hpp"
 #include "time/TimeSpan.hpp"
 
 #include "os/print.hpp"
 #include <assert.h>
 
-void singleThreadTimingAndOrderTest()
+template <typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> void singleThreadTimingAndOrderTest()
 {
   os::print("Running single-thread FIFO order + timing test...\n");
 
-  lib::ConcurrentQueue<int> queue;
+  lib::ConcurrentQueue<int, 128, Allocator> queue;
 
   constexpr size_t N = 100000;
 
@@ -50,9 +51,9 @@ void singleThreadTimingAndOrderTest()
   os::print("Single-thread FIFO order + timing test passed.\n");
 }
 
-void multiThreadTests()
+template <typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> void multiThreadTests()
 {
-  lib::ConcurrentQueue<int> *queue = new lib::ConcurrentQueue<int>();
+  lib::ConcurrentQueue<int, 128, Allocator> *queue = new lib::ConcurrentQueue<int, 128, Allocator>();
 
   bool started = false;
 
@@ -182,6 +183,10 @@ int main()
   printf(" Multi thread tests\n");
   multiThreadTests();
 
+  printf(" Slab allocator\n");
+  singleThreadTimingAndOrderTest<lib::memory::allocator::SlabAllocator<uint8_t>>();
+  multiThreadTests<lib::memory::allocator::SlabAllocator<uint8_t>>();
+
   for (uint32_t i = 0; i < 10; i++)
   {
     printf(" concurrentListMultithreadTests\n");
@@ -1,5 +1,6 @@
 #include "datastructure/ConcurrentSkipListMap.hpp"
 #include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/SlabAllocator.hpp"
 #include "os/Thread.hpp"
 #include "os/print.hpp"
 #include "time/TimeSpan.hpp"
@@ -95,12 +96,122 @@ void iteratorTests()
   os::print("Iterator tests passed!\n");
 }
 
-void multiThreadInsertTests()
+void rangeTests()
 {
-  os::print("Running multi-threaded insert tests...\n");
+  os::print("Running range tests...\n");
+
+  lib::ConcurrentSkipListMap<int, int> map;
+
+  for (int i = 1; i <= 1000; i++)
+  {
+    map.insert(i * 10, i * 100);
+  }
+
+  assert(map.lowerBound(15).key() == 20);
+  assert(map.lowerBound(20).key() == 20);
+  assert(map.upperBound(20).key() == 30);
+  assert(map.upperBound(25).key() == 30);
+  assert(map.lowerBound(10001) == map.end());
+  assert(map.upperBound(10000) == map.end());
+
+  int count = 0;
+  int lastKey = 90;
+
+  for (auto e : map.range(100, 200))
+  {
+    assert(e.first == lastKey + 10);
+    assert(e.second == e.first * 10);
+    lastKey = e.first;
+    count++;
+  }
+
+  assert(count == 10);
+  assert(lastKey == 190);
+
+  map.remove(150);
+  count = 0;
+
+  for (auto e : map.range(100, 200))
+  {
+    assert(e.first != 150);
+    count++;
+  }
+
+  assert(count == 9);
+  assert(map.upperBound(140).key() == 160);
+
+  auto empty = map.range(101, 109);
+  assert(empty.begin() == empty.end());
+
+  for (int i = 1; i <= 1000; i++)
+  {
+    map.remove(i * 10);
+  }
+
+  os::print("Range tests passed!\n");
+}
+
+void bulkLoadTests()
+{
+  os::print("Running bulk load tests...\n");
 
   lib::ConcurrentSkipListMap<int, int> map;
 
+  std::vector<std::pair<int, int>> sorted;
+
+  for (int i = 1; i <= 10000; i++)
+  {
+    sorted.push_back({i * 2, i});
+  }
+
+  map.bulkLoad(sorted.begin(), sorted.end());
+
+  assert(map.size() == 10000);
+
+  for (int i = 1; i <= 10000; i++)
+  {
+    assert(map.find(i * 2).value() == i);
+    assert(map.find(i * 2 + 1) == map.end());
+  }
+
+  int count = 0;
+  int lastKey = 0;
+
+  for (auto e : map)
+  {
+    assert(e.first > lastKey);
+    lastKey = e.first;
+    count++;
+  }
+
+  assert(count == 10000);
+
+  // Loaded nodes behave as inserted ones.
+  assert(map.insert(3, 3) != map.end());
+  assert(map.remove(4));
+  assert(map.lowerBound(4).key() == 6);
+
+  // Not empty anymore, falls back to insert.
+  std::vector<std::pair<int, int>> more = {{5, 5}, {7, 7}};
+  map.bulkLoad(more.begin(), more.end());
+
+  assert(map.find(5).value() == 5);
+  assert(map.size() == 10000 + 2);
+
+  for (int i = 1; i <= 10000; i++)
+  {
+    map.remove(i * 2);
+  }
+
+  os::print("Bulk load tests passed!\n");
+}
+
+template <typename Allocator = lib::memory::allocator::SystemAllocator<uint8_t>> void multiThreadInsertTests()
+{
+  os::print("Running multi-threaded insert tests...\n");
+
+  lib::ConcurrentSkipListMap<int, int, 16, Allocator> map;
+
   size_t totalThreads = os::Thread::getHardwareConcurrency();
   os::Thread threads[totalThreads];
   std::atomic<bool> started(false);
@@ -597,6 +708,41 @@ void benchmarkInsertST(int numOperations)
   os::print("  Random:     %7d ops | %8.3f ms | %8.2f ns/op | %10.0f ops/sec\n", numOperations, elapsed.milliseconds(), avgNs, opsPerSec);
 }
 
+void benchmarkBulkLoadST(int numOperations)
+{
+  std::vector<std::pair<int, int>> sorted(numOperations);
+
+  for (int i = 0; i < numOperations; i++)
+  {
+    sorted[i] = {i, i * 10};
+  }
+
+  lib::ConcurrentSkipListMap<int, int> map;
+
+  lib::time::TimeSpan start = lib::time::TimeSpan::now();
+  map.bulkLoad(sorted.begin(), sorted.end());
+  lib::time::TimeSpan elapsed = lib::time::TimeSpan::now() - start;
+
+  assert(map.size() == numOperations);
+
+  os::print("  Bulk load:  %7d ops | %8.3f ms | %8.2f ns/op\n", numOperations, elapsed.milliseconds(), elapsed.nanoseconds() / numOperations);
+
+  start = lib::time::TimeSpan::now();
+
+  int visited = 0;
+
+  for (auto e : map.range(0, numOperations))
+  {
+    visited++;
+  }
+
+  elapsed = lib::time::TimeSpan::now() - start;
+
+  assert(visited == numOperations);
+
+  os::print("  Range scan: %7d ops | %8.3f ms | %8.2f ns/op\n", numOperations, elapsed.milliseconds(), elapsed.nanoseconds() / numOperations);
+}
+
 void benchmarkAtST(int numElements)
 {
   lib::ConcurrentSkipListMap<int, int> map;
@@ -729,6 +875,14 @@ void singleThreadBenchmarks()
     benchmarkInsertST(size);
   }
 
+  // BULK LOAD
+  os::print("\n\n--- BULK LOAD / RANGE BENCHMARK ---\n");
+  for (int size : sizes)
+  {
+    os::print("\n[%d elements]\n", size);
+    benchmarkBulkLoadST(size);
+  }
+
   // LOOKUP
   os::print("\n\n--- LOOKUP (at) BENCHMARK ---\n");
   for (int size : sizes)
@@ -1235,7 +1389,11 @@ int main()
     // srand(time(nullptr));
     basicTests();
     iteratorTests();
+    rangeTests();
+    bulkLoadTests();
     multiThreadInsertTests();
+    os::print("With slab allocator:\n");
+    multiThreadInsertTests<lib::memory::allocator::SlabAllocator<uint8_t>>();
 
     multiThreadRemoveTests();
     mixedOperationsTests();
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (ConcurrentSlotMapTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(ConcurrentSlotMapTests ${TEST_DIR}/ConcurrentSlotMapTests.cpp)
+target_link_libraries(ConcurrentSlotMapTests PRIVATE Engine)
+add_test(NAME ConcurrentSlotMapTests COMMAND ConcurrentSlotMapTests)
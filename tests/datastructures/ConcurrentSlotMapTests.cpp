@@ -0,0 +1,179 @@
+#include "datastructure/ConcurrentHashMap.hpp"
+#include "datastructure/ConcurrentSlotMap.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <string>
+#include <vector>
+
+using SlotMap = lib::ConcurrentSlotMap<std::string>;
+
+void singleThreadTests()
+{
+  SlotMap map;
+
+  assert(map.empty());
+  assert(map.get(SlotMap::NULL_HANDLE) == nullptr);
+
+  std::vector<SlotMap::Handle> handles;
+
+  for (size_t i = 0; i < 1000; i++)
+  {
+    handles.push_back(map.insert(std::to_string(i)));
+  }
+
+  assert(map.size() == 1000);
+
+  for (size_t i = 0; i < 1000; i++)
+  {
+    assert(*map.get(handles[i]) == std::to_string(i));
+  }
+
+  SlotMap::Handle stale = handles[10];
+
+  assert(map.erase(stale));
+  assert(!map.erase(stale));
+  assert(map.get(stale) == nullptr);
+
+  // The freed slot is reused with a new generation, the old handle stays invalid.
+  SlotMap::Handle reused = map.insert("reused");
+
+  assert(SlotMap::indexOf(reused) == SlotMap::indexOf(stale));
+  assert(SlotMap::generationOf(reused) != SlotMap::generationOf(stale));
+  assert(map.get(stale) == nullptr);
+  assert(*map.get(reused) == "reused");
+
+  size_t visited = 0;
+  map.forEach([&](SlotMap::Handle, std::string &) { visited++; });
+  assert(visited == map.size());
+
+  map.clear();
+  assert(map.empty());
+  assert(map.get(reused) == nullptr);
+}
+
+void multiThreadTests()
+{
+  SlotMap map;
+
+  std::atomic<int> can_start(0);
+
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  const size_t operations = 10000;
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          can_start.fetch_add(1);
+          while (can_start.load() != totalThreads)
+          {
+          }
+
+          std::vector<SlotMap::Handle> owned;
+
+          for (size_t j = 0; j < operations; j++)
+          {
+            std::string value = std::to_string(i * operations + j);
+
+            owned.push_back(map.insert(value));
+            assert(*map.get(owned.back()) == value);
+
+            // Keep slots churning through the free list.
+            if (j % 2 == 1)
+            {
+              SlotMap::Handle handle = owned[owned.size() - 2];
+              assert(map.erase(handle));
+              assert(map.get(handle) == nullptr);
+              owned[owned.size() - 2] = owned.back();
+              owned.pop_back();
+            }
+          }
+
+          for (SlotMap::Handle handle : owned)
+          {
+            assert(map.get(handle) != nullptr);
+          }
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  assert(map.size() == totalThreads * operations / 2);
+}
+
+void benchmarks()
+{
+  const size_t count = 10000;
+
+  SlotMap map;
+  lib::ConcurrentHashMap<std::string, std::string *> names;
+  std::vector<SlotMap::Handle> handles;
+  std::vector<std::string> keys;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    keys.push_back("resource" + std::to_string(i));
+    handles.push_back(map.insert(keys.back()));
+    names.insert(keys.back(), map.get(handles.back()));
+  }
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  size_t hits = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    hits += map.get(handles[i]) != nullptr;
+  }
+
+  double slotNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    hits += names.find(keys[i]) != names.end();
+  }
+
+  double nameNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  assert(hits == 2 * count);
+
+  os::print("average handle lookup time is %fns, average name lookup time is %fns\n", slotNs / count, nameNs / count);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+
+  for (size_t i = 0; i < 10; i++)
+  {
+    multiThreadTests();
+  }
+
+  benchmarks();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
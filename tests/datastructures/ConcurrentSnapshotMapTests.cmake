@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (ConcurrentSnapshotMapTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(ConcurrentSnapshotMapTests ${TEST_DIR}/ConcurrentSnapshotMapTests.cpp)
+target_link_libraries(ConcurrentSnapshotMapTests PRIVATE Engine)
+add_test(NAME ConcurrentSnapshotMapTests COMMAND ConcurrentSnapshotMapTests)
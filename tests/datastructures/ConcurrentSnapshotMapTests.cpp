@@ -0,0 +1,265 @@
+#include "datastructure/ConcurrentHashMap.hpp"
+#include "datastructure/ConcurrentSnapshotMap.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+using SnapshotMap = lib::ConcurrentSnapshotMap<std::string, int>;
+
+void singleThreadTests()
+{
+  SnapshotMap map;
+
+  assert(map.isEmpty());
+  assert(map.find("missing") == map.end());
+  assert(map.begin() == map.end());
+
+  for (int i = 0; i < 1000; i++)
+  {
+    assert(map.insert(std::to_string(i), i) != map.end());
+  }
+
+  assert(map.size() == 1000);
+
+  // Inserting a present key leaves the old value in place.
+  assert(map.insert("10", -1) == map.end());
+
+  for (int i = 0; i < 1000; i++)
+  {
+    auto it = map.find(std::to_string(i));
+    assert(it != map.end() && it.value() == i);
+    assert(map.contains(std::to_string(i)));
+  }
+
+  // Values keep their address across publishes and can be changed in place.
+  int *address = &map.find("10").value();
+  map.find("10").value() = 0;
+  map.insert("new", 1);
+  assert(&map.find("10").value() == address);
+  map["10"].value() = 10;
+  assert(map.find("10").value() == 10);
+
+  for (int i = 0; i < 1000; i += 2)
+  {
+    assert(map.remove(std::to_string(i)));
+    assert(!map.remove(std::to_string(i)));
+  }
+
+  assert(map.size() == 501);
+
+  for (int i = 1; i < 1000; i += 2)
+  {
+    assert(map.find(std::to_string(i)).value() == i);
+  }
+
+  assert(map["defaulted"].value() == 0);
+  assert(map.size() == 502);
+
+  size_t visited = 0;
+
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    assert(map.contains(it.key()));
+    visited++;
+  }
+
+  assert(visited == map.size());
+
+  map.clear();
+  assert(map.isEmpty());
+  assert(map.begin() == map.end());
+}
+
+void batchTests()
+{
+  SnapshotMap map;
+
+  map.insert("kept", 1);
+  map.insert("removed", 2);
+
+  {
+    auto batch = map.batch();
+
+    for (int i = 0; i < 100; i++)
+    {
+      batch.insert(std::to_string(i), i);
+    }
+
+    batch.remove("removed");
+    // Entries inserted and removed by the same batch never show up.
+    batch.insert("transient", 3);
+    batch.remove("transient");
+
+    // Nothing is visible until the batch is committed.
+    assert(map.size() == 2);
+  }
+
+  assert(map.size() == 101);
+  assert(map.contains("kept"));
+  assert(!map.contains("removed"));
+  assert(!map.contains("transient"));
+
+  auto batch = map.batch();
+  batch.remove("kept");
+  batch.commit();
+
+  assert(!map.contains("kept"));
+  assert(map.size() == 100);
+}
+
+void multiThreadTests()
+{
+  SnapshotMap map;
+
+  const int keys = 256;
+
+  for (int i = 0; i < keys; i++)
+  {
+    map.insert("stable" + std::to_string(i), i);
+  }
+
+  std::atomic<int> can_start(0);
+  std::atomic<bool> done(false);
+
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          can_start.fetch_add(1);
+          while (can_start.load() != totalThreads)
+          {
+          }
+
+          if (i == 0)
+          {
+            // One writer churns keys while everyone else reads.
+            for (int round = 0; round < 200; round++)
+            {
+              auto batch = map.batch();
+
+              for (int j = 0; j < 16; j++)
+              {
+                batch.insert("churn" + std::to_string(round * 16 + j), j);
+              }
+
+              batch.commit();
+
+              for (int j = 0; j < 16; j++)
+              {
+                assert(map.remove("churn" + std::to_string(round * 16 + j)));
+              }
+            }
+
+            done.store(true);
+          }
+          else
+          {
+            while (!done.load())
+            {
+              for (int j = 0; j < keys; j++)
+              {
+                auto it = map.find("stable" + std::to_string(j));
+                assert(it != map.end() && it.value() == j);
+              }
+
+              size_t stable = 0;
+
+              for (auto it = map.begin(); it != map.end(); ++it)
+              {
+                stable += it.key().rfind("stable", 0) == 0;
+              }
+
+              assert(stable == keys);
+            }
+          }
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  assert(map.size() == keys);
+}
+
+void benchmarks()
+{
+  const size_t count = 10000;
+
+  SnapshotMap snapshots;
+  lib::ConcurrentHashMap<std::string, int> hashes;
+  std::vector<std::string> keys;
+
+  {
+    auto batch = snapshots.batch();
+
+    for (size_t i = 0; i < count; i++)
+    {
+      keys.push_back("resource" + std::to_string(i));
+      batch.insert(keys.back(), i);
+      hashes.insert(keys.back(), i);
+    }
+  }
+
+  size_t hits = 0;
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    hits += snapshots.find(keys[i]) != snapshots.end();
+  }
+
+  double snapshotNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    hits += hashes.find(keys[i]) != hashes.end();
+  }
+
+  double hashNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  assert(hits == 2 * count);
+
+  os::print("average snapshot map lookup time is %fns, average hash map lookup time is %fns\n", snapshotNs / count, hashNs / count);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  batchTests();
+
+  for (size_t i = 0; i < 10; i++)
+  {
+    multiThreadTests();
+  }
+
+  benchmarks();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
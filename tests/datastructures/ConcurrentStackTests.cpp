@@ -1,5 +1,6 @@
 #include "datastructure/ConcurrentStack.hpp"
 #include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/SlabAllocator.hpp"
 #include "time/TimeSpan.hpp"
 
 #include "os/print.hpp"
@@ -68,9 +69,9 @@ void multiThreadTests()
   }
 }
 
-void multiThreadProducerTests()
+template <typename Allocator = lib::memory::allocator::SystemAllocator<lib::detail::ConcurrentStackNode<int>>> void multiThreadProducerTests()
 {
-  lib::detail::ConcurrentStackProducer<int> stack = lib::detail::ConcurrentStackProducer<int>();
+  lib::detail::ConcurrentStackProducer<int, Allocator> stack;
 
   std::atomic<int> can_push(0);
   std::atomic<int> can_pop(0);
@@ -131,6 +132,68 @@ void multiThreadProducerTests()
   }
 }
 
+void sharedDomainTests()
+{
+  lib::HazardPointerDomain domain;
+
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  {
+    lib::detail::ConcurrentStackProducer<int> first(domain);
+    lib::detail::ConcurrentStackProducer<int> second(domain);
+
+    std::atomic<int> can_start(0);
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      threads[i] = os::Thread(
+          [&]()
+          {
+            lib::memory::SystemMemoryManager::initializeThread();
+
+            can_start.fetch_add(1);
+            while (can_start.load() != totalThreads)
+            {
+            }
+
+            for (size_t j = 0; j < 1000; j++)
+            {
+              int x;
+
+              first.push(j);
+              second.push(j);
+
+              assert(first.pop(x));
+              assert(second.pop(x));
+            }
+
+            lib::memory::SystemMemoryManager::finializeThread();
+          });
+    }
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      if (threads[i].isRunning())
+      {
+        threads[i].join();
+      }
+    }
+
+    // Both stacks draw their records from the same domain, a thread holds at most one at a time.
+    assert(domain.records() <= totalThreads);
+  }
+
+  // Retired nodes of destroyed stacks are handed back to them, records stay in the domain for reuse.
+  lib::detail::ConcurrentStackProducer<int> third(domain);
+
+  third.push(1);
+
+  int x;
+  assert(third.pop(x) && x == 1);
+  assert(domain.records() <= totalThreads);
+}
+
 int main()
 {
   lib::memory::SystemMemoryManager::init();
@@ -139,6 +202,10 @@ int main()
   multiThreadTests();
   os::print("producer:\n");
   multiThreadProducerTests();
+  os::print("producer with slab allocator:\n");
+  multiThreadProducerTests<lib::memory::allocator::SlabAllocator<lib::detail::ConcurrentStackNode<int>>>();
+  os::print("shared domain:\n");
+  sharedDomainTests();
   lib::memory::SystemMemoryManager::finializeThread();
   lib::memory::SystemMemoryManager::shutdown();
   return 0;
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (ConcurrentVectorTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(ConcurrentVectorTests ${TEST_DIR}/ConcurrentVectorTests.cpp)
+target_link_libraries(ConcurrentVectorTests PRIVATE Engine)
+add_test(NAME ConcurrentVectorTests COMMAND ConcurrentVectorTests)
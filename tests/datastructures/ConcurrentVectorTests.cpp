@@ -0,0 +1,217 @@
+#include "datastructure/ConcurrentVector.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/BoundedHeapAllocator.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+
+void singleThreadTests()
+{
+  lib::ConcurrentVector<int> vector;
+
+  assert(vector.empty());
+
+  vector.pushBack(0);
+  int *first = &vector[0];
+
+  for (int i = 1; i < 10000; i++)
+  {
+    assert(vector.pushBack(i) == (size_t)i);
+  }
+
+  // Growing never moves elements.
+  assert(first == &vector[0]);
+  assert(vector.size() == 10000);
+  assert(vector.capacity() >= 10000);
+
+  for (int i = 0; i < 10000; i++)
+  {
+    assert(vector[i] == i);
+  }
+
+  size_t start = vector.growBy(100, 7);
+  assert(start == 10000);
+  assert(vector.size() == 10100);
+
+  for (size_t i = start; i < vector.size(); i++)
+  {
+    assert(vector[i] == 7);
+  }
+
+  bool thrown = false;
+
+  try
+  {
+    vector.at(vector.size());
+  }
+  catch (std::out_of_range &)
+  {
+    thrown = true;
+  }
+
+  assert(thrown);
+}
+
+struct ThrowingCopy
+{
+  int value;
+
+  ThrowingCopy(int value) : value(value)
+  {
+  }
+
+  ThrowingCopy(const ThrowingCopy &other) : value(other.value)
+  {
+    if (value < 0)
+    {
+      throw std::runtime_error("copy failed");
+    }
+  }
+};
+
+void exceptionTests()
+{
+  lib::ConcurrentVector<ThrowingCopy> vector;
+
+  vector.pushBack(ThrowingCopy(0));
+
+  bool thrown = false;
+
+  try
+  {
+    vector.pushBack(ThrowingCopy(-1));
+  }
+  catch (std::runtime_error &)
+  {
+    thrown = true;
+  }
+
+  assert(thrown);
+
+  // The failed index does not block later writers, it is counted by size() and rejected by at().
+  assert(vector.pushBack(ThrowingCopy(2)) == 2);
+  assert(vector.size() == 3);
+  assert(vector[0].value == 0 && vector[2].value == 2);
+
+  thrown = false;
+
+  try
+  {
+    vector.at(1);
+  }
+  catch (std::out_of_range &)
+  {
+    thrown = true;
+  }
+
+  assert(thrown);
+}
+
+void boundedHeapTests()
+{
+  const size_t bufferSize = 1 << 20;
+
+  void *buffer = lib::memory::SystemMemoryManager::allignedMalloc(bufferSize, 128, 0);
+
+  {
+    lib::allocator::BoundedHeapAllocator<size_t> allocator(buffer, bufferSize);
+    lib::ConcurrentVector<size_t, lib::allocator::BoundedHeapAllocator<size_t>> vector(allocator);
+
+    for (size_t i = 0; i < 4096; i++)
+    {
+      vector.pushBack(i);
+    }
+
+    for (size_t i = 0; i < 4096; i++)
+    {
+      assert(vector[i] == i);
+    }
+  }
+
+  lib::memory::SystemMemoryManager::free(buffer);
+}
+
+void multiThreadTests()
+{
+  lib::ConcurrentVector<size_t> vector;
+
+  std::atomic<int> can_push(0);
+
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  const size_t operations = 10000;
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          can_push.fetch_add(1);
+          while (can_push.load() != totalThreads)
+          {
+          }
+
+          double total_insert_ns = 0;
+
+          for (size_t j = 0; j < operations; j++)
+          {
+            lib::time::TimeSpan then = lib::time::TimeSpan::now();
+            size_t index = vector.pushBack(i * operations + j);
+            total_insert_ns += (lib::time::TimeSpan::now() - then).nanoseconds();
+
+            // Reads of already published elements stay valid while other threads grow the vector.
+            assert(vector[index] == i * operations + j);
+
+            // Every index below size() is constructed, even while other threads are still writing earlier ones.
+            size_t published = vector.size();
+            assert(published == 0 || vector[published - 1] < totalThreads * operations);
+          }
+
+          os::print("Thread %u average push time is %fns\n", os::Thread::getCurrentThreadId(), total_insert_ns / operations);
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  assert(vector.size() == totalThreads * operations);
+
+  std::vector<bool> seen(totalThreads * operations, false);
+
+  for (size_t i = 0; i < vector.size(); i++)
+  {
+    assert(!seen[vector[i]]);
+    seen[vector[i]] = true;
+  }
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  exceptionTests();
+  boundedHeapTests();
+
+  for (size_t i = 0; i < 10; i++)
+  {
+    multiThreadTests();
+  }
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (FlatIntervalMapTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(FlatIntervalMapTests ${TEST_DIR}/FlatIntervalMapTests.cpp)
+target_link_libraries(FlatIntervalMapTests PRIVATE Engine)
+add_test(NAME FlatIntervalMapTests COMMAND FlatIntervalMapTests)
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "datastructure/FlatIntervalMap.hpp"
+#include "datastructure/TaggedInternvalTree.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+using Map = lib::FlatIntervalMap<uint32_t, uint64_t>;
+
+// Every interval is non empty, sorted, disjoint and different from an adjacent neighbour.
+void checkInvariants(const Map &map)
+{
+  const Map::Interval *previous = nullptr;
+
+  for (const Map::Interval &interval : map)
+  {
+    assert(interval.start <= interval.end);
+
+    if (previous)
+    {
+      assert(previous->end < interval.start);
+      assert(previous->end + 1 != interval.start || previous->tag != interval.tag);
+    }
+
+    previous = &interval;
+  }
+}
+
+void singleThreadTests()
+{
+  Map map;
+
+  map.reset(0, 99, 0);
+  assert(map.size() == 1);
+
+  // Splitting in the middle leaves both sides.
+  map.assign(10, 19, 1);
+  assert(map.size() == 3);
+
+  std::vector<Map::Interval> out;
+  map.queryAll(0, 99, out);
+  assert(out.size() == 3);
+  assert(out[0].start == 0 && out[0].end == 9 && out[0].tag == 0);
+  assert(out[1].start == 10 && out[1].end == 19 && out[1].tag == 1);
+  assert(out[2].start == 20 && out[2].end == 99 && out[2].tag == 0);
+
+  // Adjacent ranges with the same tag merge.
+  map.assign(20, 29, 1);
+  assert(map.size() == 3);
+
+  out.clear();
+  map.query(0, 99, 1, out);
+  assert(out.size() == 2);
+  assert(out[0].end == 9 && out[1].start == 30);
+
+  // Single point overlaps are reported.
+  out.clear();
+  map.queryAll(9, 10, out);
+  assert(out.size() == 2 && out[0].start == 9 && out[0].end == 9 && out[1].start == 10 && out[1].end == 10);
+
+  map.assign(0, 99, 2);
+  assert(map.size() == 1);
+
+  size_t capacity = map.capacity();
+  map.clear();
+  assert(map.size() == 0 && map.capacity() == capacity);
+
+  out.clear();
+  map.queryAll(0, 99, out);
+  assert(out.empty());
+}
+
+void randomTests()
+{
+  std::mt19937 generator(7);
+
+  const uint64_t points = 256;
+
+  for (size_t round = 0; round < 200; round++)
+  {
+    Map map;
+    std::vector<uint32_t> expected(points, 0);
+
+    map.reset(0, points - 1, 0);
+
+    for (size_t i = 0; i < 200; i++)
+    {
+      uint64_t a = generator() % points;
+      uint64_t b = generator() % points;
+      uint32_t tag = generator() % 4;
+
+      map.assign(a, b, tag);
+
+      for (uint64_t p = std::min(a, b); p <= std::max(a, b); p++)
+      {
+        expected[p] = tag;
+      }
+
+      checkInvariants(map);
+
+      uint64_t start = std::min(a, b) / 2;
+      uint64_t end = std::max(a, b);
+
+      std::vector<Map::Interval> out;
+      map.query(start, end, tag, out);
+
+      uint64_t covered = 0;
+
+      for (const Map::Interval &interval : out)
+      {
+        assert(interval.start >= start && interval.end <= end);
+
+        for (uint64_t p = interval.start; p <= interval.end; p++)
+        {
+          assert(expected[p] == interval.tag && interval.tag != tag);
+        }
+
+        covered += interval.end - interval.start + 1;
+      }
+
+      uint64_t different = 0;
+
+      for (uint64_t p = start; p <= end; p++)
+      {
+        different += expected[p] != tag;
+      }
+
+      assert(covered == different);
+    }
+  }
+}
+
+struct Access
+{
+  uint32_t access;
+  uint64_t consumer;
+
+  bool operator==(const Access &o) const
+  {
+    return access == o.access && consumer == o.consumer;
+  }
+
+  bool operator!=(const Access &o) const
+  {
+    return !(*this == o);
+  }
+};
+
+// Replays the buffer hazard tracking of RenderGraph::analyseDependencyGraph over many sub-range accesses.
+void benchmarks()
+{
+  const size_t accesses = 4000;
+  const uint64_t bufferSize = 1 << 24;
+
+  std::mt19937 generator(11);
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+  for (size_t i = 0; i < accesses; i++)
+  {
+    uint64_t offset = (generator() % (bufferSize / 256)) * 256;
+    uint64_t size = 256 * (1 + generator() % 64);
+    ranges.push_back({offset, std::min(offset + size, bufferSize) - 1});
+  }
+
+  size_t treeBarriers = 0;
+  size_t mapBarriers = 0;
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  {
+    lib::BoundedTaggedIntervalTree<Access, uint64_t> tree(accesses * 4);
+    std::vector<lib::BoundedTaggedIntervalTree<Access, uint64_t>::Interval> out;
+
+    tree.insert(0, bufferSize - 1, Access{0, (uint64_t)-1});
+
+    for (size_t i = 0; i < accesses; i++)
+    {
+      out.clear();
+      tree.queryAll(ranges[i].first, ranges[i].second, out);
+
+      for (const auto &interval : out)
+      {
+        treeBarriers++;
+        tree.remove(interval.start, interval.end, interval.tag);
+        tree.insert(interval.start, interval.end, Access{(uint32_t)(i % 3), i});
+      }
+    }
+  }
+
+  double treeNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  lib::FlatIntervalMap<Access, uint64_t> map;
+  std::vector<lib::FlatIntervalMap<Access, uint64_t>::Interval> out;
+
+  then = lib::time::TimeSpan::now();
+
+  // Second pass reuses the capacity left by the first, as consecutive compiles do.
+  for (size_t pass = 0; pass < 2; pass++)
+  {
+    mapBarriers = 0;
+    map.reset(0, bufferSize - 1, Access{0, (uint64_t)-1});
+
+    for (size_t i = 0; i < accesses; i++)
+    {
+      out.clear();
+      map.queryAll(ranges[i].first, ranges[i].second, out);
+
+      for (const auto &interval : out)
+      {
+        mapBarriers++;
+        map.assign(interval.start, interval.end, Access{(uint32_t)(i % 3), i});
+      }
+    }
+  }
+
+  double mapNs = (lib::time::TimeSpan::now() - then).nanoseconds() / 2;
+
+  os::print("%zu sub-range accesses: interval tree %fms (%zu barriers), flat interval map %fms (%zu barriers)\n", accesses, treeNs / 1e6, treeBarriers, mapNs / 1e6,
+            mapBarriers);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  randomTests();
+  benchmarks();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
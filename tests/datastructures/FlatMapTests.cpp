@@ -3,16 +3,200 @@
 #include "memory/SystemMemoryManager.hpp"
 #include "time/TimeSpan.hpp"
 
+#include "algorithm/random.hpp"
 #include "os/print.hpp"
 #include <assert.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+void singleThreadTests()
+{
+  lib::FlatMap<uint64_t, uint64_t> map;
+
+  assert(map.empty());
+  assert(map.find(10) == map.end());
+
+  for (uint64_t i = 0; i < 1000; i++)
+  {
+    assert(map.insert(i, i * 2).second);
+  }
+
+  assert(!map.insert(10, 0).second);
+  assert(map.size() == 1000);
+
+  for (uint64_t i = 0; i < 1000; i++)
+  {
+    assert(map.contains(i));
+    assert(map.at(i) == i * 2);
+  }
+
+  for (uint64_t i = 0; i < 1000; i += 2)
+  {
+    assert(map.erase(i));
+  }
+
+  assert(!map.erase(0));
+  assert(map.size() == 500);
+
+  for (uint64_t i = 0; i < 1000; i++)
+  {
+    assert(map.contains(i) == (i % 2 == 1));
+  }
+
+  uint64_t visited = 0;
+
+  for (auto &[key, value] : map)
+  {
+    assert(key % 2 == 1);
+    assert(value == key * 2);
+    visited++;
+  }
+
+  assert(visited == 500);
+
+  map[1] = 7;
+  map[2000] += 3;
+
+  assert(map.at(1) == 7);
+  assert(map.at(2000) == 3);
+
+  map.clear();
+  assert(map.empty());
+  assert(map.begin() == map.end());
+
+  lib::FlatMap<std::string, std::vector<int>> strings;
+
+  strings["a"].push_back(1);
+  strings["a"].push_back(2);
+  strings["b"].push_back(3);
+
+  lib::FlatMap<std::string, std::vector<int>> copy = strings;
+  lib::FlatMap<std::string, std::vector<int>> moved = std::move(strings);
+
+  assert(copy.at("a").size() == 2);
+  assert(moved.at("b").size() == 1);
+  assert(strings.empty());
+
+  lib::FlatSet<uint32_t> set;
+
+  assert(set.insert(3).second);
+  assert(!set.insert(3).second);
+  assert(set.contains(3));
+  assert(set.count(4) == 0);
+}
+
+void randomizedTests()
+{
+  lib::FlatMap<uint64_t, uint64_t> map;
+  std::unordered_map<uint64_t, uint64_t> reference;
+
+  uint64_t seed = 42;
+
+  for (size_t i = 0; i < 200000; i++)
+  {
+    seed = lib::hashInteger(seed + i);
+
+    uint64_t key = seed % 4096;
+
+    switch (seed % 3)
+    {
+    case 0:
+      assert(map.insert(key, i).second == reference.insert({key, i}).second);
+      break;
+    case 1:
+      assert(map.erase(key) == (reference.erase(key) == 1));
+      break;
+    case 2:
+      assert(map.contains(key) == (reference.count(key) == 1));
+      break;
+    }
+
+    assert(map.size() == reference.size());
+  }
+
+  for (auto &[key, value] : reference)
+  {
+    assert(map.at(key) == value);
+  }
+}
+
+template <typename Map> void benchmark(const char *name, const std::vector<uint64_t> &keys)
+{
+  Map map;
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (uint64_t key : keys)
+  {
+    map[key] = key;
+  }
+
+  double insertNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  then = lib::time::TimeSpan::now();
+
+  uint64_t hits = 0;
+
+  for (uint64_t key : keys)
+  {
+    hits += map.count(key);
+    hits += map.count(key + 1);
+  }
+
+  double findNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  then = lib::time::TimeSpan::now();
+
+  for (uint64_t key : keys)
+  {
+    map.erase(key);
+  }
+
+  double eraseNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  assert(hits >= keys.size());
+
+  os::print(
+      "%s: average insert time is %fns, average find time is %fns, average erase time is %fns\n",
+      name,
+      insertNs / keys.size(),
+      findNs / (2 * keys.size()),
+      eraseNs / keys.size());
+}
+
+void benchmarks()
+{
+  for (size_t count : {1000, 100000, 1000000})
+  {
+    std::vector<uint64_t> keys(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      keys[i] = lib::hashInteger(i) << 1;
+    }
+
+    os::print("%zu keys:\n", count);
+
+    benchmark<lib::FlatMap<uint64_t, uint64_t>>("lib::FlatMap", keys);
+    benchmark<std::unordered_map<uint64_t, uint64_t>>("std::unordered_map", keys);
+  }
+}
 
 int main()
 {
   lib::time::TimeSpan then = lib::time::TimeSpan::now();
   lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  randomizedTests();
+  benchmarks();
 
+  os::print("FlatMap tests finished in %fms\n", (lib::time::TimeSpan::now() - then).milliseconds());
 
+  lib::memory::SystemMemoryManager::finializeThread();
   lib::memory::SystemMemoryManager::shutdown();
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (TaggedGridTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(TaggedGridTests ${TEST_DIR}/TaggedGridTests.cpp)
+target_link_libraries(TaggedGridTests PRIVATE Engine)
+add_test(NAME TaggedGridTests COMMAND TaggedGridTests)
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "datastructure/BoundedTaggedRectTreap.hpp"
+#include "datastructure/TaggedGrid.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+using Grid = lib::TaggedGrid<uint32_t, uint64_t>;
+
+// Rectangles are inside the query, disjoint, and carry the tag of every cell they cover.
+void checkQuery(Grid &grid, const std::vector<uint32_t> &expected, uint64_t x1, uint64_t y1, uint64_t x2, uint64_t y2)
+{
+  std::vector<Grid::Rect> out;
+  grid.query(x1, y1, x2, y2, out);
+
+  std::vector<uint32_t> covered(expected.size(), 0);
+
+  for (const Grid::Rect &rect : out)
+  {
+    assert(rect.x1 <= rect.x2 && rect.y1 <= rect.y2);
+    assert(rect.x1 >= x1 && rect.x2 <= x2 && rect.y1 >= y1 && rect.y2 <= y2);
+
+    for (uint64_t x = rect.x1; x <= rect.x2; x++)
+    {
+      for (uint64_t y = rect.y1; y <= rect.y2; y++)
+      {
+        assert(expected[x * grid.getHeight() + y] == rect.tag);
+        covered[x * grid.getHeight() + y] += 1;
+      }
+    }
+  }
+
+  for (uint64_t x = x1; x <= x2; x++)
+  {
+    for (uint64_t y = y1; y <= y2; y++)
+    {
+      assert(covered[x * grid.getHeight() + y] == 1);
+    }
+  }
+}
+
+void singleThreadTests()
+{
+  Grid grid;
+  std::vector<Grid::Rect> out;
+
+  grid.reset(4, 6, 0);
+  assert(grid.isUniform());
+
+  grid.query(0, 0, 3, 5, out);
+  assert(out.size() == 1 && out[0].x2 == 3 && out[0].y2 == 5 && out[0].tag == 0);
+
+  // Queries are clipped to the grid.
+  grid.query(2, 4, 10, 10, out);
+  assert(out.size() == 1 && out[0].x1 == 2 && out[0].y1 == 4 && out[0].x2 == 3 && out[0].y2 == 5);
+
+  grid.query(4, 0, 10, 10, out);
+  assert(out.empty());
+
+  // One mip of every layer.
+  grid.assign(1, 0, 1, 5, 1);
+  assert(!grid.isUniform());
+
+  grid.query(0, 0, 3, 5, out);
+  assert(out.size() == 3);
+  assert(out[0].x1 == 0 && out[0].x2 == 0 && out[0].tag == 0);
+  assert(out[1].x1 == 1 && out[1].x2 == 1 && out[1].tag == 1);
+  assert(out[2].x1 == 2 && out[2].x2 == 3 && out[2].y1 == 0 && out[2].y2 == 5 && out[2].tag == 0);
+
+  // One layer of every mip splits each column in the same three runs, merged across mips.
+  grid.assign(0, 2, 3, 2, 2);
+  grid.query(0, 0, 3, 5, out);
+
+  size_t twos = 0;
+
+  for (const Grid::Rect &rect : out)
+  {
+    if (rect.tag == 2)
+    {
+      assert(rect.x1 == 0 && rect.x2 == 3 && rect.y1 == 2 && rect.y2 == 2);
+      twos++;
+    }
+  }
+
+  assert(twos == 1);
+
+  // Whole grid transitions go back to a single tag.
+  grid.assign(0, 0, 3, 5, 3);
+  assert(grid.isUniform());
+  grid.query(0, 0, 3, 5, out);
+  assert(out.size() == 1 && out[0].tag == 3);
+}
+
+void randomTests()
+{
+  std::mt19937 generator(5);
+
+  for (size_t round = 0; round < 200; round++)
+  {
+    Grid grid;
+
+    uint64_t width = 1 + generator() % 12;
+    uint64_t height = 1 + generator() % 12;
+    std::vector<uint32_t> expected(width * height, 0);
+
+    grid.reset(width, height, 0);
+
+    for (size_t i = 0; i < 100; i++)
+    {
+      uint64_t x1 = generator() % width;
+      uint64_t x2 = generator() % width;
+      uint64_t y1 = generator() % height;
+      uint64_t y2 = generator() % height;
+      uint32_t tag = generator() % 3;
+
+      if (i % 10 == 0)
+      {
+        x1 = 0, y1 = 0, x2 = width - 1, y2 = height - 1;
+      }
+
+      grid.assign(x1, y1, x2, y2, tag);
+
+      for (uint64_t x = std::min(x1, x2); x <= std::max(x1, x2); x++)
+      {
+        for (uint64_t y = std::min(y1, y2); y <= std::max(y1, y2); y++)
+        {
+          expected[x * height + y] = tag;
+        }
+      }
+
+      uint64_t qx = generator() % width;
+      uint64_t qy = generator() % height;
+
+      checkQuery(grid, expected, qx, qy, std::min(width - 1, qx + generator() % width), std::min(height - 1, qy + generator() % height));
+      checkQuery(grid, expected, 0, 0, width - 1, height - 1);
+    }
+  }
+}
+
+struct Access
+{
+  uint32_t access;
+  uint64_t consumer;
+
+  bool operator==(const Access &o) const
+  {
+    return access == o.access && consumer == o.consumer;
+  }
+
+  bool operator!=(const Access &o) const
+  {
+    return !(*this == o);
+  }
+};
+
+struct View
+{
+  uint64_t baseMip, mipCount, baseLayer, layerCount;
+  uint32_t access;
+};
+
+// Mip chain generation of every layer followed by whole resource reads, as a renderer does for cubemaps and arrays.
+std::vector<View> textureUsages(uint64_t mips, uint64_t layers)
+{
+  std::vector<View> views;
+
+  for (uint64_t layer = 0; layer < layers; layer++)
+  {
+    views.push_back(View{0, 1, layer, 1, 1});
+
+    for (uint64_t mip = 1; mip < mips; mip++)
+    {
+      views.push_back(View{mip - 1, 1, layer, 1, 2});
+      views.push_back(View{mip, 1, layer, 1, 1});
+    }
+  }
+
+  views.push_back(View{0, mips, 0, layers, 2});
+  views.push_back(View{0, mips, 0, layers, 1});
+  views.push_back(View{0, mips, 0, layers, 2});
+
+  return views;
+}
+
+// Replays the texture hazard tracking of RenderGraph::analyseDependencyGraph and counts the subresources transitioned.
+void benchmark(const char *label, uint64_t mips, uint64_t layers, size_t textures)
+{
+  std::vector<View> views = textureUsages(mips, layers);
+
+  size_t treapBarriers = 0;
+  size_t treapSubresources = 0;
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (size_t texture = 0; texture < textures; texture++)
+  {
+    std::vector<lib::BoundedTaggedRectTreap<Access, uint64_t>::Rect> out;
+    lib::BoundedTaggedRectTreap<Access, uint64_t> treap(views.size() * 4);
+
+    treap.insert(0, 0, mips - 1, layers - 1, Access{0, (uint64_t)-1});
+
+    for (size_t i = 0; i < views.size(); i++)
+    {
+      const View &view = views[i];
+      treap.queryAll(view.baseMip, view.baseLayer, view.baseMip + view.mipCount - 1, view.baseLayer + view.layerCount - 1, out);
+
+      for (const auto &rect : out)
+      {
+        treapBarriers++;
+        treapSubresources += (rect.x2 - rect.x1 + 1) * (rect.y2 - rect.y1 + 1);
+        treap.remove(rect.x1, rect.y1, rect.x2, rect.y2, rect.tag);
+        treap.insert(rect.x1, rect.y1, rect.x2, rect.y2, Access{view.access, i});
+      }
+    }
+  }
+
+  double treapNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  size_t gridBarriers = 0;
+  size_t gridSubresources = 0;
+
+  lib::TaggedGrid<Access, uint64_t> grid;
+  std::vector<lib::TaggedGrid<Access, uint64_t>::Rect> out;
+
+  then = lib::time::TimeSpan::now();
+
+  for (size_t texture = 0; texture < textures; texture++)
+  {
+    grid.reset(mips, layers, Access{0, (uint64_t)-1});
+
+    for (size_t i = 0; i < views.size(); i++)
+    {
+      const View &view = views[i];
+      grid.query(view.baseMip, view.baseLayer, view.baseMip + view.mipCount - 1, view.baseLayer + view.layerCount - 1, out);
+
+      for (const auto &rect : out)
+      {
+        gridBarriers++;
+        gridSubresources += (rect.x2 - rect.x1 + 1) * (rect.y2 - rect.y1 + 1);
+        grid.assign(rect.x1, rect.y1, rect.x2, rect.y2, Access{view.access, i});
+      }
+    }
+  }
+
+  double gridNs = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  // Both transition every subresource the same number of times.
+  assert(treapSubresources == gridSubresources);
+
+  os::print("%zu %s textures (%llu mips x %llu layers): rect treap %fms (%zu barriers), tagged grid %fms (%zu barriers)\n", textures, label, (unsigned long long)mips,
+            (unsigned long long)layers, treapNs / 1e6, treapBarriers, gridNs / 1e6, gridBarriers);
+}
+
+void benchmarks()
+{
+  benchmark("cubemap", 11, 6, 64);
+  benchmark("array", 12, 64, 8);
+  benchmark("2d", 13, 1, 256);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  randomTests();
+  benchmarks();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (AliasingPlannerTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(AliasingPlannerTests ${TEST_DIR}/AliasingPlannerTests.cpp)
+target_link_libraries(AliasingPlannerTests PRIVATE Engine)
+add_test(NAME AliasingPlannerTests COMMAND AliasingPlannerTests)
@@ -0,0 +1,163 @@
+#include "memory/AliasingPlanner.hpp"
+#include "memory/SystemMemoryManager.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+using namespace lib::memory;
+
+struct Allocation
+{
+  uint64_t size;
+  uint64_t alignment;
+  uint64_t firstUse;
+  uint64_t lastUse;
+};
+
+// Checks that allocations alive at the same time never share bytes, that every offset is aligned and that the plan
+// is never smaller than the lower bound.
+void validate(const AliasingPlanner &planner, const std::vector<Allocation> &allocations)
+{
+  for (uint32_t i = 0; i < allocations.size(); i++)
+  {
+    assert(planner.offsetOf(i) % allocations[i].alignment == 0);
+    assert(planner.offsetOf(i) + allocations[i].size <= planner.size());
+
+    for (uint32_t j = i + 1; j < allocations.size(); j++)
+    {
+      bool together = allocations[i].firstUse <= allocations[j].lastUse && allocations[j].firstUse <= allocations[i].lastUse;
+      bool shared = planner.offsetOf(i) < planner.offsetOf(j) + allocations[j].size && planner.offsetOf(j) < planner.offsetOf(i) + allocations[i].size;
+
+      assert(!(together && shared));
+    }
+  }
+
+  assert(planner.size() >= planner.lowerBound());
+}
+
+void plan(AliasingPlanner &planner, const std::vector<Allocation> &allocations)
+{
+  planner.clear();
+
+  for (const Allocation &allocation : allocations)
+  {
+    planner.request(allocation.size, allocation.alignment, allocation.firstUse, allocation.lastUse);
+  }
+
+  planner.plan();
+  validate(planner, allocations);
+}
+
+void basicTests()
+{
+  AliasingPlanner planner;
+
+  plan(planner, {});
+  assert(planner.size() == 0 && planner.lowerBound() == 0);
+
+  // Never alive together, everything starts at zero.
+  plan(planner, {{256, 16, 0, 0}, {64, 16, 1, 1}, {128, 16, 2, 3}});
+  assert(planner.size() == 256 && planner.lowerBound() == 256);
+  assert(planner.offsetOf(0) == 0 && planner.offsetOf(1) == 0 && planner.offsetOf(2) == 0);
+
+  // Always alive together, laid out back to back with alignment.
+  plan(planner, {{100, 16, 0, 4}, {100, 16, 0, 4}, {100, 16, 0, 4}});
+  assert(planner.lowerBound() == 300);
+  assert(planner.size() == 324);
+
+  // Lifetimes are inclusive, sharing a level means sharing the time.
+  plan(planner, {{64, 16, 0, 1}, {64, 16, 1, 2}});
+  assert(planner.size() == 128 && planner.lowerBound() == 128);
+}
+
+void largeEarlyAllocationTests()
+{
+  AliasingPlanner planner;
+
+  // A large allocation early on should not widen the space of the small ones that come after it. Every level has
+  // 1024 bytes alive, so the plan must fit in 1024 bytes.
+  std::vector<Allocation> allocations = {
+    {1024, 16, 0, 0},
+    {512, 16, 1, 2},
+    {256, 16, 1, 1},
+    {256, 16, 1, 3},
+    {256, 16, 2, 2},
+    {512, 16, 3, 3},
+  };
+
+  plan(planner, allocations);
+  assert(planner.lowerBound() == 1024);
+  assert(planner.size() == 1024);
+
+  // Best fit takes the tightest gap, the last allocation goes in the 256 byte hole left by the third one instead of
+  // the 512 byte hole left by the first.
+  allocations = {
+    {512, 16, 0, 0},
+    {256, 16, 0, 2},
+    {256, 16, 0, 0},
+    {128, 16, 0, 2},
+    {128, 16, 1, 2},
+  };
+
+  plan(planner, allocations);
+  assert(planner.offsetOf(4) == 768);
+  assert(planner.size() == 1152);
+}
+
+void randomTests()
+{
+  AliasingPlanner planner;
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+
+  auto next = [&state]()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  };
+
+  uint64_t planned = 0;
+  uint64_t bound = 0;
+
+  for (uint32_t round = 0; round < 200; round++)
+  {
+    std::vector<Allocation> allocations;
+    uint32_t count = 1 + next() % 64;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      uint64_t firstUse = next() % 32;
+
+      allocations.push_back(Allocation{
+        .size = 1 + next() % 4096,
+        .alignment = uint64_t(1) << (next() % 9),
+        .firstUse = firstUse,
+        .lastUse = firstUse + next() % 8,
+      });
+    }
+
+    plan(planner, allocations);
+
+    planned += planner.size();
+    bound += planner.lowerBound();
+  }
+
+  os::print("AliasingPlanner: random plans use %.2f%% of their lower bound\n", 100.0 * planned / bound);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  basicTests();
+  largeEarlyAllocationTests();
+  randomTests();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
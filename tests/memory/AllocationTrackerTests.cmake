@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (AllocationTrackerTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(AllocationTrackerTests ${TEST_DIR}/AllocationTrackerTests.cpp)
+target_link_libraries(AllocationTrackerTests PRIVATE Engine)
+add_test(NAME AllocationTrackerTests COMMAND AllocationTrackerTests)
@@ -0,0 +1,272 @@
+#include "memory/AllocationTracker.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Logger.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using lib::memory::AllocationTagScope;
+using lib::memory::AllocationTracker;
+using lib::memory::SystemMemoryManager;
+
+AllocationTracker::TagSnapshot find(const AllocationTracker::Snapshot &snapshot, uint16_t tag)
+{
+  for (const AllocationTracker::TagSnapshot &entry : snapshot.tags)
+  {
+    if (entry.tag == tag)
+    {
+      return entry;
+    }
+  }
+
+  return AllocationTracker::TagSnapshot{};
+}
+
+void tagTests()
+{
+  uint16_t a = AllocationTracker::registerTag("tests a");
+  uint16_t b = AllocationTracker::registerTag("tests b");
+
+  assert(a != AllocationTracker::UNTAGGED && a != b);
+  assert(AllocationTracker::registerTag("tests a") == a);
+  assert(AllocationTracker::currentTag() == AllocationTracker::UNTAGGED);
+
+  {
+    AllocationTagScope outer(a);
+    assert(AllocationTracker::currentTag() == a);
+
+    {
+      AllocationTagScope inner(b);
+      assert(AllocationTracker::currentTag() == b);
+    }
+
+    assert(AllocationTracker::currentTag() == a);
+  }
+
+  assert(AllocationTracker::currentTag() == AllocationTracker::UNTAGGED);
+}
+
+void countingTests()
+{
+  uint16_t tag = AllocationTracker::registerTag("tests counting");
+
+  std::vector<void *> blocks;
+  blocks.reserve(128);
+
+  {
+    AllocationTagScope scope(tag);
+
+    for (size_t i = 0; i < 100; i++)
+    {
+      blocks.push_back(SystemMemoryManager::malloc(100));
+    }
+
+    for (size_t alignment = 8; alignment <= 4096; alignment *= 2)
+    {
+      void *ptr = SystemMemoryManager::alignedAlloc(alignment, 100);
+      assert(((uintptr_t)ptr % alignment) == 0);
+      blocks.push_back(ptr);
+    }
+  }
+
+  AllocationTracker::TagSnapshot entry = find(AllocationTracker::snapshot(), tag);
+
+  assert(entry.allocations == blocks.size());
+  assert(entry.liveAllocations == (int64_t)blocks.size());
+  assert(entry.liveBytes == (int64_t)blocks.size() * 100);
+  assert(entry.histogram[3] == blocks.size());
+  assert(entry.peakBytes >= entry.liveBytes);
+
+  // Frees are charged to the tag of the allocation, not of the freeing scope.
+  for (void *ptr : blocks)
+  {
+    SystemMemoryManager::free(ptr);
+  }
+
+  entry = find(AllocationTracker::snapshot(), tag);
+
+  assert(entry.liveAllocations == 0);
+  assert(entry.liveBytes == 0);
+  assert(entry.peakBytes == (int64_t)blocks.size() * 100);
+
+  uint16_t external = AllocationTracker::registerTag("tests external");
+
+  AllocationTracker::recordExternal(external, 1 << 20);
+  assert(find(AllocationTracker::snapshot(), external).liveBytes == 1 << 20);
+  AllocationTracker::releaseExternal(external, 1 << 20);
+  assert(find(AllocationTracker::snapshot(), external).liveBytes == 0);
+}
+
+// Every thread allocates into its own shard and frees what the next thread allocated.
+void multiThreadTests()
+{
+  size_t totalThreads = os::Thread::getHardwareConcurrency() < 2 ? 2 : os::Thread::getHardwareConcurrency();
+  const size_t perThread = 10000;
+
+  os::Thread threads[totalThreads];
+
+  uint16_t tag = AllocationTracker::registerTag("tests threads");
+
+  std::vector<std::vector<void *>> blocks(totalThreads, std::vector<void *>(perThread));
+  std::atomic<size_t> allocated(0);
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          SystemMemoryManager::initializeThread();
+
+          {
+            AllocationTagScope scope(tag);
+
+            for (size_t j = 0; j < perThread; j++)
+            {
+              blocks[i][j] = SystemMemoryManager::malloc(64);
+            }
+          }
+
+          allocated.fetch_add(1);
+          while (allocated.load() != totalThreads)
+          {
+          }
+
+          for (void *ptr : blocks[(i + 1) % totalThreads])
+          {
+            SystemMemoryManager::free(ptr);
+          }
+
+          SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  AllocationTracker::TagSnapshot entry = find(AllocationTracker::snapshot(), tag);
+
+  assert(entry.allocations == totalThreads * perThread);
+  assert(entry.liveAllocations == 0);
+  assert(entry.liveBytes == 0);
+  assert(entry.peakBytes >= (int64_t)(perThread * 64));
+}
+
+// Allocates from a thread local destructor that runs after the tracker handed the shard of the thread back.
+struct LateAllocation
+{
+  uint16_t tag = AllocationTracker::UNTAGGED;
+
+  ~LateAllocation()
+  {
+    AllocationTagScope scope(tag);
+    SystemMemoryManager::free(SystemMemoryManager::malloc(100));
+  }
+};
+
+thread_local LateAllocation lateAllocation;
+
+// Exiting threads keep counting, and the shard taken by a late allocation is handed back for the next thread.
+void threadExitTests()
+{
+  uint16_t tag = AllocationTracker::registerTag("tests thread exit");
+  const size_t totalThreads = 4;
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    os::Thread thread(
+        [tag]()
+        {
+          // Constructed before the first tracked allocation of the thread, so it is destroyed after the shard release.
+          lateAllocation.tag = tag;
+          SystemMemoryManager::free(SystemMemoryManager::malloc(100));
+        });
+
+    thread.join();
+  }
+
+  AllocationTracker::TagSnapshot entry = find(AllocationTracker::snapshot(), tag);
+
+  assert(entry.allocations == totalThreads);
+  assert(entry.liveAllocations == 0);
+  assert(entry.liveBytes == 0);
+}
+
+void logTests()
+{
+  os::Logger::start();
+
+  AllocationTracker::Snapshot previous = AllocationTracker::snapshot();
+  AllocationTracker::log(AllocationTracker::snapshot(), &previous);
+
+  AllocationTracker::startPeriodicLog(lib::time::TimeSpan::fromMilliseconds(10));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  AllocationTracker::stopPeriodicLog();
+
+  os::Logger::shutdown();
+}
+
+// Compares the bookkeeping done on every allocation to the allocation itself.
+void benchmark()
+{
+  const size_t operations = 1000000;
+
+  uint16_t tag = AllocationTracker::registerTag("tests benchmark");
+  AllocationTagScope scope(tag);
+
+  alignas(16) static char buffer[AllocationTracker::HEADER_SIZE + 64];
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < operations; i++)
+  {
+    SystemMemoryManager::free(SystemMemoryManager::malloc(64));
+  }
+
+  double allocation = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  then = lib::time::TimeSpan::now();
+
+  for (size_t i = 0; i < operations; i++)
+  {
+    AllocationTracker::untrack(AllocationTracker::track(buffer, 64, AllocationTracker::HEADER_SIZE));
+  }
+
+  double tracking = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  os::print("SystemMemoryManager (%s, tracking %s): %fns per malloc/free\n", SystemMemoryManager::backend(), AllocationTracker::enabled() ? "on" : "off", allocation / operations);
+  os::print("AllocationTracker: %fns per track/untrack\n", tracking / operations);
+}
+
+int main()
+{
+  SystemMemoryManager::init();
+  SystemMemoryManager::initializeThread();
+
+  tagTests();
+
+  if (AllocationTracker::enabled())
+  {
+    countingTests();
+    multiThreadTests();
+    threadExitTests();
+  }
+
+  logTests();
+  benchmark();
+
+  SystemMemoryManager::finializeThread();
+  SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (ConcurrentBoundedHeapTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(ConcurrentBoundedHeapTests ${TEST_DIR}/ConcurrentBoundedHeapTests.cpp)
+target_link_libraries(ConcurrentBoundedHeapTests PRIVATE Engine)
+add_test(NAME ConcurrentBoundedHeapTests COMMAND ConcurrentBoundedHeapTests)
@@ -0,0 +1,231 @@
+#include "memory/ConcurrentBoundedHeap.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/ConcurrentBoundedHeapAllocator.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+void singleThreadTests()
+{
+  lib::memory::ConcurrentBoundedHeap heap(1 << 20, 2);
+
+  assert(heap.arenaCount() == 2);
+
+  std::vector<void *> blocks;
+
+  for (size_t size = 1; size <= 4096; size *= 2)
+  {
+    void *ptr = heap.allocate(size);
+    assert(ptr != nullptr);
+    memset(ptr, 0xff, size);
+    blocks.push_back(ptr);
+  }
+
+  lib::memory::ConcurrentBoundedHeap::Diagnostics diagnostics = heap.diagnostics();
+  assert(diagnostics.allocated > 0);
+  assert(diagnostics.peakRequestSize == 4096);
+  assert(diagnostics.oomCount == 0);
+
+  for (void *ptr : blocks)
+  {
+    heap.free(ptr);
+  }
+
+  heap.free(nullptr);
+
+  diagnostics = heap.diagnostics();
+  assert(diagnostics.allocated == 0);
+  assert(diagnostics.peakAllocated > 0);
+
+  // Larger than an arena, the other arena is never borrowed.
+  assert(heap.allocate(1 << 20) == nullptr);
+  assert(heap.diagnostics().oomCount == 1);
+
+  std::vector<uint32_t, lib::memory::allocator::ConcurrentBoundedHeapAllocator<uint32_t>> values(&heap);
+
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    values.push_back(i);
+  }
+
+  assert(values[999] == 999);
+
+  // Arenas too small to hold an o1heap instance fail the constructor, which frees what it allocated.
+  bool thrown = false;
+
+  try
+  {
+    lib::memory::ConcurrentBoundedHeap small(256, 4);
+  }
+  catch (const std::bad_alloc &)
+  {
+    thrown = true;
+  }
+
+  assert(thrown);
+}
+
+// Blocks allocated by one thread and freed by another go back to the owning arena.
+void remoteFreeTests()
+{
+  size_t totalThreads = std::max<size_t>(2, os::Thread::getHardwareConcurrency());
+  const size_t perThread = 1000;
+
+  os::Thread threads[totalThreads];
+
+  lib::memory::ConcurrentBoundedHeap heap(totalThreads * (1 << 20), totalThreads);
+
+  std::vector<std::vector<uint64_t *>> blocks(totalThreads);
+  std::atomic<size_t> can_start(0);
+  std::atomic<size_t> allocated(0);
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          can_start.fetch_add(1);
+          while (can_start.load() != totalThreads)
+          {
+          }
+
+          for (size_t j = 0; j < perThread; j++)
+          {
+            uint64_t *ptr = static_cast<uint64_t *>(heap.allocate(sizeof(uint64_t) * (1 + j % 16)));
+            assert(ptr != nullptr);
+            *ptr = i * perThread + j;
+            blocks[i].push_back(ptr);
+          }
+
+          allocated.fetch_add(1);
+          while (allocated.load() != totalThreads)
+          {
+          }
+
+          // Free everything the next thread allocated.
+          std::vector<uint64_t *> &remote = blocks[(i + 1) % totalThreads];
+
+          for (size_t j = 0; j < remote.size(); j++)
+          {
+            assert(*remote[j] == ((i + 1) % totalThreads) * perThread + j);
+            heap.free(remote[j]);
+          }
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  // Remote frees stay pending until the owning arena allocates again or is reclaimed.
+  for (size_t i = 0; i < heap.arenaCount(); i++)
+  {
+    assert(heap.diagnostics(i).allocated > 0);
+  }
+
+  heap.reclaim();
+
+  lib::memory::ConcurrentBoundedHeap::Diagnostics diagnostics = heap.diagnostics();
+
+  assert(diagnostics.allocated == 0);
+  assert(diagnostics.remoteFrees == totalThreads * perThread);
+  assert(diagnostics.oomCount == 0);
+}
+
+struct Latency
+{
+  double average;
+  double p999;
+  double worst;
+};
+
+template <typename Allocate, typename Free> Latency measure(Allocate allocate, Free free)
+{
+  const size_t operations = 200000;
+  const size_t live = 256;
+
+  std::vector<void *> slots(live, nullptr);
+  std::vector<double> samples;
+  samples.reserve(operations);
+
+  uint32_t seed = 7;
+
+  for (size_t i = 0; i < operations; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+
+    size_t slot = seed % live;
+    size_t size = 16 + (seed >> 16) % 2048;
+
+    lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+    if (slots[slot])
+    {
+      free(slots[slot]);
+    }
+
+    slots[slot] = allocate(size);
+
+    samples.push_back((lib::time::TimeSpan::now() - then).nanoseconds());
+  }
+
+  for (void *ptr : slots)
+  {
+    free(ptr);
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  double total = 0;
+
+  for (double sample : samples)
+  {
+    total += sample;
+  }
+
+  return Latency{total / samples.size(), samples[samples.size() * 999 / 1000], samples.back()};
+}
+
+// The o1heap arena bounds the worst case, malloc may fall back to the system on any call.
+void benchmark()
+{
+  lib::memory::ConcurrentBoundedHeap heap(8 << 20, 1);
+
+  Latency system = measure([](size_t size) { return lib::memory::SystemMemoryManager::malloc(size); }, [](void *ptr) { lib::memory::SystemMemoryManager::free(ptr); });
+  Latency bounded = measure([&](size_t size) { return heap.allocate(size); }, [&](void *ptr) { heap.free(ptr); });
+
+  assert(heap.diagnostics().oomCount == 0);
+
+  os::print("SystemMemoryManager (%s): average %fns, p99.9 %fns, worst %fns\n", lib::memory::SystemMemoryManager::backend(), system.average, system.p999, system.worst);
+  os::print("ConcurrentBoundedHeap: average %fns, p99.9 %fns, worst %fns\n", bounded.average, bounded.p999, bounded.worst);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  remoteFreeTests();
+  benchmark();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
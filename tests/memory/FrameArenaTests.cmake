@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (FrameArenaTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(FrameArenaTests ${TEST_DIR}/FrameArenaTests.cpp)
+target_link_libraries(FrameArenaTests PRIVATE Engine)
+add_test(NAME FrameArenaTests COMMAND FrameArenaTests)
@@ -0,0 +1,216 @@
+#include "memory/FrameArena.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/FrameArenaAllocator.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+template <typename T> using FrameVector = std::vector<T, lib::memory::allocator::FrameArenaAllocator<T>>;
+
+struct DrawArgs
+{
+  uint32_t vertexCount, instanceCount, firstVertex, firstInstance;
+};
+
+struct Tracked
+{
+  static std::atomic<int> alive;
+
+  std::string name;
+
+  Tracked(const char *name) : name(name)
+  {
+    alive++;
+  }
+
+  ~Tracked()
+  {
+    alive--;
+  }
+};
+
+std::atomic<int> Tracked::alive(0);
+
+void singleThreadTests()
+{
+  lib::memory::FrameArena arena(1024);
+
+  for (size_t alignment = 1; alignment <= 256; alignment *= 2)
+  {
+    void *ptr = arena.allocate(3, alignment);
+    assert(((uintptr_t)ptr % alignment) == 0);
+  }
+
+  // Larger than a chunk.
+  char *large = static_cast<char *>(arena.allocate(4096));
+  large[4095] = 1;
+
+  DrawArgs *args = arena.create<DrawArgs>(DrawArgs{3, 1, 0, 0});
+  assert(args->vertexCount == 3);
+
+  uint32_t offsets[] = {1, 2, 3};
+  uint32_t *copied = arena.copy(offsets, 3);
+  assert(copied != offsets && copied[2] == 3);
+  assert(arena.copy(offsets, 0) == nullptr);
+
+  arena.create<Tracked>("a render pass name that does not fit in the small string buffer");
+  arena.create<Tracked>("b");
+  assert(Tracked::alive == 2);
+
+  arena.reset();
+
+  assert(Tracked::alive == 0);
+  assert(arena.bytesAllocated() == 0);
+
+  arena.create<Tracked>("c");
+}
+
+// Once every chunk a frame needs exists, later frames never reach the system allocator.
+void steadyStateTests()
+{
+  lib::memory::FrameArena arena;
+
+  uint64_t allocations = 0;
+  size_t chunks = 0;
+
+  for (uint32_t frame = 0; frame < 64; frame++)
+  {
+    if (frame == 2)
+    {
+      allocations = lib::memory::SystemMemoryManager::threadAllocationCount();
+      chunks = arena.chunkCount();
+    }
+
+    FrameVector<DrawArgs *> commands(&arena);
+
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+      commands.push_back(arena.create<DrawArgs>(DrawArgs{i, 1, 0, 0}));
+    }
+
+    for (uint32_t i = 0; i < commands.size(); i++)
+    {
+      assert(commands[i]->vertexCount == i);
+    }
+
+    commands = FrameVector<DrawArgs *>();
+    arena.reset();
+  }
+
+  assert(arena.chunkCount() == chunks);
+  assert(lib::memory::SystemMemoryManager::threadAllocationCount() == allocations);
+}
+
+// Every thread records into its own chunks, nothing is shared until reset.
+void multiThreadTests()
+{
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  lib::memory::FrameArena arena(4096);
+
+  for (uint32_t frame = 0; frame < 8; frame++)
+  {
+    std::atomic<int> can_start(0);
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      threads[i] = os::Thread(
+          [&, i]()
+          {
+            lib::memory::SystemMemoryManager::initializeThread();
+
+            can_start.fetch_add(1);
+            while (can_start.load() != totalThreads)
+            {
+            }
+
+            std::vector<DrawArgs *> recorded;
+
+            for (uint32_t j = 0; j < 10000; j++)
+            {
+              recorded.push_back(arena.create<DrawArgs>(DrawArgs{(uint32_t)i, j, frame, 0}));
+            }
+
+            for (uint32_t j = 0; j < recorded.size(); j++)
+            {
+              assert(recorded[j]->vertexCount == i && recorded[j]->instanceCount == j && recorded[j]->firstVertex == frame);
+            }
+
+            lib::memory::SystemMemoryManager::finializeThread();
+          });
+    }
+
+    for (size_t i = 0; i < totalThreads; i++)
+    {
+      if (threads[i].isRunning())
+      {
+        threads[i].join();
+      }
+    }
+
+    assert(arena.bytesAllocated() == totalThreads * 10000 * sizeof(DrawArgs));
+    arena.reset();
+  }
+}
+
+void benchmark()
+{
+  const size_t operations = 1000000;
+
+  std::vector<DrawArgs *> recorded(operations);
+
+  lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+  for (uint32_t i = 0; i < operations; i++)
+  {
+    recorded[i] = new DrawArgs{i, 1, 0, 0};
+  }
+
+  for (uint32_t i = 0; i < operations; i++)
+  {
+    delete recorded[i];
+  }
+
+  double heap = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  lib::memory::FrameArena arena;
+
+  for (uint32_t frame = 0; frame < 2; frame++)
+  {
+    then = lib::time::TimeSpan::now();
+
+    for (uint32_t i = 0; i < operations; i++)
+    {
+      recorded[i] = arena.create<DrawArgs>(DrawArgs{i, 1, 0, 0});
+    }
+
+    arena.reset();
+  }
+
+  double linear = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+  os::print("new/delete: average time per argument is %fns\n", heap / operations);
+  os::print("FrameArena: average time per argument is %fns\n", linear / operations);
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  steadyStateTests();
+  multiThreadTests();
+  benchmark();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
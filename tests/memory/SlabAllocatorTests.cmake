@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (SlabAllocatorTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(SlabAllocatorTests ${TEST_DIR}/SlabAllocatorTests.cpp)
+target_link_libraries(SlabAllocatorTests PRIVATE Engine)
+add_test(NAME SlabAllocatorTests COMMAND SlabAllocatorTests)
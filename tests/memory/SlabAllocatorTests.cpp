@@ -0,0 +1,187 @@
+#include "memory/SlabMemoryManager.hpp"
+#include "memory/SystemMemoryManager.hpp"
+#include "memory/allocator/SlabAllocator.hpp"
+#include "memory/allocator/SystemAllocator.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+struct Node
+{
+  uint64_t key;
+  uint64_t value;
+  Node *next;
+};
+
+void singleThreadTests()
+{
+  std::vector<void *> blocks;
+
+  for (size_t size = 1; size <= 2 * lib::memory::SlabMemoryManager::MAX_BLOCK_SIZE; size += 7)
+  {
+    void *ptr = lib::memory::SlabMemoryManager::malloc(size);
+    assert(ptr != nullptr);
+    assert(((uintptr_t)ptr % 16) == 0);
+    memset(ptr, 0xab, size);
+    lib::memory::SlabMemoryManager::free(ptr, size);
+  }
+
+  lib::memory::allocator::SlabAllocator<Node> allocator;
+
+  for (size_t i = 0; i < 100000; i++)
+  {
+    Node *node = allocator.allocate(1);
+    node->key = i;
+    blocks.push_back(node);
+  }
+
+  size_t slabs = lib::memory::SlabMemoryManager::slabCount();
+
+  for (void *block : blocks)
+  {
+    allocator.deallocate((Node *)block);
+  }
+
+  // Freed blocks are reused before new slabs are carved.
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    blocks[i] = allocator.allocate(1);
+  }
+
+  assert(lib::memory::SlabMemoryManager::slabCount() == slabs);
+
+  for (void *block : blocks)
+  {
+    allocator.deallocate((Node *)block);
+  }
+}
+
+// Blocks allocated by one thread and freed by another go through the remote free list of the owner.
+void remoteFreeTests()
+{
+  const size_t count = 100000;
+
+  std::vector<Node *> blocks(count);
+  lib::memory::allocator::SlabAllocator<Node> allocator;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    blocks[i] = allocator.allocate(1);
+    blocks[i]->key = i;
+  }
+
+  os::Thread thread(
+      [&]()
+      {
+        lib::memory::SystemMemoryManager::initializeThread();
+
+        lib::memory::allocator::SlabAllocator<Node> remote;
+
+        for (size_t i = 0; i < count; i++)
+        {
+          assert(blocks[i]->key == i);
+          remote.deallocate(blocks[i]);
+        }
+
+        lib::memory::SystemMemoryManager::finializeThread();
+      });
+
+  thread.join();
+
+  size_t slabs = lib::memory::SlabMemoryManager::slabCount();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    blocks[i] = allocator.allocate(1);
+  }
+
+  assert(lib::memory::SlabMemoryManager::slabCount() == slabs);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    allocator.deallocate(blocks[i]);
+  }
+}
+
+template <typename Allocator> void benchmark(const char *name)
+{
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  std::atomic<int> can_start(0);
+
+  const size_t operations = 100000;
+  const size_t live = 256;
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          Allocator allocator;
+          Node *window[live] = {};
+
+          can_start.fetch_add(1);
+          while (can_start.load() != totalThreads)
+          {
+          }
+
+          lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+          for (size_t j = 0; j < operations; j++)
+          {
+            Node *&slot = window[j % live];
+
+            if (slot)
+            {
+              allocator.deallocate(slot, 1);
+            }
+
+            slot = allocator.allocate(1);
+            slot->key = j;
+          }
+
+          double ns = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+          for (size_t j = 0; j < live; j++)
+          {
+            allocator.deallocate(window[j], 1);
+          }
+
+          os::print("%s: thread %u average allocate + deallocate time is %fns\n", name, os::Thread::getCurrentThreadId(), ns / operations);
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  singleThreadTests();
+  remoteFreeTests();
+
+  benchmark<lib::memory::allocator::SystemAllocator<Node>>("SystemAllocator");
+  benchmark<lib::memory::allocator::SlabAllocator<Node>>("SlabAllocator");
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
@@ -0,0 +1,8 @@
+cmake_minimum_required(VERSION 3.10)
+
+project (SystemMemoryManagerTests)
+get_filename_component(TEST_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+
+add_executable(SystemMemoryManagerTests ${TEST_DIR}/SystemMemoryManagerTests.cpp)
+target_link_libraries(SystemMemoryManagerTests PRIVATE Engine)
+add_test(NAME SystemMemoryManagerTests COMMAND SystemMemoryManagerTests)
@@ -0,0 +1,168 @@
+#include "memory/SystemMemoryManager.hpp"
+#include "os/Thread.hpp"
+#include "time/TimeSpan.hpp"
+
+#include "os/print.hpp"
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct alignas(64) CacheLine
+{
+  uint64_t data[8];
+};
+
+void alignmentTests()
+{
+  for (size_t alignment = 16; alignment <= 4096; alignment *= 2)
+  {
+    void *ptr = lib::memory::SystemMemoryManager::allignedMalloc(alignment * 3, alignment, 0);
+    assert(ptr != nullptr);
+    assert(((uintptr_t)ptr % alignment) == 0);
+    memset(ptr, 0xab, alignment * 3);
+    lib::memory::SystemMemoryManager::free(ptr);
+
+    ptr = lib::memory::SystemMemoryManager::alignedAlloc(alignment, alignment);
+    assert(ptr != nullptr);
+    assert(((uintptr_t)ptr % alignment) == 0);
+    lib::memory::SystemMemoryManager::free(ptr);
+  }
+
+  CacheLine *line = new CacheLine();
+  assert(((uintptr_t)line % alignof(CacheLine)) == 0);
+  delete line;
+
+  CacheLine *lines = new CacheLine[7];
+  assert(((uintptr_t)lines % alignof(CacheLine)) == 0);
+  delete[] lines;
+}
+
+// Memory allocated by one thread and released by another, the common pattern for jobs and their payloads.
+void crossThreadTests()
+{
+  const size_t count = 100000;
+
+  std::vector<uint64_t *> blocks(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    blocks[i] = (uint64_t *)lib::memory::SystemMemoryManager::malloc(sizeof(uint64_t) * (1 + i % 32));
+    blocks[i][0] = i;
+  }
+
+  os::Thread thread(
+      [&]()
+      {
+        lib::memory::SystemMemoryManager::initializeThread();
+
+        for (size_t i = 0; i < count; i++)
+        {
+          assert(blocks[i][0] == i);
+          lib::memory::SystemMemoryManager::free(blocks[i]);
+        }
+
+        lib::memory::SystemMemoryManager::finializeThread();
+      });
+
+  thread.join();
+}
+
+// Every thread keeps a window of live allocations of mixed sizes, half of the frees are done by the next thread.
+void benchmark()
+{
+  size_t totalThreads = os::Thread::getHardwareConcurrency();
+  os::Thread threads[totalThreads];
+
+  const size_t operations = 200000;
+  const size_t live = 512;
+  const size_t sizes[] = {16, 24, 32, 48, 64, 96, 128, 256, 512, 1024, 4096, 16384};
+
+  std::vector<std::atomic<void *>> handoff(totalThreads * live);
+
+  for (auto &slot : handoff)
+  {
+    slot.store(nullptr);
+  }
+
+  std::atomic<size_t> can_start(0);
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    threads[i] = os::Thread(
+        [&, i]()
+        {
+          lib::memory::SystemMemoryManager::initializeThread();
+
+          void *window[live] = {};
+          std::atomic<void *> *outgoing = &handoff[i * live];
+          std::atomic<void *> *incoming = &handoff[((i + 1) % totalThreads) * live];
+
+          can_start.fetch_add(1);
+          while (can_start.load() != totalThreads)
+          {
+          }
+
+          lib::time::TimeSpan then = lib::time::TimeSpan::now();
+
+          for (size_t j = 0; j < operations; j++)
+          {
+            size_t size = sizes[(j * 7 + i) % (sizeof(sizes) / sizeof(sizes[0]))];
+
+            if (j & 1)
+            {
+              void *&slot = window[j % live];
+              lib::memory::SystemMemoryManager::free(slot);
+              slot = lib::memory::SystemMemoryManager::malloc(size);
+              *(uint64_t *)slot = j;
+            }
+            else
+            {
+              lib::memory::SystemMemoryManager::free(incoming[j % live].exchange(nullptr));
+              void *ptr = lib::memory::SystemMemoryManager::malloc(size);
+              *(uint64_t *)ptr = j;
+              lib::memory::SystemMemoryManager::free(outgoing[j % live].exchange(ptr));
+            }
+          }
+
+          double ns = (lib::time::TimeSpan::now() - then).nanoseconds();
+
+          for (size_t j = 0; j < live; j++)
+          {
+            lib::memory::SystemMemoryManager::free(window[j]);
+          }
+
+          os::print("%s: thread %u average allocate + deallocate time is %fns\n", lib::memory::SystemMemoryManager::backend(), os::Thread::getCurrentThreadId(), ns / operations);
+
+          lib::memory::SystemMemoryManager::finializeThread();
+        });
+  }
+
+  for (size_t i = 0; i < totalThreads; i++)
+  {
+    if (threads[i].isRunning())
+    {
+      threads[i].join();
+    }
+  }
+
+  for (auto &slot : handoff)
+  {
+    lib::memory::SystemMemoryManager::free(slot.load());
+  }
+}
+
+int main()
+{
+  lib::memory::SystemMemoryManager::init();
+  lib::memory::SystemMemoryManager::initializeThread();
+
+  alignmentTests();
+  crossThreadTests();
+  benchmark();
+
+  lib::memory::SystemMemoryManager::finializeThread();
+  lib::memory::SystemMemoryManager::shutdown();
+  return 0;
+}
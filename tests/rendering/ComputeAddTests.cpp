@@ -146,7 +146,7 @@ int main()
         .shader = addShader,
       });
 
-  RHICommandBuffer commandBuffer;
+  RHICommandBuffer commandBuffer(renderGraph);
   auto timer = renderGraph->createTimer(
       TimerInfo{
         .name = "timer",
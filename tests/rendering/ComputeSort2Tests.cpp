@@ -470,7 +470,7 @@ int main()
   auto sortScatterTimer = renderGraph->createTimer(TimerInfo{.name = "sortScatterTimer", .unit = TimerUnit::Miliseconds});
   auto totalTimer = renderGraph->createTimer(TimerInfo{.name = "totalTimer", .unit = TimerUnit::Miliseconds});
 
-  RHICommandBuffer commandBuffer;
+  RHICommandBuffer commandBuffer(renderGraph);
 
   bool finalResultInA = (numPasses % 2 == 0);
 
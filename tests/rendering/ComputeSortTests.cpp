@@ -361,7 +361,7 @@ int main()
         .shader = radixSortShader,
       });
 
-  RHICommandBuffer commandBuffer;
+  RHICommandBuffer commandBuffer(renderGraph);
 
   auto zeroHistogramTimer = renderGraph->createTimer(
       TimerInfo{
@@ -172,7 +172,7 @@ int main()
 
     renderPass.depthStencilAttachment = &depthStencilAttatchment;
 
-    RHICommandBuffer commandBuffer;
+    RHICommandBuffer commandBuffer(renderGraph);
     commandBuffer.cmdBindGraphicsPipeline(graphicsPipeline);
     commandBuffer.cmdBeginRenderPass(renderPass);
     commandBuffer.cmdBindVertexBuffer(